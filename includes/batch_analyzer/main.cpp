@@ -0,0 +1,656 @@
+// Project includes
+#include "../signal_proc_lib/time_signal.h"
+#include "../signal_proc_lib/record_stream.h"
+#include "../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "../signal_proc_lib/thread_pool.h"
+#include "../signal_proc_lib/rt_state_filters.h"
+#include "../signal_proc_lib/signal_presence_gate.h"
+#include "../signal_proc_lib/compressed_record.h"
+
+// STL includes
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+
+// Headless batch analysis of all records inside a directory.
+//
+// Each record is loaded by one task of the thread pool, which then adds one detection task per channel.
+// The detection runs as fast as possible (no real time playback) and does not need Qt or OpenGL.
+// For each record the beats are written to <output_dir>/<record>.qrs.csv;
+// the timing of all records is written to <output_dir>/summary.csv.
+// With --gate-leads, the gating statistics of the channels are written to <output_dir>/<record>.gating.csv.
+// With --stream, each record is read block by block by one task (see RecordStream_C) instead of being loaded completely,
+// so records larger than the memory can be analyzed.
+
+using BatchClock_TP = std::chrono::steady_clock;
+
+enum class RecordFormat_TP {
+    MIT,
+    G11
+};
+
+//! Options of the batch analyzer
+struct BatchOptions_TP {
+    std::filesystem::path _record_dir;
+    std::filesystem::path _output_dir;
+    //! Suffix of the G11 exports inside the record directory
+    std::string _g11_suffix = ".txt";
+    unsigned int _num_threads = 0;
+    //! Number of threads, which parse one G11 export (see TextColumnParser_C). If zero, the number of hardware threads
+    unsigned int _num_parse_threads = 1;
+    size_t _block_size = 4096;
+    unsigned int _training_phase_duration_sec = 2;
+    //! Removes the baseline wander before the detection (see BaselineWanderStateFilter)
+    bool _remove_baseline = false;
+    //! Removes the powerline interference before the detection (see PowerlineNotchStateFilter)
+    bool _remove_powerline = false;
+    //! Frequency of the powerline. If zero, it is estimated for each channel
+    double _mains_freq_hz = 0.0;
+    //! Suspends the detection of disconnected, flat, saturated or noisy channels (see SignalPresenceGate)
+    bool _gate_lead_off = false;
+    //! Reads the records block by block instead of loading them completely
+    bool _stream = false;
+    //! Opens the records from their binary caches and writes the caches after the first load (see RecordCache_C)
+    bool _use_cache = true;
+    //! Writes the MIT records losslessly compressed into the output directory (see CompressedRecord_C) instead of
+    //! analyzing them
+    bool _compress = false;
+};
+
+//! Detection result of one channel
+struct ChannelResult_TP {
+    std::string _label;
+    double _sample_rate_hz = 0.0;
+    size_t _num_samples = 0;
+    std::vector<double> _beats_sec;
+    double _detection_duration_sec = 0.0;
+    SignalGateStatistics_TP _gate_statistics;
+};
+
+//! One record and the results of its channels. Written by the tasks of the record only
+struct RecordJob_TP {
+    std::filesystem::path _path;
+    RecordFormat_TP _format = RecordFormat_TP::MIT;
+    //! Released by the last channel task
+    std::unique_ptr<TimeSignal_C<double>> _signal;
+    std::vector<ChannelResult_TP> _channels;
+    double _load_duration_sec = 0.0;
+    //! Channels which are not finished yet
+    std::atomic<size_t> _num_open_channels = 0;
+    bool _load_failed = false;
+    //! Size of the signal files and of the compressed record (--compress only)
+    size_t _num_source_bytes = 0;
+    size_t _num_compressed_bytes = 0;
+};
+
+//! The wfdb lib is not thread safe (see TimeSignal_C::LoadFromMITFileFormat())
+std::mutex g_wfdb_lock;
+
+//! Returns the records inside the directory, ordered by name
+std::vector<std::unique_ptr<RecordJob_TP>> FindRecords(const BatchOptions_TP& options)
+{
+    std::vector<std::unique_ptr<RecordJob_TP>> records;
+    for ( const auto& entry : std::filesystem::directory_iterator(options._record_dir) ) {
+        if ( !entry.is_regular_file() ) {
+            continue;
+        }
+        const auto& path = entry.path();
+        auto record = std::make_unique<RecordJob_TP>();
+        if ( path.extension() == ".hea" ) {
+            // the wfdb lib expects the record path without the file suffix
+            record->_path = path.parent_path() / path.stem();
+            record->_format = RecordFormat_TP::MIT;
+        } else if ( path.extension() == ".ecgz" ) {
+            // a compressed record without its header is read like a MIT record (see CompressedRecord_C).
+            // The compressed record of a record with header is read instead of its signal files
+            record->_path = path.parent_path() / path.stem();
+            record->_format = RecordFormat_TP::MIT;
+            std::error_code error;
+            if ( std::filesystem::exists(record->_path.string() + ".hea", error) ) {
+                continue;
+            }
+        } else if ( path.extension() == options._g11_suffix ) {
+            record->_path = path;
+            record->_format = RecordFormat_TP::G11;
+        } else {
+            continue;
+        }
+        records.push_back(std::move(record));
+    }
+    std::sort(records.begin(), records.end(), [](const auto& lhs, const auto& rhs) { return lhs->_path < rhs->_path; });
+    return records;
+}
+
+//! Parameters of the lead-off gate of the channel: the saturation limit is the full scale of the ADC, if it is known.
+//! The baseline of the ADC is neglected
+SignalPresenceParams_TP CreateGateParams(const ECGChannelInfo_TP<double>& channel)
+{
+    SignalPresenceParams_TP params;
+    if ( channel._gain > 0.0 && channel._adc_resolution_bits > 1 ) {
+        params._saturation_limit = 0.99 * std::ldexp(1.0, channel._adc_resolution_bits - 1) / channel._gain;
+    }
+    return params;
+}
+
+//! Returns the powerline frequency of the channel: the frequency of the options or the frequency estimated from the
+//! first 10 s of the samples (50 Hz, if it can not be estimated)
+double GetMainsFrequency(const ECGChannelInfo_TP<double>& channel, span<const double> samples, const BatchOptions_TP& options)
+{
+    double mains_freq_hz = options._mains_freq_hz;
+    if ( options._remove_powerline && mains_freq_hz <= 0.0 ) {
+        const size_t num_estimation_samples = std::min(samples.size(), static_cast<size_t>(10.0 * channel._sample_rate_hz));
+        mains_freq_hz = PowerlineNotchStateFilter<double>::EstimateMainsFrequency(samples.data(), num_estimation_samples, channel._sample_rate_hz);
+    }
+    return mains_freq_hz > 0.0 ? mains_freq_hz : 50.0;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: ChannelDetection_C
+//
+//! Detection of one channel: the optional filters, the lead-off gate and the detector.
+//! The samples are appended in order, in blocks of any size; the result does not depend on the block size.
+class ChannelDetection_C {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param mains_samples the first samples of the channel, from which the powerline frequency is estimated
+    ChannelDetection_C(const ECGChannelInfo_TP<double>& channel,
+                       span<const double> mains_samples,
+                       const BatchOptions_TP& options,
+                       ChannelResult_TP& result);
+
+    // Public functions
+public:
+    //! Appends the next samples of the channel
+    void Append(const double* samples, size_t num_samples);
+
+    //! Stores the gating statistics inside the result
+    void Finish();
+
+    // Private functions
+private:
+    //! Processes samples, which belong to one block of the detection
+    void ProcessBlock(const double* samples, size_t num_samples);
+
+    // Private variables
+private:
+    const BatchOptions_TP& _options;
+
+    ChannelResult_TP& _result;
+
+    double _sample_rate_hz = 0.0;
+
+    double _sample_dist_sec = 0.0;
+
+    PanTopkinsQRSDetection<double> _detector;
+
+    PowerlineNotchStateFilter<double> _powerline_filter;
+
+    BaselineWanderStateFilter<double> _baseline_filter;
+
+    SignalPresenceGate<double> _gate;
+
+    //! the baseline filter delays the samples, so the timestamps of the blocks are shifted back by the delay
+    double _baseline_delay_sec = 0.0;
+
+    size_t _block_size = 0;
+
+    //! Number of appended samples
+    size_t _num_samples = 0;
+
+    //! Both filters work in place on the copy of the block
+    std::vector<double> _block;
+};
+
+ChannelDetection_C::ChannelDetection_C(const ECGChannelInfo_TP<double>& channel,
+                                       span<const double> mains_samples,
+                                       const BatchOptions_TP& options,
+                                       ChannelResult_TP& result)
+    : _options(options),
+    _result(result),
+    _sample_rate_hz(channel._sample_rate_hz),
+    _sample_dist_sec(1.0 / channel._sample_rate_hz),
+    _detector(channel._sample_rate_hz, options._training_phase_duration_sec),
+    _powerline_filter(channel._sample_rate_hz, GetMainsFrequency(channel, mains_samples, options)),
+    _baseline_filter(channel._sample_rate_hz),
+    _gate(channel._sample_rate_hz, CreateGateParams(channel))
+{
+    _detector.Connect([this](const double& timestamp_sec) { _result._beats_sec.push_back(timestamp_sec); });
+    _baseline_delay_sec = options._remove_baseline ? _baseline_filter.GetFilterDelay() * _sample_dist_sec : 0.0;
+
+    // Dead leads are not filtered and detected. After a reconnection the detection starts anew,
+    // because the filter states and thresholds belong to the signal before the lead-off
+    _gate.Connect([this](SignalPresence_TP state) {
+        if ( state == SignalPresence_TP::Present ) {
+            _detector.Reset(_sample_rate_hz, _options._training_phase_duration_sec);
+            _powerline_filter.ResetState();
+            _baseline_filter.ResetState();
+        }
+    });
+    // the gate decides for each of its windows, so the blocks are the windows of the gate
+    _block_size = options._gate_lead_off ? _gate.GetWindowLength() : options._block_size;
+    if ( options._remove_baseline || options._remove_powerline ) {
+        _block.resize(_block_size);
+    }
+}
+
+void ChannelDetection_C::Append(const double* samples, size_t num_samples)
+{
+    auto start = BatchClock_TP::now();
+    // the blocks start at multiples of the block size, independent of the appended blocks
+    size_t idx = 0;
+    while ( idx < num_samples ) {
+        const size_t current_block_size = std::min(num_samples - idx, _block_size - _num_samples % _block_size);
+        ProcessBlock(samples + idx, current_block_size);
+        idx += current_block_size;
+    }
+    _result._detection_duration_sec += std::chrono::duration<double>(BatchClock_TP::now() - start).count();
+}
+
+void ChannelDetection_C::ProcessBlock(const double* samples, size_t num_samples)
+{
+    const double timestamp_sec = _num_samples * _sample_dist_sec - _baseline_delay_sec;
+    _num_samples += num_samples;
+    if ( _options._gate_lead_off && !_gate.Apply(samples, num_samples) ) {
+        return;
+    }
+    if ( !_block.empty() ) {
+        std::copy(samples, samples + num_samples, _block.begin());
+        if ( _options._remove_powerline ) {
+            _powerline_filter.Apply(_block.data(), num_samples);
+        }
+        if ( _options._remove_baseline ) {
+            _baseline_filter.Apply(_block.data(), num_samples);
+        }
+        samples = _block.data();
+    }
+    _detector.AppendBlock(span<const double>(samples, num_samples), timestamp_sec);
+}
+
+void ChannelDetection_C::Finish()
+{
+    _result._gate_statistics = _gate.GetStatistics();
+}
+
+void DetectChannel(RecordJob_TP& record, size_t channel_idx, const BatchOptions_TP& options)
+{
+    const auto& channel = record._signal->constData()[channel_idx];
+    const auto samples = record._signal->GetSamples(channel_idx);
+    ChannelDetection_C detection(channel, samples, options, record._channels[channel_idx]);
+    detection.Append(samples.data(), samples.size());
+    detection.Finish();
+
+    if ( --record._num_open_channels == 0 ) {
+        // the samples are not needed for the output; release them before the next records are loaded
+        record._signal.reset();
+    }
+}
+
+//! Reads the record block by block and detects all channels with each block. Only one block is held in memory
+void StreamRecord(RecordJob_TP& record, const BatchOptions_TP& options)
+{
+    auto start = BatchClock_TP::now();
+    std::unique_ptr<RecordStream_C<double>> stream;
+    // the wfdb lib is only used for records, which are not decoded natively; it is locked, while it reads the record
+    std::unique_lock<std::mutex> wfdb_lck(g_wfdb_lock, std::defer_lock);
+    if ( record._format == RecordFormat_TP::MIT ) {
+        auto mit_stream = std::make_unique<MITRecordStream_C<double>>(options._block_size);
+        wfdb_lck.lock();
+        record._load_failed = !mit_stream->Open(record._path.string());
+        if ( mit_stream->IsNative() ) {
+            wfdb_lck.unlock();
+        }
+        stream = std::move(mit_stream);
+    } else {
+        auto g11_stream = std::make_unique<G11RecordStream_C<double>>(options._block_size);
+        record._load_failed = !g11_stream->Open(record._path.string());
+        stream = std::move(g11_stream);
+    }
+    record._load_duration_sec = std::chrono::duration<double>(BatchClock_TP::now() - start).count();
+    if ( record._load_failed ) {
+        return;
+    }
+
+    const auto& channels = stream->GetChannels();
+    record._channels.resize(channels.size());
+    std::vector<std::unique_ptr<ChannelDetection_C>> detections(channels.size());
+    RecordBlock_TP<double> block;
+    while ( stream->ReadBlock(block) ) {
+        for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+            if ( channels[channel_idx]._sample_rate_hz <= 0.0 ) {
+                continue;
+            }
+            if ( !detections[channel_idx] ) {
+                // the powerline frequency is estimated from the first block
+                detections[channel_idx] = std::make_unique<ChannelDetection_C>(channels[channel_idx], block.GetChannel(channel_idx),
+                                                                               options, record._channels[channel_idx]);
+            }
+            detections[channel_idx]->Append(block._samples[channel_idx].data(), block._num_frames);
+        }
+    }
+    for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+        record._channels[channel_idx]._label = channels[channel_idx]._label;
+        record._channels[channel_idx]._sample_rate_hz = channels[channel_idx]._sample_rate_hz;
+        record._channels[channel_idx]._num_samples = stream->GetPosition();
+        if ( detections[channel_idx] ) {
+            detections[channel_idx]->Finish();
+        }
+    }
+}
+
+//! Loads the record and adds one detection task per channel to the pool
+void LoadRecord(RecordJob_TP& record, ThreadPool_C& pool, const BatchOptions_TP& options)
+{
+    auto start = BatchClock_TP::now();
+    record._signal = std::make_unique<TimeSignal_C<double>>();
+    record._signal->SetUseCache(options._use_cache);
+    if ( record._format == RecordFormat_TP::MIT ) {
+        std::unique_lock<std::mutex> lck(g_wfdb_lock);
+        record._signal->LoadFromMITFileFormat(record._path.string(), options._num_parse_threads);
+    } else {
+        record._signal->ReadG11Data(record._path.string(), options._num_parse_threads);
+    }
+    record._load_duration_sec = std::chrono::duration<double>(BatchClock_TP::now() - start).count();
+
+    const auto& channels = record._signal->constData();
+    record._channels.resize(channels.size());
+    for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+        record._channels[channel_idx]._label = channels[channel_idx]._label;
+        record._channels[channel_idx]._sample_rate_hz = channels[channel_idx]._sample_rate_hz;
+        record._channels[channel_idx]._num_samples = record._signal->GetSamples(channel_idx).size();
+    }
+    record._load_failed = channels.empty();
+
+    // count all channels before the first task is started, because each task may release the samples
+    size_t num_channels = 0;
+    for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+        if ( record._channels[channel_idx]._num_samples > 0 && channels[channel_idx]._sample_rate_hz > 0.0 ) {
+            ++num_channels;
+        }
+    }
+    record._num_open_channels = num_channels;
+    if ( num_channels == 0 ) {
+        record._signal.reset();
+        return;
+    }
+    for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+        if ( record._channels[channel_idx]._num_samples > 0 && channels[channel_idx]._sample_rate_hz > 0.0 ) {
+            pool.AddTask([&record, channel_idx, &options]() { DetectChannel(record, channel_idx, options); });
+        }
+    }
+}
+
+//! Writes the adc values of the MIT record losslessly compressed into the output directory
+void CompressRecord(RecordJob_TP& record, const BatchOptions_TP& options)
+{
+    auto start = BatchClock_TP::now();
+    const std::string record_dir = record._path.parent_path().string();
+    const std::string record_name = record._path.filename().string();
+    // the same readers as TimeSignal_C::LoadFromMITFileFormat()
+    auto channels = CompressedRecord_C<double>(options._num_parse_threads).Read(record_dir, record_name);
+    WFDBNativeReader_C<double> native_reader;
+    if ( channels.empty() ) {
+        channels = native_reader.Read(record_dir, record_name);
+    }
+    if ( channels.empty() ) {
+        std::unique_lock<std::mutex> lck(g_wfdb_lock);
+        MITFileIO_C<double> reader;
+        std::vector<char> database_path_char(record_dir.c_str(), record_dir.c_str() + record_dir.size() + 1);
+        reader.SetWFDBPath(database_path_char.data());
+        std::vector<char> record_name_char(record_name.c_str(), record_name.c_str() + record_name.size() + 1);
+        channels = reader.Read(record_name_char.data());
+    }
+
+    // the size of the header and of the signal files
+    std::error_code error;
+    std::vector<std::string> source_files = { record_name + ".hea" };
+    for ( const auto& channel : channels ) {
+        if ( std::find(source_files.begin(), source_files.end(), channel._filename) == source_files.end() ) {
+            source_files.push_back(channel._filename);
+        }
+    }
+    for ( const auto& source_file : source_files ) {
+        const auto file_size = std::filesystem::file_size(record._path.parent_path() / source_file, error);
+        record._num_source_bytes += error ? 0 : static_cast<size_t>(file_size);
+    }
+
+    const auto filename = CompressedRecord_C<double>::GetFilename(options._output_dir.string(), record_name);
+    record._load_failed = channels.empty() ||
+                          !CompressedRecord_C<double>::Write(filename, channels, 4096, options._num_parse_threads,
+                                                             WFDBNativeReader_C<double>::GetSourceFiles(record_dir, record_name));
+    if ( !record._load_failed ) {
+        record._num_compressed_bytes = static_cast<size_t>(std::filesystem::file_size(filename, error));
+    }
+    record._load_duration_sec = std::chrono::duration<double>(BatchClock_TP::now() - start).count();
+}
+
+//! Writes one line per beat: channel index, channel label, sample index, timestamp in seconds
+bool WriteAnnotations(const RecordJob_TP& record, const std::filesystem::path& filename)
+{
+    std::ofstream file(filename);
+    if ( !file ) {
+        return false;
+    }
+    file << "channel,label,sample_idx,timestamp_sec\n";
+    file << std::fixed << std::setprecision(6);
+    for ( size_t channel_idx = 0; channel_idx < record._channels.size(); ++channel_idx ) {
+        const auto& channel = record._channels[channel_idx];
+        for ( const double timestamp_sec : channel._beats_sec ) {
+            file << channel_idx << "," << channel._label << ","
+                 << std::llround(timestamp_sec * channel._sample_rate_hz) << "," << timestamp_sec << "\n";
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+//! Writes one line per channel: the state at the end of the record, the suspended duration and the number of suspensions and resumptions
+bool WriteGatingStatistics(const RecordJob_TP& record, const std::filesystem::path& filename)
+{
+    std::ofstream file(filename);
+    if ( !file ) {
+        return false;
+    }
+    const char* state_names[] = { "present", "flatline", "saturated", "noisy" };
+    file << "channel,label,state,gated_sec,suspensions,resumptions\n";
+    file << std::fixed << std::setprecision(3);
+    for ( size_t channel_idx = 0; channel_idx < record._channels.size(); ++channel_idx ) {
+        const auto& channel = record._channels[channel_idx];
+        const auto& statistics = channel._gate_statistics;
+        file << channel_idx << "," << channel._label << "," << state_names[static_cast<int>(statistics._state)] << ","
+             << statistics._num_gated_samples / channel._sample_rate_hz << ","
+             << statistics._num_suspensions << "," << statistics._num_resumptions << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+//! Compresses the MIT records in parallel and prints the compression ratios
+int CompressRecords(std::vector<std::unique_ptr<RecordJob_TP>>& records, const BatchOptions_TP& options)
+{
+    {
+        ThreadPool_C pool(options._num_threads);
+        for ( auto& record : records ) {
+            if ( record->_format == RecordFormat_TP::MIT ) {
+                pool.AddTask([&record, &options]() { CompressRecord(*record, options); });
+            }
+        }
+        pool.WaitUntilFinished();
+    }
+
+    std::cout << std::left << std::setw(16) << "record" << std::setw(14) << "bytes" << std::setw(14) << "compressed"
+              << std::setw(10) << "ratio" << "time [ms]" << std::endl;
+    int exit_code = 0;
+    for ( const auto& record : records ) {
+        const auto record_name = record->_path.stem().string();
+        if ( record->_format != RecordFormat_TP::MIT ) {
+            // G11 exports hold scaled values, no adc values
+            std::cout << "Skipped " << record->_path << " (no MIT record)" << std::endl;
+            continue;
+        }
+        if ( record->_load_failed ) {
+            std::cout << "Could not compress " << record->_path << std::endl;
+            exit_code = 1;
+            continue;
+        }
+        std::cout << std::left << std::setw(16) << record_name << std::setw(14) << record->_num_source_bytes
+                  << std::setw(14) << record->_num_compressed_bytes
+                  << std::setw(10) << static_cast<double>(record->_num_source_bytes) / record->_num_compressed_bytes
+                  << record->_load_duration_sec * 1000.0 << std::endl;
+    }
+    return exit_code;
+}
+
+void PrintUsage()
+{
+    std::cout << "usage: ecg_batch_analyzer <record_dir> [--output-dir <dir>] [--threads N] [--block-size N]" << std::endl;
+    std::cout << "                          [--training-sec N] [--g11-suffix <suffix>] [--remove-baseline]" << std::endl;
+    std::cout << "                          [--notch <50|60|auto>] [--gate-leads] [--stream] [--no-cache] [--compress]" << std::endl;
+    std::cout << "Analyzes all MIT records (<name>.hea or <name>.ecgz) and G11 exports (<name>.txt) inside record_dir." << std::endl;
+    std::cout << "--compress writes the MIT records losslessly compressed (<name>.ecgz) into the output directory instead." << std::endl;
+    std::cout << "The output directory defaults to <record_dir>/qrs_annotations" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    BatchOptions_TP options;
+    for ( int arg_idx = 1; arg_idx < argc; ++arg_idx ) {
+        std::string arg = argv[arg_idx];
+        const bool has_value = arg_idx + 1 < argc;
+        if ( arg == "--output-dir" && has_value ) {
+            options._output_dir = argv[++arg_idx];
+        } else if ( arg == "--threads" && has_value ) {
+            options._num_threads = std::stoul(argv[++arg_idx]);
+        } else if ( arg == "--block-size" && has_value ) {
+            options._block_size = std::stoul(argv[++arg_idx]);
+        } else if ( arg == "--training-sec" && has_value ) {
+            options._training_phase_duration_sec = std::stoul(argv[++arg_idx]);
+        } else if ( arg == "--g11-suffix" && has_value ) {
+            options._g11_suffix = argv[++arg_idx];
+        } else if ( arg == "--remove-baseline" ) {
+            options._remove_baseline = true;
+        } else if ( arg == "--notch" && has_value ) {
+            const std::string mains_freq = argv[++arg_idx];
+            options._remove_powerline = true;
+            options._mains_freq_hz = mains_freq == "auto" ? 0.0 : std::stod(mains_freq);
+        } else if ( arg == "--gate-leads" ) {
+            options._gate_lead_off = true;
+        } else if ( arg == "--stream" ) {
+            options._stream = true;
+        } else if ( arg == "--no-cache" ) {
+            options._use_cache = false;
+        } else if ( arg == "--compress" ) {
+            options._compress = true;
+        } else if ( options._record_dir.empty() ) {
+            options._record_dir = arg;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::error_code error;
+    if ( options._record_dir.empty() || options._block_size == 0 || !std::filesystem::is_directory(options._record_dir, error) ) {
+        PrintUsage();
+        return 1;
+    }
+    if ( options._output_dir.empty() ) {
+        options._output_dir = options._record_dir / "qrs_annotations";
+    }
+    std::filesystem::create_directories(options._output_dir, error);
+    if ( error ) {
+        std::cout << "Could not create the output directory " << options._output_dir << ": " << error.message() << std::endl;
+        return 1;
+    }
+
+    auto records = FindRecords(options);
+    if ( records.empty() ) {
+        std::cout << "No records inside " << options._record_dir << std::endl;
+        return 1;
+    }
+
+    // several records are loaded in parallel already; a single record is parsed by all threads
+    options._num_parse_threads = records.size() == 1 ? options._num_threads : 1;
+
+    if ( options._compress ) {
+        return CompressRecords(records, options);
+    }
+
+    auto start = BatchClock_TP::now();
+    unsigned int num_threads = 0;
+    {
+        ThreadPool_C pool(options._num_threads);
+        num_threads = pool.GetThreadCount();
+        for ( auto& record : records ) {
+            if ( options._stream ) {
+                pool.AddTask([&record, &options]() { StreamRecord(*record, options); });
+            } else {
+                pool.AddTask([&record, &pool, &options]() { LoadRecord(*record, pool, options); });
+            }
+        }
+        pool.WaitUntilFinished();
+    }
+    const double wall_duration_sec = std::chrono::duration<double>(BatchClock_TP::now() - start).count();
+
+    // write the results in the order of the records, independent of the order in which the tasks finished
+    std::ofstream summary(options._output_dir / "summary.csv");
+    summary << "record,channels,samples,beats,load_ms,detection_ms,samples_per_sec\n";
+    std::cout << std::left << std::setw(16) << "record" << std::setw(10) << "channels" << std::setw(14) << "samples"
+              << std::setw(10) << "beats" << std::setw(12) << "load [ms]" << std::setw(16) << "detection [ms]"
+              << "samp/s" << std::endl;
+
+    size_t num_analyzed_records = 0;
+    size_t total_samples = 0;
+    size_t total_beats = 0;
+    int exit_code = 0;
+    for ( const auto& record : records ) {
+        const auto record_name = record->_path.stem().string();
+        if ( record->_load_failed ) {
+            std::cout << "Could not load " << record->_path << std::endl;
+            exit_code = 1;
+            continue;
+        }
+
+        size_t num_samples = 0;
+        size_t num_beats = 0;
+        double detection_duration_sec = 0.0;
+        for ( const auto& channel : record->_channels ) {
+            num_samples += channel._num_samples;
+            num_beats += channel._beats_sec.size();
+            detection_duration_sec += channel._detection_duration_sec;
+        }
+        ++num_analyzed_records;
+        total_samples += num_samples;
+        total_beats += num_beats;
+        const double samples_per_sec = detection_duration_sec > 0.0 ? num_samples / detection_duration_sec : 0.0;
+
+        if ( !WriteAnnotations(*record, options._output_dir / (record_name + ".qrs.csv")) ) {
+            std::cout << "Could not write the annotations of " << record_name << std::endl;
+            exit_code = 1;
+        }
+        if ( options._gate_lead_off && !WriteGatingStatistics(*record, options._output_dir / (record_name + ".gating.csv")) ) {
+            std::cout << "Could not write the gating statistics of " << record_name << std::endl;
+            exit_code = 1;
+        }
+        summary << record_name << "," << record->_channels.size() << "," << num_samples << "," << num_beats << ","
+                << record->_load_duration_sec * 1000.0 << "," << detection_duration_sec * 1000.0 << ","
+                << samples_per_sec << "\n";
+        std::cout << std::left << std::setw(16) << record_name << std::setw(10) << record->_channels.size()
+                  << std::setw(14) << num_samples << std::setw(10) << num_beats
+                  << std::setw(12) << record->_load_duration_sec * 1000.0
+                  << std::setw(16) << detection_duration_sec * 1000.0 << samples_per_sec << std::endl;
+    }
+
+    std::cout << num_analyzed_records << " records, " << total_samples << " samples, " << total_beats << " beats in "
+              << wall_duration_sec << " s on " << num_threads << " threads ("
+              << total_samples / wall_duration_sec << " samp/s)" << std::endl;
+    return exit_code;
+}
@@ -85,6 +85,8 @@ CreateSignalFromFileWidget_C::CreateSignal(QString& filepath,
         }        
         signal.ReadG11Data(path);
     }
+    // The playback steps through all channels in lockstep: bring them onto one timeline once, at loading
+    signal.AlignSampleRates();
     // TODO MOVE-CTOR for TimeSignal_C
     return signal;
 }
\ No newline at end of file
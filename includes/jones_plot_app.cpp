@@ -277,43 +277,94 @@ void JonesPlotApplication_C::OnBtnPlaySignal()
         if ( data.empty() ) {
             throw std::runtime_error("Signal is empty!!");
         }
-        // data for plot 0
+        // channel for plot 0
         int plot0_id = 2;//plot_0->GetID() + 2;
-        const auto& plot0_data = data[plot0_id]._data;
-        const auto& plot0_timestamps = data[plot0_id]._timestamps;
-
-        // data to plot 1
+        // channel for plot 1
         int plot1_id = 3;//plot_1->GetID() + 3;
-        const auto& plot1_data = data[plot1_id]._data;
-        const auto& plot1_timestamps = data[plot1_id]._timestamps;
-
-        // iterator to the channel-data for plot 0
-        auto series_1_begin_it = plot0_data.begin();
-        auto timestamps_1_begin_it = plot0_timestamps.begin();
-        auto time_series_end = plot0_data.end();
-        // iterator to the channel-data for plot 1
-        auto series_2_begin_it = plot1_data.begin();
-        auto timestamps_2_begin_it = plot1_timestamps.begin();
-
-        // Hide all this pointer stuff in convenience methods so we can use:
+
         double sample_rate_hz = data[plot0_id]._sample_rate_hz;
         double sample_dist_ms = (1.0 / sample_rate_hz) * 1000.0;
+
+        // The frames are played back block by block from a stream (see RecordStream_C), which holds one block of 10 s,
+        // so records, which are not loaded completely, are played back the same way
+        TimeSignalStream_C<SignalModelDataType_TP> stream(*signal, static_cast<size_t>(10.0 * sample_rate_hz));
+        RecordBlock_TP<SignalModelDataType_TP> block;
+        stream.ReadBlock(block);
+        size_t block_frame_idx = 0;
         
         // Testing Detector 1 - plot 0
+        // The detectors publish their beats into lock-free queues, so this thread never waits for the lock of the charts.
+        SPSCQueue_TC<BeatEvent_TP> beat_queue_0(1024);
         PanTopkinsQRSDetection<double> detector_0(sample_rate_hz, 2);
-        // Callback :
-        std::function<void(const Timestamp_TP&)> member_callback = std::bind(&OGLSweepChart_C<ModelDataType_TP>::AddNewFiducialMark, 
-                                                                             plot_0, 
-                                                                             std::placeholders::_1);
-        detector_0.Connect(member_callback);
+        detector_0.ConnectEventQueue(&beat_queue_0);
 
         // Testing Detector 2 - plot 1
+        SPSCQueue_TC<BeatEvent_TP> beat_queue_1(1024);
         PanTopkinsQRSDetection<double> detector_1(sample_rate_hz, 2);
-        // Callback :
-        std::function<void(const Timestamp_TP&)> member_callback_1 = std::bind(&OGLSweepChart_C<ModelDataType_TP>::AddNewFiducialMark,
-            plot_1,
-            std::placeholders::_1);
-        detector_1.Connect(member_callback_1);
+        detector_1.ConnectEventQueue(&beat_queue_1);
+
+        // The filtered samples of the current stream block; the detectors are fed with one block at once
+        std::vector<double> detector_block_0;
+        std::vector<double> detector_block_1;
+        detector_block_0.reserve(block._num_frames);
+        detector_block_1.reserve(block._num_frames);
+
+        // Consumer: drains the queues in batches and adds the qrs complexes as fiducial marks to the charts
+        std::atomic<bool> is_beat_thread_stop_requested = false;
+        std::thread beat_thread([&]() {
+            auto drain_beats = [](SPSCQueue_TC<BeatEvent_TP>& queue, OGLSweepChart_C<ModelDataType_TP>* plot) {
+                BeatEvent_TP events[64];
+                size_t num_events = 0;
+                while ( (num_events = queue.PopBatch(events, 64)) > 0 ) {
+                    for ( size_t idx = 0; idx < num_events; ++idx ) {
+                        if ( events[idx]._classification == BeatClassification_TP::QRS ) {
+                            plot->AddNewFiducialMark(events[idx]._timestamp_sec);
+                        }
+                    }
+                }
+            };
+
+            while ( !is_beat_thread_stop_requested.load() ) {
+                drain_beats(beat_queue_0, plot_0);
+                drain_beats(beat_queue_1, plot_1);
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+            drain_beats(beat_queue_0, plot_0);
+            drain_beats(beat_queue_1, plot_1);
+        });
+
+        // Remove the powerline interference of both displayed signals at once (one frame holds one sample of each signal).
+        // The frequency is estimated from the first block
+        const auto mains_estimation_samples = block.GetChannel(plot0_id);
+        const double mains_freq_hz = PowerlineNotchStateFilter<SignalModelDataType_TP>::EstimateMainsFrequency(mains_estimation_samples.data(),
+                                                                                                              mains_estimation_samples.size(),
+                                                                                                              sample_rate_hz);
+        PowerlineNotchStateFilter<SignalModelDataType_TP> powerline_filter(sample_rate_hz, mains_freq_hz, 2);
+
+        // Remove the baseline wander of the displayed signals.
+        // The output of the filter belongs to the sample GetFilterDelay() samples ago and is drawn at the timestamp of this sample
+        BaselineWanderStateFilter<SignalModelDataType_TP> baseline_filter_0(sample_rate_hz);
+        BaselineWanderStateFilter<SignalModelDataType_TP> baseline_filter_1(sample_rate_hz);
+        const long long baseline_delay_samples = baseline_filter_0.GetFilterDelay();
+
+        // Disconnected or flat leads are not drawn. The baseline filter starts anew, when the lead is reconnected.
+        // Number of samples processed by the baseline filter since the start of the signal or the last reconnection of the lead
+        long long num_baseline_samples_0 = 0;
+        long long num_baseline_samples_1 = 0;
+        SignalPresenceGate<SignalModelDataType_TP> presence_gate_0(sample_rate_hz);
+        SignalPresenceGate<SignalModelDataType_TP> presence_gate_1(sample_rate_hz);
+        presence_gate_0.Connect([&baseline_filter_0, &num_baseline_samples_0](SignalPresence_TP state) {
+            if ( state == SignalPresence_TP::Present ) {
+                baseline_filter_0.ResetState();
+                num_baseline_samples_0 = 0;
+            }
+        });
+        presence_gate_1.Connect([&baseline_filter_1, &num_baseline_samples_1](SignalPresence_TP state) {
+            if ( state == SignalPresence_TP::Present ) {
+                baseline_filter_1.ResetState();
+                num_baseline_samples_1 = 0;
+            }
+        });
 
         // TODO: Also respect the moving average delay
         auto filt_delay_samples =  detector_0.GetFilterDelay(); 
@@ -325,31 +376,67 @@ void JonesPlotApplication_C::OnBtnPlaySignal()
         while ( !signal_processed && 
                 !_is_stop_requested.load() ) 
         {
-            if ( series_1_begin_it != time_series_end ) {
+            if ( block_frame_idx == block._num_frames && stream.ReadBlock(block) ) {
+                block_frame_idx = 0;
+            }
+            if ( block_frame_idx < block._num_frames ) {
+                const SignalModelDataType_TP sample_0 = block._samples[plot0_id][block_frame_idx];
+                const SignalModelDataType_TP sample_1 = block._samples[plot1_id][block_frame_idx];
+                const long long frame_idx = static_cast<long long>(block._first_frame + block_frame_idx);
+                const bool is_present_0 = presence_gate_0.Process(sample_0);
+                const bool is_present_1 = presence_gate_1.Process(sample_1);
+                SignalModelDataType_TP frame[2] = { sample_0, sample_1 };
+                powerline_filter.ApplyFrame(frame);
+                // timestamp of the sample, to which the output of the baseline filter belongs
+                const auto corrected_timestamp = static_cast<SignalModelDataType_TP>((1.0 / sample_rate_hz) * (frame_idx - baseline_delay_samples));
+                // The first outputs of the baseline filter belong to samples before the start of the signal or,
+                // after a reconnection, to samples of the suspended interval.
                 // AddDatapoint(..) is the only thread safe method of OGLSweepChart_C!
-                plot_0->AddDatapoint(*series_1_begin_it, *timestamps_1_begin_it);
-                //detector_0.AppendPoint(*series_1_begin_it, *timestamps_1_begin_it);
-
-                plot_1->AddDatapoint(*series_2_begin_it, *timestamps_2_begin_it);
-                //detector_1.AppendPoint(*series_2_begin_it, *timestamps_2_begin_it);
+                if ( is_present_0 ) {
+                    const auto corrected_value_0 = baseline_filter_0.Process(frame[0]);
+                    if ( ++num_baseline_samples_0 > baseline_delay_samples ) {
+                        plot_0->AddDatapoint(corrected_value_0, corrected_timestamp);
+                    }
+                }
+                if ( is_present_1 ) {
+                    const auto corrected_value_1 = baseline_filter_1.Process(frame[1]);
+                    if ( ++num_baseline_samples_1 > baseline_delay_samples ) {
+                        plot_1->AddDatapoint(corrected_value_1, corrected_timestamp);
+                    }
+                }
+                detector_block_0.push_back(frame[0]);
+                detector_block_1.push_back(frame[1]);
 
                 // Prototyping
                 /*double filtered_sig = detector_0.AppendPoint(*series_1_begin_it, *timestamps_1_begin_it);*/
                 // The timestamps do not match because the filtered signal is delayed ofc and therefore need to be shifted
                 //plot_1->AddDatapoint(filtered_sig, *(timestamps_1_begin_it)-filt_delay_sec);
 
-                ++series_1_begin_it;
-                ++timestamps_1_begin_it;
-                ++series_2_begin_it;
-                ++timestamps_2_begin_it;
+                ++block_frame_idx;
+                if ( block_frame_idx == block._num_frames ) {
+                    // The detectors publish the beats of the block into the queues (see beat_thread)
+                    const double block_t0_sec = block._first_frame / sample_rate_hz;
+                    detector_0.AppendBlock(span<const double>(detector_block_0.data(), detector_block_0.size()), block_t0_sec);
+                    detector_1.AppendBlock(span<const double>(detector_block_1.data(), detector_block_1.size()), block_t0_sec);
+                    detector_block_0.clear();
+                    detector_block_1.clear();
+                }
             } else {
                 signal_processed = true;
                 _is_signal_playing.store(false);
                 std::cout << "processing finished; thread returns" << std::endl;
+                for ( const auto* presence_gate : { &presence_gate_0, &presence_gate_1 } ) {
+                    const auto statistics = presence_gate->GetStatistics();
+                    std::cout << "lead-off gate: " << statistics._num_gated_samples / sample_rate_hz << " s suspended, "
+                              << statistics._num_suspensions << " suspensions, " << statistics._num_resumptions << " resumptions" << std::endl;
+                }
             }
             std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(sample_dist_ms)));
         }
 
+        is_beat_thread_stop_requested.store(true);
+        beat_thread.join();
+
         _is_signal_playing.store(false);
     });
 
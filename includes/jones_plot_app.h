@@ -6,6 +6,8 @@
 #include "list_view_dialog.h"
 
 #include "../includes/signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "../includes/signal_proc_lib/signal_presence_gate.h"
+#include "../includes/signal_proc_lib/record_stream.h"
 
 // Qt includes
 #include <QtWidgets/QMainWindow>
@@ -0,0 +1,90 @@
+#pragma once
+
+// STL includes
+#include <vector>
+#include <cmath>
+#include <cstddef>
+
+//! Result of the comparison of detected beats with reference beats
+struct BeatMatchResult_TP {
+    //! Detected beats with a reference beat inside the tolerance
+    size_t _true_positives = 0;
+    //! Detected beats without a reference beat
+    size_t _false_positives = 0;
+    //! Reference beats without a detected beat
+    size_t _false_negatives = 0;
+
+    //! Se = TP / (TP + FN)
+    double Sensitivity() const
+    {
+        const size_t num_reference_beats = _true_positives + _false_negatives;
+        return num_reference_beats > 0 ? static_cast<double>(_true_positives) / num_reference_beats : 0.0;
+    }
+
+    //! +P = TP / (TP + FP)
+    double PositivePredictivity() const
+    {
+        const size_t num_detected_beats = _true_positives + _false_positives;
+        return num_detected_beats > 0 ? static_cast<double>(_true_positives) / num_detected_beats : 0.0;
+    }
+
+    BeatMatchResult_TP& operator+=(const BeatMatchResult_TP& other)
+    {
+        _true_positives += other._true_positives;
+        _false_positives += other._false_positives;
+        _false_negatives += other._false_negatives;
+        return *this;
+    }
+};
+
+//! Matches the detected beats with the reference beats (e.g. the beat annotations of a MIT-BIH record).
+//! Each reference beat is matched with at most one detected beat within the tolerance,
+//! like the beat-by-beat comparison of ANSI/AAMI EC57 (tolerance 150 ms).
+//!
+//! \param reference_beats_sec timestamps of the reference beats in ascending order
+//! \param detected_beats_sec timestamps of the detected beats in ascending order
+//! \param begin_sec beats before this timestamp are not compared (e.g. the training phase of the detector)
+inline
+BeatMatchResult_TP
+MatchBeats(const std::vector<double>& reference_beats_sec,
+           const std::vector<double>& detected_beats_sec,
+           double tolerance_sec = 0.15,
+           double begin_sec = 0.0)
+{
+    BeatMatchResult_TP result;
+    size_t reference_idx = 0;
+    size_t detected_idx = 0;
+    while ( reference_idx < reference_beats_sec.size() && reference_beats_sec[reference_idx] < begin_sec ) {
+        ++reference_idx;
+    }
+    while ( detected_idx < detected_beats_sec.size() && detected_beats_sec[detected_idx] < begin_sec ) {
+        ++detected_idx;
+    }
+
+    while ( reference_idx < reference_beats_sec.size() && detected_idx < detected_beats_sec.size() ) {
+        const double reference_sec = reference_beats_sec[reference_idx];
+        const double detected_sec = detected_beats_sec[detected_idx];
+        if ( std::abs(detected_sec - reference_sec) <= tolerance_sec ) {
+            // A following detection, which is closer to this reference beat, is matched instead
+            if ( detected_idx + 1 < detected_beats_sec.size() &&
+                 std::abs(detected_beats_sec[detected_idx + 1] - reference_sec) < std::abs(detected_sec - reference_sec) )
+            {
+                ++result._false_positives;
+                ++detected_idx;
+                continue;
+            }
+            ++result._true_positives;
+            ++reference_idx;
+            ++detected_idx;
+        } else if ( detected_sec < reference_sec ) {
+            ++result._false_positives;
+            ++detected_idx;
+        } else {
+            ++result._false_negatives;
+            ++reference_idx;
+        }
+    }
+    result._false_negatives += reference_beats_sec.size() - reference_idx;
+    result._false_positives += detected_beats_sec.size() - detected_idx;
+    return result;
+}
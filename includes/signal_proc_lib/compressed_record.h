@@ -0,0 +1,584 @@
+#pragma once
+
+// Project includes
+#include "mit_file_io.h"
+#include "mapped_file.h"
+#include "lossless_codec.h"
+#include "thread_pool.h"
+#include "wfdb_native_reader.h"
+
+// STL includes
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+///////////////////////////////////////////////////////
+//
+// Class: CompressedRecord_C
+//
+//! Losslessly compressed MIT record (<record>.ecgz), e.g. for archives of raw recordings, which are read again and
+//! again: less bytes are read from the disk than from the signal files of the record.
+//!
+//! The adc values of the signals are split into blocks of frames; the samples of each signal inside a block are
+//! encoded independently of the other blocks (see LosslessCodec_C), so each block is decoded on its own:
+//! the frames of a record are read from any position (seekable) and the blocks are decoded in parallel.
+//!
+//! Layout of the file (native byte order):
+//! - header: magic "ECGZ", version, number of signals, frames per block, number of frames, sample rate,
+//!   number of source files
+//! - size and modification time of each source file (the header and the signal files, which the record was written from)
+//! - description of each signal: gain, baseline, adc zero, adc resolution, description, units
+//! - the offsets of the blocks inside the file (one more than blocks: the last one is the end of the last block)
+//! - the blocks: the encoded samples of each signal
+//!
+//! The reader has the interface of WFDBNativeReader_C: the samples are the adc values, the channels are the channels
+//! of MITDataChannel_TP. TimeSignal_C::LoadFromMITFileFormat() and MITRecordStream_C read the compressed record
+//! <record_dir>/<record_name>.ecgz instead of the signal files, if it exists. Like RecordCache_C, a compressed record
+//! next to the signal files of the record is opened only, if it was written from these files and they did not change
+//! since then; a compressed record without signal files (e.g. inside an archive) is always opened.
+//!
+//! The blocks are decoded by a thread pool, which is started with the first parallel decoding and is kept until the
+//! reader is destroyed, so a stream (see MITRecordStream_C) does not start threads for each block.
+//!
+//! Usage:
+//! WFDBNativeReader_C<double> reader;
+//! CompressedRecord_C<double>::Write("/archive/100.ecgz", reader.Read("/data/mitdb", "100"));
+//! // next to the signal files: CompressedRecord_C<double>::Write("/data/mitdb/100.ecgz", channels, 4096, 0,
+//! //                                                             WFDBNativeReader_C<double>::GetSourceFiles("/data/mitdb", "100"));
+//! auto channels = CompressedRecord_C<double>().Read("/archive", "100");
+template<typename SampleDataType_TP>
+class CompressedRecord_C {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param num_threads number of threads, which decode the blocks. If zero, the number of hardware threads is used
+    CompressedRecord_C(unsigned int num_threads = 0);
+
+    // Public functions
+public:
+    //! Reads the record <record_dir>/<record_name>.ecgz.
+    //! Returns an empty vector, if there is no valid compressed record
+    std::vector<MITDataChannel_TP<SampleDataType_TP>> Read(const std::string& record_dir, const std::string& record_name);
+
+    //! Maps the compressed record <record_dir>/<record_name>.ecgz and checks its header and the offsets of its blocks.
+    //! Returns false as well, if the signal files of the record inside record_dir are not the ones, which the compressed
+    //! record was written from, or changed since then
+    bool Open(const std::string& record_dir, const std::string& record_name);
+
+    void Close();
+
+    //! Returns the number of frames of the opened record (one sample of each signal)
+    size_t GetNumFrames() const;
+
+    //! Returns the channels of the opened record without samples
+    std::vector<MITDataChannel_TP<SampleDataType_TP>> GetChannels() const;
+
+    //! Decodes the frames [first_frame, first_frame + num_frames) of the opened record; the blocks are decoded in parallel.
+    //! channel_dst[signal_idx] receives the num_frames samples of the signal
+    //!
+    //! \returns false, if a block is invalid
+    bool DecodeFrames(size_t first_frame, size_t num_frames, SampleDataType_TP* const* channel_dst);
+
+    //! Releases the mapped pages of the blocks, which are decoded and not needed anymore (see MappedFile_C::ReleasePages())
+    void ReleaseFrames(size_t first_frame, size_t num_frames);
+
+    //! Writes the channels (the adc values, e.g. of WFDBNativeReader_C::Read()) as compressed record. The blocks are
+    //! encoded in parallel.
+    //!
+    //! \param source_files the files, which the channels were read from (see WFDBNativeReader_C::GetSourceFiles()).
+    //!                     Needed, if the compressed record is written next to them (see Open())
+    //! \returns false, if a sample is no integer (the compression is lossless for adc values only),
+    //!          the channels differ in length, a source file does not exist or the file can not be written
+    static bool Write(const std::string& filename,
+                      const std::vector<MITDataChannel_TP<SampleDataType_TP>>& channels,
+                      size_t frames_per_block = 4096,
+                      unsigned int num_threads = 0,
+                      const std::vector<std::string>& source_files = {});
+
+    //! Returns the path of the compressed record
+    static std::string GetFilename(const std::string& record_dir, const std::string& record_name);
+
+    //! Version of the file layout; records of other versions are not opened
+    static constexpr uint32_t _version = 2;
+
+    // Private types
+private:
+    //! Size and modification time of a source file (see RecordCache_C)
+    struct SourceStamp_TP {
+        uint64_t _size = 0;
+        int64_t _modification_time = 0;
+    };
+
+    //! Description of one signal
+    struct Signal_TP {
+        double _gain = 200.0;
+        int32_t _baseline = 0;
+        int32_t _adc_zero = 0;
+        int32_t _adc_resolution_bits = 12;
+        std::string _description;
+        std::string _units = "mV";
+    };
+
+    // Private functions
+private:
+    //! Returns false, if the file does not exist
+    static bool GetSourceStamp(const std::string& filename, SourceStamp_TP& stamp);
+
+    //! Decodes the samples of all signals of a block into samples[signal_idx * frames_per_block + frame_idx]
+    bool DecodeBlock(size_t block_idx, std::vector<int32_t>& samples) const;
+
+    template<typename Value_TP>
+    static void Append(std::vector<unsigned char>& buffer, const Value_TP& value);
+
+    static void AppendString(std::vector<unsigned char>& buffer, const std::string& text);
+
+    //! Reads a value at position and moves the position behind it. Returns false at the end of the file
+    template<typename Value_TP>
+    bool Extract(size_t& position, Value_TP& value) const;
+
+    bool ExtractString(size_t& position, std::string& text) const;
+
+    //! Calls function(block_idx) for the blocks [first_block, end_block) on up to _num_threads threads of _pool
+    template<typename Function_TP>
+    void ForEachBlock(size_t first_block, size_t end_block, Function_TP function);
+
+    // Private variables
+private:
+    static constexpr char _magic[4] = { 'E', 'C', 'G', 'Z' };
+
+    unsigned int _num_threads = 1;
+
+    //! Decodes the blocks; started with the first call of ForEachBlock(), which uses more than one thread
+    std::unique_ptr<ThreadPool_C> _pool;
+
+    MappedFile_C _file;
+
+    std::string _filename;
+
+    std::vector<Signal_TP> _signals;
+
+    double _sample_freq_hz = 0.0;
+
+    size_t _num_frames = 0;
+
+    size_t _frames_per_block = 0;
+
+    //! Offsets of the blocks inside the file; _block_offsets[block_idx + 1] is the end of the block
+    std::vector<uint64_t> _block_offsets;
+};
+
+template<typename SampleDataType_TP>
+CompressedRecord_C<SampleDataType_TP>::CompressedRecord_C(unsigned int num_threads)
+    : _num_threads(num_threads > 0 ? num_threads : std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+template<typename SampleDataType_TP>
+inline
+std::string
+CompressedRecord_C<SampleDataType_TP>::GetFilename(const std::string& record_dir, const std::string& record_name)
+{
+    return record_dir + "/" + record_name + ".ecgz";
+}
+
+template<typename SampleDataType_TP>
+inline
+bool
+CompressedRecord_C<SampleDataType_TP>::GetSourceStamp(const std::string& filename, SourceStamp_TP& stamp)
+{
+    std::error_code error;
+    const auto size = std::filesystem::file_size(filename, error);
+    if ( error ) {
+        return false;
+    }
+    const auto modification_time = std::filesystem::last_write_time(filename, error);
+    if ( error ) {
+        return false;
+    }
+    stamp._size = static_cast<uint64_t>(size);
+    stamp._modification_time = static_cast<int64_t>(modification_time.time_since_epoch().count());
+    return true;
+}
+
+template<typename SampleDataType_TP>
+template<typename Value_TP>
+inline
+void
+CompressedRecord_C<SampleDataType_TP>::Append(std::vector<unsigned char>& buffer, const Value_TP& value)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(Value_TP));
+}
+
+template<typename SampleDataType_TP>
+inline
+void
+CompressedRecord_C<SampleDataType_TP>::AppendString(std::vector<unsigned char>& buffer, const std::string& text)
+{
+    Append(buffer, static_cast<uint32_t>(text.size()));
+    buffer.insert(buffer.end(), text.begin(), text.end());
+}
+
+template<typename SampleDataType_TP>
+template<typename Value_TP>
+inline
+bool
+CompressedRecord_C<SampleDataType_TP>::Extract(size_t& position, Value_TP& value) const
+{
+    if ( position + sizeof(Value_TP) > _file.GetSize() ) {
+        return false;
+    }
+    std::memcpy(&value, _file.GetData() + position, sizeof(Value_TP));
+    position += sizeof(Value_TP);
+    return true;
+}
+
+template<typename SampleDataType_TP>
+inline
+bool
+CompressedRecord_C<SampleDataType_TP>::ExtractString(size_t& position, std::string& text) const
+{
+    uint32_t size = 0;
+    if ( !Extract(position, size) || position + size > _file.GetSize() ) {
+        return false;
+    }
+    text.assign(reinterpret_cast<const char*>(_file.GetData()) + position, size);
+    position += size;
+    return true;
+}
+
+template<typename SampleDataType_TP>
+template<typename Function_TP>
+inline
+void
+CompressedRecord_C<SampleDataType_TP>::ForEachBlock(size_t first_block, size_t end_block, Function_TP function)
+{
+    const size_t num_blocks = end_block - first_block;
+    const size_t num_tasks = std::min<size_t>(_num_threads, num_blocks);
+    if ( num_tasks <= 1 ) {
+        for ( size_t block_idx = first_block; block_idx < end_block; ++block_idx ) {
+            function(block_idx);
+        }
+        return;
+    }
+    if ( !_pool ) {
+        _pool = std::make_unique<ThreadPool_C>(_num_threads);
+    }
+    // each task decodes consecutive blocks
+    for ( size_t task_idx = 0; task_idx < num_tasks; ++task_idx ) {
+        const size_t task_first_block = first_block + num_blocks * task_idx / num_tasks;
+        const size_t task_end_block = first_block + num_blocks * (task_idx + 1) / num_tasks;
+        _pool->AddTask([task_first_block, task_end_block, &function]() {
+            for ( size_t block_idx = task_first_block; block_idx < task_end_block; ++block_idx ) {
+                function(block_idx);
+            }
+        });
+    }
+    _pool->WaitUntilFinished();
+}
+
+template<typename SampleDataType_TP>
+inline
+bool
+CompressedRecord_C<SampleDataType_TP>::Write(const std::string& filename,
+                                             const std::vector<MITDataChannel_TP<SampleDataType_TP>>& channels,
+                                             size_t frames_per_block,
+                                             unsigned int num_threads,
+                                             const std::vector<std::string>& source_files)
+{
+    if ( channels.empty() || frames_per_block == 0 ) {
+        return false;
+    }
+    std::vector<SourceStamp_TP> source_stamps(source_files.size());
+    for ( size_t source_idx = 0; source_idx < source_files.size(); ++source_idx ) {
+        if ( !GetSourceStamp(source_files[source_idx], source_stamps[source_idx]) ) {
+            return false;
+        }
+    }
+    const size_t num_frames = channels.front()._data.size();
+    std::vector<std::vector<int32_t>> adc_values(channels.size(), std::vector<int32_t>(num_frames));
+    for ( size_t signal_idx = 0; signal_idx < channels.size(); ++signal_idx ) {
+        const auto& data = channels[signal_idx]._data;
+        if ( data.size() != num_frames ) {
+            return false;
+        }
+        for ( size_t frame_idx = 0; frame_idx < num_frames; ++frame_idx ) {
+            const double value = static_cast<double>(data[frame_idx]);
+            if ( value != std::floor(value) || value < INT32_MIN || value > INT32_MAX ) {
+                return false;
+            }
+            adc_values[signal_idx][frame_idx] = static_cast<int32_t>(value);
+        }
+    }
+
+    // encode the blocks in parallel
+    const size_t num_blocks = (num_frames + frames_per_block - 1) / frames_per_block;
+    std::vector<std::vector<unsigned char>> blocks(num_blocks);
+    CompressedRecord_C<SampleDataType_TP> encoder(num_threads);
+    encoder.ForEachBlock(0, num_blocks, [&](size_t block_idx) {
+        const size_t first_frame = block_idx * frames_per_block;
+        const size_t num_block_frames = std::min(frames_per_block, num_frames - first_frame);
+        for ( const auto& signal_values : adc_values ) {
+            LosslessCodec_C::Encode(signal_values.data() + first_frame, num_block_frames, blocks[block_idx]);
+        }
+    });
+
+    std::vector<unsigned char> header(std::begin(_magic), std::end(_magic));
+    Append(header, _version);
+    Append(header, static_cast<uint32_t>(channels.size()));
+    Append(header, static_cast<uint32_t>(frames_per_block));
+    Append(header, static_cast<uint64_t>(num_frames));
+    Append(header, channels.front()._sample_frequency_hz);
+    Append(header, static_cast<uint32_t>(source_stamps.size()));
+    for ( const auto& stamp : source_stamps ) {
+        Append(header, stamp._size);
+        Append(header, stamp._modification_time);
+    }
+    for ( const auto& channel : channels ) {
+        Append(header, channel._gain);
+        Append(header, static_cast<int32_t>(channel._adc_baseline_0U_output_mV));
+        Append(header, static_cast<int32_t>(channel._adc_baseline_0mV_output_U));
+        Append(header, static_cast<int32_t>(channel._adc_resolution_bits));
+        AppendString(header, channel._description);
+        AppendString(header, channel._units);
+    }
+    uint64_t block_offset = header.size() + (num_blocks + 1) * sizeof(uint64_t);
+    for ( const auto& block : blocks ) {
+        Append(header, block_offset);
+        block_offset += block.size();
+    }
+    Append(header, block_offset);
+
+    // like RecordCache_C::Write(): the record is never opened half written
+    const std::string temporary_filename = filename + ".tmp";
+    {
+        std::ofstream file(temporary_filename, std::ios::binary | std::ios::trunc);
+        if ( !file.is_open() ) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+        for ( const auto& block : blocks ) {
+            file.write(reinterpret_cast<const char*>(block.data()), block.size());
+        }
+        if ( !file.good() ) {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temporary_filename, error);
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary_filename, filename, error);
+    if ( error ) {
+        std::filesystem::remove(temporary_filename, error);
+        return false;
+    }
+    return true;
+}
+
+template<typename SampleDataType_TP>
+inline
+bool
+CompressedRecord_C<SampleDataType_TP>::Open(const std::string& record_dir, const std::string& record_name)
+{
+    Close();
+    _filename = GetFilename(record_dir, record_name);
+    std::error_code error;
+    if ( !std::filesystem::exists(_filename, error) || !_file.Open(_filename) ) {
+        return false;
+    }
+
+    size_t position = sizeof(_magic);
+    uint32_t version = 0;
+    uint32_t num_signals = 0;
+    uint32_t frames_per_block = 0;
+    uint64_t num_frames = 0;
+    uint32_t num_sources = 0;
+    bool is_valid = _file.GetSize() >= sizeof(_magic) && std::memcmp(_file.GetData(), _magic, sizeof(_magic)) == 0 &&
+                    Extract(position, version) && version == _version &&
+                    Extract(position, num_signals) && num_signals > 0 &&
+                    Extract(position, frames_per_block) && frames_per_block > 0 &&
+                    Extract(position, num_frames) && Extract(position, _sample_freq_hz) &&
+                    Extract(position, num_sources);
+
+    // the compressed record is outdated, if the signal files of the record changed since it was written
+    const auto source_files = is_valid ? WFDBNativeReader_C<SampleDataType_TP>::GetSourceFiles(record_dir, record_name) :
+                                         std::vector<std::string>();
+    is_valid = is_valid && (source_files.empty() || num_sources == source_files.size());
+    for ( uint32_t source_idx = 0; is_valid && source_idx < num_sources; ++source_idx ) {
+        SourceStamp_TP written_stamp;
+        SourceStamp_TP stamp;
+        is_valid = Extract(position, written_stamp._size) && Extract(position, written_stamp._modification_time) &&
+                   (source_files.empty() ||
+                    (GetSourceStamp(source_files[source_idx], stamp) &&
+                     stamp._size == written_stamp._size && stamp._modification_time == written_stamp._modification_time));
+    }
+
+    _signals.resize(is_valid ? num_signals : 0);
+    for ( auto& signal : _signals ) {
+        is_valid = is_valid &&
+                   Extract(position, signal._gain) && Extract(position, signal._baseline) &&
+                   Extract(position, signal._adc_zero) && Extract(position, signal._adc_resolution_bits) &&
+                   ExtractString(position, signal._description) && ExtractString(position, signal._units);
+    }
+
+    // the blocks must follow each other inside the file
+    const size_t num_blocks = is_valid ? (num_frames + frames_per_block - 1) / frames_per_block : 0;
+    is_valid = is_valid && num_blocks < _file.GetSize() / sizeof(uint64_t);
+    _block_offsets.resize(is_valid ? num_blocks + 1 : 0);
+    for ( size_t block_idx = 0; is_valid && block_idx < _block_offsets.size(); ++block_idx ) {
+        is_valid = Extract(position, _block_offsets[block_idx]) && _block_offsets[block_idx] <= _file.GetSize() &&
+                   (block_idx == 0 || _block_offsets[block_idx] >= _block_offsets[block_idx - 1]);
+    }
+    is_valid = is_valid && _block_offsets.front() >= position;
+
+    if ( !is_valid ) {
+        Close();
+        return false;
+    }
+    _num_frames = num_frames;
+    _frames_per_block = frames_per_block;
+    return true;
+}
+
+template<typename SampleDataType_TP>
+inline
+void
+CompressedRecord_C<SampleDataType_TP>::Close()
+{
+    _file.Close();
+    _signals.clear();
+    _block_offsets.clear();
+    _num_frames = 0;
+    _frames_per_block = 0;
+}
+
+template<typename SampleDataType_TP>
+inline
+size_t
+CompressedRecord_C<SampleDataType_TP>::GetNumFrames() const
+{
+    return _num_frames;
+}
+
+template<typename SampleDataType_TP>
+inline
+std::vector<MITDataChannel_TP<SampleDataType_TP>>
+CompressedRecord_C<SampleDataType_TP>::GetChannels() const
+{
+    std::vector<MITDataChannel_TP<SampleDataType_TP>> channels(_signals.size());
+    for ( size_t signal_idx = 0; signal_idx < _signals.size(); ++signal_idx ) {
+        const auto& signal = _signals[signal_idx];
+        auto& channel = channels[signal_idx];
+        channel._filename = _filename;
+        channel._description = signal._description;
+        channel._units = signal._units;
+        channel._gain = signal._gain;
+        channel._sample_frequency_hz = _sample_freq_hz;
+        channel._adc_resolution_bits = signal._adc_resolution_bits;
+        channel._adc_baseline_0U_output_mV = signal._baseline;
+        channel._adc_baseline_0mV_output_U = signal._adc_zero;
+        channel._num_samples = static_cast<unsigned int>(_num_frames);
+    }
+    return channels;
+}
+
+template<typename SampleDataType_TP>
+inline
+bool
+CompressedRecord_C<SampleDataType_TP>::DecodeBlock(size_t block_idx, std::vector<int32_t>& samples) const
+{
+    const size_t num_block_frames = std::min(_frames_per_block, _num_frames - block_idx * _frames_per_block);
+    samples.resize(_signals.size() * _frames_per_block);
+    const unsigned char* src = _file.GetData() + _block_offsets[block_idx];
+    size_t size = _block_offsets[block_idx + 1] - _block_offsets[block_idx];
+    for ( size_t signal_idx = 0; signal_idx < _signals.size(); ++signal_idx ) {
+        const size_t num_bytes = LosslessCodec_C::Decode(src, size, num_block_frames, samples.data() + signal_idx * _frames_per_block);
+        if ( num_bytes == 0 ) {
+            return false;
+        }
+        src += num_bytes;
+        size -= num_bytes;
+    }
+    return true;
+}
+
+template<typename SampleDataType_TP>
+inline
+bool
+CompressedRecord_C<SampleDataType_TP>::DecodeFrames(size_t first_frame, size_t num_frames, SampleDataType_TP* const* channel_dst)
+{
+    if ( first_frame >= _num_frames || num_frames == 0 ) {
+        return true;
+    }
+    num_frames = std::min(num_frames, _num_frames - first_frame);
+    const size_t end_frame = first_frame + num_frames;
+    const size_t first_block = first_frame / _frames_per_block;
+    const size_t end_block = (end_frame + _frames_per_block - 1) / _frames_per_block;
+
+    std::atomic<bool> is_valid = true;
+    ForEachBlock(first_block, end_block, [&](size_t block_idx) {
+        // the blocks at the start and the end of the range are decoded completely, only their frames inside the range are copied
+        thread_local std::vector<int32_t> samples;
+        if ( !DecodeBlock(block_idx, samples) ) {
+            is_valid = false;
+            return;
+        }
+        const size_t block_first_frame = block_idx * _frames_per_block;
+        const size_t copy_first_frame = std::max(first_frame, block_first_frame);
+        const size_t copy_end_frame = std::min(end_frame, block_first_frame + _frames_per_block);
+        for ( size_t signal_idx = 0; signal_idx < _signals.size(); ++signal_idx ) {
+            const int32_t* src = samples.data() + signal_idx * _frames_per_block + (copy_first_frame - block_first_frame);
+            SampleDataType_TP* dst = channel_dst[signal_idx] + (copy_first_frame - first_frame);
+            for ( size_t frame_idx = 0; frame_idx < copy_end_frame - copy_first_frame; ++frame_idx ) {
+                dst[frame_idx] = static_cast<SampleDataType_TP>(src[frame_idx]);
+            }
+        }
+    });
+    return is_valid;
+}
+
+template<typename SampleDataType_TP>
+inline
+void
+CompressedRecord_C<SampleDataType_TP>::ReleaseFrames(size_t first_frame, size_t num_frames)
+{
+    if ( _block_offsets.empty() || num_frames == 0 ) {
+        return;
+    }
+    // only the blocks, which are decoded completely
+    const size_t first_block = (first_frame + _frames_per_block - 1) / _frames_per_block;
+    const size_t end_block = std::min((first_frame + num_frames) / _frames_per_block, _block_offsets.size() - 1);
+    if ( end_block > first_block ) {
+        _file.ReleasePages(_block_offsets[first_block], _block_offsets[end_block] - _block_offsets[first_block]);
+    }
+}
+
+template<typename SampleDataType_TP>
+inline
+std::vector<MITDataChannel_TP<SampleDataType_TP>>
+CompressedRecord_C<SampleDataType_TP>::Read(const std::string& record_dir, const std::string& record_name)
+{
+    if ( !Open(record_dir, record_name) ) {
+        return {};
+    }
+    auto channels = GetChannels();
+    std::vector<SampleDataType_TP*> channel_dst;
+    for ( auto& channel : channels ) {
+        channel._data.resize(_num_frames);
+        channel_dst.push_back(channel._data.data());
+    }
+    if ( !DecodeFrames(0, _num_frames, channel_dst.data()) ) {
+        channels.clear();
+    }
+    Close();
+    return channels;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+// Projects includes
+#include "pan_topkins_qrs_detector.h"
+#include "rt_state_filters.h"
+#include "qrs_filter_chain.h"
+
+// STL includes
+#include <vector>
+#include <cmath>
+#include <functional>
+#include <algorithm>
+
+//! PanTopkinsQRSDetection with an anti-aliased polyphase decimation in front.
+//!
+//! The pan topkins detection only uses frequencies up to about 15 Hz, so the signal is decimated
+//! to about 200 Hz (by an integer factor) before the bandpass, derivation and moving average are applied.
+//! The timestamps of the detected qrs complexes and GetFilterDelay() refer to the original sample timeline,
+//! so this class can be used instead of PanTopkinsQRSDetection.
+//! The timestamps are corrected by the delay of the anti-aliasing filter and by the longer delay of the bandpass
+//! at the lower sample frequency, so they match the timestamps of a PanTopkinsQRSDetection running on the original signal
+//! (with the resolution of the decimated signal).
+//!
+//! Usage:
+//! DecimatingQRSDetection<double> detector(1000.0, 2);
+//! detector.Connect([](const double& timestamp) { ... });
+//! detector.AppendPoint(sample, timestamp);
+template<typename DataType_TP>
+class DecimatingQRSDetection {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param sample_freq_hz sample frequency of the input signal
+    //! \param target_sample_freq_hz the signal is decimated by round(sample_freq_hz / target_sample_freq_hz)
+    DecimatingQRSDetection(double sample_freq_hz,
+                           unsigned int training_phase_duration_sec,
+                           double target_sample_freq_hz = 200.0);
+
+    // Public functions
+public:
+    //! See PanTopkinsQRSDetection::AppendPoint()
+    void AppendPoint(const DataType_TP& sample, const double timestamp_sec);
+
+    //! See PanTopkinsQRSDetection::AppendBlock()
+    void AppendBlock(span<const DataType_TP> samples, const double t0_sec);
+
+    //! Returns the delay of the anti-aliasing and detection filters in input samples,
+    //! as it is subtracted from the timestamps of the detected qrs complexes
+    int GetFilterDelay();
+
+    //! Stores the callback, which is called, when a qrs complex was detected
+    void Connect(std::function<void(const double&)> callback);
+
+    //! Returns the current thresholds, levels and counters
+    QRSDetectionState_TP GetState() const;
+
+    unsigned int GetDecimationFactor();
+
+    // Private functions
+private:
+    static unsigned int CalculateDecimationFactor(double sample_freq_hz, double target_sample_freq_hz);
+
+    static std::vector<double> DesignAntiAliasingTaps(double sample_freq_hz, unsigned int decimation_factor);
+
+    // Private variables
+private:
+    //! Highest frequency used by the detection, which must not be attenuated by the anti-aliasing filter
+    static constexpr double _passband_edge_hz = 15.0;
+
+    //! Anti-aliasing taps per decimation factor
+    static constexpr unsigned int _taps_per_phase = 8;
+
+    static constexpr double _kaiser_beta = 5.0;
+
+    //! Number of input samples decimated at once by AppendBlock()
+    static constexpr size_t _block_chunk_size = 4096;
+
+    double _sample_freq_hz = 0.0;
+
+    //! Added to the timestamps of the decimated samples, before they are passed to the detector
+    double _timestamp_correction_sec = 0.0;
+
+    PolyphaseDecimator<DataType_TP> _decimator;
+
+    //! Detection on the decimated signal
+    PanTopkinsQRSDetection<DataType_TP> _detector;
+
+    //! Working buffer of AppendBlock(): the decimated samples of one chunk
+    std::vector<DataType_TP> _decimated_buff;
+};
+
+template<typename DataType_TP>
+DecimatingQRSDetection<DataType_TP>::DecimatingQRSDetection(double sample_freq_hz,
+                                                             unsigned int training_phase_duration_sec,
+                                                             double target_sample_freq_hz)
+    : _sample_freq_hz(sample_freq_hz),
+    _decimator(CalculateDecimationFactor(sample_freq_hz, target_sample_freq_hz),
+               DesignAntiAliasingTaps(sample_freq_hz, CalculateDecimationFactor(sample_freq_hz, target_sample_freq_hz))),
+    _detector(sample_freq_hz / CalculateDecimationFactor(sample_freq_hz, target_sample_freq_hz), training_phase_duration_sec)
+{
+    // The detector subtracts its filter delay in decimated samples; the bandpass delay of the original detector
+    // is the same number of (shorter) original samples. The anti-aliasing filter delays the signal in addition.
+    const double bandpass_delay_samples = QRSFilterParams_TP::_num_taps / 2;
+    const double decimation_factor = _decimator.GetDecimationFactor();
+    _timestamp_correction_sec = (bandpass_delay_samples * (decimation_factor - 1) - _decimator.GetFilterDelay()) / _sample_freq_hz;
+
+    _decimated_buff.resize(_block_chunk_size / _decimator.GetDecimationFactor() + 1);
+}
+
+template<typename DataType_TP>
+inline
+void
+DecimatingQRSDetection<DataType_TP>::AppendPoint(const DataType_TP& sample, const double timestamp_sec)
+{
+    DataType_TP decimated_sample = 0;
+    if ( _decimator.Apply(sample, decimated_sample) ) {
+        _detector.AppendPoint(decimated_sample, timestamp_sec + _timestamp_correction_sec);
+    }
+}
+
+template<typename DataType_TP>
+void
+DecimatingQRSDetection<DataType_TP>::AppendBlock(span<const DataType_TP> samples, const double t0_sec)
+{
+    const size_t block_size = samples.size();
+    for ( size_t chunk_begin = 0; chunk_begin < block_size; chunk_begin += _block_chunk_size ) {
+        const size_t chunk_size = std::min(_block_chunk_size, block_size - chunk_begin);
+
+        size_t first_output_idx = 0;
+        const size_t num_outputs = _decimator.Apply(samples.data() + chunk_begin, chunk_size, _decimated_buff.data(), first_output_idx);
+        if ( num_outputs > 0 ) {
+            _detector.AppendBlock(span<const DataType_TP>(_decimated_buff.data(), num_outputs),
+                                  t0_sec + (chunk_begin + first_output_idx) / _sample_freq_hz + _timestamp_correction_sec);
+        }
+    }
+}
+
+template<typename DataType_TP>
+inline
+int
+DecimatingQRSDetection<DataType_TP>::GetFilterDelay()
+{
+    // the detector subtracts its delay in decimated samples, the timestamps were corrected before
+    return static_cast<int>(std::lround(_detector.GetFilterDelay() * static_cast<double>(_decimator.GetDecimationFactor()) -
+                                        _timestamp_correction_sec * _sample_freq_hz));
+}
+
+template<typename DataType_TP>
+inline
+void
+DecimatingQRSDetection<DataType_TP>::Connect(std::function<void(const double&)> callback)
+{
+    _detector.Connect(callback);
+}
+
+template<typename DataType_TP>
+inline
+QRSDetectionState_TP
+DecimatingQRSDetection<DataType_TP>::GetState() const
+{
+    return _detector.GetState();
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+DecimatingQRSDetection<DataType_TP>::GetDecimationFactor()
+{
+    return _decimator.GetDecimationFactor();
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+DecimatingQRSDetection<DataType_TP>::CalculateDecimationFactor(double sample_freq_hz, double target_sample_freq_hz)
+{
+    const long factor = std::lround(sample_freq_hz / target_sample_freq_hz);
+    return factor > 1 ? static_cast<unsigned int>(factor) : 1;
+}
+
+template<typename DataType_TP>
+inline
+std::vector<double>
+DecimatingQRSDetection<DataType_TP>::DesignAntiAliasingTaps(double sample_freq_hz, unsigned int decimation_factor)
+{
+    if ( decimation_factor == 1 ) {
+        // no decimation: pass through
+        return { 1.0 };
+    }
+    // cutoff in the middle between the passband edge and the new nyquist frequency
+    const double cutoff_hz = 0.5 * (_passband_edge_hz + 0.5 * sample_freq_hz / decimation_factor);
+    return DesignLowpassTaps(_taps_per_phase * decimation_factor + 1, cutoff_hz, sample_freq_hz, _kaiser_beta);
+}
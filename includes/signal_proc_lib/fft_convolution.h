@@ -0,0 +1,430 @@
+#pragma once
+
+// Project includes
+#include "time_signal.h"
+#include "thread_pool.h"
+
+// STL includes
+#include <vector>
+#include <complex>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include <bit>
+
+///////////////////////////////////////////////////////
+//
+// Class: FFTPlan_C
+//
+//! Radix-2 complex FFT of one size. The bit reversal permutation and the twiddle factors are calculated once.
+//! A plan is not changed after construction, so one plan is shared by all threads (see Get()).
+class FFTPlan_C {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param size power of two
+    FFTPlan_C(size_t size);
+
+    // Public functions
+public:
+    //! Returns the plan of the size. The plan is created on the first request and cached afterwards
+    static std::shared_ptr<const FFTPlan_C> Get(size_t size);
+
+    //! Forward transform in place: X[k] = sum x[n] e^(-2 pi i k n / size)
+    void Forward(std::complex<double>* data) const;
+
+    //! Inverse transform in place, without the scaling by 1 / size
+    void Inverse(std::complex<double>* data) const;
+
+    size_t GetSize() const;
+
+    // Private functions
+private:
+    template<bool Inverse_TP>
+    void Transform(std::complex<double>* data) const;
+
+    // Private variables
+private:
+    size_t _size = 1;
+
+    //! Index pairs (i, bit reversed i) with i < bit reversed i, which are swapped before the butterflies
+    std::vector<std::pair<unsigned int, unsigned int>> _swaps;
+
+    //! Twiddle factors of all stages: for the stage with butterflies of length len,
+    //! e^(-2 pi i k / len) is stored at _twiddles[len / 2 + k], k < len / 2
+    std::vector<std::complex<double>> _twiddles;
+};
+
+inline
+FFTPlan_C::FFTPlan_C(size_t size)
+    : _size(std::bit_ceil(std::max<size_t>(size, 1)))
+{
+    const unsigned int num_bits = std::countr_zero(_size);
+    for ( size_t idx = 0; idx < _size; ++idx ) {
+        size_t reversed_idx = 0;
+        for ( unsigned int bit = 0; bit < num_bits; ++bit ) {
+            reversed_idx |= ((idx >> bit) & 1) << (num_bits - 1 - bit);
+        }
+        if ( idx < reversed_idx ) {
+            _swaps.emplace_back(static_cast<unsigned int>(idx), static_cast<unsigned int>(reversed_idx));
+        }
+    }
+
+    _twiddles.resize(std::max<size_t>(_size, 2));
+    const double pi = 3.14159265358979323846;
+    for ( size_t len = 2; len <= _size; len *= 2 ) {
+        for ( size_t k = 0; k < len / 2; ++k ) {
+            const double angle = -2.0 * pi * k / len;
+            _twiddles[len / 2 + k] = std::complex<double>(std::cos(angle), std::sin(angle));
+        }
+    }
+}
+
+inline
+std::shared_ptr<const FFTPlan_C>
+FFTPlan_C::Get(size_t size)
+{
+    static std::mutex cache_lock;
+    static std::map<size_t, std::shared_ptr<const FFTPlan_C>> cache;
+
+    size = std::bit_ceil(std::max<size_t>(size, 1));
+    std::unique_lock<std::mutex> lck(cache_lock);
+    auto& plan = cache[size];
+    if ( !plan ) {
+        plan = std::make_shared<const FFTPlan_C>(size);
+    }
+    return plan;
+}
+
+inline
+void
+FFTPlan_C::Forward(std::complex<double>* data) const
+{
+    Transform<false>(data);
+}
+
+inline
+void
+FFTPlan_C::Inverse(std::complex<double>* data) const
+{
+    Transform<true>(data);
+}
+
+inline
+size_t
+FFTPlan_C::GetSize() const
+{
+    return _size;
+}
+
+template<bool Inverse_TP>
+inline
+void
+FFTPlan_C::Transform(std::complex<double>* data) const
+{
+    for ( const auto& swap : _swaps ) {
+        std::swap(data[swap.first], data[swap.second]);
+    }
+
+    // real and imaginary parts are multiplied explicitly:
+    // the operator of std::complex checks for infinities and is not inlined
+    for ( size_t len = 2; len <= _size; len *= 2 ) {
+        const size_t half_len = len / 2;
+        const std::complex<double>* twiddles = _twiddles.data() + half_len;
+        for ( size_t begin = 0; begin < _size; begin += len ) {
+            std::complex<double>* lower = data + begin;
+            std::complex<double>* upper = lower + half_len;
+            for ( size_t k = 0; k < half_len; ++k ) {
+                const double twiddle_real = twiddles[k].real();
+                const double twiddle_imag = Inverse_TP ? -twiddles[k].imag() : twiddles[k].imag();
+                const double product_real = upper[k].real() * twiddle_real - upper[k].imag() * twiddle_imag;
+                const double product_imag = upper[k].real() * twiddle_imag + upper[k].imag() * twiddle_real;
+                upper[k] = std::complex<double>(lower[k].real() - product_real, lower[k].imag() - product_imag);
+                lower[k] = std::complex<double>(lower[k].real() + product_real, lower[k].imag() + product_imag);
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: OfflineFIRFilter
+//
+//! Method of the convolution used by OfflineFIRFilter
+enum class ConvolutionMethod_TP {
+    //! Direct convolution below fft_crossover_num_taps taps, overlap-save FFT convolution above
+    Auto,
+    Direct,
+    FFT
+};
+
+//! Number of taps, from which on the FFT convolution is faster than the direct convolution.
+//! Measured with fir_convolution_benchmark (includes/tests/benchmark)
+constexpr unsigned int fft_crossover_num_taps = 64;
+
+//! FIR filter for whole records (offline), intended for long filters (hundreds of taps).
+//!
+//! The channel is filtered in place, in chunks: a work buffer holds the input of the current chunk
+//! and the num_taps - 1 preceding samples. Because the filter only reads samples at or after the next output,
+//! each chunk is written back to the channel right after it was calculated.
+//! Samples outside of the channel are considered equal to the first / last sample.
+//!
+//! Long filters are calculated with the overlap-save method: the spectrum of the taps is calculated once
+//! and each chunk costs one forward and one inverse FFT. The taps are real, so two consecutive chunks are packed
+//! into the real and imaginary part of one complex FFT. Short filters are calculated directly;
+//! the loop over the samples of a chunk is vectorized by the compiler.
+//!
+//! With compensate_delay, the output is shifted by (num_taps - 1) / 2 samples:
+//! a linear phase (symmetric) filter becomes zero phase, e.g. for the delineation of the waves.
+//!
+//! Usage:
+//! OfflineFIRFilter<double> filter(DesignBandpassTaps(501, 2.0, 40.0, 360.0, 6.0));
+//! filter.Apply(channels, 0);
+template<typename DataType_TP>
+class OfflineFIRFilter {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param taps impulse response
+    //! \param compensate_delay shift the output by the delay of a linear phase filter
+    //! \param method convolution method; Auto selects it with fft_crossover_num_taps
+    OfflineFIRFilter(const std::vector<double>& taps,
+                     bool compensate_delay = true,
+                     ConvolutionMethod_TP method = ConvolutionMethod_TP::Auto);
+
+    // Public functions
+public:
+    //! Filters the samples in place
+    void Apply(std::vector<DataType_TP>& data) const;
+
+    //! Filters the samples of the channel in place
+    void Apply(ECGChannelInfo_TP<DataType_TP>& channel) const;
+
+    //! Filters all channels in place, one task per channel
+    //!
+    //! \param num_threads number of threads; zero uses all hardware threads
+    void Apply(std::vector<ECGChannelInfo_TP<DataType_TP>>& channels, unsigned int num_threads) const;
+
+    //! Returns the method used for the convolution (Direct or FFT)
+    ConvolutionMethod_TP GetMethod() const;
+
+    //! Returns the number of input samples per FFT (zero for the direct convolution)
+    size_t GetFFTSize() const;
+
+    // Private functions
+private:
+    void ApplyDirect(std::vector<DataType_TP>& data) const;
+
+    void ApplyFFT(std::vector<DataType_TP>& data) const;
+
+    //! Copies count input samples, beginning at position (may be outside of the data), to destination
+    static void LoadInput(const std::vector<DataType_TP>& data, long long position, size_t count, double* destination);
+
+    // Private variables
+private:
+    //! Number of outputs per chunk of the direct convolution (the work buffer stays inside the L1 cache)
+    static constexpr size_t _direct_chunk_size = 1024;
+
+    //! The FFT size is at least this multiple of the number of taps, so most of each FFT yields valid outputs
+    static constexpr size_t _fft_size_factor = 8;
+
+    //! Taps in reversed order: the output is the dot product with the input
+    std::vector<double> _reversed_taps;
+
+    //! Shift of the output in samples
+    long long _delay_samples = 0;
+
+    ConvolutionMethod_TP _method = ConvolutionMethod_TP::Direct;
+
+    std::shared_ptr<const FFTPlan_C> _plan;
+
+    //! Spectrum of the taps (zero padded to the FFT size), scaled by 1 / FFT size
+    std::vector<std::complex<double>> _taps_spectrum;
+};
+
+template<typename DataType_TP>
+OfflineFIRFilter<DataType_TP>::OfflineFIRFilter(const std::vector<double>& taps,
+                                                bool compensate_delay,
+                                                ConvolutionMethod_TP method)
+    : _reversed_taps(taps.rbegin(), taps.rend())
+{
+    if ( _reversed_taps.empty() ) {
+        _reversed_taps.push_back(1.0);
+    }
+    const size_t num_taps = _reversed_taps.size();
+    _delay_samples = compensate_delay ? static_cast<long long>((num_taps - 1) / 2) : 0;
+
+    _method = method;
+    if ( _method == ConvolutionMethod_TP::Auto ) {
+        _method = num_taps < fft_crossover_num_taps ? ConvolutionMethod_TP::Direct : ConvolutionMethod_TP::FFT;
+    }
+
+    if ( _method == ConvolutionMethod_TP::FFT ) {
+        _plan = FFTPlan_C::Get(_fft_size_factor * num_taps);
+        const size_t fft_size = _plan->GetSize();
+        _taps_spectrum.assign(fft_size, std::complex<double>(0.0, 0.0));
+        for ( size_t idx = 0; idx < num_taps; ++idx ) {
+            _taps_spectrum[idx] = taps[idx] / static_cast<double>(fft_size);
+        }
+        _plan->Forward(_taps_spectrum.data());
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+OfflineFIRFilter<DataType_TP>::Apply(std::vector<DataType_TP>& data) const
+{
+    if ( data.empty() ) {
+        return;
+    }
+    if ( _method == ConvolutionMethod_TP::FFT ) {
+        ApplyFFT(data);
+    } else {
+        ApplyDirect(data);
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+OfflineFIRFilter<DataType_TP>::Apply(ECGChannelInfo_TP<DataType_TP>& channel) const
+{
+    Apply(channel._data);
+    if ( !channel._data.empty() ) {
+        const auto min_max = std::minmax_element(channel._data.begin(), channel._data.end());
+        channel._min_val = *min_max.first;
+        channel._max_val = *min_max.second;
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+OfflineFIRFilter<DataType_TP>::Apply(std::vector<ECGChannelInfo_TP<DataType_TP>>& channels, unsigned int num_threads) const
+{
+    ThreadPool_C pool(std::min<unsigned int>(num_threads == 0 ? std::thread::hardware_concurrency() : num_threads,
+                                             std::max<size_t>(channels.size(), 1)));
+    for ( auto& channel : channels ) {
+        pool.AddTask([this, &channel]() { Apply(channel); });
+    }
+    pool.WaitUntilFinished();
+}
+
+template<typename DataType_TP>
+inline
+ConvolutionMethod_TP
+OfflineFIRFilter<DataType_TP>::GetMethod() const
+{
+    return _method;
+}
+
+template<typename DataType_TP>
+inline
+size_t
+OfflineFIRFilter<DataType_TP>::GetFFTSize() const
+{
+    return _plan ? _plan->GetSize() : 0;
+}
+
+template<typename DataType_TP>
+inline
+void
+OfflineFIRFilter<DataType_TP>::LoadInput(const std::vector<DataType_TP>& data, long long position, size_t count, double* destination)
+{
+    const long long num_samples = static_cast<long long>(data.size());
+    for ( size_t idx = 0; idx < count; ++idx, ++position ) {
+        const long long clamped_position = std::clamp(position, 0LL, num_samples - 1);
+        destination[idx] = static_cast<double>(data[clamped_position]);
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+OfflineFIRFilter<DataType_TP>::ApplyDirect(std::vector<DataType_TP>& data) const
+{
+    const size_t num_taps = _reversed_taps.size();
+    const size_t history_size = num_taps - 1;
+    const size_t num_samples = data.size();
+
+    // input of the outputs [chunk_begin, chunk_begin + _direct_chunk_size):
+    // positions [chunk_begin + delay - history_size, chunk_begin + delay + _direct_chunk_size)
+    std::vector<double> input(history_size + _direct_chunk_size);
+    std::vector<double> output(_direct_chunk_size);
+    long long input_begin = _delay_samples - static_cast<long long>(history_size);
+    LoadInput(data, input_begin, input.size(), input.data());
+
+    for ( size_t chunk_begin = 0; chunk_begin < num_samples; chunk_begin += _direct_chunk_size ) {
+        // one pass over the chunk per tap: no loop carried dependency, so the loop is vectorized
+        std::fill(output.begin(), output.end(), 0.0);
+        for ( size_t tap_idx = 0; tap_idx < num_taps; ++tap_idx ) {
+            const double tap = _reversed_taps[tap_idx];
+            const double* tap_input = input.data() + tap_idx;
+            for ( size_t idx = 0; idx < _direct_chunk_size; ++idx ) {
+                output[idx] += tap * tap_input[idx];
+            }
+        }
+
+        const size_t chunk_size = std::min(_direct_chunk_size, num_samples - chunk_begin);
+        for ( size_t idx = 0; idx < chunk_size; ++idx ) {
+            data[chunk_begin + idx] = static_cast<DataType_TP>(output[idx]);
+        }
+
+        // the next input starts _direct_chunk_size samples later; the history is kept.
+        // The new input is located after the next chunk, which is not written yet
+        std::copy(input.begin() + _direct_chunk_size, input.end(), input.begin());
+        input_begin += _direct_chunk_size;
+        LoadInput(data, input_begin + history_size, _direct_chunk_size, input.data() + history_size);
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+OfflineFIRFilter<DataType_TP>::ApplyFFT(std::vector<DataType_TP>& data) const
+{
+    const size_t num_taps = _reversed_taps.size();
+    const size_t history_size = num_taps - 1;
+    const size_t num_samples = data.size();
+    const size_t fft_size = _plan->GetSize();
+    // valid outputs of one FFT; the first history_size outputs contain the wrap around of the circular convolution
+    const size_t chunk_size = fft_size - history_size;
+
+    // input of two consecutive chunks: the first is transformed as real part, the second as imaginary part
+    std::vector<double> input(history_size + 2 * chunk_size);
+    std::vector<std::complex<double>> spectrum(fft_size);
+    long long input_begin = _delay_samples - static_cast<long long>(history_size);
+    LoadInput(data, input_begin, input.size(), input.data());
+
+    for ( size_t chunk_begin = 0; chunk_begin < num_samples; chunk_begin += 2 * chunk_size ) {
+        for ( size_t idx = 0; idx < fft_size; ++idx ) {
+            spectrum[idx] = std::complex<double>(input[idx], input[chunk_size + idx]);
+        }
+        _plan->Forward(spectrum.data());
+        for ( size_t idx = 0; idx < fft_size; ++idx ) {
+            const std::complex<double> value = spectrum[idx];
+            const std::complex<double> tap = _taps_spectrum[idx];
+            spectrum[idx] = std::complex<double>(value.real() * tap.real() - value.imag() * tap.imag(),
+                                                 value.real() * tap.imag() + value.imag() * tap.real());
+        }
+        _plan->Inverse(spectrum.data());
+
+        const size_t first_chunk_size = std::min(chunk_size, num_samples - chunk_begin);
+        for ( size_t idx = 0; idx < first_chunk_size; ++idx ) {
+            data[chunk_begin + idx] = static_cast<DataType_TP>(spectrum[history_size + idx].real());
+        }
+        if ( chunk_begin + chunk_size < num_samples ) {
+            const size_t second_chunk_size = std::min(chunk_size, num_samples - chunk_begin - chunk_size);
+            for ( size_t idx = 0; idx < second_chunk_size; ++idx ) {
+                data[chunk_begin + chunk_size + idx] = static_cast<DataType_TP>(spectrum[history_size + idx].imag());
+            }
+        }
+
+        std::copy(input.begin() + 2 * chunk_size, input.end(), input.begin());
+        input_begin += 2 * chunk_size;
+        LoadInput(data, input_begin + history_size, 2 * chunk_size, input.data() + history_size);
+    }
+}
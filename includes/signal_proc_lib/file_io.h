@@ -11,6 +11,7 @@
 #include <map>
 #include <tuple>
 #include <array>
+#include <algorithm>
 
 class FileIO_C {
 
@@ -37,10 +38,10 @@ public:
     std::map<unsigned int, std::vector<DataFormat_TP>> ReadColumnData(uint32_t n_cols, uint32_t n_rows);
 
     template<class yVal, class xVal, uint32_t data_length>
-    void Read2DPoints();
+    std::vector<std::pair<yVal, xVal>> Read2DPoints();
 
     template<class yValType, class xValType, uint32_t length>
-    void ReadCSV(char delemitter);
+    std::vector<std::pair<yValType, xValType>> ReadCSV(char delemitter);
 
     template<class Type_IT>
     int64_t CountLines();
@@ -146,14 +147,14 @@ std::map<unsigned int, std::vector<DataFormat_TP>> FileIO_C::ReadColumnData(uint
 // Dynamic template parameter list ? |
 // length does not need to be the exact length (number of liens) because it uses push back
 template<class yValType, class xValType, uint32_t length>
-void FileIO_C::Read2DPoints() {
+std::vector<std::pair<yValType, xValType>> FileIO_C::Read2DPoints() {
     std::vector<std::pair<yValType, xValType>> data;
     data.reserve(length);
     yValType y_value;
     xValType x_value;
     // Process data and store inside the data vector
-    while ( _filestream >> y_value >> timestamp ) {
-        data.push_back(std::make_pair(y_value, timestamp));
+    while ( _filestream >> y_value >> x_value ) {
+        data.push_back(std::make_pair(y_value, x_value));
     }
     return data;
 }
@@ -178,7 +179,7 @@ FileIO_C::ReadBytes(const int number_of_bytes, char* buffer)
 }
 
 template<class yValType, class xValType, uint32_t length>
-void FileIO_C::ReadCSV(char delemitter)
+std::vector<std::pair<yValType, xValType>> FileIO_C::ReadCSV(char delemitter)
 {
     std::vector<std::pair<yValType, xValType>> data;
     data.reserve(length);
@@ -187,8 +188,8 @@ void FileIO_C::ReadCSV(char delemitter)
     xValType x_value;
     char token = delemitter;
     // Process data and store inside the data vector
-    while ( (_filestream >> y_value >> token >> timestamp) && (token == delemitter) ) {
-        data.emplace_back(std::make_pair(y_value, timestamp));
+    while ( (_filestream >> y_value >> token >> x_value) && (token == delemitter) ) {
+        data.emplace_back(std::make_pair(y_value, x_value));
     }
 
     return data;
@@ -0,0 +1,420 @@
+#pragma once
+
+// Project includes
+#include "rt_state_filters.h"
+#include "qrs_filter_chain.h"
+#include "span.h"
+
+// STL includes
+#include <vector>
+#include <memory>
+#include <map>
+#include <tuple>
+#include <cmath>
+#include <algorithm>
+
+//! Stages of the qrs filter chain, which are provided as derived streams by FilteredStreamCache_TC.
+//! Each stage is derived from the stream of the previous stage (the bandpassed stream from the input)
+enum class QRSStreamStage_TP {
+    Bandpassed,
+    Differentiated,
+    Squared,
+    //! Output of the complete filter chain (input of the decision logic of PanTopkinsQRSDetection)
+    Integrated
+};
+
+//! Filter configuration of a derived stream: the key of the stream inside FilteredStreamCache_TC
+struct FilteredStreamKey_TP {
+    QRSStreamStage_TP _stage = QRSStreamStage_TP::Integrated;
+    QRSBandpass_TP _bandpass = QRSBandpass_TP::FIR;
+
+    bool operator<(const FilteredStreamKey_TP& other) const
+    {
+        return std::tie(_bandpass, _stage) < std::tie(other._bandpass, other._stage);
+    }
+};
+
+///////////////////////////////////////////////////////
+//
+// Class: QRSStageFilter
+//
+//! One stage of the qrs filter chain behind the QRSFilterChain interface,
+//! so the streams of FilteredStreamCache_TC store the different stage filters the same way
+template<typename DataType_TP, typename Filter_TP>
+class QRSStageFilter : public QRSFilterChain<DataType_TP> {
+
+    // Construction / Destruction / Copying
+public:
+    QRSStageFilter(Filter_TP filter, unsigned int delay_samples);
+
+    // Public functions
+public:
+    void Apply(DataType_TP* dst, const DataType_TP* src, size_t block_size) override;
+
+    DataType_TP Process(const DataType_TP sample) override;
+
+    void ResetState() override;
+
+    //! Returns the delay of this stage only
+    unsigned int GetFilterDelay() override;
+
+    // Private variables
+private:
+    FilterPipeline<Filter_TP> _pipeline;
+
+    unsigned int _delay_samples = 0;
+};
+
+template<typename DataType_TP, typename Filter_TP>
+QRSStageFilter<DataType_TP, Filter_TP>::QRSStageFilter(Filter_TP filter, unsigned int delay_samples)
+    : _pipeline(std::move(filter)),
+    _delay_samples(delay_samples)
+{
+}
+
+template<typename DataType_TP, typename Filter_TP>
+inline
+void
+QRSStageFilter<DataType_TP, Filter_TP>::Apply(DataType_TP* dst, const DataType_TP* src, size_t block_size)
+{
+    _pipeline.Apply(dst, src, block_size);
+}
+
+template<typename DataType_TP, typename Filter_TP>
+inline
+DataType_TP
+QRSStageFilter<DataType_TP, Filter_TP>::Process(const DataType_TP sample)
+{
+    return _pipeline.Process(sample);
+}
+
+template<typename DataType_TP, typename Filter_TP>
+inline
+void
+QRSStageFilter<DataType_TP, Filter_TP>::ResetState()
+{
+    _pipeline.ResetState();
+}
+
+template<typename DataType_TP, typename Filter_TP>
+inline
+unsigned int
+QRSStageFilter<DataType_TP, Filter_TP>::GetFilterDelay()
+{
+    return _delay_samples;
+}
+
+template<typename DataType_TP>
+class FilteredStreamCache_TC;
+
+///////////////////////////////////////////////////////
+//
+// Class: FilteredStream_TC
+//
+//! Derived stream of FilteredStreamCache_TC: the output of one filter stage for the last appended block.
+//! Consumers read the samples through GetBlock() without copying them.
+//! The stream keeps the stream it is derived from alive, so a stream is torn down as soon as
+//! neither a consumer nor a stream derived from it holds it.
+template<typename DataType_TP>
+class FilteredStream_TC {
+
+    // Public functions
+public:
+    //! Returns the samples of the stream, which belong to the last block appended to the cache.
+    //! The view is valid until the next block is appended
+    span<const DataType_TP> GetBlock() const;
+
+    //! Returns the timestamp of the first input sample of the last block
+    double GetBlockTimestamp() const;
+
+    //! Returns the delay of the stream relative to the input in samples (the sum of the delays of all stages up to this stage).
+    //! The delay of the moving average is the half window; PanTopkinsQRSDetection uses its own GetFilterDelay() instead
+    unsigned int GetFilterDelay() const;
+
+    FilteredStreamKey_TP GetKey() const;
+
+    // Private functions
+private:
+    friend class FilteredStreamCache_TC<DataType_TP>;
+
+    FilteredStream_TC(const FilteredStreamKey_TP& key,
+                      std::shared_ptr<FilteredStream_TC<DataType_TP>> source,
+                      std::unique_ptr<QRSFilterChain<DataType_TP>> stage_filter);
+
+    // Private variables
+private:
+    FilteredStreamKey_TP _key;
+
+    //! Stream, which is filtered by _stage_filter. nullptr for the bandpassed stream (filters the input)
+    std::shared_ptr<FilteredStream_TC<DataType_TP>> _source;
+
+    std::unique_ptr<QRSFilterChain<DataType_TP>> _stage_filter;
+
+    unsigned int _delay_samples = 0;
+
+    //! Output of the last block; grows to the largest block size
+    std::vector<DataType_TP> _samples;
+
+    size_t _num_samples = 0;
+
+    double _t0_sec = 0.0;
+
+    //! Number of the block inside _samples, so each stream is filtered once per block, independent of the number of derived streams
+    size_t _block_number = 0;
+};
+
+template<typename DataType_TP>
+FilteredStream_TC<DataType_TP>::FilteredStream_TC(const FilteredStreamKey_TP& key,
+                                                  std::shared_ptr<FilteredStream_TC<DataType_TP>> source,
+                                                  std::unique_ptr<QRSFilterChain<DataType_TP>> stage_filter)
+    : _key(key),
+    _source(std::move(source)),
+    _stage_filter(std::move(stage_filter))
+{
+    _delay_samples = _stage_filter->GetFilterDelay() + (_source ? _source->GetFilterDelay() : 0);
+}
+
+template<typename DataType_TP>
+inline
+span<const DataType_TP>
+FilteredStream_TC<DataType_TP>::GetBlock() const
+{
+    return span<const DataType_TP>(_samples.data(), _num_samples);
+}
+
+template<typename DataType_TP>
+inline
+double
+FilteredStream_TC<DataType_TP>::GetBlockTimestamp() const
+{
+    return _t0_sec;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+FilteredStream_TC<DataType_TP>::GetFilterDelay() const
+{
+    return _delay_samples;
+}
+
+template<typename DataType_TP>
+inline
+FilteredStreamKey_TP
+FilteredStream_TC<DataType_TP>::GetKey() const
+{
+    return _key;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: FilteredStreamCache_TC
+//
+//! Shared pre-processing of one channel: each derived stream (stage of the qrs filter chain with one bandpass)
+//! is computed once per appended block, no matter how many consumers (detectors, display, measurements) read it.
+//!
+//! Acquire() returns the stream of a configuration and creates it together with the streams it is derived from,
+//! if no consumer holds it yet. The cache only keeps weak references: a stream is torn down, as soon as it is released
+//! by all consumers and is not the source of another stream (its entry is removed with the next appended block).
+//! A newly created stream starts with empty filter states at the next block.
+//!
+//! The cache and its streams are used from one thread: append a block, then let the consumers read their views.
+//!
+//! Usage:
+//! FilteredStreamCache_TC<double> cache(360.0);
+//! auto integrated = cache.Acquire({ QRSStreamStage_TP::Integrated, QRSBandpass_TP::FIR });
+//! auto bandpassed = cache.Acquire({ QRSStreamStage_TP::Bandpassed, QRSBandpass_TP::FIR }); // computed once, shared
+//! cache.AppendBlock(block, t0_sec);
+//! detector.AppendFilteredBlock(integrated->GetBlock(), integrated->GetBlockTimestamp());
+template<typename DataType_TP>
+class FilteredStreamCache_TC {
+
+    // Construction / Destruction / Copying
+public:
+    FilteredStreamCache_TC(double sample_freq_hz);
+
+    // Public functions
+public:
+    //! Returns the stream of the configuration. It stays alive as long as the returned pointer is held
+    std::shared_ptr<const FilteredStream_TC<DataType_TP>> Acquire(const FilteredStreamKey_TP& key);
+
+    //! Filters the block once for each live stream (sources before derived streams) and tears down released streams
+    //!
+    //! \param t0_sec the timestamp of the first sample inside the block
+    void AppendBlock(span<const DataType_TP> samples, const double t0_sec);
+
+    //! Clears the filter states of all live streams
+    void ResetState();
+
+    //! Returns the number of streams inside the cache, including the streams, which are only held as source of other streams.
+    //! Released streams are counted until the next appended block
+    size_t GetStreamCount();
+
+    double GetSampleFrequency();
+
+    // Private functions
+private:
+    std::shared_ptr<FilteredStream_TC<DataType_TP>> GetOrCreateStream(const FilteredStreamKey_TP& key);
+
+    std::unique_ptr<QRSFilterChain<DataType_TP>> CreateStageFilter(const FilteredStreamKey_TP& key);
+
+    //! Filters the block into the stream, after its source stream was filtered
+    void FilterStream(FilteredStream_TC<DataType_TP>& stream, span<const DataType_TP> samples, const double t0_sec);
+
+    // Private variables
+private:
+    double _sample_freq_hz = 1.0;
+
+    std::map<FilteredStreamKey_TP, std::weak_ptr<FilteredStream_TC<DataType_TP>>> _streams;
+
+    //! Number of the last appended block
+    size_t _block_number = 0;
+};
+
+template<typename DataType_TP>
+FilteredStreamCache_TC<DataType_TP>::FilteredStreamCache_TC(double sample_freq_hz)
+    : _sample_freq_hz(sample_freq_hz)
+{
+}
+
+template<typename DataType_TP>
+inline
+std::shared_ptr<const FilteredStream_TC<DataType_TP>>
+FilteredStreamCache_TC<DataType_TP>::Acquire(const FilteredStreamKey_TP& key)
+{
+    return GetOrCreateStream(key);
+}
+
+template<typename DataType_TP>
+inline
+std::shared_ptr<FilteredStream_TC<DataType_TP>>
+FilteredStreamCache_TC<DataType_TP>::GetOrCreateStream(const FilteredStreamKey_TP& key)
+{
+    auto stream_it = _streams.find(key);
+    if ( stream_it != _streams.end() ) {
+        if ( auto stream = stream_it->second.lock() ) {
+            return stream;
+        }
+    }
+
+    std::shared_ptr<FilteredStream_TC<DataType_TP>> source;
+    if ( key._stage != QRSStreamStage_TP::Bandpassed ) {
+        const auto source_stage = static_cast<QRSStreamStage_TP>(static_cast<int>(key._stage) - 1);
+        source = GetOrCreateStream({ source_stage, key._bandpass });
+    }
+    // the constructor is private
+    std::shared_ptr<FilteredStream_TC<DataType_TP>> stream(
+        new FilteredStream_TC<DataType_TP>(key, std::move(source), CreateStageFilter(key)));
+    // up to date with the last block, so it starts with the next one
+    stream->_block_number = _block_number;
+    _streams[key] = stream;
+    return stream;
+}
+
+template<typename DataType_TP>
+inline
+std::unique_ptr<QRSFilterChain<DataType_TP>>
+FilteredStreamCache_TC<DataType_TP>::CreateStageFilter(const FilteredStreamKey_TP& key)
+{
+    // same stages as the qrs filter chains (see RuntimeQRSFilterChain and IIRQRSFilterChain)
+    switch ( key._stage ) {
+    case QRSStreamStage_TP::Bandpassed:
+        if ( key._bandpass == QRSBandpass_TP::ButterworthIIR ) {
+            const auto sections = DesignButterworthBandpassSections(QRSFilterParams_TP::_highpass_cutoff_hz,
+                                                                    QRSFilterParams_TP::_lowpass_cutoff_hz,
+                                                                    _sample_freq_hz);
+            const double center_freq_hz = 0.5 * (QRSFilterParams_TP::_highpass_cutoff_hz + QRSFilterParams_TP::_lowpass_cutoff_hz);
+            const auto delay_samples = static_cast<unsigned int>(std::lround(BiquadCascadeGroupDelay(sections, center_freq_hz, _sample_freq_hz)));
+            using Filter_TP = BiquadCascadeStateFilter<DataType_TP, QRSFilterParams_TP::_num_iir_sections>;
+            return std::make_unique<QRSStageFilter<DataType_TP, Filter_TP>>(Filter_TP(sections), delay_samples);
+        } else {
+            using Filter_TP = FIRStateFilter<DataType_TP, QRSFilterParams_TP::_num_taps>;
+            return std::make_unique<QRSStageFilter<DataType_TP, Filter_TP>>(
+                Filter_TP(DesignBandpassTaps<QRSFilterParams_TP::_num_taps>(QRSFilterParams_TP::_highpass_cutoff_hz,
+                                                                            QRSFilterParams_TP::_lowpass_cutoff_hz,
+                                                                            _sample_freq_hz,
+                                                                            QRSFilterParams_TP::_kaiser_beta)),
+                QRSFilterParams_TP::_num_taps / 2);
+        }
+    case QRSStreamStage_TP::Differentiated:
+        return std::make_unique<QRSStageFilter<DataType_TP, DerivationStateFilter<DataType_TP>>>(DerivationStateFilter<DataType_TP>(), 0);
+    case QRSStreamStage_TP::Squared:
+        return std::make_unique<QRSStageFilter<DataType_TP, SquaringStateFilter<DataType_TP>>>(SquaringStateFilter<DataType_TP>(), 0);
+    case QRSStreamStage_TP::Integrated:
+    default:
+        MovingAverageStateFilter<DataType_TP> moving_average((static_cast<double>(QRSFilterParams_TP::_window_length_ms) / 1000.0) * _sample_freq_hz);
+        const auto delay_samples = static_cast<unsigned int>(moving_average.GetFilterDelay());
+        return std::make_unique<QRSStageFilter<DataType_TP, MovingAverageStateFilter<DataType_TP>>>(std::move(moving_average), delay_samples);
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+FilteredStreamCache_TC<DataType_TP>::AppendBlock(span<const DataType_TP> samples, const double t0_sec)
+{
+    ++_block_number;
+    for ( auto stream_it = _streams.begin(); stream_it != _streams.end(); ) {
+        auto stream = stream_it->second.lock();
+        if ( !stream ) {
+            // released by all consumers and derived streams
+            stream_it = _streams.erase(stream_it);
+            continue;
+        }
+        FilterStream(*stream, samples, t0_sec);
+        ++stream_it;
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+FilteredStreamCache_TC<DataType_TP>::FilterStream(FilteredStream_TC<DataType_TP>& stream,
+                                                  span<const DataType_TP> samples,
+                                                  const double t0_sec)
+{
+    if ( stream._block_number == _block_number ) {
+        return;
+    }
+    const DataType_TP* src = samples.data();
+    if ( stream._source ) {
+        FilterStream(*stream._source, samples, t0_sec);
+        src = stream._source->_samples.data();
+    }
+    if ( stream._samples.size() < samples.size() ) {
+        stream._samples.resize(samples.size());
+    }
+    stream._stage_filter->Apply(stream._samples.data(), src, samples.size());
+    stream._num_samples = samples.size();
+    stream._t0_sec = t0_sec;
+    stream._block_number = _block_number;
+}
+
+template<typename DataType_TP>
+inline
+void
+FilteredStreamCache_TC<DataType_TP>::ResetState()
+{
+    for ( auto& [key, weak_stream] : _streams ) {
+        if ( auto stream = weak_stream.lock() ) {
+            stream->_stage_filter->ResetState();
+            stream->_num_samples = 0;
+        }
+    }
+}
+
+template<typename DataType_TP>
+inline
+size_t
+FilteredStreamCache_TC<DataType_TP>::GetStreamCount()
+{
+    return _streams.size();
+}
+
+template<typename DataType_TP>
+inline
+double
+FilteredStreamCache_TC<DataType_TP>::GetSampleFrequency()
+{
+    return _sample_freq_hz;
+}
@@ -0,0 +1,355 @@
+#pragma once
+
+// Projects includes
+#include "pan_topkins_qrs_detector.h"
+#include "qrs_filter_chain.h"
+
+// STL includes
+#include <array>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+#include <functional>
+
+///////////////////////////////////////////////////////
+//
+// Class: FixedPointQRSFilterChain
+//
+//! Integer version of the pan topkins filter stages (bandpass, derivation, squaring and moving average)
+//! for raw ADC counts, e.g. the samples returned by MITFileIO_C<int16_t>::Read().
+//!
+//! The bandpass taps are quantized to 16 bit. Their scale is chosen, so the sum of the absolute taps
+//! stays below 2^15: for 16 bit samples the bandpass accumulates exactly in 32 bit (|result| < 2^30),
+//! which the compiler maps to the 16 bit multiply-add SIMD instructions.
+//! 32 bit samples accumulate in 64 bit.
+//! The bandpass output keeps as many fractional bits as the ADC resolution allows without an overflow
+//! of the 64 bit window sums, so the rounding noise does not create additional peaks in the integrated signal.
+//! The moving average outputs the integer window sum, without the division by the window length,
+//! so it is exact and does not drift.
+//!
+//! The output is a constant multiple of the output of QRSFilterChain for the same counts.
+template<typename SampleType_TP>
+class FixedPointQRSFilterChain {
+
+    static_assert(std::is_integral<SampleType_TP>::value && std::is_signed<SampleType_TP>::value &&
+                  sizeof(SampleType_TP) <= 4,
+                  "FixedPointQRSFilterChain requires signed 16 or 32 bit samples");
+
+    // Construction / Destruction / Copying
+public:
+    //! \param adc_resolution_bits number of used bits of the samples (e.g. MITDataChannel_TP::_adc_resolution_bits);
+    //!        the full range of the sample type, if zero
+    FixedPointQRSFilterChain(double sample_freq_hz, unsigned int adc_resolution_bits = 0);
+
+    // Public functions
+public:
+    //! Filters the block src into dst (moving average window sums)
+    void Apply(int64_t* dst, const SampleType_TP* src, size_t block_size);
+
+    void ResetState();
+
+    //! Number of fractional bits of the quantized bandpass taps
+    int GetTapFractionalBits();
+
+    //! Number of fractional bits of the bandpass output (negative, if integer bits are dropped)
+    int GetOutputFractionalBits();
+
+    // Private types
+private:
+    using Accumulator_TP = std::conditional_t<sizeof(SampleType_TP) <= 2, int32_t, int64_t>;
+
+    // Private variables
+private:
+    static constexpr unsigned int _num_taps = QRSFilterParams_TP::_num_taps;
+
+    //! Upper limit for the sum of the absolute quantized taps (minus the rounding error of each tap)
+    static constexpr double _tap_sum_limit = (1 << 15) - static_cast<double>(_num_taps);
+
+    //! Bits available for the window sums (one bit headroom)
+    static constexpr double _window_sum_bits = 62.0;
+
+    std::array<int16_t, _num_taps> _taps{};
+
+    int _tap_fractional_bits = 0;
+
+    //! Right shift of the bandpass accumulator
+    int _output_shift = 0;
+
+    //! Delay line of the bandpass, stored twice in a row:
+    //! the newest sample is at _fir_read_idx, the older ones follow without wrapping
+    std::array<SampleType_TP, 2 * _num_taps> _fir_delay_line{};
+
+    unsigned int _fir_read_idx = 0;
+
+    int64_t _last_bandpass_output = 0;
+
+    // Moving average
+    std::vector<int64_t> _ma_buffer;
+
+    int64_t _ma_sum = 0;
+
+    size_t _ma_num_samples = 0;
+
+    size_t _ma_head_idx = 0;
+
+    size_t _ma_tail_idx = 0;
+};
+
+template<typename SampleType_TP>
+FixedPointQRSFilterChain<SampleType_TP>::FixedPointQRSFilterChain(double sample_freq_hz, unsigned int adc_resolution_bits)
+{
+    const auto taps = DesignBandpassTaps<_num_taps>(QRSFilterParams_TP::_highpass_cutoff_hz,
+                                                    QRSFilterParams_TP::_lowpass_cutoff_hz,
+                                                    sample_freq_hz,
+                                                    QRSFilterParams_TP::_kaiser_beta);
+    double tap_sum = 0.0;
+    for ( const auto& tap : taps ) {
+        tap_sum += std::abs(tap);
+    }
+    _tap_fractional_bits = static_cast<int>(std::floor(std::log2(_tap_sum_limit / tap_sum)));
+    const double tap_scale = std::ldexp(1.0, _tap_fractional_bits);
+    for ( unsigned int tap_idx = 0; tap_idx < _num_taps; ++tap_idx ) {
+        _taps[tap_idx] = static_cast<int16_t>(std::lround(taps[tap_idx] * tap_scale));
+    }
+
+    // same window length as the floating point filter chains
+    const size_t window_length = static_cast<size_t>(QRSFilterParams_TP::_window_length_ms * sample_freq_hz / 1000.0);
+    _ma_buffer.resize(window_length > 0 ? window_length : 1);
+
+    // Magnitude bits of the derivation output of full scale counts (without fractional bits).
+    // The window sums of the squared derivation must fit into _window_sum_bits
+    if ( adc_resolution_bits == 0 || adc_resolution_bits > 8 * sizeof(SampleType_TP) ) {
+        adc_resolution_bits = 8 * sizeof(SampleType_TP);
+    }
+    const double derivation_bits = adc_resolution_bits + std::log2(tap_sum);
+    const int output_fractional_bits =
+        static_cast<int>(std::floor((_window_sum_bits - std::log2(_ma_buffer.size())) / 2.0 - derivation_bits));
+    _output_shift = _tap_fractional_bits - std::min(output_fractional_bits, _tap_fractional_bits);
+}
+
+template<typename SampleType_TP>
+inline
+void
+FixedPointQRSFilterChain<SampleType_TP>::Apply(int64_t* dst, const SampleType_TP* src, size_t block_size)
+{
+    const Accumulator_TP rounding = _output_shift > 0 ? Accumulator_TP(1) << (_output_shift - 1) : 0;
+    const size_t window_length = _ma_buffer.size();
+
+    // bandpass
+    for ( size_t idx = 0; idx < block_size; ++idx ) {
+        _fir_read_idx = _fir_read_idx == 0 ? _num_taps - 1 : _fir_read_idx - 1;
+        _fir_delay_line[_fir_read_idx] = src[idx];
+        _fir_delay_line[_fir_read_idx + _num_taps] = src[idx];
+
+        const SampleType_TP* history = _fir_delay_line.data() + _fir_read_idx;
+        Accumulator_TP result = 0;
+        for ( unsigned int tap_idx = 0; tap_idx < _num_taps; ++tap_idx ) {
+            result += static_cast<Accumulator_TP>(_taps[tap_idx]) * history[tap_idx];
+        }
+        // arithmetic shift: rounds to the nearest integer
+        dst[idx] = static_cast<int64_t>((result + rounding) >> _output_shift);
+    }
+
+    // derivation and squaring
+    for ( size_t idx = 0; idx < block_size; ++idx ) {
+        const int64_t bandpass_output = dst[idx];
+        const int64_t diff = bandpass_output - _last_bandpass_output;
+        _last_bandpass_output = bandpass_output;
+        dst[idx] = diff * diff;
+    }
+
+    // moving average (window sum)
+    for ( size_t idx = 0; idx < block_size; ++idx ) {
+        _ma_sum += dst[idx];
+        ++_ma_num_samples;
+        _ma_buffer[_ma_head_idx] = dst[idx];
+        _ma_head_idx = _ma_head_idx + 1 == window_length ? 0 : _ma_head_idx + 1;
+
+        dst[idx] = _ma_sum;
+
+        if ( _ma_num_samples >= window_length ) {
+            _ma_sum -= _ma_buffer[_ma_tail_idx];
+            _ma_tail_idx = _ma_tail_idx + 1 == window_length ? 0 : _ma_tail_idx + 1;
+        }
+    }
+}
+
+template<typename SampleType_TP>
+inline
+void
+FixedPointQRSFilterChain<SampleType_TP>::ResetState()
+{
+    _fir_delay_line.fill(0);
+    _fir_read_idx = 0;
+    _last_bandpass_output = 0;
+    _ma_sum = 0;
+    _ma_num_samples = 0;
+    _ma_head_idx = 0;
+    _ma_tail_idx = 0;
+}
+
+template<typename SampleType_TP>
+inline
+int
+FixedPointQRSFilterChain<SampleType_TP>::GetTapFractionalBits()
+{
+    return _tap_fractional_bits;
+}
+
+template<typename SampleType_TP>
+inline
+int
+FixedPointQRSFilterChain<SampleType_TP>::GetOutputFractionalBits()
+{
+    return _tap_fractional_bits - _output_shift;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: FixedPointQRSDetection
+//
+//! PanTopkinsQRSDetection on raw integer ADC counts.
+//!
+//! The filter stages run in integer arithmetic (see FixedPointQRSFilterChain), which halves (int32)
+//! or quarters (int16) the memory traffic of the input and doubles / quadruples the SIMD width of the bandpass.
+//! The adaptive thresholds are relative to the filtered signal, so the decision logic of PanTopkinsQRSDetection
+//! is used unchanged: it reports the same beats as the floating point detection of the same counts.
+//! Due to the quantized taps, a beat can be reported one sample earlier or later,
+//! when two neighbouring samples of the integrated signal are almost equal.
+//! The amplitudes of the published BeatEvent_TP are in the scale of the integer window sums.
+//!
+//! Usage:
+//! MITFileIO_C<int16_t> file_io;
+//! auto channels = file_io.Read(path);
+//! FixedPointQRSDetection<int16_t> detector(360.0, 2, channels[0]._adc_resolution_bits);
+//! detector.Connect([](const double& timestamp) { ... });
+//! detector.AppendBlock(span<const int16_t>(channels[0]._data.data(), channels[0]._data.size()), 0.0);
+template<typename SampleType_TP = int16_t>
+class FixedPointQRSDetection {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param adc_resolution_bits see FixedPointQRSFilterChain
+    FixedPointQRSDetection(double sample_freq_hz,
+                           unsigned int training_phase_duration_sec,
+                           unsigned int adc_resolution_bits = 0);
+
+    // Public functions
+public:
+    //! See PanTopkinsQRSDetection::AppendPoint()
+    void AppendPoint(const SampleType_TP& sample, const double timestamp_sec);
+
+    //! See PanTopkinsQRSDetection::AppendBlock()
+    void AppendBlock(span<const SampleType_TP> samples, const double t0_sec);
+
+    //! Returns the delay due to the filtering in number of samples
+    int GetFilterDelay();
+
+    //! Stores the callback, which is called, when a qrs complex was detected
+    void Connect(std::function<void(const double&)> callback);
+
+    //! See PanTopkinsQRSDetection::ConnectEventQueue()
+    void ConnectEventQueue(SPSCQueue_TC<BeatEvent_TP>* event_queue);
+
+    //! Returns the number of events, which were dropped because the event queue was full
+    size_t GetNumDroppedEvents();
+
+    //! Returns the current thresholds, levels and counters (in the scale of the integer window sums)
+    QRSDetectionState_TP GetState() const;
+
+    // Private variables
+private:
+    //! Number of samples filtered at once, so the working buffers stay inside the L1 cache
+    static constexpr size_t _chunk_size = 256;
+
+    double _sample_freq_hz = 0.0;
+
+    FixedPointQRSFilterChain<SampleType_TP> _filter_chain;
+
+    //! Decision logic on the integer window sums
+    PanTopkinsQRSDetection<double> _detector;
+
+    std::array<int64_t, _chunk_size> _filtered_chunk{};
+
+    std::array<double, _chunk_size> _detection_chunk{};
+};
+
+template<typename SampleType_TP>
+FixedPointQRSDetection<SampleType_TP>::FixedPointQRSDetection(double sample_freq_hz,
+                                                              unsigned int training_phase_duration_sec,
+                                                              unsigned int adc_resolution_bits)
+    : _sample_freq_hz(sample_freq_hz),
+    _filter_chain(sample_freq_hz, adc_resolution_bits),
+    _detector(sample_freq_hz, training_phase_duration_sec)
+{
+}
+
+template<typename SampleType_TP>
+inline
+void
+FixedPointQRSDetection<SampleType_TP>::AppendPoint(const SampleType_TP& sample, const double timestamp_sec)
+{
+    int64_t filtered_sample = 0;
+    _filter_chain.Apply(&filtered_sample, &sample, 1);
+
+    const double detection_sample = static_cast<double>(filtered_sample);
+    _detector.AppendFilteredBlock(span<const double>(&detection_sample, 1), timestamp_sec);
+}
+
+template<typename SampleType_TP>
+void
+FixedPointQRSDetection<SampleType_TP>::AppendBlock(span<const SampleType_TP> samples, const double t0_sec)
+{
+    const size_t block_size = samples.size();
+    for ( size_t chunk_begin = 0; chunk_begin < block_size; chunk_begin += _chunk_size ) {
+        const size_t current_chunk_size = std::min(_chunk_size, block_size - chunk_begin);
+        _filter_chain.Apply(_filtered_chunk.data(), samples.data() + chunk_begin, current_chunk_size);
+        for ( size_t idx = 0; idx < current_chunk_size; ++idx ) {
+            _detection_chunk[idx] = static_cast<double>(_filtered_chunk[idx]);
+        }
+        _detector.AppendFilteredBlock(span<const double>(_detection_chunk.data(), current_chunk_size),
+                                      t0_sec + chunk_begin / _sample_freq_hz);
+    }
+}
+
+template<typename SampleType_TP>
+inline
+int
+FixedPointQRSDetection<SampleType_TP>::GetFilterDelay()
+{
+    return _detector.GetFilterDelay();
+}
+
+template<typename SampleType_TP>
+inline
+void
+FixedPointQRSDetection<SampleType_TP>::Connect(std::function<void(const double&)> callback)
+{
+    _detector.Connect(callback);
+}
+
+template<typename SampleType_TP>
+inline
+void
+FixedPointQRSDetection<SampleType_TP>::ConnectEventQueue(SPSCQueue_TC<BeatEvent_TP>* event_queue)
+{
+    _detector.ConnectEventQueue(event_queue);
+}
+
+template<typename SampleType_TP>
+inline
+size_t
+FixedPointQRSDetection<SampleType_TP>::GetNumDroppedEvents()
+{
+    return _detector.GetNumDroppedEvents();
+}
+
+template<typename SampleType_TP>
+inline
+QRSDetectionState_TP
+FixedPointQRSDetection<SampleType_TP>::GetState() const
+{
+    return _detector.GetState();
+}
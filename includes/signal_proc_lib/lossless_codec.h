@@ -0,0 +1,226 @@
+#pragma once
+
+// STL includes
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+///////////////////////////////////////////////////////
+//
+// Class: LosslessCodec_C
+//
+//! Lossless compression of the integer samples (adc values) of one channel, e.g. for the storage of records
+//! (see CompressedRecord_C).
+//!
+//! The samples are predicted from the previous samples by a fixed linear predictor of the order 0 (the sample),
+//! 1 (delta to the previous sample) or 2 (delta to the linear extrapolation of the two previous samples); the encoder
+//! chooses the order with the smallest residuals. The residuals are mapped to unsigned values (zigzag: small negative
+//! and positive residuals become small values) and bit-packed in groups of 32: each group stores the number of bits
+//! of its largest value and 32 values of this width.
+//!
+//! Layout of an encoded block of num_samples samples:
+//! - order of the predictor (1 byte), the first order samples (4 bytes each)
+//! - for each group of 32 residuals: width (1 byte), the 32 values packed into width 32 bit words
+//!   (the last group is filled with zeros)
+//!
+//! The groups are unpacked by a loop without branches, which the compiler vectorizes; the prediction is undone
+//! while the unpacked group is in the cache.
+//!
+//! Usage:
+//! std::vector<unsigned char> encoded;
+//! LosslessCodec_C::Encode(samples.data(), samples.size(), encoded);
+//! LosslessCodec_C::Decode(encoded.data(), encoded.size(), samples.size(), decoded.data());
+class LosslessCodec_C {
+
+    // Public functions
+public:
+    //! Appends the encoded samples to dst
+    static void Encode(const int32_t* samples, size_t num_samples, std::vector<unsigned char>& dst);
+
+    //! Decodes num_samples samples from the encoded block [src, src + size) into dst.
+    //!
+    //! \returns the number of bytes of the encoded block; zero, if the block is invalid
+    static size_t Decode(const unsigned char* src, size_t size, size_t num_samples, int32_t* dst);
+
+    //! Number of residuals, which are packed with the same width
+    static constexpr size_t _group_size = 32;
+
+    //! Highest order of the predictor
+    static constexpr unsigned int _max_order = 2;
+
+    // Private functions
+private:
+    //! Computes the residuals of the predictor. Returns false, if a residual does not fit into 32 bit
+    static bool ComputeResiduals(const int32_t* samples, size_t num_samples, unsigned int order, uint32_t* residuals);
+
+    //! Packs a group of residuals with the smallest width and appends it to dst
+    static void PackGroup(const uint32_t* residuals, std::vector<unsigned char>& dst);
+
+    //! Unpacks the group of 32 values, which are packed into width words
+    static void UnpackGroup(const unsigned char* src, unsigned int width, uint32_t* residuals);
+
+    static uint32_t ZigZagEncode(int64_t value);
+
+    static int32_t ZigZagDecode(uint32_t value);
+};
+
+inline
+uint32_t
+LosslessCodec_C::ZigZagEncode(int64_t value)
+{
+    return static_cast<uint32_t>((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+inline
+int32_t
+LosslessCodec_C::ZigZagDecode(uint32_t value)
+{
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+inline
+bool
+LosslessCodec_C::ComputeResiduals(const int32_t* samples, size_t num_samples, unsigned int order, uint32_t* residuals)
+{
+    // the residuals of samples of more than 30 bits may need 33 bits
+    int64_t max_magnitude = 0;
+    for ( size_t idx = order; idx < num_samples; ++idx ) {
+        int64_t prediction = 0;
+        if ( order == 1 ) {
+            prediction = samples[idx - 1];
+        } else if ( order == 2 ) {
+            prediction = 2 * static_cast<int64_t>(samples[idx - 1]) - samples[idx - 2];
+        }
+        const int64_t residual = samples[idx] - prediction;
+        max_magnitude = std::max(max_magnitude, residual < 0 ? -(residual + 1) : residual);
+        residuals[idx - order] = ZigZagEncode(residual);
+    }
+    return max_magnitude <= INT32_MAX;
+}
+
+inline
+void
+LosslessCodec_C::PackGroup(const uint32_t* residuals, std::vector<unsigned char>& dst)
+{
+    uint32_t combined_bits = 0;
+    for ( size_t idx = 0; idx < _group_size; ++idx ) {
+        combined_bits |= residuals[idx];
+    }
+    unsigned int width = 0;
+    while ( width < 32 && (combined_bits >> width) != 0 ) {
+        ++width;
+    }
+
+    uint32_t words[_group_size + 2] = {};
+    for ( size_t idx = 0; idx < _group_size; ++idx ) {
+        const size_t bit_position = idx * width;
+        const uint64_t shifted_value = static_cast<uint64_t>(residuals[idx]) << (bit_position % 32);
+        words[bit_position / 32] |= static_cast<uint32_t>(shifted_value);
+        words[bit_position / 32 + 1] |= static_cast<uint32_t>(shifted_value >> 32);
+    }
+    dst.push_back(static_cast<unsigned char>(width));
+    const unsigned char* word_bytes = reinterpret_cast<const unsigned char*>(words);
+    dst.insert(dst.end(), word_bytes, word_bytes + width * sizeof(uint32_t));
+}
+
+inline
+void
+LosslessCodec_C::UnpackGroup(const unsigned char* src, unsigned int width, uint32_t* residuals)
+{
+    uint32_t words[_group_size + 2];
+    std::memcpy(words, src, width * sizeof(uint32_t));
+    words[width] = 0;
+    words[width + 1] = 0;
+    const uint64_t mask = (uint64_t(1) << width) - 1;
+    for ( size_t idx = 0; idx < _group_size; ++idx ) {
+        const size_t bit_position = idx * width;
+        const uint64_t value = words[bit_position / 32] | (static_cast<uint64_t>(words[bit_position / 32 + 1]) << 32);
+        residuals[idx] = static_cast<uint32_t>((value >> (bit_position % 32)) & mask);
+    }
+}
+
+inline
+void
+LosslessCodec_C::Encode(const int32_t* samples, size_t num_samples, std::vector<unsigned char>& dst)
+{
+    const size_t num_groups = (num_samples + _group_size - 1) / _group_size;
+    std::vector<uint32_t> residuals(num_groups * _group_size);
+    std::vector<uint32_t> best_residuals(num_groups * _group_size);
+
+    // the order with the smallest sum of residual widths (estimated by the sum of the residuals)
+    unsigned int best_order = 0;
+    uint64_t best_cost = UINT64_MAX;
+    for ( unsigned int order = 0; order <= _max_order && order <= num_samples; ++order ) {
+        if ( !ComputeResiduals(samples, num_samples, order, residuals.data()) ) {
+            continue;
+        }
+        uint64_t cost = 0;
+        for ( size_t idx = 0; idx + order < num_samples; ++idx ) {
+            cost += residuals[idx];
+        }
+        if ( cost < best_cost ) {
+            best_cost = cost;
+            best_order = order;
+            best_residuals.swap(residuals);
+        }
+    }
+
+    dst.push_back(static_cast<unsigned char>(best_order));
+    const unsigned char* warmup_bytes = reinterpret_cast<const unsigned char*>(samples);
+    dst.insert(dst.end(), warmup_bytes, warmup_bytes + best_order * sizeof(int32_t));
+    const size_t num_residuals = num_samples - best_order;
+    std::fill(best_residuals.begin() + num_residuals, best_residuals.end(), 0);
+    for ( size_t first_residual = 0; first_residual < num_residuals; first_residual += _group_size ) {
+        PackGroup(best_residuals.data() + first_residual, dst);
+    }
+}
+
+inline
+size_t
+LosslessCodec_C::Decode(const unsigned char* src, size_t size, size_t num_samples, int32_t* dst)
+{
+    if ( size < 1 || src[0] > _max_order || src[0] > num_samples || size < 1 + src[0] * sizeof(int32_t) ) {
+        return 0;
+    }
+    const unsigned int order = src[0];
+    size_t position = 1;
+    std::memcpy(dst, src + position, order * sizeof(int32_t));
+    position += order * sizeof(int32_t);
+
+    // unpack the residuals behind the first samples and undo the prediction group by group, while the group is in the cache.
+    // The second order prediction is undone by two running sums: of the residuals (the deltas) and of the deltas
+    uint32_t sample = order > 0 ? static_cast<uint32_t>(dst[order - 1]) : 0;
+    uint32_t delta = order == 2 ? static_cast<uint32_t>(dst[1]) - static_cast<uint32_t>(dst[0]) : 0;
+    uint32_t residuals[_group_size];
+    const size_t num_residuals = num_samples - order;
+    for ( size_t first_residual = 0; first_residual < num_residuals; first_residual += _group_size ) {
+        const unsigned int width = position < size ? src[position] : 33;
+        if ( width > 32 || position + 1 + width * sizeof(uint32_t) > size ) {
+            return 0;
+        }
+        UnpackGroup(src + position + 1, width, residuals);
+        position += 1 + width * sizeof(uint32_t);
+
+        int32_t* group_dst = dst + order + first_residual;
+        const size_t num_group_residuals = std::min(_group_size, num_residuals - first_residual);
+        if ( order == 0 ) {
+            for ( size_t idx = 0; idx < num_group_residuals; ++idx ) {
+                group_dst[idx] = ZigZagDecode(residuals[idx]);
+            }
+        } else if ( order == 1 ) {
+            for ( size_t idx = 0; idx < num_group_residuals; ++idx ) {
+                sample += static_cast<uint32_t>(ZigZagDecode(residuals[idx]));
+                group_dst[idx] = static_cast<int32_t>(sample);
+            }
+        } else {
+            for ( size_t idx = 0; idx < num_group_residuals; ++idx ) {
+                delta += static_cast<uint32_t>(ZigZagDecode(residuals[idx]));
+                sample += delta;
+                group_dst[idx] = static_cast<int32_t>(sample);
+            }
+        }
+    }
+    return position;
+}
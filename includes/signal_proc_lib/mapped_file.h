@@ -0,0 +1,227 @@
+#pragma once
+
+// OS includes
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// STL includes
+#include <string>
+#include <cstddef>
+#include <algorithm>
+
+///////////////////////////////////////////////////////
+//
+// Class: MappedFile_C
+//
+//! Read only memory mapping of a whole file. The pages are loaded by the OS on the first access,
+//! so reading the mapped bytes needs neither a read buffer nor a copy.
+//! The mapping is released with the object (move only).
+//!
+//! Usage:
+//! MappedFile_C file;
+//! if ( file.Open("100.dat") ) { Decode(file.GetData(), file.GetSize()); }
+class MappedFile_C {
+
+    // Construction / Destruction / Copying
+public:
+    MappedFile_C() = default;
+
+    ~MappedFile_C();
+
+    MappedFile_C(const MappedFile_C& other) = delete;
+
+    MappedFile_C& operator=(const MappedFile_C& other) = delete;
+
+    MappedFile_C(MappedFile_C&& other) noexcept;
+
+    MappedFile_C& operator=(MappedFile_C&& other) noexcept;
+
+    // Public functions
+public:
+    //! Maps the file. Returns false, if the file can not be opened or mapped.
+    //! An empty file is opened with a size of zero
+    bool Open(const std::string& filename);
+
+    //! Releases the mapping
+    void Close();
+
+    bool IsOpen() const;
+
+    //! Returns the first byte of the file (nullptr for an empty or closed file)
+    const unsigned char* GetData() const;
+
+    //! Returns the size of the file in bytes
+    size_t GetSize() const;
+
+    //! Tells the OS, that the bytes [offset, offset + size) are not needed anymore: their pages are dropped from the
+    //! working set and loaded again on the next access. Keeps the memory of a sequential reader bounded
+    void ReleasePages(size_t offset, size_t size);
+
+    // Private variables
+private:
+    const unsigned char* _data = nullptr;
+
+    size_t _size = 0;
+
+    bool _is_open = false;
+};
+
+inline
+MappedFile_C::~MappedFile_C()
+{
+    Close();
+}
+
+inline
+MappedFile_C::MappedFile_C(MappedFile_C&& other) noexcept
+    : _data(other._data),
+    _size(other._size),
+    _is_open(other._is_open)
+{
+    other._data = nullptr;
+    other._size = 0;
+    other._is_open = false;
+}
+
+inline
+MappedFile_C&
+MappedFile_C::operator=(MappedFile_C&& other) noexcept
+{
+    if ( this != &other ) {
+        Close();
+        _data = other._data;
+        _size = other._size;
+        _is_open = other._is_open;
+        other._data = nullptr;
+        other._size = 0;
+        other._is_open = false;
+    }
+    return *this;
+}
+
+inline
+bool
+MappedFile_C::Open(const std::string& filename)
+{
+    Close();
+#ifdef _WIN32
+    HANDLE file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                     FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if ( file_handle == INVALID_HANDLE_VALUE ) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if ( !GetFileSizeEx(file_handle, &file_size) ) {
+        CloseHandle(file_handle);
+        return false;
+    }
+    _size = static_cast<size_t>(file_size.QuadPart);
+    if ( _size > 0 ) {
+        HANDLE mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if ( mapping_handle != nullptr ) {
+            _data = static_cast<const unsigned char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+            // the view keeps the mapping alive
+            CloseHandle(mapping_handle);
+        }
+    }
+    CloseHandle(file_handle);
+#else
+    const int file_descriptor = ::open(filename.c_str(), O_RDONLY);
+    if ( file_descriptor < 0 ) {
+        return false;
+    }
+    struct stat file_status;
+    if ( ::fstat(file_descriptor, &file_status) != 0 ) {
+        ::close(file_descriptor);
+        return false;
+    }
+    _size = static_cast<size_t>(file_status.st_size);
+    if ( _size > 0 ) {
+        void* address = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+        if ( address != MAP_FAILED ) {
+            _data = static_cast<const unsigned char*>(address);
+            // the files are decoded front to back: read ahead
+            ::madvise(address, _size, MADV_SEQUENTIAL);
+        }
+    }
+    // the mapping stays valid after the file is closed
+    ::close(file_descriptor);
+#endif
+    if ( _size > 0 && _data == nullptr ) {
+        _size = 0;
+        return false;
+    }
+    _is_open = true;
+    return true;
+}
+
+inline
+void
+MappedFile_C::Close()
+{
+    if ( _data != nullptr ) {
+#ifdef _WIN32
+        UnmapViewOfFile(_data);
+#else
+        ::munmap(const_cast<unsigned char*>(_data), _size);
+#endif
+    }
+    _data = nullptr;
+    _size = 0;
+    _is_open = false;
+}
+
+inline
+bool
+MappedFile_C::IsOpen() const
+{
+    return _is_open;
+}
+
+inline
+const unsigned char*
+MappedFile_C::GetData() const
+{
+    return _data;
+}
+
+inline
+size_t
+MappedFile_C::GetSize() const
+{
+    return _size;
+}
+
+inline
+void
+MappedFile_C::ReleasePages(size_t offset, size_t size)
+{
+    if ( _data == nullptr || offset >= _size ) {
+        return;
+    }
+    size = std::min(size, _size - offset);
+#ifdef _WIN32
+    // unlocking pages, which are not locked, removes them from the working set
+    VirtualUnlock(const_cast<unsigned char*>(_data + offset), size);
+#else
+    // only whole pages inside the range are released
+    const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t first_page = (offset + page_size - 1) / page_size * page_size;
+    const size_t end_page = (offset + size) / page_size * page_size;
+    if ( end_page > first_page ) {
+        ::madvise(const_cast<unsigned char*>(_data + first_page), end_page - first_page, MADV_DONTNEED);
+    }
+#endif
+}
@@ -15,6 +15,7 @@ extern "C"{
 #include <stdio.h>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <malloc.h>
 
 //! Interface for MIT-ECG Data
@@ -50,6 +51,18 @@ struct MITDataChannel_TP {
     std::vector<SampleDataType_TP> _data;
 };
 
+//! Annotation of a record, e.g. the reference beat annotations (annotator "atr") of the MIT-BIH arrhythmia database.
+//! For information about the annotation codes see:
+//! https://physionet.org/physiotools/wag/annot-5.htm
+struct MITAnnotation_TP {
+    //! index of the annotated sample
+    long long _sample_idx = 0;
+    //! annotation code (see wfdb/ecgcodes.h)
+    int _code = 0;
+    //! true, if the annotation labels a beat (qrs complex)
+    bool _is_beat = false;
+};
+
 template<typename SampleDataType_TP>
 class MITFileIO_C {
 public:
@@ -59,9 +72,30 @@ public:
 public:
     const std::vector<MITDataChannel_TP<SampleDataType_TP>> Read(char* record_name);
 
+    //! Opens the signals of the record for reading with ReadFrames()
+    //! Returns the channels without samples; an empty vector, if the record can not be opened
+    std::vector<MITDataChannel_TP<SampleDataType_TP>> OpenSignals(char* record_name);
+
+    //! Reads up to num_frames frames of the opened signals (one sample of each signal).
+    //! channel_dst[channel_idx] receives the samples of the channel
+    //!
+    //! \returns the number of read frames; less than num_frames at the end of the record
+    size_t ReadFrames(size_t num_frames, SampleDataType_TP* const* channel_dst);
+
+    //! Reads the annotations of the record from the annotation file <record_name>.<annotator>
+    //! Returns an empty vector, if the annotation file can not be opened
+    std::vector<MITAnnotation_TP> ReadAnnotations(char* record_name, char* annotator);
+
+    //! Returns true, if the annotation code labels a beat (same codes as isqrs() of wfdb/ecgmap.h)
+    static bool IsBeatAnnotation(int code);
+
     void SetWFDBPath(char* path);
 
     const std::string GetWFDBPath();
+
+private:
+    //! One frame returned by getvec()
+    std::vector<WFDB_Sample> _frame;
 };
 
 //template<typename SampleDataType_TP>
@@ -77,6 +111,33 @@ const
 std::vector<MITDataChannel_TP<SampleDataType_TP>>
 MITFileIO_C<SampleDataType_TP>::Read(char* record_path)
 {
+    auto channel_data = OpenSignals(record_path);
+    if ( channel_data.empty() ) {
+        return {/*no signal inside the file*/};
+    }
+
+    // assume num_samples is equal for all channels
+    const size_t number_of_samples = channel_data[/*channel_count*/0]._num_samples;
+    std::vector<SampleDataType_TP*> channel_dst;
+    for ( auto& channel : channel_data ) {
+        channel._data.resize(number_of_samples);
+        channel_dst.push_back(channel._data.data());
+    }
+    // the wfdb lib stops at the end of the data, even if the header specifies more samples
+    const size_t number_of_read_samples = ReadFrames(number_of_samples, channel_dst.data());
+    for ( auto& channel : channel_data ) {
+        channel._data.resize(number_of_read_samples);
+    }
+
+    return channel_data;
+}
+
+template<typename SampleDataType_TP>
+inline
+std::vector<MITDataChannel_TP<SampleDataType_TP>>
+MITFileIO_C<SampleDataType_TP>::OpenSignals(char* record_path)
+{
+    _frame.clear();
     int number_of_signals = isigopen(record_path, NULL, 0);
 
     if ( number_of_signals < 1 ) {
@@ -84,9 +145,11 @@ MITFileIO_C<SampleDataType_TP>::Read(char* record_path)
     }
 
     // Read the header 
-    WFDB_Siginfo *signal_info;
-    signal_info = (WFDB_Siginfo *)malloc(number_of_signals * sizeof(WFDB_Siginfo));
-    number_of_signals = isigopen(record_path, signal_info, number_of_signals);
+    std::vector<WFDB_Siginfo> signal_info(number_of_signals);
+    number_of_signals = isigopen(record_path, signal_info.data(), number_of_signals);
+    if ( number_of_signals < 1 ) {
+        return {};
+    }
 
     std::vector<MITDataChannel_TP<SampleDataType_TP>> channel_data;
     channel_data.reserve(number_of_signals);
@@ -113,31 +176,95 @@ MITFileIO_C<SampleDataType_TP>::Read(char* record_path)
         // adc output (in physical units) given 0V DC input
         channel_data[channel_count]._adc_baseline_0mV_output_U = signal_info[channel_count].adczero;
     }
-    
-    // Read the body
-    WFDB_Sample *sample_data;
-    sample_data = (WFDB_Sample *)malloc(number_of_signals * sizeof(WFDB_Sample));
+    _frame.resize(number_of_signals);
 
-    // assume num_samples is equal for all channels
-    int number_of_samples = channel_data[/*channel_count*/0]._num_samples;
-    // Read a sample from each channel and store it inside the corresponding MITDataChannel_TP object
-    for ( int sample_count = 0; sample_count < number_of_samples; ++sample_count ) {
+    return channel_data;
+}
+
+template<typename SampleDataType_TP>
+inline
+size_t
+MITFileIO_C<SampleDataType_TP>::ReadFrames(size_t num_frames, SampleDataType_TP* const* channel_dst)
+{
+    const size_t number_of_signals = _frame.size();
+    // Read a sample from each channel and store it inside the corresponding channel
+    for ( size_t sample_count = 0; sample_count < num_frames; ++sample_count ) {
         // error codes
         //-1 End of data (contents of vector not valid)
         //-3 Failure: unexpected physical end of file
         //-4 Failure : checksum error(detected only at end of file)
-        if ( getvec(sample_data) < 0 ) {
-            break;
+        if ( number_of_signals == 0 || getvec(_frame.data()) < 0 ) {
+            return sample_count;
         }
         // insert the sample of each channel into its corresponding data vector
-        for ( int channel_id = 0; channel_id < number_of_signals; ++channel_id ) {
-            channel_data[channel_id]._data.push_back(sample_data[channel_id]);
+        for ( size_t channel_id = 0; channel_id < number_of_signals; ++channel_id ) {
+            channel_dst[channel_id][sample_count] = static_cast<SampleDataType_TP>(_frame[channel_id]);
         }
     }
+    return num_frames;
+}
 
-    return channel_data;
+
+template<typename SampleDataType_TP>
+inline
+std::vector<MITAnnotation_TP>
+MITFileIO_C<SampleDataType_TP>::ReadAnnotations(char* record_name, char* annotator)
+{
+    WFDB_Anninfo annotator_info;
+    annotator_info.name = annotator;
+    annotator_info.stat = WFDB_READ;
+    if ( annopen(record_name, &annotator_info, 1) < 0 ) {
+        return {};
+    }
+
+    std::vector<MITAnnotation_TP> annotations;
+    WFDB_Annotation annotation;
+    // error codes
+    //-1 End of file
+    //-3 Failure: unexpected physical end of file
+    while ( getann(0, &annotation) == 0 ) {
+        MITAnnotation_TP mit_annotation;
+        mit_annotation._sample_idx = annotation.time;
+        mit_annotation._code = annotation.anntyp;
+        mit_annotation._is_beat = IsBeatAnnotation(annotation.anntyp);
+        annotations.push_back(mit_annotation);
+    }
+    iannclose(0);
+
+    return annotations;
 }
 
+template<typename SampleDataType_TP>
+inline
+bool
+MITFileIO_C<SampleDataType_TP>::IsBeatAnnotation(int code)
+{
+    switch ( code ) {
+    case 1:  // NORMAL
+    case 2:  // LBBB
+    case 3:  // RBBB
+    case 4:  // ABERR
+    case 5:  // PVC
+    case 6:  // FUSION
+    case 7:  // NPC
+    case 8:  // APC
+    case 9:  // SVPB
+    case 10: // VESC
+    case 11: // NESC
+    case 12: // PACE
+    case 13: // UNKNOWN
+    case 25: // BBB
+    case 30: // LEARN
+    case 34: // AESC
+    case 35: // SVESC
+    case 37: // NAPC
+    case 38: // PFUS
+    case 41: // RONT
+        return true;
+    default:
+        return false;
+    }
+}
 
 template<typename SampleDataType_TP>
 inline 
@@ -153,6 +280,6 @@ const
 std::string 
 MITFileIO_C<SampleDataType_TP>::GetWFDBPath()
 {
-    return std::to_string(getwfdb());
+    return std::string(getwfdb());
 }
 
@@ -0,0 +1,459 @@
+#pragma once
+
+// Projects includes
+#include "rt_state_filters.h"
+#include "qrs_filter_chain.h"
+#include "span.h"
+
+// STL includes
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+//! Multi channel version of PanTopkinsQRSDetection.
+//!
+//! Runs the pan topkins qrs detection for num_channels leads in lockstep.
+//! The state of all filters (bandpass, derivation, moving-average) and of the adaptive thresholds
+//! is stored as structure of arrays: one array per state variable, with one entry per channel.
+//! Because of this, the innermost loops of the filters run over the channels
+//! and the compiler can vectorize them, so that one SIMD instruction advances multiple leads at once.
+//!
+//! Each channel still has its own adaptive thresholds and its own refractory- and t-wave-counter,
+//! so the detected beats of a channel are the same as with an own PanTopkinsQRSDetection instance for this channel.
+//!
+//! Usage:
+//! MultiChannelQRSDetection<double> detector(360.0, 12, 2);
+//! detector.Connect([](unsigned int channel, const double& timestamp) { ... });
+//! // frame contains one sample of each channel
+//! detector.AppendFrame(frame, timestamp);
+template<typename DataType_TP>
+class MultiChannelQRSDetection {
+
+    // Constructor / Destrcutor/...
+public:
+    MultiChannelQRSDetection(double sample_freq_hz,
+                             unsigned int num_channels,
+                             unsigned int training_phase_duration_sec);
+
+    // Public functions
+public:
+    //! Processes one frame
+    //!
+    //! \param frame pointer to one sample of each channel (num_channels values)
+    //! \param timestamp_sec the timestamp of the frame
+    void AppendFrame(const DataType_TP* frame, const double timestamp_sec);
+
+    //! Processes multiple consecutive frames
+    //!
+    //! \param frames interleaved samples: frames[frame_idx * num_channels + channel_idx].
+    //!        The size must be a multiple of num_channels
+    //! \param t0_sec timestamp of the first frame.
+    //!        The timestamps of the following frames are calculated with the sample frequency.
+    void AppendBlock(span<const DataType_TP> frames, const double t0_sec);
+
+    //! Returns the delay due to the filtering in number of samples
+    int GetFilterDelay();
+
+    //! Returns the number of channels processed in parallel
+    unsigned int GetChannelCount();
+
+    //! Resets the state of all channels
+    void Reset();
+
+    //! Stores the callback, which is called when a qrs complex was detected.
+    //! The first argument is the index of the channel, the second the timestamp of the qrs complex
+    void Connect(std::function<void(unsigned int, const double&)> callback);
+
+    // Private functions
+private:
+    //! Bandpass filters the frame and stores the result inside _work_buff
+    void ApplyBandpass(const DataType_TP* frame);
+
+    //! Derivation, squaring and moving average of _work_buff (in place)
+    void ApplyDerivationSquareMA();
+
+    //! Sets the window sum of each channel to the exact sum of the samples inside the window
+    //! (see MovingAverageStateFilter::ReanchorSum())
+    void ReanchorMASums();
+
+    //! Training phase, peak detection and adaptive thresholding for all channels of _work_buff
+    void DetectQRS(const double timestamp_sec);
+
+    // Private variables
+private:
+    // Pan Topkins Parameters for the algorithm (see PanTopkinsQRSDetection)
+    const double _refractory_period_ms = 200.0;
+
+    const double _t_wave_period_ms = 360.0;
+
+    const double _counter_tolerance_sec = 1e-9;
+
+    const unsigned int _filter_order = QRSFilterParams_TP::_num_taps;
+
+    //! Sample frequency of all channels
+    double _sample_freq_hz = 0.0;
+
+    //! Number of channels processed in parallel
+    unsigned int _num_channels = 0;
+
+    //! the length of the MA-window in samples
+    unsigned int _window_length_samples = 0;
+
+    //! The number of training samples
+    unsigned int _number_of_training_samples = 0;
+
+    //! Delay of the input signal due to the filtering in samples
+    unsigned int _filter_delay_samples = 0;
+
+    //! Number of frames processed since construction or Reset()
+    size_t _num_frames = 0;
+
+    //! Bandpass filter taps
+    std::vector<DataType_TP> _taps;
+
+    //! Delay line of the bandpass: _filter_order frames, stored twice in a row
+    //! so the last _filter_order frames can always be read without wrapping
+    std::vector<DataType_TP> _fir_delay_line;
+
+    //! Position inside _fir_delay_line where the next frame is written
+    unsigned int _fir_write_idx = 0;
+
+    //! Last input of the derivation filter of each channel
+    std::vector<DataType_TP> _diff_last_input;
+
+    //! 'sliding window' buffer of the moving average: _window_length_samples frames (zero before the first frames)
+    std::vector<DataType_TP> _ma_buffer;
+
+    //! Sum of all samples inside the window of each channel; re-anchored each time the window wraps
+    std::vector<DataType_TP> _ma_sum;
+
+    //! idx of the frame inside _ma_buffer, where the next frame is inserted (equal for all channels).
+    //! It holds the oldest frame of the window, which is removed when the new frame is added
+    size_t _ma_head_idx = 0;
+
+    //! Filtered values of the current frame
+    std::vector<DataType_TP> _work_buff;
+
+    // Training phase (threshold initialization) - running max and sum of each channel
+    std::vector<DataType_TP> _training_max;
+
+    std::vector<DataType_TP> _training_sum;
+
+    unsigned int _training_data_idx = 0;
+
+    bool _thresholds_initialized = false;
+
+    // Adaptive thresholds of each channel
+    std::vector<double> _signal_threshold;
+
+    std::vector<double> _noise_threshold;
+
+    std::vector<double> _signal_level;
+
+    std::vector<double> _noise_level;
+
+    // Refractory period and t-wave counters of each channel
+    std::vector<double> _t_wave_counter;
+
+    std::vector<double> _refractory_period_counter;
+
+    std::vector<double> _last_peak_timestamp;
+
+    //! Previous (peak candidate) and pre-previous filtered value of each channel
+    std::vector<DataType_TP> _peak_amplitude;
+
+    std::vector<DataType_TP> _value_prev_previous;
+
+    //! 1 for each channel where the previous sample was a peak
+    std::vector<unsigned char> _peak_mask;
+
+    //! Timestamp of the current peak candidates (the previous frame)
+    double _peak_timestamp = 0.0;
+
+    //! The number of detected qrs complexes of each channel
+    std::vector<unsigned int> _qrs_counter;
+
+    //! The function called, when a qrs complex is detected
+    std::function<void(unsigned int, const double&)> _qrs_callback;
+};
+
+template<typename DataType_TP>
+MultiChannelQRSDetection<DataType_TP>::MultiChannelQRSDetection(double sample_freq_hz,
+                                                               unsigned int num_channels,
+                                                               unsigned int training_phase_duration_sec)
+{
+    _sample_freq_hz = sample_freq_hz;
+    _num_channels = num_channels;
+    _window_length_samples = (static_cast<double>(QRSFilterParams_TP::_window_length_ms) / 1000.0) * _sample_freq_hz;
+    _number_of_training_samples = training_phase_duration_sec * _sample_freq_hz;
+
+    // Same bandpass design as PanTopkinsQRSDetection
+    const auto taps = DesignBandpassTaps<QRSFilterParams_TP::_num_taps>(QRSFilterParams_TP::_highpass_cutoff_hz,
+                                                                        QRSFilterParams_TP::_lowpass_cutoff_hz,
+                                                                        _sample_freq_hz,
+                                                                        QRSFilterParams_TP::_kaiser_beta);
+    _taps.assign(taps.begin(), taps.end());
+    _filter_delay_samples = (_filter_order / 2) * 2;
+
+    _fir_delay_line.resize(2 * _filter_order * _num_channels);
+    _diff_last_input.resize(_num_channels);
+    _ma_buffer.resize(_window_length_samples * _num_channels);
+    _ma_sum.resize(_num_channels);
+    _work_buff.resize(_num_channels);
+    _training_max.resize(_num_channels);
+    _training_sum.resize(_num_channels);
+    _signal_threshold.resize(_num_channels);
+    _noise_threshold.resize(_num_channels);
+    _signal_level.resize(_num_channels);
+    _noise_level.resize(_num_channels);
+    _t_wave_counter.resize(_num_channels);
+    _refractory_period_counter.resize(_num_channels);
+    _last_peak_timestamp.resize(_num_channels);
+    _peak_amplitude.resize(_num_channels);
+    _value_prev_previous.resize(_num_channels);
+    _peak_mask.resize(_num_channels);
+    _qrs_counter.resize(_num_channels);
+
+    Reset();
+}
+
+template<typename DataType_TP>
+void
+MultiChannelQRSDetection<DataType_TP>::AppendFrame(const DataType_TP* frame, const double timestamp_sec)
+{
+    ApplyBandpass(frame);
+    ApplyDerivationSquareMA();
+    DetectQRS(timestamp_sec);
+    ++_num_frames;
+}
+
+template<typename DataType_TP>
+void
+MultiChannelQRSDetection<DataType_TP>::AppendBlock(span<const DataType_TP> frames, const double t0_sec)
+{
+    const size_t num_frames = frames.size() / _num_channels;
+    const double sample_dist_sec = 1.0 / _sample_freq_hz;
+    for ( size_t frame_idx = 0; frame_idx < num_frames; ++frame_idx ) {
+        AppendFrame(frames.data() + frame_idx * _num_channels, t0_sec + frame_idx * sample_dist_sec);
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+MultiChannelQRSDetection<DataType_TP>::ApplyBandpass(const DataType_TP* frame)
+{
+    const unsigned int num_channels = _num_channels;
+    DataType_TP* delay_line = _fir_delay_line.data();
+
+    // Store the frame twice, so the newest _filter_order frames are always
+    // located at [_fir_write_idx + 1, _fir_write_idx + _filter_order]
+    std::copy(frame, frame + num_channels, delay_line + _fir_write_idx * num_channels);
+    std::copy(frame, frame + num_channels, delay_line + (_fir_write_idx + _filter_order) * num_channels);
+
+    DataType_TP* out = _work_buff.data();
+    std::fill(out, out + num_channels, DataType_TP(0));
+    const DataType_TP* newest = delay_line + (_fir_write_idx + _filter_order) * num_channels;
+    for ( unsigned int tap_idx = 0; tap_idx < _filter_order; ++tap_idx ) {
+        const DataType_TP coefficient = _taps[tap_idx];
+        const DataType_TP* delayed = newest - tap_idx * num_channels;
+        // vectorized over the channels
+        for ( unsigned int channel = 0; channel < num_channels; ++channel ) {
+            out[channel] += coefficient * delayed[channel];
+        }
+    }
+
+    if ( ++_fir_write_idx == _filter_order ) {
+        _fir_write_idx = 0;
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+MultiChannelQRSDetection<DataType_TP>::ApplyDerivationSquareMA()
+{
+    const unsigned int num_channels = _num_channels;
+    DataType_TP* values = _work_buff.data();
+    DataType_TP* last_input = _diff_last_input.data();
+    DataType_TP* ma_head = _ma_buffer.data() + _ma_head_idx * num_channels;
+    DataType_TP* ma_sum = _ma_sum.data();
+    const DataType_TP window_length = static_cast<DataType_TP>(_window_length_samples);
+
+    // derivation, square, add to the moving average window and remove the oldest frame
+    for ( unsigned int channel = 0; channel < num_channels; ++channel ) {
+        DataType_TP derivated = values[channel] - last_input[channel];
+        last_input[channel] = values[channel];
+        DataType_TP squared = derivated * derivated;
+        ma_sum[channel] += squared - ma_head[channel];
+        ma_head[channel] = squared;
+        values[channel] = ma_sum[channel] / window_length;
+    }
+
+    if ( ++_ma_head_idx == _window_length_samples ) {
+        _ma_head_idx = 0;
+        ReanchorMASums();
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+MultiChannelQRSDetection<DataType_TP>::ReanchorMASums()
+{
+    const unsigned int num_channels = _num_channels;
+    DataType_TP* ma_sum = _ma_sum.data();
+    std::fill(ma_sum, ma_sum + num_channels, DataType_TP(0));
+    for ( size_t frame_idx = 0; frame_idx < _window_length_samples; ++frame_idx ) {
+        const DataType_TP* ma_frame = _ma_buffer.data() + frame_idx * num_channels;
+        // vectorized over the channels
+        for ( unsigned int channel = 0; channel < num_channels; ++channel ) {
+            ma_sum[channel] += ma_frame[channel];
+        }
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+MultiChannelQRSDetection<DataType_TP>::DetectQRS(const double timestamp)
+{
+    const unsigned int num_channels = _num_channels;
+    const DataType_TP* values = _work_buff.data();
+
+    // Training phase 1
+    if ( !_thresholds_initialized ) {
+        if ( _training_data_idx < _number_of_training_samples ) {
+            DataType_TP* training_max = _training_max.data();
+            DataType_TP* training_sum = _training_sum.data();
+            if ( _training_data_idx == 0 ) {
+                std::copy(values, values + num_channels, training_max);
+            }
+            for ( unsigned int channel = 0; channel < num_channels; ++channel ) {
+                training_max[channel] = std::max(training_max[channel], values[channel]);
+                training_sum[channel] += values[channel];
+            }
+        } else {
+            for ( unsigned int channel = 0; channel < num_channels; ++channel ) {
+                _signal_threshold[channel] = _training_max[channel] * 0.25;
+                DataType_TP signal_mean = _training_sum[channel] / _number_of_training_samples;
+                _noise_threshold[channel] = signal_mean * 1 / 2;
+            }
+            _thresholds_initialized = true;
+        }
+        ++_training_data_idx;
+    }
+
+    // Peak detection of all channels at once (branch free);
+    // A peak is detected after three samples were aquired
+    DataType_TP* peak_amplitude = _peak_amplitude.data();
+    DataType_TP* prev_previous = _value_prev_previous.data();
+    unsigned char* peak_mask = _peak_mask.data();
+    const unsigned char peaks_possible = _num_frames >= 2;
+    unsigned char any_peak = 0;
+    for ( unsigned int channel = 0; channel < num_channels; ++channel ) {
+        peak_mask[channel] = peaks_possible &
+                             (peak_amplitude[channel] >= prev_previous[channel]) &
+                             (peak_amplitude[channel] >= values[channel]);
+        any_peak |= peak_mask[channel];
+    }
+
+    // Adaptive thresholding, only for the channels where a peak was found
+    if ( any_peak ) {
+        for ( unsigned int channel = 0; channel < num_channels; ++channel ) {
+            if ( !peak_mask[channel] ) {
+                continue;
+            }
+            double time_since_last_peak_sec = timestamp - _last_peak_timestamp[channel];
+            _refractory_period_counter[channel] -= time_since_last_peak_sec;
+            _t_wave_counter[channel] -= time_since_last_peak_sec;
+            _last_peak_timestamp[channel] = timestamp;
+
+            const DataType_TP amplitude = peak_amplitude[channel];
+            if ( amplitude > _signal_threshold[channel] ) {
+                if ( _t_wave_counter[channel] > _counter_tolerance_sec &&
+                     _refractory_period_counter[channel] <= _counter_tolerance_sec )
+                {
+                    // t-wave
+                    _t_wave_counter[channel] = 0;
+                } else if ( _refractory_period_counter[channel] <= _counter_tolerance_sec ) {
+                    // qrs complex
+                    if ( _qrs_callback ) {
+                        _qrs_callback(channel, _peak_timestamp - (_filter_delay_samples / _sample_freq_hz));
+                    }
+                    _signal_level[channel] = 0.125 * amplitude + 0.875 * _signal_level[channel];
+                    ++_qrs_counter[channel];
+                    _refractory_period_counter[channel] = _refractory_period_ms / 1000.0;
+                    _t_wave_counter[channel] = _t_wave_period_ms / 1000.0;
+                }
+            } else if ( amplitude > _noise_threshold[channel] &&
+                        amplitude < _signal_threshold[channel] )
+            {
+                // noise
+                _noise_level[channel] = 0.125 * amplitude + 0.875 * _noise_level[channel];
+            }
+
+            _signal_threshold[channel] = _noise_level[channel] + 0.25 * (_signal_level[channel] - _noise_level[channel]);
+            _noise_threshold[channel] = 0.5 * _signal_threshold[channel];
+        }
+    }
+
+    // The current values are the next peak candidates
+    std::copy(peak_amplitude, peak_amplitude + num_channels, prev_previous);
+    std::copy(values, values + num_channels, peak_amplitude);
+    _peak_timestamp = timestamp;
+}
+
+template<typename DataType_TP>
+inline
+int
+MultiChannelQRSDetection<DataType_TP>::GetFilterDelay()
+{
+    return _filter_delay_samples;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+MultiChannelQRSDetection<DataType_TP>::GetChannelCount()
+{
+    return _num_channels;
+}
+
+template<typename DataType_TP>
+void
+MultiChannelQRSDetection<DataType_TP>::Reset()
+{
+    _num_frames = 0;
+    _fir_write_idx = 0;
+    _ma_head_idx = 0;
+    _training_data_idx = 0;
+    _thresholds_initialized = false;
+    _peak_timestamp = 0.0;
+
+    std::fill(_fir_delay_line.begin(), _fir_delay_line.end(), DataType_TP(0));
+    std::fill(_diff_last_input.begin(), _diff_last_input.end(), DataType_TP(0));
+    std::fill(_ma_buffer.begin(), _ma_buffer.end(), DataType_TP(0));
+    std::fill(_ma_sum.begin(), _ma_sum.end(), DataType_TP(0));
+    std::fill(_training_max.begin(), _training_max.end(), DataType_TP(0));
+    std::fill(_training_sum.begin(), _training_sum.end(), DataType_TP(0));
+    std::fill(_signal_threshold.begin(), _signal_threshold.end(), 0.0);
+    std::fill(_noise_threshold.begin(), _noise_threshold.end(), 0.0);
+    std::fill(_signal_level.begin(), _signal_level.end(), 0.0);
+    std::fill(_noise_level.begin(), _noise_level.end(), 0.0);
+    std::fill(_t_wave_counter.begin(), _t_wave_counter.end(), 0.0);
+    std::fill(_refractory_period_counter.begin(), _refractory_period_counter.end(), 0.0);
+    std::fill(_last_peak_timestamp.begin(), _last_peak_timestamp.end(), 0.0);
+    std::fill(_peak_amplitude.begin(), _peak_amplitude.end(), DataType_TP(0));
+    std::fill(_value_prev_previous.begin(), _value_prev_previous.end(), DataType_TP(0));
+    std::fill(_peak_mask.begin(), _peak_mask.end(), 0);
+    std::fill(_qrs_counter.begin(), _qrs_counter.end(), 0);
+}
+
+template<typename DataType_TP>
+inline
+void
+MultiChannelQRSDetection<DataType_TP>::Connect(std::function<void(unsigned int, const double&)> qrs_callback)
+{
+    _qrs_callback = qrs_callback;
+}
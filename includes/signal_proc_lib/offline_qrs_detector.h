@@ -0,0 +1,353 @@
+#pragma once
+
+// Project includes
+#include "pan_topkins_qrs_detector.h"
+#include "time_signal.h"
+#include "thread_pool.h"
+
+// STL includes
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+
+//! Offline (whole record) QRS detection on multiple threads.
+//!
+//! The record is split into segments of equal length, which are processed in parallel by a thread pool.
+//! The detector of each segment starts earlier, inside the previous segment (overlap), to warm up its filters
+//! and adaptive thresholds before the samples of the segment itself are processed.
+//! A segment owns the beats which its detector reports while processing the samples of the segment;
+//! beats reported during the warm-up are dropped, so there are no duplicate beats at the segment edges.
+//!
+//! After all segments are processed, they are merged in order, while the state of a sequential pass (levels,
+//! thresholds, counters) is carried from segment to segment. The filters and the peak detection only depend
+//! on the last samples, but the signal and noise levels forget their start values slowly (by 0.875 per update),
+//! so the levels of a segment's detector differ slightly from the levels of the sequential pass.
+//! A segment is accepted (see IsSynchronized()), if
+//! - the last beats of its warm-up coincide with the beats of the previous segments,
+//! - both detectors wait for the same refractory period and t-wave and
+//! - no peak of the segment came closer to the thresholds of the segment's detector than the thresholds of both
+//!   detectors differ (the difference only shrinks while both detectors make the same decisions).
+//! Then both detectors make the same decisions, and the levels of the sequential pass at the end of the segment
+//! follow from the number of level updates. Otherwise, the detector of the previous segment continues through this
+//! segment with the state of the sequential pass. So the result equals one sequential pass (up to rounding errors)
+//! for any number of threads. The overlap has to contain the training phase and some beats (see _num_agreeing_beats).
+//!
+//! Usage:
+//! OfflineQRSDetection<double> detector(8);
+//! auto beat_timestamps_sec = detector.DetectAll(channel);
+template<typename DataType_TP>
+class OfflineQRSDetection {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param num_threads number of threads; zero uses all hardware threads
+    //! \param training_phase_duration_sec duration of the threshold initialization of each detector
+    OfflineQRSDetection(unsigned int num_threads, unsigned int training_phase_duration_sec = 2);
+
+    // Public functions
+public:
+    //! Detects all qrs complexes inside the channel
+    //!
+    //! \returns the timestamps of the qrs complexes in seconds (relative to the first sample), in ascending order
+    std::vector<double> DetectAll(const ECGChannelInfo_TP<DataType_TP>& channel);
+
+    //! Length of the segments processed in parallel in seconds
+    void SetSegmentLength(double segment_length_sec);
+
+    //! Length of the warm-up in front of each segment in seconds
+    void SetOverlap(double overlap_sec);
+
+    //! Returns the number of segments of the last DetectAll() call,
+    //! which were processed again because their warm-up did not converge (see IsSynchronized())
+    unsigned int GetNumResyncedSegments();
+
+    // Private types
+private:
+    struct Segment_TP {
+        //! First sample of this segment
+        long long _begin = 0;
+        //! One after the last sample of this segment
+        long long _end = 0;
+        //! First sample processed by the detector of this segment
+        long long _warmup_begin = 0;
+        //! Timestamps of the beats reported while processing [_begin, _end)
+        std::vector<double> _beats;
+        //! Timestamps of the beats reported while processing [_warmup_begin, _begin)
+        std::vector<double> _warmup_beats;
+        //! True after the warm-up, when the reported beats belong to this segment
+        bool _collect_beats = false;
+        //! State of the detector after all samples before _begin were processed
+        QRSDetectionState_TP _state_at_begin;
+        //! State of the detector after the last sample of the segment; the threshold margin covers [_begin, _end)
+        QRSDetectionState_TP _state_at_end;
+        //! The detector, which stopped after the last sample of the segment
+        std::unique_ptr<PanTopkinsQRSDetection<DataType_TP>> _detector;
+    };
+
+    // Private functions
+private:
+    //! Creates the detector of the segment and runs it from segment._warmup_begin to segment._end
+    void ProcessSegment(Segment_TP& segment, const ECGChannelInfo_TP<DataType_TP>& channel);
+
+    //! Feeds the samples [begin, end) of the channel into the detector of the segment
+    void RunDetector(Segment_TP& segment, const ECGChannelInfo_TP<DataType_TP>& channel, long long begin, long long end);
+
+    //! Connects the detector of the segment, so it reports its beats to the segment
+    void ConnectDetector(Segment_TP& segment);
+
+    //! Returns true, if the detector of the segment makes the same decisions inside the segment as a sequential pass:
+    //! the last _num_agreeing_beats beats of the warm-up coincide with the previous beats, the counters
+    //! (refractory period, t-wave) are equal and the threshold margin of the segment exceeds the difference
+    //! of the thresholds
+    //!
+    //! \param previous_beats the beats of all previous segments
+    //! \param sequential_state the state of the sequential pass at the begin of the segment
+    bool IsSynchronized(const Segment_TP& segment,
+                        const std::vector<double>& previous_beats,
+                        const QRSDetectionState_TP& sequential_state,
+                        double sample_rate_hz);
+
+    //! Returns the state of the sequential pass at the end of a synchronized segment
+    //!
+    //! \param sequential_state the state of the sequential pass at the begin of the segment
+    QRSDetectionState_TP ContinueSequentialState(const Segment_TP& segment, const QRSDetectionState_TP& sequential_state);
+
+    // Private variables
+private:
+    unsigned int _num_threads = 0;
+
+    unsigned int _training_phase_duration_s = 2;
+
+    double _segment_length_s = 300.0;
+
+    double _overlap_s = 30.0;
+
+    unsigned int _num_resynced_segments = 0;
+
+    //! Number of samples passed at once to the detectors
+    const long long _block_size = 4096;
+
+    //! Number of beats at the end of the warm-up, which must coincide with the beats of the previous segments
+    const size_t _num_agreeing_beats = 4;
+
+    //! Absolute tolerance for the comparison of counters and timestamps
+    const double _time_tolerance_sec = 1e-9;
+
+    //! Relative tolerance for the rounding errors of the filtered samples and levels of different detectors
+    const double _level_tolerance = 1e-9;
+};
+
+template<typename DataType_TP>
+OfflineQRSDetection<DataType_TP>::OfflineQRSDetection(unsigned int num_threads, unsigned int training_phase_duration_sec)
+    : _num_threads(num_threads),
+    _training_phase_duration_s(training_phase_duration_sec)
+{
+}
+
+template<typename DataType_TP>
+inline
+void
+OfflineQRSDetection<DataType_TP>::SetSegmentLength(double segment_length_sec)
+{
+    _segment_length_s = segment_length_sec;
+}
+
+template<typename DataType_TP>
+inline
+void
+OfflineQRSDetection<DataType_TP>::SetOverlap(double overlap_sec)
+{
+    _overlap_s = overlap_sec;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+OfflineQRSDetection<DataType_TP>::GetNumResyncedSegments()
+{
+    return _num_resynced_segments;
+}
+
+template<typename DataType_TP>
+std::vector<double>
+OfflineQRSDetection<DataType_TP>::DetectAll(const ECGChannelInfo_TP<DataType_TP>& channel)
+{
+    _num_resynced_segments = 0;
+    const double sample_rate_hz = channel._sample_rate_hz;
+    const long long num_samples = channel._data.size();
+    if ( num_samples == 0 || sample_rate_hz <= 0.0 ) {
+        return {};
+    }
+
+    const long long segment_length = std::max(1ll, static_cast<long long>(_segment_length_s * sample_rate_hz));
+    const long long overlap = static_cast<long long>(_overlap_s * sample_rate_hz);
+
+    std::vector<Segment_TP> segments((num_samples + segment_length - 1) / segment_length);
+    for ( size_t segment_idx = 0; segment_idx < segments.size(); ++segment_idx ) {
+        auto& segment = segments[segment_idx];
+        segment._begin = segment_idx * segment_length;
+        segment._end = std::min(segment._begin + segment_length, num_samples);
+        segment._warmup_begin = std::max(0ll, segment._begin - overlap);
+    }
+
+    {
+        ThreadPool_C pool(_num_threads);
+        for ( auto& segment : segments ) {
+            pool.AddTask([&]() { ProcessSegment(segment, channel); });
+        }
+        pool.WaitUntilFinished();
+    }
+
+    // Merge in order. The first segment has no warm-up, so its beats are always correct
+    std::vector<double> beats = segments[0]._beats;
+    QRSDetectionState_TP sequential_state = segments[0]._state_at_end;
+    for ( size_t segment_idx = 1; segment_idx < segments.size(); ++segment_idx ) {
+        auto& previous_segment = segments[segment_idx - 1];
+        auto& segment = segments[segment_idx];
+
+        if ( segment._warmup_begin == 0 ) {
+            // the detector started with the record, like the sequential pass
+            sequential_state = segment._state_at_end;
+        } else if ( IsSynchronized(segment, beats, sequential_state, sample_rate_hz) ) {
+            sequential_state = ContinueSequentialState(segment, sequential_state);
+        } else {
+            // continue the detector of the previous segment with the state of the sequential pass
+            segment._beats.clear();
+            segment._detector = std::move(previous_segment._detector);
+            segment._detector->SetState(sequential_state);
+            ConnectDetector(segment);
+            RunDetector(segment, channel, segment._begin, segment._end);
+            sequential_state = segment._detector->GetState();
+            ++_num_resynced_segments;
+        }
+        previous_segment._detector.reset();
+        beats.insert(beats.end(), segment._beats.begin(), segment._beats.end());
+    }
+
+    return beats;
+}
+
+template<typename DataType_TP>
+void
+OfflineQRSDetection<DataType_TP>::ProcessSegment(Segment_TP& segment, const ECGChannelInfo_TP<DataType_TP>& channel)
+{
+    segment._detector = std::make_unique<PanTopkinsQRSDetection<DataType_TP>>(channel._sample_rate_hz,
+                                                                               _training_phase_duration_s);
+    ConnectDetector(segment);
+
+    // warm-up: the reported beats are only compared with the beats of the previous segments
+    segment._collect_beats = false;
+    RunDetector(segment, channel, segment._warmup_begin, segment._begin);
+    segment._state_at_begin = segment._detector->GetState();
+
+    segment._collect_beats = true;
+    segment._detector->ResetThresholdMargin();
+    RunDetector(segment, channel, segment._begin, segment._end);
+    segment._state_at_end = segment._detector->GetState();
+}
+
+template<typename DataType_TP>
+void
+OfflineQRSDetection<DataType_TP>::RunDetector(Segment_TP& segment,
+                                              const ECGChannelInfo_TP<DataType_TP>& channel,
+                                              long long begin,
+                                              long long end)
+{
+    const double sample_rate_hz = channel._sample_rate_hz;
+    for ( long long idx = begin; idx < end; idx += _block_size ) {
+        auto current_block_size = std::min(_block_size, end - idx);
+        segment._detector->AppendBlock(span<const DataType_TP>(channel._data.data() + idx, current_block_size),
+                                       idx / sample_rate_hz);
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+OfflineQRSDetection<DataType_TP>::ConnectDetector(Segment_TP& segment)
+{
+    segment._detector->Connect([&segment](const double& timestamp_sec) {
+        if ( segment._collect_beats ) {
+            segment._beats.push_back(timestamp_sec);
+        } else {
+            segment._warmup_beats.push_back(timestamp_sec);
+        }
+    });
+}
+
+template<typename DataType_TP>
+bool
+OfflineQRSDetection<DataType_TP>::IsSynchronized(const Segment_TP& segment,
+                                                 const std::vector<double>& previous_beats,
+                                                 const QRSDetectionState_TP& sequential_state,
+                                                 double sample_rate_hz)
+{
+    const auto& state = segment._state_at_begin;
+    if ( !state._thresholds_initialized ||
+         !sequential_state._thresholds_initialized ||
+         segment._warmup_beats.size() < _num_agreeing_beats ||
+         previous_beats.size() < _num_agreeing_beats )
+    {
+        return false;
+    }
+
+    // Both detectors report the beats at the same samples, the timestamps only differ by rounding errors
+    const double beat_tolerance_sec = 0.5 / sample_rate_hz;
+    if ( !std::equal(segment._warmup_beats.end() - _num_agreeing_beats, segment._warmup_beats.end(),
+                     previous_beats.end() - _num_agreeing_beats,
+                     [beat_tolerance_sec](double lhs, double rhs) { return std::abs(lhs - rhs) <= beat_tolerance_sec; }) )
+    {
+        return false;
+    }
+
+    auto times_equal = [this](double lhs, double rhs) {
+        return std::abs(lhs - rhs) <= _time_tolerance_sec;
+    };
+    // The counters only decrease until they are restarted, so all expired counters behave the same
+    auto counters_equal = [this, &times_equal](double lhs, double rhs) {
+        return ( lhs <= _time_tolerance_sec && rhs <= _time_tolerance_sec ) || times_equal(lhs, rhs);
+    };
+    if ( !times_equal(state._last_peak_timestamp, sequential_state._last_peak_timestamp) ||
+         !counters_equal(state._t_wave_counter, sequential_state._t_wave_counter) ||
+         !counters_equal(state._refractory_period_counter, sequential_state._refractory_period_counter) )
+    {
+        return false;
+    }
+
+    // While both detectors make the same decisions, the differences of their levels shrink with each update.
+    // The signal threshold is noise_level + 0.25 * (signal_level - noise_level), the noise threshold half of it
+    // (see PanTopkinsQRSDetection::DetectQRS()), so its difference is bounded by the differences at the begin
+    const double signal_level_difference = std::abs(state._signal_level - sequential_state._signal_level);
+    const double noise_level_difference = std::abs(state._noise_level - sequential_state._noise_level);
+    const double threshold_difference = std::max({ std::abs(state._signal_threshold - sequential_state._signal_threshold),
+                                                   2.0 * std::abs(state._noise_threshold - sequential_state._noise_threshold),
+                                                   0.75 * noise_level_difference + 0.25 * signal_level_difference });
+    const double rounding_tolerance = _level_tolerance * std::max(std::abs(state._signal_level), std::abs(sequential_state._signal_level));
+    return segment._state_at_end._min_threshold_margin > threshold_difference + rounding_tolerance;
+}
+
+template<typename DataType_TP>
+QRSDetectionState_TP
+OfflineQRSDetection<DataType_TP>::ContinueSequentialState(const Segment_TP& segment,
+                                                          const QRSDetectionState_TP& sequential_state)
+{
+    const auto& state_at_begin = segment._state_at_begin;
+    QRSDetectionState_TP state = segment._state_at_end;
+
+    // each update multiplies the difference of the levels by 0.875
+    const unsigned int num_signal_level_updates = state._num_signal_level_updates - state_at_begin._num_signal_level_updates;
+    const unsigned int num_noise_level_updates = state._num_noise_level_updates - state_at_begin._num_noise_level_updates;
+    state._signal_level += std::pow(0.875, num_signal_level_updates) * (sequential_state._signal_level - state_at_begin._signal_level);
+    state._noise_level += std::pow(0.875, num_noise_level_updates) * (sequential_state._noise_level - state_at_begin._noise_level);
+
+    // the thresholds are calculated from the levels at each peak
+    if ( state._num_peaks == state_at_begin._num_peaks ) {
+        state._signal_threshold = sequential_state._signal_threshold;
+        state._noise_threshold = sequential_state._noise_threshold;
+    } else {
+        state._signal_threshold = state._noise_level + 0.25 * (state._signal_level - state._noise_level);
+        state._noise_threshold = 0.5 * state._signal_threshold;
+    }
+    return state;
+}
@@ -2,23 +2,69 @@
 
 // Projects includes
 #include "rt_state_filters.h"
-
-// KFR includes
-#include "kfr/base.hpp"
-#include "kfr/dsp.hpp"
-#include "kfr/io.hpp"
+#include "qrs_filter_chain.h"
+#include "spsc_queue.h"
+#include "span.h"
 
 // STL includes
 #include <iostream>
 #include <functional>
+#include <memory>
+#include <array>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+//! Adaptive state of the PanTopkinsQRSDetection (thresholds, levels and counters).
+//! Together with the filter state it determines all future detections
+struct QRSDetectionState_TP {
+    double _signal_threshold = 0.0;
+    double _noise_threshold = 0.0;
+    double _signal_level = 0.0;
+    double _noise_level = 0.0;
+    double _t_wave_counter = 0.0;
+    double _refractory_period_counter = 0.0;
+    double _last_peak_timestamp = 0.0;
+    bool _thresholds_initialized = false;
+    //! Number of updates of the signal level (qrs complexes), since construction or Reset()
+    unsigned int _num_signal_level_updates = 0;
+    //! Number of updates of the noise level, since construction or Reset()
+    unsigned int _num_noise_level_updates = 0;
+    //! Number of peaks (updates of the thresholds), since construction or Reset()
+    unsigned int _num_peaks = 0;
+    //! Smallest distance of a peak amplitude to the signal threshold and to twice the noise threshold
+    //! since ResetThresholdMargin(). A detector, whose signal threshold differs by less (and whose noise threshold
+    //! is half of its signal threshold), makes the same decisions for these peaks
+    double _min_threshold_margin = std::numeric_limits<double>::infinity();
+};
+
+//! Classification of a detected peak
+enum class BeatClassification_TP {
+    QRS,
+    //! Peak above the signal threshold, right after the refractory period of a qrs complex
+    TWave
+};
+
+//! Published by PanTopkinsQRSDetection for each classified peak
+struct BeatEvent_TP {
+    //! Timestamp of the beat (filter delay compensated) in seconds
+    double _timestamp_sec = 0.0;
+    //! Amplitude of the peak inside the filtered (MA-integrated) signal
+    double _amplitude = 0.0;
+    //! Index of the beat inside the stream (filter delay compensated), counted since construction or Reset()
+    long long _sample_idx = 0;
+    BeatClassification_TP _classification = BeatClassification_TP::QRS;
+};
 
 template<typename DataType_TP>
 class PanTopkinsQRSDetection {
 
     // Constructor / Destrcutor/...
 public:
+    //! \param bandpass selects the FIR bandpass or the cheaper IIR bandpass with less delay (see QRSBandpass_TP)
     PanTopkinsQRSDetection(double sample_freq_hz, 
-                           unsigned int training_hase_duration_sec);
+                           unsigned int training_hase_duration_sec,
+                           QRSBandpass_TP bandpass = QRSBandpass_TP::FIR);
 
     ~PanTopkinsQRSDetection();
 
@@ -30,20 +76,75 @@ public:
     //! \param timestamp the timestamp of the current sample inside the datastream
     void AppendPoint(const DataType_TP& data, const double timestamp_sec);
 
+    //! Block implementation of AppendPoint().
+    //! The filter stages process each chunk of the block in one fused loop (see FilterPipeline), the filter states are kept between blocks.
+    //! QRS complexes are reported with the same timestamps as when the block is passed sample by sample to AppendPoint().
+    //! Blocks of any size are processed in chunks of a working buffer, which is allocated with the detector,
+    //! so neither AppendPoint() nor AppendBlock() allocate memory.
+    //!
+    //! \param samples consecutive samples of the datastream which is analyzed
+    //! \param t0_sec the timestamp of the first sample inside the block. 
+    //!        The timestamps of the following samples are calculated with the sample frequency.
+    void AppendBlock(span<const DataType_TP> samples, const double t0_sec);
+
+    //! Runs only the decision logic of AppendBlock() on samples, which were filtered by an external filter chain
+    //! (bandpass, derivation, squaring and moving average), e.g. by the integer filters of FixedPointQRSDetection.
+    //! The decisions are invariant to a constant scale of the filtered samples.
+    void AppendFilteredBlock(span<const DataType_TP> filtered_samples, const double t0_sec);
+
     //! Returns the delay due to the filtering in number of samples
     int GetFilterDelay();
 
     //! Resets the filter state ( Removes all values in the delay_line)
+    //! Without allocations, if the sample frequency does not change
     void Reset(float sample_freq_hz, unsigned int training_phase_duration_sec);
 
     //! Stores the callback, which is called, when a qrs complex was detected
     void Connect(std::function<void(const double&)> callback);
 
+    //! Publishes an event for each detected qrs complex and t-wave into the queue.
+    //! The detector is the producer of the queue, the consumer drains it on its own thread.
+    //! When the queue is full, the event is dropped (see GetNumDroppedEvents()) - the detector never blocks.
+    //! Pass nullptr to disconnect the queue.
+    void ConnectEventQueue(SPSCQueue_TC<BeatEvent_TP>* event_queue);
+
+    //! Returns the number of events, which were dropped because the event queue was full
+    size_t GetNumDroppedEvents();
+
+    //! Returns the current thresholds, levels and counters
+    QRSDetectionState_TP GetState() const;
+
+    //! Replaces the thresholds, levels, counters and the timestamp of the last peak, e.g. with the state of another
+    //! detector of the same stream. The filter states and the numbers of updates and peaks are kept
+    void SetState(const QRSDetectionState_TP& state);
+
+    //! Restarts the measurement of the smallest distance of the peaks to the thresholds (see QRSDetectionState_TP)
+    void ResetThresholdMargin();
+
     // Private functions
 public:
     // Initializes the signal and noise thresholds - learning phase 1
     void InitializeThresholds(const std::vector<DataType_TP>& training_data);
 
+private:
+    //! Initializes the thresholds from the maximum and the sum of the filtered training samples
+    void InitializeThresholds(const DataType_TP training_max, const DataType_TP training_sum, size_t num_training_samples);
+
+    //! Training phase and adaptive thresholding of one filtered (MA-integrated) sample.
+    //! Shared by AppendPoint() and AppendBlock()
+    //!
+    //! \param is_peak true, if the previous filtered sample is a peak (see PeakDetectorFilter::Apply())
+    void DetectQRS(const DataType_TP filtered_sample, const double timestamp_sec, const bool is_peak);
+
+    //! Peak detection of the whole chunk at once, then DetectQRS() for each sample.
+    //! chunk_size must not be greater than _block_chunk_size
+    //!
+    //! \param chunk_begin index of the first sample of the chunk inside the block, which starts at t0_sec
+    void DetectQRSChunk(const DataType_TP* filtered_samples, size_t chunk_size, const double t0_sec, size_t chunk_begin);
+
+    //! Pushes an event for the current peak into the event queue (if connected)
+    void PublishEvent(const BeatClassification_TP classification);
+
     // Private variables
 private:
     // Pan-Topkins adaptive Threshold parameter
@@ -69,46 +170,39 @@ private:
     //! T-Waves can only be found after refractory_period passed but before the t_wave_period passed
     const double _t_wave_period_ms = 360.0;
 
-    // The window length for the moving-average-integration in milliseconds.
-    // A QRS normally has a max width of 150 milliseconds.
-    const unsigned int _window_length_ms = 150;
+    //! Counters within this tolerance are considered expired. The timestamps calculated inside AppendBlock() 
+    //! can differ from the timestamps of the caller by rounding errors, which would flip the decision
+    //! when a peak occurs exactly at the end of the refractory period.
+    const double _counter_tolerance_sec = 1e-9;
 
     //! Duration  which will be used for the initialization of the thresholds in seconds
     unsigned int _training_phase_duration_s = 2;
 
-    //! Filter taps / order
-    const unsigned int _filter_order = 63;
-
-    //! Cutoff frequency of the lowpass filter 
-    //! (all frequencies below this one will be left in the signal after filtering)
-    const unsigned int _low_cutoff_freq_hz = 11;
-
-    //! Cutoff frquency of the highpass filter
-    //! (all frequencies above this one will be left in the signal after filtering)
-    const unsigned int _high_cutoff_freq_hz = 5;
-
     //! Sample frequency of the signal on which the qrs detection is done.
     double _sample_freq_hz = 0.0;
 
-    //! the length of the MA-window in samples
-    unsigned int _window_length_samples = 0;
-
     //! The number of training samples
     unsigned int _number_of_training_samples = 0;
 
     //! Delay of the input signal due to the filtering in samples
     unsigned int _filter_delay_samples = 0;
 
+    //! Bandpass of the filter chain
+    QRSBandpass_TP _bandpass = QRSBandpass_TP::FIR;
+
     //! True if the training phase is completed and thresholds are initialized
     bool _thresholds_initialized = false;
 
-    //! Buffer for the training phase of the algorithm
-    std::vector<DataType_TP> _training_buffer;
-    //! Tail index for the training buffer
+    //! Maximum of the filtered samples of the training phase
+    DataType_TP _training_max = 0;
+    //! Sum of the filtered samples of the training phase
+    DataType_TP _training_sum = 0;
+    //! Number of samples processed during the training phase
     unsigned int _training_data_idx = 0;
 
-    //! Bandpass filter
-    kfr::filter_fir<kfr::fbase, double>* _bandpass_filter;
+    //! Bandpass, derivation, squaring and moving average.
+    //! Specialized at compile time for the common sample frequencies (see CreateQRSFilterChain())
+    std::unique_ptr<QRSFilterChain<DataType_TP>> _filter_chain;
 
     //! This value is initialized with _t_wave_period_ms, when a qrs complex was detected and decremented gradually, to detect
     //! if a Peak appears right after another peak. If a peak occurs _t_wave_period_ms ms after another peak, 
@@ -129,62 +223,65 @@ private:
     //! The number of detected qrs complex, since Reset() was called, or this class was initialized
     unsigned int _qrs_counter = 0;
 
+    //! The number of updates of the noise level, since Reset() was called, or this class was initialized
+    unsigned int _noise_peak_counter = 0;
+
+    //! The number of peaks, since Reset() was called, or this class was initialized
+    unsigned int _peak_counter = 0;
+
+    //! Smallest distance of a peak amplitude to the thresholds (see QRSDetectionState_TP)
+    double _min_threshold_margin = std::numeric_limits<double>::infinity();
+
     //! Amplitude value of the current peak
     DataType_TP _peak_amplitude = 0;
 
     //! Timestamp of the current peak
     double _peak_timestamp = 0;
 
-    kfr::univector<DataType_TP> _input_buff;
+    //! Number of samples filtered at once by AppendBlock()
+    static constexpr size_t _block_chunk_size = 256;
 
-    //! Moving average filter
-    MovingAverageStateFilter<DataType_TP> _ma_filter;
+    //! Working buffer of AppendBlock()
+    std::array<DataType_TP, _block_chunk_size> _block_buff{};
 
-    //! Differentiation filter
-    DerivationStateFilter<DataType_TP> _diff_filter;
+    //! Indices of the peaks found inside the current chunk by the block version of PeakDetectorFilter::Apply()
+    std::array<unsigned int, _block_chunk_size> _peak_indices{};
 
     //! Filter to detect peaks in the data-stream
     PeakDetectorFilter<DataType_TP> _peak_filter;
 
     //! The function called, when a qrs complex is detected
     std::function<void(const double)> _qrs_callback;
+
+    //! Receives the beat events; optional
+    SPSCQueue_TC<BeatEvent_TP>* _event_queue = nullptr;
+
+    size_t _num_dropped_events = 0;
+
+    //! Index of the next sample inside the stream
+    long long _sample_idx = 0;
 };
 
 
 template<typename DataType_TP>
 PanTopkinsQRSDetection<DataType_TP>::PanTopkinsQRSDetection(double sample_freq_hz,
-    unsigned int training_phase_duration_sec)
-    : _peak_filter(sample_freq_hz * 3) // Make a buffer which can store up to 3 secs of signal history(Which seems bit too small (we need to lookup last eight R-R intervalls))
+    unsigned int training_phase_duration_sec,
+    QRSBandpass_TP bandpass)
 {
     _sample_freq_hz = sample_freq_hz;
     _training_phase_duration_s = training_phase_duration_sec;
-    // Create Buffers for Filtering (purpose is to keep a signal history)
-    _window_length_samples = (static_cast<double>(_window_length_ms) / 1000.0) * _sample_freq_hz;
+    _bandpass = bandpass;
 
     _number_of_training_samples = training_phase_duration_sec * _sample_freq_hz;
-    _training_buffer.resize(_number_of_training_samples);
-
-    _input_buff.resize(1);
-
-    // Create the bandpass filter
-    kfr::univector<kfr::fbase, 63> taps63;
-    kfr::expression_pointer<kfr::fbase> window = kfr::to_pointer(kfr::window_kaiser(taps63.size(), 3.0)); // 3.0=Filter gain
-    // Fill taps63 with the band pass FIR filter coefficients using kaiser window and cutoff=y.x and u.t Hz
-    kfr::fir_bandpass(taps63, _high_cutoff_freq_hz, _low_cutoff_freq_hz, window, true);
-    _bandpass_filter = new kfr::filter_fir<kfr::fbase, double>(taps63);
-    // Calculate filter delay
-    // times 2, because the lowpass and highpass filtering each introduce a delay, which is half the filter order.
-    _filter_delay_samples = (_filter_order / 2) * 2;
-
-    // Configure MA-Filter 
-    _ma_filter.SetParams(_window_length_samples);
-    //_filter_delay_samples += _ma_filter.GetFilterDelay();
+
+    // Create the filters (bandpass with 5 - 11 Hz, derivation, squaring, moving average)
+    _filter_chain = CreateQRSFilterChain<DataType_TP>(_sample_freq_hz, _bandpass);
+    _filter_delay_samples = _filter_chain->GetFilterDelay();
 }
 
 template<typename DataType_TP>
 PanTopkinsQRSDetection<DataType_TP>::~PanTopkinsQRSDetection()
 {
-    delete _bandpass_filter;
 }
 
 
@@ -192,37 +289,79 @@ template<typename DataType_TP>
 void
 PanTopkinsQRSDetection<DataType_TP>::AppendPoint(const DataType_TP& sample, const double timestamp)
 {
-    _input_buff[0] = sample;
-    
-    // Use bandpass as state filter: filter each sample by sample
-    _bandpass_filter->apply(_input_buff);
+    // Use the filter chain as state filter: filter each sample by sample
+    const DataType_TP filtered_sample = _filter_chain->Process(sample);
+    DetectQRS(filtered_sample, timestamp, _peak_filter.Apply(filtered_sample));
+}
+
+template<typename DataType_TP>
+void
+PanTopkinsQRSDetection<DataType_TP>::AppendBlock(span<const DataType_TP> samples, const double t0_sec)
+{
+    const size_t block_size = samples.size();
+    for ( size_t chunk_begin = 0; chunk_begin < block_size; chunk_begin += _block_chunk_size ) {
+        const size_t chunk_size = std::min(_block_chunk_size, block_size - chunk_begin);
 
-    // derivation state filter
-    _diff_filter.Apply(_input_buff[0]);
+        // bandpass, derivation, squaring and moving average
+        _filter_chain->Apply(_block_buff.data(), samples.data() + chunk_begin, chunk_size);
 
-    // square derivated sig
-    _input_buff[0] = _input_buff[0] * _input_buff[0];
-    // moving average state filter 
-    _ma_filter.Apply(_input_buff[0]);
+        DetectQRSChunk(_block_buff.data(), chunk_size, t0_sec, chunk_begin);
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+PanTopkinsQRSDetection<DataType_TP>::AppendFilteredBlock(span<const DataType_TP> filtered_samples, const double t0_sec)
+{
+    const size_t block_size = filtered_samples.size();
+    for ( size_t chunk_begin = 0; chunk_begin < block_size; chunk_begin += _block_chunk_size ) {
+        const size_t chunk_size = std::min(_block_chunk_size, block_size - chunk_begin);
+        DetectQRSChunk(filtered_samples.data() + chunk_begin, chunk_size, t0_sec, chunk_begin);
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+PanTopkinsQRSDetection<DataType_TP>::DetectQRSChunk(const DataType_TP* filtered_samples,
+                                                    size_t chunk_size,
+                                                    const double t0_sec,
+                                                    size_t chunk_begin)
+{
+    const size_t num_peaks = _peak_filter.Apply(filtered_samples, chunk_size, _peak_indices.data());
+
+    // The decision logic depends on the previous sample -> sample by sample
+    const double sample_dist_sec = 1.0 / _sample_freq_hz;
+    size_t next_peak = 0;
+    for ( size_t idx = 0; idx < chunk_size; ++idx ) {
+        const bool is_peak = next_peak < num_peaks && _peak_indices[next_peak] == idx;
+        next_peak += is_peak;
+        DetectQRS(filtered_samples[idx], t0_sec + (chunk_begin + idx) * sample_dist_sec, is_peak);
+    }
+}
 
+template<typename DataType_TP>
+void
+PanTopkinsQRSDetection<DataType_TP>::DetectQRS(const DataType_TP filtered_sample, const double timestamp, const bool is_peak)
+{
     // Training phase 1 (if not already done) => Wrap this into a function,
     // outside of the Apply() function so we dont need to call if() each time?
     // => but for safe use of the class, we should always check if thresholds are initialized eitherway?
     if ( !_thresholds_initialized ) {
         if ( _training_data_idx < _number_of_training_samples ) {
             // Collect more data and initialize the thresholds when we got enough
-            _training_buffer[_training_data_idx] = _input_buff[0];
+            _training_max = _training_data_idx == 0 ? filtered_sample : std::max(_training_max, filtered_sample);
+            _training_sum += filtered_sample;
             // thresholds are not initialized yet!
         } else {
-            InitializeThresholds(_training_buffer);
+            InitializeThresholds(_training_max, _training_sum, _number_of_training_samples);
             _thresholds_initialized = true;
         }
         ++_training_data_idx;
     }
 
     // Thresholds are initialized; Now we can start QRS Detection 
-    // Peak detection (=> detect peaks only when not in refractory period)
-    bool is_peak = _peak_filter.Apply(_input_buff[0]);
 
     // bool is_qrs = false;
     // bool is_t_wave = false;
@@ -234,6 +373,12 @@ PanTopkinsQRSDetection<DataType_TP>::AppendPoint(const DataType_TP& sample, cons
         _refractory_period_counter -= _time_since_last_peak_sec;
         _t_wave_counter -= _time_since_last_peak_sec;
         _last_peak_timestamp = timestamp;
+        ++_peak_counter;
+        if ( _thresholds_initialized ) {
+            _min_threshold_margin = std::min({ _min_threshold_margin,
+                                               std::abs(_peak_amplitude - _signal_threshold),
+                                               2.0 * std::abs(_peak_amplitude - _noise_threshold) });
+        }
 
         // Now use criterias (T-period, inhibitation time,..) to remove false positive peaks and only return valid peak locations
         
@@ -242,16 +387,20 @@ PanTopkinsQRSDetection<DataType_TP>::AppendPoint(const DataType_TP& sample, cons
             // Found a potential QRS peak
 
             // first check if it could also be a t - wave
-            if ( _t_wave_counter > 0 && 
-                _refractory_period_counter <= 0 )
+            if ( _t_wave_counter > _counter_tolerance_sec && 
+                _refractory_period_counter <= _counter_tolerance_sec )
             {
                 //is_t_wave = true;
                 _t_wave_counter = 0;
+                PublishEvent(BeatClassification_TP::TWave);
             } // It's not a t-wave, check for qrs:
-            else if ( _refractory_period_counter <= 0 ) {
+            else if ( _refractory_period_counter <= _counter_tolerance_sec ) {
                 //is_qrs = true;
                 // Call callback to notify the listener the detected qrs location
-                _qrs_callback(_peak_timestamp-(_filter_delay_samples/_sample_freq_hz) );
+                if ( _qrs_callback ) {
+                    _qrs_callback(_peak_timestamp-(_filter_delay_samples/_sample_freq_hz) );
+                }
+                PublishEvent(BeatClassification_TP::QRS);
 
                 // update signal level
                 _signal_level = 0.125 * _peak_amplitude + 0.875 * _signal_level;
@@ -269,11 +418,12 @@ PanTopkinsQRSDetection<DataType_TP>::AppendPoint(const DataType_TP& sample, cons
             // Found noise
             // update noise level
             _noise_level = 0.125 * _peak_amplitude + 0.875 * _noise_level;
+            ++_noise_peak_counter;
         }
 
         // Update signal and noise thresholds
         // first set of thresholds
-        _signal_threshold = _signal_level + 0.25 * (_signal_level - _noise_level);
+        _signal_threshold = _noise_level + 0.25 * (_signal_level - _noise_level);
         _noise_threshold = 0.5 * _signal_threshold;
 
         // Todo: second set of thresholds for qrs search back
@@ -285,10 +435,29 @@ PanTopkinsQRSDetection<DataType_TP>::AppendPoint(const DataType_TP& sample, cons
     // TODO The timestamp of the detected peak is  actually _timestamp_last_sample ( does not exist yet )
     // and not the timestamp of the current sample
     // => calculate _timestamp_last_sample with the sample frequency: _timestamp_last_sample = timestamp_current - _sample_dist_sec
-    _peak_amplitude = _input_buff[0];
+    _peak_amplitude = filtered_sample;
     _peak_timestamp = timestamp;
-    // Just for prototyping: return the filtered signal
-    return /*_input_buff[0]*/;
+    ++_sample_idx;
+}
+
+template<typename DataType_TP>
+inline
+void
+PanTopkinsQRSDetection<DataType_TP>::PublishEvent(const BeatClassification_TP classification)
+{
+    if ( _event_queue == nullptr ) {
+        return;
+    }
+
+    BeatEvent_TP event;
+    event._timestamp_sec = _peak_timestamp - (_filter_delay_samples / _sample_freq_hz);
+    event._amplitude = _peak_amplitude;
+    // the peak is the sample before the current one
+    event._sample_idx = _sample_idx - 1 - static_cast<long long>(_filter_delay_samples);
+    event._classification = classification;
+    if ( !_event_queue->TryPush(event) ) {
+        ++_num_dropped_events;
+    }
 }
 
 template<typename DataType_TP>
@@ -298,16 +467,28 @@ void PanTopkinsQRSDetection<DataType_TP>::Reset(float sample_freq_hz, unsigned i
     _t_wave_counter = 0;
     _refractory_period_counter = 0;
     _qrs_counter = 0;
+    _noise_peak_counter = 0;
+    _peak_counter = 0;
+    _min_threshold_margin = std::numeric_limits<double>::infinity();
 
     _thresholds_initialized = false;
     _training_data_idx = 0;
+    _training_max = 0;
+    _training_sum = 0;
+    _sample_idx = 0;
 
+    const bool sample_freq_changed = static_cast<double>(sample_freq_hz) != _sample_freq_hz;
     _sample_freq_hz = sample_freq_hz;
     _training_phase_duration_s = training_phase_duration_sec;
-    _window_length_samples = (static_cast<double>(_window_length_ms) / 1000.0) * _sample_freq_hz;
-    // Create Buffers to keep data for training phase 1 (Threshold initialization)
+    // Number of samples for the training phase 1 (Threshold initialization)
     _number_of_training_samples = training_phase_duration_sec * _sample_freq_hz;
-    _training_buffer.resize(_number_of_training_samples);
+    if ( sample_freq_changed ) {
+        _filter_chain = CreateQRSFilterChain<DataType_TP>(_sample_freq_hz, _bandpass);
+        _filter_delay_samples = _filter_chain->GetFilterDelay();
+    } else {
+        _filter_chain->ResetState();
+    }
+    _peak_filter.ResetState();
 }
 
 template<typename DataType_TP>
@@ -318,6 +499,66 @@ PanTopkinsQRSDetection<DataType_TP>::Connect(std::function<void(const double&)>
     _qrs_callback = qrs_callback;
 }
 
+template<typename DataType_TP>
+inline
+void
+PanTopkinsQRSDetection<DataType_TP>::ConnectEventQueue(SPSCQueue_TC<BeatEvent_TP>* event_queue)
+{
+    _event_queue = event_queue;
+}
+
+template<typename DataType_TP>
+inline
+size_t
+PanTopkinsQRSDetection<DataType_TP>::GetNumDroppedEvents()
+{
+    return _num_dropped_events;
+}
+
+
+template<typename DataType_TP>
+inline
+QRSDetectionState_TP
+PanTopkinsQRSDetection<DataType_TP>::GetState() const
+{
+    QRSDetectionState_TP state;
+    state._signal_threshold = _signal_threshold;
+    state._noise_threshold = _noise_threshold;
+    state._signal_level = _signal_level;
+    state._noise_level = _noise_level;
+    state._t_wave_counter = _t_wave_counter;
+    state._refractory_period_counter = _refractory_period_counter;
+    state._last_peak_timestamp = _last_peak_timestamp;
+    state._thresholds_initialized = _thresholds_initialized;
+    state._num_signal_level_updates = _qrs_counter;
+    state._num_noise_level_updates = _noise_peak_counter;
+    state._num_peaks = _peak_counter;
+    state._min_threshold_margin = _min_threshold_margin;
+    return state;
+}
+
+template<typename DataType_TP>
+inline
+void
+PanTopkinsQRSDetection<DataType_TP>::SetState(const QRSDetectionState_TP& state)
+{
+    _signal_threshold = state._signal_threshold;
+    _noise_threshold = state._noise_threshold;
+    _signal_level = state._signal_level;
+    _noise_level = state._noise_level;
+    _t_wave_counter = state._t_wave_counter;
+    _refractory_period_counter = state._refractory_period_counter;
+    _last_peak_timestamp = state._last_peak_timestamp;
+    _thresholds_initialized = state._thresholds_initialized;
+}
+
+template<typename DataType_TP>
+inline
+void
+PanTopkinsQRSDetection<DataType_TP>::ResetThresholdMargin()
+{
+    _min_threshold_margin = std::numeric_limits<double>::infinity();
+}
 
 template<typename DataType_TP>
 inline
@@ -331,17 +572,31 @@ template<typename DataType_TP>
 void
 PanTopkinsQRSDetection<DataType_TP>::InitializeThresholds(const std::vector<DataType_TP>& training_data)
 {
-    // Signal threshold
-    // 0.25 of the max amplitude is signal thresh
-    _signal_threshold = *std::max_element(training_data.begin(), training_data.end()) * 0.25;
-        
-    // Noise threshold
-    // Calculate signal mean
+    if ( training_data.empty() ) {
+        InitializeThresholds(0, 0, 0);
+        return;
+    }
     DataType_TP signal_sum = 0;
     for ( const auto& sample : training_data ) {
         signal_sum += sample;
     }
-    DataType_TP signal_mean = signal_sum / training_data.size();
+    InitializeThresholds(*std::max_element(training_data.begin(), training_data.end()), signal_sum, training_data.size());
+}
+
+template<typename DataType_TP>
+inline
+void
+PanTopkinsQRSDetection<DataType_TP>::InitializeThresholds(const DataType_TP training_max,
+                                                          const DataType_TP training_sum,
+                                                          size_t num_training_samples)
+{
+    // Signal threshold
+    // 0.25 of the max amplitude is signal thresh
+    _signal_threshold = training_max * 0.25;
+
+    // Noise threshold
+    // Calculate signal mean
+    DataType_TP signal_mean = num_training_samples > 0 ? training_sum / num_training_samples : 0;
     // 0.5 of the mean signal is considered to be the noise threhold
     _noise_threshold = signal_mean * 1 / 2;
 }
@@ -0,0 +1,328 @@
+#pragma once
+
+// Project includes
+#include "qrs_filter_chain.h"
+
+// STL includes
+#include <vector>
+#include <utility>
+#include <numeric>
+#include <cmath>
+#include <type_traits>
+#include <algorithm>
+
+///////////////////////////////////////////////////////
+//
+// Class: PolyphaseResampler
+//
+//! Streaming sample rate conversion by the rational factor up_factor / down_factor.
+//!
+//! The lowpass (anti-imaging and anti-aliasing) is designed for the up_factor times upsampled input and split into
+//! up_factor phases (the filter bank), which are calculated at construction. Output sample k belongs to the
+//! upsampled position k * down_factor and is the dot product of the phase (k * down_factor) mod up_factor
+//! with the input samples around the input position k * down_factor / up_factor: 2 * half_filter_length + 1 multiplications
+//! per output, independent of the factors.
+//!
+//! The output sample k belongs to the time k / output sample frequency, relative to the first input sample:
+//! the outputs are aligned with the input timeline and need no timestamp correction.
+//! Because the lowpass is centered, an output is available half_filter_length input samples later (GetFilterDelay());
+//! Flush() returns the outputs of the last input samples at the end of the stream.
+//! The signal before the first and after the last input sample is considered to be constant.
+//!
+//! Usage:
+//! PolyphaseResampler<double> resampler(250.0, 360.0);
+//! std::vector<double> output(resampler.GetMaxOutputCount(block_size));
+//! size_t num_outputs = resampler.Apply(block, block_size, output.data());
+template<typename DataType_TP>
+class PolyphaseResampler {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param input_sample_freq_hz sample frequency of the input
+    //! \param output_sample_freq_hz sample frequency of the output. The ratio of the frequencies is approximated
+    //!        by a fraction with a denominator up to max_up_factor (exact for the usual ecg sample frequencies)
+    //! \param half_filter_length number of input samples on each side of an output, which are used for its calculation
+    PolyphaseResampler(double input_sample_freq_hz,
+                       double output_sample_freq_hz,
+                       unsigned int half_filter_length = 8,
+                       unsigned int max_up_factor = 1000);
+
+    // Public functions
+public:
+    //! Adds one input sample and stores the new output samples inside output (space for GetMaxOutputCount(1) samples)
+    //!
+    //! \returns the number of new output samples
+    size_t Apply(const DataType_TP& sample, DataType_TP* output);
+
+    //! Block version of Apply(): resamples block_size input samples into dst
+    //! (space for GetMaxOutputCount(block_size) samples)
+    //!
+    //! \returns the number of output samples
+    size_t Apply(const DataType_TP* src, size_t block_size, DataType_TP* dst);
+
+    //! Ends the stream: stores the outputs up to the time of the last input sample, which are still missing, inside dst
+    //! (space for GetMaxOutputCount(GetFilterDelay()) samples) and resets the state
+    //!
+    //! \returns the number of output samples
+    size_t Flush(DataType_TP* dst);
+
+    void ResetState();
+
+    //! Returns the maximum number of output samples of num_input_samples input samples
+    size_t GetMaxOutputCount(size_t num_input_samples);
+
+    //! Returns the number of input samples, by which the outputs lag behind the input
+    unsigned int GetFilterDelay();
+
+    unsigned int GetUpFactor();
+
+    unsigned int GetDownFactor();
+
+    //! Returns the exact output sample frequency (input sample frequency * up_factor / down_factor)
+    double GetOutputSampleFrequency();
+
+    //! Returns the fraction up / down with up <= max_up_factor, which approximates the ratio best (continued fraction)
+    static std::pair<unsigned int, unsigned int> ApproximateRatio(double ratio, unsigned int max_up_factor);
+
+    // Private types
+private:
+    //! Integer samples are resampled with double precision
+    using Value_TP = std::conditional_t<std::is_floating_point<DataType_TP>::value, DataType_TP, double>;
+
+    // Private functions
+private:
+    DataType_TP CalculateOutput(unsigned int phase);
+
+    //! Adds the sample to the delay line and stores the outputs with a position below max_output_position inside output
+    //!
+    //! \returns the number of outputs
+    size_t PushSample(const Value_TP sample, DataType_TP* output, const long long max_output_position);
+
+    // Private variables
+private:
+    double _input_sample_freq_hz = 1.0;
+
+    unsigned int _up_factor = 1;
+
+    unsigned int _down_factor = 1;
+
+    unsigned int _half_filter_length = 0;
+
+    //! Taps per phase: 2 * _half_filter_length + 1
+    unsigned int _phase_length = 1;
+
+    //! Taps of phase p (scaled by _up_factor), in the order of the delay line (newest input first):
+    //! _phase_taps[p * _phase_length + j] = up_factor * h[p + j * up_factor]
+    std::vector<Value_TP> _phase_taps;
+
+    //! Last _phase_length input samples, stored twice in a row, so the newest _phase_length samples
+    //! are located at [_write_idx, _write_idx + _phase_length)
+    std::vector<Value_TP> _delay_line;
+
+    //! Position of the newest sample inside the delay line
+    unsigned int _write_idx = 0;
+
+    //! Upsampled position of the next output relative to the input sample, which is at the center of the delay line
+    //! after the next input sample was added. The output is calculated as soon as it is below _up_factor
+    long long _next_output_position = 0;
+
+    //! Last input sample (repeated by Flush())
+    Value_TP _last_sample = 0;
+
+    bool _is_filled = false;
+};
+
+template<typename DataType_TP>
+PolyphaseResampler<DataType_TP>::PolyphaseResampler(double input_sample_freq_hz,
+                                                    double output_sample_freq_hz,
+                                                    unsigned int half_filter_length,
+                                                    unsigned int max_up_factor)
+    : _input_sample_freq_hz(input_sample_freq_hz),
+    _half_filter_length(std::max(1u, half_filter_length))
+{
+    std::tie(_up_factor, _down_factor) = ApproximateRatio(output_sample_freq_hz / input_sample_freq_hz, max_up_factor);
+    _phase_length = 2 * _half_filter_length + 1;
+
+    // lowpass at the upsampled frequency, centered: the center tap belongs to the center of the delay line.
+    // Cutoff below the smaller nyquist frequency
+    const double upsampled_freq_hz = input_sample_freq_hz * _up_factor;
+    const double cutoff_hz = 0.45 * std::min(input_sample_freq_hz, GetOutputSampleFrequency());
+    const unsigned int num_taps = 2 * _half_filter_length * _up_factor + 1;
+    const auto taps = DesignLowpassTaps(num_taps, cutoff_hz, upsampled_freq_hz, 6.0);
+
+    _phase_taps.assign(_up_factor * _phase_length, Value_TP(0));
+    for ( unsigned int phase = 0; phase < _up_factor; ++phase ) {
+        for ( unsigned int idx = 0; idx < _phase_length; ++idx ) {
+            const size_t tap_idx = phase + static_cast<size_t>(idx) * _up_factor;
+            if ( tap_idx < taps.size() ) {
+                _phase_taps[phase * _phase_length + idx] = static_cast<Value_TP>(_up_factor * taps[tap_idx]);
+            }
+        }
+    }
+    _delay_line.resize(2 * _phase_length);
+    ResetState();
+}
+
+template<typename DataType_TP>
+inline
+std::pair<unsigned int, unsigned int>
+PolyphaseResampler<DataType_TP>::ApproximateRatio(double ratio, unsigned int max_up_factor)
+{
+    // convergents h / k of the continued fraction of 1 / ratio = down / up
+    const double inverse_ratio = 1.0 / ratio;
+    double remainder = inverse_ratio;
+    unsigned long long h_prev = 1, h = static_cast<unsigned long long>(std::floor(remainder));
+    unsigned long long k_prev = 0, k = 1;
+    while ( true ) {
+        const double fraction = remainder - std::floor(remainder);
+        if ( std::abs(static_cast<double>(h) / k - inverse_ratio) <= 1e-12 * inverse_ratio || fraction < 1e-12 ) {
+            break;
+        }
+        remainder = 1.0 / fraction;
+        const unsigned long long term = static_cast<unsigned long long>(std::floor(remainder));
+        const unsigned long long h_next = term * h + h_prev;
+        const unsigned long long k_next = term * k + k_prev;
+        if ( k_next > max_up_factor ) {
+            break;
+        }
+        h_prev = h;
+        h = h_next;
+        k_prev = k;
+        k = k_next;
+    }
+    return { static_cast<unsigned int>(k), static_cast<unsigned int>(std::max(1ull, h)) };
+}
+
+template<typename DataType_TP>
+inline
+size_t
+PolyphaseResampler<DataType_TP>::Apply(const DataType_TP& sample, DataType_TP* output)
+{
+    return PushSample(static_cast<Value_TP>(sample), output, _up_factor);
+}
+
+template<typename DataType_TP>
+inline
+size_t
+PolyphaseResampler<DataType_TP>::Apply(const DataType_TP* src, size_t block_size, DataType_TP* dst)
+{
+    size_t num_outputs = 0;
+    for ( size_t idx = 0; idx < block_size; ++idx ) {
+        num_outputs += PushSample(static_cast<Value_TP>(src[idx]), dst + num_outputs, _up_factor);
+    }
+    return num_outputs;
+}
+
+template<typename DataType_TP>
+inline
+size_t
+PolyphaseResampler<DataType_TP>::Flush(DataType_TP* dst)
+{
+    size_t num_outputs = 0;
+    if ( _is_filled ) {
+        const Value_TP last_sample = _last_sample;
+        for ( unsigned int count = 1; count < _half_filter_length; ++count ) {
+            num_outputs += PushSample(last_sample, dst + num_outputs, _up_factor);
+        }
+        // the last input sample is at the center now: only an output exactly at its position belongs to the input
+        num_outputs += PushSample(last_sample, dst + num_outputs, 1);
+    }
+    ResetState();
+    return num_outputs;
+}
+
+template<typename DataType_TP>
+inline
+size_t
+PolyphaseResampler<DataType_TP>::PushSample(const Value_TP sample, DataType_TP* output, const long long max_output_position)
+{
+    if ( !_is_filled ) {
+        // the signal before the first sample equals the first sample
+        std::fill(_delay_line.begin(), _delay_line.end(), sample);
+        _is_filled = true;
+    }
+    _last_sample = sample;
+
+    _write_idx = _write_idx == 0 ? _phase_length - 1 : _write_idx - 1;
+    _delay_line[_write_idx] = sample;
+    _delay_line[_write_idx + _phase_length] = sample;
+
+    size_t num_outputs = 0;
+    while ( _next_output_position < max_output_position ) {
+        output[num_outputs++] = CalculateOutput(static_cast<unsigned int>(_next_output_position));
+        _next_output_position += _down_factor;
+    }
+    _next_output_position -= _up_factor;
+    return num_outputs;
+}
+
+template<typename DataType_TP>
+inline
+DataType_TP
+PolyphaseResampler<DataType_TP>::CalculateOutput(unsigned int phase)
+{
+    const Value_TP* taps = _phase_taps.data() + phase * _phase_length;
+    const Value_TP* history = _delay_line.data() + _write_idx;
+    Value_TP result = 0;
+    for ( unsigned int idx = 0; idx < _phase_length; ++idx ) {
+        result += taps[idx] * history[idx];
+    }
+    if constexpr ( std::is_floating_point<DataType_TP>::value ) {
+        return result;
+    } else {
+        return static_cast<DataType_TP>(std::lround(result));
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+PolyphaseResampler<DataType_TP>::ResetState()
+{
+    std::fill(_delay_line.begin(), _delay_line.end(), Value_TP(0));
+    _write_idx = 0;
+    // the first output (position 0) needs the input sample _half_filter_length; it is at the center, when this sample was added
+    _next_output_position = static_cast<long long>(_half_filter_length) * _up_factor;
+    _last_sample = 0;
+    _is_filled = false;
+}
+
+template<typename DataType_TP>
+inline
+size_t
+PolyphaseResampler<DataType_TP>::GetMaxOutputCount(size_t num_input_samples)
+{
+    return (num_input_samples * _up_factor) / _down_factor + 1;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+PolyphaseResampler<DataType_TP>::GetFilterDelay()
+{
+    return _half_filter_length;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+PolyphaseResampler<DataType_TP>::GetUpFactor()
+{
+    return _up_factor;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+PolyphaseResampler<DataType_TP>::GetDownFactor()
+{
+    return _down_factor;
+}
+
+template<typename DataType_TP>
+inline
+double
+PolyphaseResampler<DataType_TP>::GetOutputSampleFrequency()
+{
+    return _input_sample_freq_hz * _up_factor / _down_factor;
+}
@@ -0,0 +1,673 @@
+#pragma once
+
+// Projects includes
+#include "rt_state_filters.h"
+
+// STL includes
+#include <array>
+#include <vector>
+#include <memory>
+#include <cmath>
+
+///////////////////////////////////////////////////////
+//
+// Compile time filter design
+//
+// std::sin() etc. are not constexpr, so the filter design uses own series implementations.
+// The same functions are used for the runtime design, so both paths produce the same taps.
+
+//! Filter parameters of the pan topkins qrs detection
+struct QRSFilterParams_TP {
+    //! Filter taps / order of the bandpass
+    static constexpr unsigned int _num_taps = 63;
+
+    //! Cutoff frequency of the highpass filter
+    //! (all frequencies above this one will be left in the signal after filtering)
+    static constexpr double _highpass_cutoff_hz = 5.0;
+
+    //! Cutoff frequency of the lowpass filter
+    //! (all frequencies below this one will be left in the signal after filtering)
+    static constexpr double _lowpass_cutoff_hz = 11.0;
+
+    //! Shape parameter of the kaiser window
+    static constexpr double _kaiser_beta = 3.0;
+
+    //! Number of second order sections of the IIR bandpass (see QRSBandpass_TP::ButterworthIIR)
+    static constexpr unsigned int _num_iir_sections = 2;
+
+    //! The window length for the moving-average-integration in milliseconds.
+    //! A QRS normally has a max width of 150 milliseconds.
+    static constexpr unsigned int _window_length_ms = 150;
+};
+
+constexpr double constexpr_pi = 3.14159265358979323846;
+
+constexpr
+double
+constexpr_sqrt(const double x)
+{
+    if ( x <= 0.0 ) {
+        return 0.0;
+    }
+    // Newton iteration
+    double result = x > 1.0 ? x : 1.0;
+    for ( int iteration = 0; iteration < 100; ++iteration ) {
+        const double next = 0.5 * (result + x / result);
+        if ( next == result ) {
+            break;
+        }
+        result = next;
+    }
+    return result;
+}
+
+constexpr
+double
+constexpr_sin(double x)
+{
+    // reduce to [-pi, pi]
+    const double periods = x / (2.0 * constexpr_pi);
+    const long long full_periods = static_cast<long long>(periods < 0.0 ? periods - 0.5 : periods + 0.5);
+    x -= full_periods * 2.0 * constexpr_pi;
+
+    // taylor series
+    double term = x;
+    double result = x;
+    for ( int n = 1; n < 40; ++n ) {
+        term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+        result += term;
+    }
+    return result;
+}
+
+constexpr
+double
+constexpr_cos(const double x)
+{
+    return constexpr_sin(x + 0.5 * constexpr_pi);
+}
+
+//! Modified bessel function of the first kind and order zero (kaiser window)
+constexpr
+double
+constexpr_bessel_i0(const double x)
+{
+    double term = 1.0;
+    double result = 1.0;
+    for ( int k = 1; k < 100; ++k ) {
+        const double factor = x / (2.0 * k);
+        term *= factor * factor;
+        result += term;
+        if ( term < result * 1e-17 ) {
+            break;
+        }
+    }
+    return result;
+}
+
+//! Kaiser windowed sinc bandpass with unity gain in the center of the passband, written to taps[0, num_taps).
+//! Shared by the compile time and the runtime design, so both produce the same taps for the same parameters
+//! (unless the compiler contracts the runtime arithmetic to fused multiply-adds, e.g. -march with FMA and -ffp-contract=fast)
+//!
+//! \param highpass_cutoff_hz lower edge of the passband
+//! \param lowpass_cutoff_hz upper edge of the passband
+constexpr
+void
+FillBandpassTaps(double* taps,
+                 const unsigned int num_taps,
+                 const double highpass_cutoff_hz,
+                 const double lowpass_cutoff_hz,
+                 const double sample_freq_hz,
+                 const double kaiser_beta)
+{
+    // normalized to the sample frequency
+    const double lower_freq = highpass_cutoff_hz / sample_freq_hz;
+    const double upper_freq = lowpass_cutoff_hz / sample_freq_hz;
+    const double center = (num_taps - 1) / 2.0;
+    const double window_norm = constexpr_bessel_i0(kaiser_beta);
+
+    for ( unsigned int idx = 0; idx < num_taps; ++idx ) {
+        const double m = idx - center;
+        const double sinc = m == 0.0 ?
+                            2.0 * (upper_freq - lower_freq) :
+                            (constexpr_sin(2.0 * constexpr_pi * upper_freq * m) -
+                             constexpr_sin(2.0 * constexpr_pi * lower_freq * m)) / (constexpr_pi * m);
+        const double ratio = center > 0.0 ? m / center : 0.0;
+        const double window = constexpr_bessel_i0(kaiser_beta * constexpr_sqrt(1.0 - ratio * ratio)) / window_norm;
+        taps[idx] = sinc * window;
+    }
+
+    // Unity gain at the center frequency of the passband
+    const double center_freq = 0.5 * (lower_freq + upper_freq);
+    double real = 0.0;
+    double imag = 0.0;
+    for ( unsigned int idx = 0; idx < num_taps; ++idx ) {
+        real += taps[idx] * constexpr_cos(2.0 * constexpr_pi * center_freq * idx);
+        imag += taps[idx] * constexpr_sin(2.0 * constexpr_pi * center_freq * idx);
+    }
+    const double gain = constexpr_sqrt(real * real + imag * imag);
+    if ( gain != 0.0 ) {
+        for ( unsigned int idx = 0; idx < num_taps; ++idx ) {
+            taps[idx] /= gain;
+        }
+    }
+}
+
+//! Kaiser windowed sinc lowpass with unity gain at DC, written to taps[0, num_taps) (see FillBandpassTaps())
+constexpr
+void
+FillLowpassTaps(double* taps,
+                const unsigned int num_taps,
+                const double cutoff_hz,
+                const double sample_freq_hz,
+                const double kaiser_beta)
+{
+    const double cutoff_freq = cutoff_hz / sample_freq_hz;
+    const double center = (num_taps - 1) / 2.0;
+    const double window_norm = constexpr_bessel_i0(kaiser_beta);
+
+    double sum = 0.0;
+    for ( unsigned int idx = 0; idx < num_taps; ++idx ) {
+        const double m = idx - center;
+        const double sinc = m == 0.0 ?
+                            2.0 * cutoff_freq :
+                            constexpr_sin(2.0 * constexpr_pi * cutoff_freq * m) / (constexpr_pi * m);
+        const double ratio = center > 0.0 ? m / center : 0.0;
+        const double window = constexpr_bessel_i0(kaiser_beta * constexpr_sqrt(1.0 - ratio * ratio)) / window_norm;
+        taps[idx] = sinc * window;
+        sum += taps[idx];
+    }
+    if ( sum != 0.0 ) {
+        for ( unsigned int idx = 0; idx < num_taps; ++idx ) {
+            taps[idx] /= sum;
+        }
+    }
+}
+
+//! Bandpass taps designed at compile time (see FillBandpassTaps())
+template<unsigned int NumTaps_TP>
+constexpr
+std::array<double, NumTaps_TP>
+DesignBandpassTaps(const double highpass_cutoff_hz,
+                   const double lowpass_cutoff_hz,
+                   const double sample_freq_hz,
+                   const double kaiser_beta)
+{
+    std::array<double, NumTaps_TP> taps{};
+    FillBandpassTaps(taps.data(), NumTaps_TP, highpass_cutoff_hz, lowpass_cutoff_hz, sample_freq_hz, kaiser_beta);
+    return taps;
+}
+
+//! DesignBandpassTaps() with the number of taps known at runtime, e.g. for long offline filters (see OfflineFIRFilter)
+inline
+std::vector<double>
+DesignBandpassTaps(const unsigned int num_taps,
+                   const double highpass_cutoff_hz,
+                   const double lowpass_cutoff_hz,
+                   const double sample_freq_hz,
+                   const double kaiser_beta)
+{
+    std::vector<double> taps(num_taps);
+    FillBandpassTaps(taps.data(), num_taps, highpass_cutoff_hz, lowpass_cutoff_hz, sample_freq_hz, kaiser_beta);
+    return taps;
+}
+
+//! Lowpass taps with the number of taps known at runtime (see FillLowpassTaps())
+inline
+std::vector<double>
+DesignLowpassTaps(const unsigned int num_taps,
+                  const double cutoff_hz,
+                  const double sample_freq_hz,
+                  const double kaiser_beta)
+{
+    std::vector<double> taps(num_taps);
+    FillLowpassTaps(taps.data(), num_taps, cutoff_hz, sample_freq_hz, kaiser_beta);
+    return taps;
+}
+
+//! Frequency response of a second order polynomial p0 + p1 z^-1 + p2 z^-2 at z = e^(j omega)
+struct PolynomialResponse_TP {
+    //! real and imaginary part of the response
+    double _real = 0.0;
+    double _imag = 0.0;
+
+    //! real and imaginary part of the sum of k * p_k * e^(-j omega k); used for the group delay
+    double _weighted_real = 0.0;
+    double _weighted_imag = 0.0;
+
+    constexpr
+    PolynomialResponse_TP(const double p0, const double p1, const double p2, const double omega)
+    {
+        _real = p0 + p1 * constexpr_cos(omega) + p2 * constexpr_cos(2.0 * omega);
+        _imag = -p1 * constexpr_sin(omega) - p2 * constexpr_sin(2.0 * omega);
+        _weighted_real = p1 * constexpr_cos(omega) + 2.0 * p2 * constexpr_cos(2.0 * omega);
+        _weighted_imag = -p1 * constexpr_sin(omega) - 2.0 * p2 * constexpr_sin(2.0 * omega);
+    }
+
+    constexpr
+    double
+    MagnitudeSquared() const
+    {
+        return _real * _real + _imag * _imag;
+    }
+
+    //! Group delay in samples: the real part of the weighted sum divided by the response
+    constexpr
+    double
+    GroupDelay() const
+    {
+        return (_weighted_real * _real + _weighted_imag * _imag) / MagnitudeSquared();
+    }
+};
+
+//! Gain of the cascade of second order sections at the frequency (in Hz)
+template<size_t NumSections_TP>
+constexpr
+double
+BiquadCascadeGain(const std::array<BiquadCoefficients_TP, NumSections_TP>& sections,
+                  const double freq_hz,
+                  const double sample_freq_hz)
+{
+    const double omega = 2.0 * constexpr_pi * freq_hz / sample_freq_hz;
+    double gain_squared = 1.0;
+    for ( const auto& section : sections ) {
+        const PolynomialResponse_TP numerator(section._b0, section._b1, section._b2, omega);
+        const PolynomialResponse_TP denominator(1.0, section._a1, section._a2, omega);
+        gain_squared *= numerator.MagnitudeSquared() / denominator.MagnitudeSquared();
+    }
+    return constexpr_sqrt(gain_squared);
+}
+
+//! Group delay of the cascade of second order sections at the frequency (in Hz) in samples
+template<size_t NumSections_TP>
+constexpr
+double
+BiquadCascadeGroupDelay(const std::array<BiquadCoefficients_TP, NumSections_TP>& sections,
+                        const double freq_hz,
+                        const double sample_freq_hz)
+{
+    const double omega = 2.0 * constexpr_pi * freq_hz / sample_freq_hz;
+    double delay_samples = 0.0;
+    for ( const auto& section : sections ) {
+        const PolynomialResponse_TP numerator(section._b0, section._b1, section._b2, omega);
+        const PolynomialResponse_TP denominator(1.0, section._a1, section._a2, omega);
+        delay_samples += numerator.GroupDelay() - denominator.GroupDelay();
+    }
+    return delay_samples;
+}
+
+//! Second order butterworth lowpass or highpass section (bilinear transform with prewarped cutoff frequency)
+constexpr
+BiquadCoefficients_TP
+DesignButterworthSection(const double cutoff_hz, const double sample_freq_hz, const bool highpass)
+{
+    const double omega = constexpr_pi * cutoff_hz / sample_freq_hz;
+    const double k = constexpr_sin(omega) / constexpr_cos(omega);
+    const double sqrt_2 = constexpr_sqrt(2.0);
+    const double norm = 1.0 / (1.0 + sqrt_2 * k + k * k);
+
+    BiquadCoefficients_TP section;
+    if ( highpass ) {
+        section._b0 = norm;
+        section._b1 = -2.0 * norm;
+        section._b2 = norm;
+    } else {
+        section._b0 = k * k * norm;
+        section._b1 = 2.0 * k * k * norm;
+        section._b2 = k * k * norm;
+    }
+    section._a1 = 2.0 * (k * k - 1.0) * norm;
+    section._a2 = (1.0 - sqrt_2 * k + k * k) * norm;
+    return section;
+}
+
+//! Butterworth bandpass of order four: a second order highpass and a second order lowpass section
+//! (like the cascaded lowpass and highpass of the original pan topkins algorithm),
+//! with unity gain in the center of the passband
+constexpr
+std::array<BiquadCoefficients_TP, QRSFilterParams_TP::_num_iir_sections>
+DesignButterworthBandpassSections(const double highpass_cutoff_hz,
+                                  const double lowpass_cutoff_hz,
+                                  const double sample_freq_hz)
+{
+    std::array<BiquadCoefficients_TP, QRSFilterParams_TP::_num_iir_sections> sections = {
+        DesignButterworthSection(highpass_cutoff_hz, sample_freq_hz, true),
+        DesignButterworthSection(lowpass_cutoff_hz, sample_freq_hz, false)
+    };
+
+    const double center_freq_hz = 0.5 * (highpass_cutoff_hz + lowpass_cutoff_hz);
+    const double gain = BiquadCascadeGain(sections, center_freq_hz, sample_freq_hz);
+    if ( gain != 0.0 ) {
+        sections[0]._b0 /= gain;
+        sections[0]._b1 /= gain;
+        sections[0]._b2 /= gain;
+    }
+    return sections;
+}
+
+//! Filters of the pan topkins qrs detection for a sample frequency known at compile time
+template<unsigned int SampleRate_TP>
+struct QRSFilterDesign_TP {
+    static constexpr std::array<double, QRSFilterParams_TP::_num_taps> _bandpass_taps =
+        DesignBandpassTaps<QRSFilterParams_TP::_num_taps>(QRSFilterParams_TP::_highpass_cutoff_hz,
+                                                          QRSFilterParams_TP::_lowpass_cutoff_hz,
+                                                          SampleRate_TP,
+                                                          QRSFilterParams_TP::_kaiser_beta);
+
+    static constexpr unsigned int _window_length_samples = QRSFilterParams_TP::_window_length_ms * SampleRate_TP / 1000;
+};
+
+//! Bandpass of the qrs filter chain
+enum class QRSBandpass_TP {
+    //! Kaiser windowed FIR with QRSFilterParams_TP::_num_taps taps (linear phase)
+    FIR,
+    //! Butterworth IIR of order four as two second order sections (see DesignButterworthBandpassSections()).
+    //! 10 multiplications per sample instead of 63 and a group delay of a few samples in the passband,
+    //! but a non-linear phase, which changes the shape of the QRS complex slightly
+    ButterworthIIR
+};
+
+///////////////////////////////////////////////////////
+//
+// Class: QRSFilterChain
+//
+//! Filter stages of the pan topkins qrs detection:
+//! bandpass, derivation, squaring and moving-average integration.
+//! The state is kept between consecutive calls of Apply() and Process().
+template<typename DataType_TP>
+class QRSFilterChain {
+
+    // Construction / Destruction / Copying
+public:
+    virtual ~QRSFilterChain() = default;
+
+    // Public functions
+public:
+    //! Filters the block src into dst
+    virtual void Apply(DataType_TP* dst, const DataType_TP* src, size_t block_size) = 0;
+
+    //! Filters one sample
+    virtual DataType_TP Process(const DataType_TP sample) = 0;
+
+    //! Clears the state of all filters (without allocations)
+    virtual void ResetState() = 0;
+
+    //! Returns the delay in samples, by which the detector corrects the timestamps of the qrs complexes
+    virtual unsigned int GetFilterDelay() = 0;
+};
+
+///////////////////////////////////////////////////////
+//
+// Class: FixedRateQRSFilterChain
+//
+//! Filter chain with the taps and the window length known at compile time,
+//! so the compiler can unroll and vectorize the filter loops.
+//! All stages are fused into one FilterPipeline.
+template<typename DataType_TP, unsigned int SampleRate_TP>
+class FixedRateQRSFilterChain : public QRSFilterChain<DataType_TP> {
+
+    // Construction / Destruction / Copying
+public:
+    FixedRateQRSFilterChain();
+
+    // Public functions
+public:
+    void Apply(DataType_TP* dst, const DataType_TP* src, size_t block_size) override;
+
+    DataType_TP Process(const DataType_TP sample) override;
+
+    void ResetState() override;
+
+    unsigned int GetFilterDelay() override;
+
+    // Private types
+private:
+    using Pipeline_TP = FilterPipeline<FIRStateFilter<DataType_TP, QRSFilterParams_TP::_num_taps>,
+                                       DerivationStateFilter<DataType_TP>,
+                                       SquaringStateFilter<DataType_TP>,
+                                       FixedLengthMovingAverageStateFilter<DataType_TP,
+                                           QRSFilterDesign_TP<SampleRate_TP>::_window_length_samples>>;
+
+    // Private variables
+private:
+    Pipeline_TP _pipeline;
+};
+
+template<typename DataType_TP, unsigned int SampleRate_TP>
+FixedRateQRSFilterChain<DataType_TP, SampleRate_TP>::FixedRateQRSFilterChain()
+    : _pipeline(FIRStateFilter<DataType_TP, QRSFilterParams_TP::_num_taps>(QRSFilterDesign_TP<SampleRate_TP>::_bandpass_taps),
+                {}, {}, {})
+{
+}
+
+template<typename DataType_TP, unsigned int SampleRate_TP>
+inline
+void
+FixedRateQRSFilterChain<DataType_TP, SampleRate_TP>::Apply(DataType_TP* dst, const DataType_TP* src, size_t block_size)
+{
+    _pipeline.Apply(dst, src, block_size);
+}
+
+template<typename DataType_TP, unsigned int SampleRate_TP>
+inline
+DataType_TP
+FixedRateQRSFilterChain<DataType_TP, SampleRate_TP>::Process(const DataType_TP sample)
+{
+    return _pipeline.Process(sample);
+}
+
+template<typename DataType_TP, unsigned int SampleRate_TP>
+inline
+void
+FixedRateQRSFilterChain<DataType_TP, SampleRate_TP>::ResetState()
+{
+    _pipeline.ResetState();
+}
+
+template<typename DataType_TP, unsigned int SampleRate_TP>
+inline
+unsigned int
+FixedRateQRSFilterChain<DataType_TP, SampleRate_TP>::GetFilterDelay()
+{
+    // times 2, because the lowpass and highpass filtering each introduce a delay, which is half the filter order.
+    return (QRSFilterParams_TP::_num_taps / 2) * 2;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: RuntimeQRSFilterChain
+//
+//! Filter chain for sample frequencies without a compile time specialization.
+//! Same pipeline as FixedRateQRSFilterChain, with taps and window length calculated at runtime.
+template<typename DataType_TP>
+class RuntimeQRSFilterChain : public QRSFilterChain<DataType_TP> {
+
+    // Construction / Destruction / Copying
+public:
+    RuntimeQRSFilterChain(double sample_freq_hz);
+
+    // Public functions
+public:
+    void Apply(DataType_TP* dst, const DataType_TP* src, size_t block_size) override;
+
+    DataType_TP Process(const DataType_TP sample) override;
+
+    void ResetState() override;
+
+    unsigned int GetFilterDelay() override;
+
+    // Private types
+private:
+    using Pipeline_TP = FilterPipeline<FIRStateFilter<DataType_TP, QRSFilterParams_TP::_num_taps>,
+                                       DerivationStateFilter<DataType_TP>,
+                                       SquaringStateFilter<DataType_TP>,
+                                       MovingAverageStateFilter<DataType_TP>>;
+
+    // Private variables
+private:
+    Pipeline_TP _pipeline;
+};
+
+template<typename DataType_TP>
+RuntimeQRSFilterChain<DataType_TP>::RuntimeQRSFilterChain(double sample_freq_hz)
+    : _pipeline(FIRStateFilter<DataType_TP, QRSFilterParams_TP::_num_taps>(
+                    DesignBandpassTaps<QRSFilterParams_TP::_num_taps>(QRSFilterParams_TP::_highpass_cutoff_hz,
+                                                                      QRSFilterParams_TP::_lowpass_cutoff_hz,
+                                                                      sample_freq_hz,
+                                                                      QRSFilterParams_TP::_kaiser_beta)),
+                {},
+                {},
+                MovingAverageStateFilter<DataType_TP>((static_cast<double>(QRSFilterParams_TP::_window_length_ms) / 1000.0) * sample_freq_hz))
+{
+}
+
+template<typename DataType_TP>
+inline
+void
+RuntimeQRSFilterChain<DataType_TP>::Apply(DataType_TP* dst, const DataType_TP* src, size_t block_size)
+{
+    _pipeline.Apply(dst, src, block_size);
+}
+
+template<typename DataType_TP>
+inline
+DataType_TP
+RuntimeQRSFilterChain<DataType_TP>::Process(const DataType_TP sample)
+{
+    return _pipeline.Process(sample);
+}
+
+template<typename DataType_TP>
+inline
+void
+RuntimeQRSFilterChain<DataType_TP>::ResetState()
+{
+    _pipeline.ResetState();
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+RuntimeQRSFilterChain<DataType_TP>::GetFilterDelay()
+{
+    // same as FixedRateQRSFilterChain::GetFilterDelay()
+    return (QRSFilterParams_TP::_num_taps / 2) * 2;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: IIRQRSFilterChain
+//
+//! Filter chain with the butterworth IIR bandpass (see QRSBandpass_TP::ButterworthIIR)
+//! instead of the FIR bandpass, for any sample frequency.
+template<typename DataType_TP>
+class IIRQRSFilterChain : public QRSFilterChain<DataType_TP> {
+
+    // Construction / Destruction / Copying
+public:
+    IIRQRSFilterChain(double sample_freq_hz);
+
+    // Public functions
+public:
+    void Apply(DataType_TP* dst, const DataType_TP* src, size_t block_size) override;
+
+    DataType_TP Process(const DataType_TP sample) override;
+
+    void ResetState() override;
+
+    //! Group delay of the bandpass in the center of the passband plus the delay of the moving average
+    unsigned int GetFilterDelay() override;
+
+    // Private types
+private:
+    using Pipeline_TP = FilterPipeline<BiquadCascadeStateFilter<DataType_TP, QRSFilterParams_TP::_num_iir_sections>,
+                                       DerivationStateFilter<DataType_TP>,
+                                       SquaringStateFilter<DataType_TP>,
+                                       MovingAverageStateFilter<DataType_TP>>;
+
+    // Private variables
+private:
+    Pipeline_TP _pipeline;
+
+    unsigned int _delay_samples = 0;
+};
+
+template<typename DataType_TP>
+IIRQRSFilterChain<DataType_TP>::IIRQRSFilterChain(double sample_freq_hz)
+    : _pipeline(BiquadCascadeStateFilter<DataType_TP, QRSFilterParams_TP::_num_iir_sections>(
+                    DesignButterworthBandpassSections(QRSFilterParams_TP::_highpass_cutoff_hz,
+                                                      QRSFilterParams_TP::_lowpass_cutoff_hz,
+                                                      sample_freq_hz)),
+                {},
+                {},
+                MovingAverageStateFilter<DataType_TP>((static_cast<double>(QRSFilterParams_TP::_window_length_ms) / 1000.0) * sample_freq_hz))
+{
+    const double center_freq_hz = 0.5 * (QRSFilterParams_TP::_highpass_cutoff_hz + QRSFilterParams_TP::_lowpass_cutoff_hz);
+    const double bandpass_delay_samples =
+        BiquadCascadeGroupDelay(DesignButterworthBandpassSections(QRSFilterParams_TP::_highpass_cutoff_hz,
+                                                                  QRSFilterParams_TP::_lowpass_cutoff_hz,
+                                                                  sample_freq_hz),
+                                center_freq_hz,
+                                sample_freq_hz);
+    _delay_samples = static_cast<unsigned int>(std::lround(bandpass_delay_samples)) +
+                     _pipeline.template GetStage<3>().GetFilterDelay();
+}
+
+template<typename DataType_TP>
+inline
+void
+IIRQRSFilterChain<DataType_TP>::Apply(DataType_TP* dst, const DataType_TP* src, size_t block_size)
+{
+    _pipeline.Apply(dst, src, block_size);
+}
+
+template<typename DataType_TP>
+inline
+DataType_TP
+IIRQRSFilterChain<DataType_TP>::Process(const DataType_TP sample)
+{
+    return _pipeline.Process(sample);
+}
+
+template<typename DataType_TP>
+inline
+void
+IIRQRSFilterChain<DataType_TP>::ResetState()
+{
+    _pipeline.ResetState();
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+IIRQRSFilterChain<DataType_TP>::GetFilterDelay()
+{
+    return _delay_samples;
+}
+
+//! Creates the filter chain for the sample frequency.
+//! With the FIR bandpass, 250, 360, 500 and 1000 Hz (and 180 / 200 Hz, which DecimatingQRSDetection produces from 360 / 1000 Hz)
+//! use the compile time specialization, all other sample frequencies the runtime design.
+template<typename DataType_TP>
+std::unique_ptr<QRSFilterChain<DataType_TP>>
+CreateQRSFilterChain(const double sample_freq_hz, const QRSBandpass_TP bandpass = QRSBandpass_TP::FIR)
+{
+    if ( bandpass == QRSBandpass_TP::ButterworthIIR ) {
+        return std::make_unique<IIRQRSFilterChain<DataType_TP>>(sample_freq_hz);
+    }
+
+    if ( sample_freq_hz == 180.0 ) {
+        return std::make_unique<FixedRateQRSFilterChain<DataType_TP, 180>>();
+    } else if ( sample_freq_hz == 200.0 ) {
+        return std::make_unique<FixedRateQRSFilterChain<DataType_TP, 200>>();
+    } else if ( sample_freq_hz == 250.0 ) {
+        return std::make_unique<FixedRateQRSFilterChain<DataType_TP, 250>>();
+    } else if ( sample_freq_hz == 360.0 ) {
+        return std::make_unique<FixedRateQRSFilterChain<DataType_TP, 360>>();
+    } else if ( sample_freq_hz == 500.0 ) {
+        return std::make_unique<FixedRateQRSFilterChain<DataType_TP, 500>>();
+    } else if ( sample_freq_hz == 1000.0 ) {
+        return std::make_unique<FixedRateQRSFilterChain<DataType_TP, 1000>>();
+    }
+    return std::make_unique<RuntimeQRSFilterChain<DataType_TP>>(sample_freq_hz);
+}
@@ -0,0 +1,374 @@
+#pragma once
+
+// Project includes
+#include "mapped_file.h"
+#include "span.h"
+
+// STL includes
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <type_traits>
+
+//! Channel of a cached record: the description and the samples in physical units
+template<typename DataType_TP>
+struct CachedChannel_TP {
+    std::string _label;
+    std::string _units = "mV";
+    double _sample_rate_hz = 0.0;
+    double _high_hz = 0.0;
+    double _low_hz = 0.0;
+    double _gain = 0.0;
+    uint32_t _range_mV = 0;
+    uint32_t _id = 0;
+    uint32_t _scale = 0;
+    uint32_t _adc_resolution_bits = 0;
+    DataType_TP _min_val = 0;
+    DataType_TP _max_val = 0;
+    //! Samples of the channel. Points into the mapped cache file after RecordCache_C::Open()
+    span<const DataType_TP> _samples;
+};
+
+///////////////////////////////////////////////////////
+//
+// Class: RecordCache_C
+//
+//! Binary columnar cache of a loaded record, so the record is opened again without parsing, scaling
+//! and generating timestamps (see TimeSignal_C).
+//!
+//! Layout of the file (native byte order):
+//! - header: magic "ECGCACHE", version, size and kind of DataType_TP, number of source files and channels
+//! - size and modification time of each source file (the record files, which the cache was created from)
+//! - description of each channel (see CachedChannel_TP), the number of its samples and the offset of its samples
+//! - the samples of each channel as one contiguous array of DataType_TP, aligned to 64 bytes
+//!
+//! Open() maps the file (see MappedFile_C) and checks it: a cache of an older version, of another data type or
+//! of source files, which changed since the cache was written, is not opened. The samples of the channels point
+//! directly into the mapped file, so they are used without a copy; the mapping lives as long as the cache.
+//!
+//! Usage:
+//! RecordCache_C<double> cache;
+//! if ( !cache.Open(RecordCache_C<double>::GetCachePath("/data/g11/ecg.txt"), { "/data/g11/ecg.txt" }) ) {
+//!     ... load the record, then RecordCache_C<double>::Write(cache_path, source_files, channels);
+//! }
+template<typename DataType_TP>
+class RecordCache_C {
+
+    // Public functions
+public:
+    //! Maps the cache file and checks it against the source files.
+    //! Returns false, if the file does not exist, is invalid or outdated
+    bool Open(const std::string& cache_path, const std::vector<std::string>& source_files);
+
+    //! Releases the mapping (the samples of the channels become invalid)
+    void Close();
+
+    bool IsOpen() const;
+
+    //! Returns the channels of the opened cache; their samples point into the mapped file
+    const std::vector<CachedChannel_TP<DataType_TP>>& GetChannels() const;
+
+    //! Writes the cache of the channels, which were loaded from the source files. The file is written to a temporary
+    //! file first and renamed, so a cache is never opened half written.
+    //! Returns false, if the file can not be written (e.g. the record is inside a read only directory)
+    static bool Write(const std::string& cache_path,
+                      const std::vector<std::string>& source_files,
+                      const std::vector<CachedChannel_TP<DataType_TP>>& channels);
+
+    //! Returns the path of the cache of a record (the path of the record file or of the record without suffix)
+    static std::string GetCachePath(const std::string& record_path);
+
+    //! Version of the file layout; caches of other versions are not opened
+    static constexpr uint32_t _version = 1;
+
+    // Private types
+private:
+    //! Size and modification time of a source file
+    struct SourceStamp_TP {
+        uint64_t _size = 0;
+        int64_t _modification_time = 0;
+    };
+
+    // Private functions
+private:
+    //! Returns false, if the file does not exist
+    static bool GetSourceStamp(const std::string& filename, SourceStamp_TP& stamp);
+
+    //! Kind of DataType_TP: 0 = unsigned, 1 = signed, 2 = floating point
+    static constexpr uint32_t GetDataKind();
+
+    template<typename Value_TP>
+    static void Append(std::vector<char>& buffer, const Value_TP& value);
+
+    static void AppendString(std::vector<char>& buffer, const std::string& text);
+
+    //! Reads a value at position and moves the position behind it. Returns false at the end of the file
+    template<typename Value_TP>
+    bool Extract(size_t& position, Value_TP& value) const;
+
+    bool ExtractString(size_t& position, std::string& text) const;
+
+    // Private variables
+private:
+    static constexpr char _magic[8] = { 'E', 'C', 'G', 'C', 'A', 'C', 'H', 'E' };
+
+    //! Alignment of the sample arrays inside the file
+    static constexpr size_t _alignment = 64;
+
+    MappedFile_C _file;
+
+    std::vector<CachedChannel_TP<DataType_TP>> _channels;
+};
+
+template<typename DataType_TP>
+inline
+std::string
+RecordCache_C<DataType_TP>::GetCachePath(const std::string& record_path)
+{
+    return record_path + ".ecgcache";
+}
+
+template<typename DataType_TP>
+constexpr
+uint32_t
+RecordCache_C<DataType_TP>::GetDataKind()
+{
+    return std::is_floating_point_v<DataType_TP> ? 2 : (std::is_signed_v<DataType_TP> ? 1 : 0);
+}
+
+template<typename DataType_TP>
+inline
+bool
+RecordCache_C<DataType_TP>::GetSourceStamp(const std::string& filename, SourceStamp_TP& stamp)
+{
+    std::error_code error;
+    const auto size = std::filesystem::file_size(filename, error);
+    if ( error ) {
+        return false;
+    }
+    const auto modification_time = std::filesystem::last_write_time(filename, error);
+    if ( error ) {
+        return false;
+    }
+    stamp._size = static_cast<uint64_t>(size);
+    stamp._modification_time = static_cast<int64_t>(modification_time.time_since_epoch().count());
+    return true;
+}
+
+template<typename DataType_TP>
+template<typename Value_TP>
+inline
+void
+RecordCache_C<DataType_TP>::Append(std::vector<char>& buffer, const Value_TP& value)
+{
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(Value_TP));
+}
+
+template<typename DataType_TP>
+inline
+void
+RecordCache_C<DataType_TP>::AppendString(std::vector<char>& buffer, const std::string& text)
+{
+    Append(buffer, static_cast<uint32_t>(text.size()));
+    buffer.insert(buffer.end(), text.begin(), text.end());
+}
+
+template<typename DataType_TP>
+template<typename Value_TP>
+inline
+bool
+RecordCache_C<DataType_TP>::Extract(size_t& position, Value_TP& value) const
+{
+    if ( position + sizeof(Value_TP) > _file.GetSize() ) {
+        return false;
+    }
+    std::memcpy(&value, _file.GetData() + position, sizeof(Value_TP));
+    position += sizeof(Value_TP);
+    return true;
+}
+
+template<typename DataType_TP>
+inline
+bool
+RecordCache_C<DataType_TP>::ExtractString(size_t& position, std::string& text) const
+{
+    uint32_t size = 0;
+    if ( !Extract(position, size) || position + size > _file.GetSize() ) {
+        return false;
+    }
+    text.assign(reinterpret_cast<const char*>(_file.GetData()) + position, size);
+    position += size;
+    return true;
+}
+
+template<typename DataType_TP>
+inline
+bool
+RecordCache_C<DataType_TP>::Write(const std::string& cache_path,
+                                  const std::vector<std::string>& source_files,
+                                  const std::vector<CachedChannel_TP<DataType_TP>>& channels)
+{
+    std::vector<char> header;
+    header.insert(header.end(), std::begin(_magic), std::end(_magic));
+    Append(header, _version);
+    Append(header, static_cast<uint32_t>(sizeof(DataType_TP)));
+    Append(header, GetDataKind());
+    Append(header, static_cast<uint32_t>(source_files.size()));
+    Append(header, static_cast<uint32_t>(channels.size()));
+    for ( const auto& source_file : source_files ) {
+        SourceStamp_TP stamp;
+        if ( !GetSourceStamp(source_file, stamp) ) {
+            return false;
+        }
+        Append(header, stamp._size);
+        Append(header, stamp._modification_time);
+    }
+
+    // the offsets of the samples follow from the size of the header, which does not depend on the offsets
+    size_t header_size = header.size();
+    for ( const auto& channel : channels ) {
+        header_size += 4 * sizeof(double) + 4 * sizeof(uint32_t) + 2 * sizeof(DataType_TP) + 2 * sizeof(uint64_t) +
+                       2 * sizeof(uint32_t) + channel._label.size() + channel._units.size();
+    }
+    std::vector<uint64_t> sample_offsets;
+    uint64_t data_end = header_size;
+    for ( const auto& channel : channels ) {
+        data_end = (data_end + _alignment - 1) / _alignment * _alignment;
+        sample_offsets.push_back(data_end);
+        data_end += channel._samples.size() * sizeof(DataType_TP);
+    }
+
+    for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+        const auto& channel = channels[channel_idx];
+        Append(header, channel._sample_rate_hz);
+        Append(header, channel._high_hz);
+        Append(header, channel._low_hz);
+        Append(header, channel._gain);
+        Append(header, channel._range_mV);
+        Append(header, channel._id);
+        Append(header, channel._scale);
+        Append(header, channel._adc_resolution_bits);
+        Append(header, channel._min_val);
+        Append(header, channel._max_val);
+        Append(header, static_cast<uint64_t>(channel._samples.size()));
+        Append(header, sample_offsets[channel_idx]);
+        AppendString(header, channel._label);
+        AppendString(header, channel._units);
+    }
+
+    const std::string temporary_path = cache_path + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        if ( !file.is_open() ) {
+            return false;
+        }
+        file.write(header.data(), header.size());
+        size_t position = header.size();
+        const char padding[_alignment] = {};
+        for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+            file.write(padding, sample_offsets[channel_idx] - position);
+            const auto& samples = channels[channel_idx]._samples;
+            file.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(DataType_TP));
+            position = sample_offsets[channel_idx] + samples.size() * sizeof(DataType_TP);
+        }
+        if ( !file.good() ) {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temporary_path, error);
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary_path, cache_path, error);
+    if ( error ) {
+        std::filesystem::remove(temporary_path, error);
+        return false;
+    }
+    return true;
+}
+
+template<typename DataType_TP>
+inline
+bool
+RecordCache_C<DataType_TP>::Open(const std::string& cache_path, const std::vector<std::string>& source_files)
+{
+    Close();
+    std::error_code error;
+    if ( !std::filesystem::exists(cache_path, error) || !_file.Open(cache_path) ) {
+        return false;
+    }
+
+    size_t position = sizeof(_magic);
+    uint32_t version = 0;
+    uint32_t sample_size = 0;
+    uint32_t data_kind = 0;
+    uint32_t num_sources = 0;
+    uint32_t num_channels = 0;
+    bool is_valid = _file.GetSize() >= sizeof(_magic) && std::memcmp(_file.GetData(), _magic, sizeof(_magic)) == 0 &&
+                    Extract(position, version) && version == _version &&
+                    Extract(position, sample_size) && sample_size == sizeof(DataType_TP) &&
+                    Extract(position, data_kind) && data_kind == GetDataKind() &&
+                    Extract(position, num_sources) && num_sources == source_files.size() &&
+                    Extract(position, num_channels) && num_channels > 0;
+
+    // the cache is outdated, if a source file changed
+    for ( uint32_t source_idx = 0; is_valid && source_idx < num_sources; ++source_idx ) {
+        SourceStamp_TP cached_stamp;
+        SourceStamp_TP stamp;
+        is_valid = Extract(position, cached_stamp._size) && Extract(position, cached_stamp._modification_time) &&
+                   GetSourceStamp(source_files[source_idx], stamp) &&
+                   stamp._size == cached_stamp._size && stamp._modification_time == cached_stamp._modification_time;
+    }
+
+    _channels.resize(is_valid ? num_channels : 0);
+    for ( auto& channel : _channels ) {
+        uint64_t num_samples = 0;
+        uint64_t sample_offset = 0;
+        is_valid = is_valid &&
+                   Extract(position, channel._sample_rate_hz) && Extract(position, channel._high_hz) &&
+                   Extract(position, channel._low_hz) && Extract(position, channel._gain) &&
+                   Extract(position, channel._range_mV) && Extract(position, channel._id) &&
+                   Extract(position, channel._scale) && Extract(position, channel._adc_resolution_bits) &&
+                   Extract(position, channel._min_val) && Extract(position, channel._max_val) &&
+                   Extract(position, num_samples) && Extract(position, sample_offset) &&
+                   ExtractString(position, channel._label) && ExtractString(position, channel._units) &&
+                   sample_offset % _alignment == 0 &&
+                   sample_offset <= _file.GetSize() && num_samples <= (_file.GetSize() - sample_offset) / sizeof(DataType_TP);
+        if ( is_valid ) {
+            channel._samples = span<const DataType_TP>(reinterpret_cast<const DataType_TP*>(_file.GetData() + sample_offset), num_samples);
+        }
+    }
+    if ( !is_valid ) {
+        Close();
+    }
+    return is_valid;
+}
+
+template<typename DataType_TP>
+inline
+void
+RecordCache_C<DataType_TP>::Close()
+{
+    _channels.clear();
+    _file.Close();
+}
+
+template<typename DataType_TP>
+inline
+bool
+RecordCache_C<DataType_TP>::IsOpen() const
+{
+    return !_channels.empty();
+}
+
+template<typename DataType_TP>
+inline
+const std::vector<CachedChannel_TP<DataType_TP>>&
+RecordCache_C<DataType_TP>::GetChannels() const
+{
+    return _channels;
+}
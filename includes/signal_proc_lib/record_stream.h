@@ -0,0 +1,597 @@
+#pragma once
+
+// Project includes
+#include "file_io.h"
+#include "mit_file_io.h"
+#include "wfdb_native_reader.h"
+#include "compressed_record.h"
+#include "time_signal.h"
+#include "mapped_file.h"
+#include "text_column_parser.h"
+#include "span.h"
+
+// STL includes
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+
+//! Consecutive frames of all channels of a record (one frame holds one sample of each channel)
+template<typename DataType_TP>
+struct RecordBlock_TP {
+    //! Returns the samples of one channel
+    span<const DataType_TP> GetChannel(size_t channel_idx) const {
+        return span<const DataType_TP>(_samples[channel_idx].data(), _num_frames);
+    }
+
+    //! Returns the timestamp of the first frame in seconds
+    double GetTimestampSec(double sample_rate_hz) const {
+        return _first_frame / sample_rate_hz;
+    }
+
+    //! Index of the first frame inside the record
+    size_t _first_frame = 0;
+
+    size_t _num_frames = 0;
+
+    //! Samples in physical units: _samples[channel_idx][frame_idx - _first_frame]
+    std::vector<std::vector<DataType_TP>> _samples;
+};
+
+///////////////////////////////////////////////////////
+//
+// Class: RecordStream_C
+//
+//! Reads a record block by block, in order, with bounded memory: only one block of frames is held in memory,
+//! instead of the whole record (see TimeSignal_C). Records, which are larger than the memory (e.g. holter records of
+//! several days), can be played back, analyzed and exported this way.
+//!
+//! The samples are the same as the samples of the channels, which TimeSignal_C loads (physical units).
+//! The channels without samples describe the record (label, sample rate, units, gain, ...).
+//!
+//! Usage:
+//! MITRecordStream_C<double> stream;
+//! if ( stream.Open("/data/mitdb/100") ) {
+//!     RecordBlock_TP<double> block;
+//!     while ( stream.ReadBlock(block) ) { detector.AppendBlock(block.GetChannel(0), block.GetTimestampSec(360.0)); }
+//! }
+template<typename DataType_TP>
+class RecordStream_C {
+
+    // Construction / Destruction / Copying
+public:
+    RecordStream_C(size_t block_size);
+
+    virtual ~RecordStream_C() = default;
+
+    // Public functions
+public:
+    //! Returns the channels of the record without samples
+    const std::vector<ECGChannelInfo_TP<DataType_TP>>& GetChannels() const;
+
+    //! Returns the number of frames of the record; zero, if the record does not specify it
+    size_t GetNumFrames() const;
+
+    //! Returns the maximal number of frames of a block
+    size_t GetBlockSize() const;
+
+    //! Returns the index of the next frame
+    size_t GetPosition() const;
+
+    //! Reads the next block of up to GetBlockSize() frames. The sample vectors of the block keep their memory,
+    //! so reading consecutive blocks into one block does not allocate
+    //!
+    //! \returns false at the end of the record (the block is empty)
+    bool ReadBlock(RecordBlock_TP<DataType_TP>& block);
+
+    //! Starts again with the first frame
+    bool Rewind();
+
+    // Protected functions
+protected:
+    //! Reads the next num_frames frames; channel_dst[channel_idx] receives the samples of the channel.
+    //! Returns the number of read frames; less than num_frames at the end of the record
+    virtual size_t ReadFrames(size_t num_frames, DataType_TP* const* channel_dst) = 0;
+
+    //! Moves to the first frame
+    virtual bool RewindSource() = 0;
+
+    //! Sets the channels and the number of frames of an opened record
+    void SetRecord(std::vector<ECGChannelInfo_TP<DataType_TP>>&& channels, size_t num_frames);
+
+    // Private variables
+private:
+    std::vector<ECGChannelInfo_TP<DataType_TP>> _channels;
+
+    size_t _num_frames = 0;
+
+    size_t _block_size = 4096;
+
+    size_t _position = 0;
+
+    std::vector<DataType_TP*> _channel_dst;
+};
+
+template<typename DataType_TP>
+RecordStream_C<DataType_TP>::RecordStream_C(size_t block_size)
+    : _block_size(std::max<size_t>(1, block_size))
+{
+}
+
+template<typename DataType_TP>
+inline
+const std::vector<ECGChannelInfo_TP<DataType_TP>>&
+RecordStream_C<DataType_TP>::GetChannels() const
+{
+    return _channels;
+}
+
+template<typename DataType_TP>
+inline
+size_t
+RecordStream_C<DataType_TP>::GetNumFrames() const
+{
+    return _num_frames;
+}
+
+template<typename DataType_TP>
+inline
+size_t
+RecordStream_C<DataType_TP>::GetBlockSize() const
+{
+    return _block_size;
+}
+
+template<typename DataType_TP>
+inline
+size_t
+RecordStream_C<DataType_TP>::GetPosition() const
+{
+    return _position;
+}
+
+template<typename DataType_TP>
+inline
+bool
+RecordStream_C<DataType_TP>::ReadBlock(RecordBlock_TP<DataType_TP>& block)
+{
+    block._first_frame = _position;
+    block._num_frames = 0;
+    if ( _channels.empty() ) {
+        return false;
+    }
+    block._samples.resize(_channels.size());
+    _channel_dst.resize(_channels.size());
+    for ( size_t channel_idx = 0; channel_idx < _channels.size(); ++channel_idx ) {
+        block._samples[channel_idx].resize(_block_size);
+        _channel_dst[channel_idx] = block._samples[channel_idx].data();
+    }
+    block._num_frames = ReadFrames(_block_size, _channel_dst.data());
+    _position += block._num_frames;
+    return block._num_frames > 0;
+}
+
+template<typename DataType_TP>
+inline
+bool
+RecordStream_C<DataType_TP>::Rewind()
+{
+    _position = 0;
+    return RewindSource();
+}
+
+template<typename DataType_TP>
+inline
+void
+RecordStream_C<DataType_TP>::SetRecord(std::vector<ECGChannelInfo_TP<DataType_TP>>&& channels, size_t num_frames)
+{
+    _channels = std::move(channels);
+    _num_frames = num_frames;
+    _position = 0;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: MITRecordStream_C
+//
+//! Streams a MIT record. Compressed records (see CompressedRecord_C) and the formats 212, 16, 61 and 80 are decoded
+//! from the mapped files (see WFDBNativeReader_C); the pages of the decoded blocks are released, so the memory stays bounded. All other records are read by the
+//! wfdb lib (getvec()), which keeps the open record in global variables: streams of the wfdb lib
+//! must not be used from different threads at the same time (see TimeSignal_C::LoadFromMITFileFormat()).
+template<typename DataType_TP>
+class MITRecordStream_C : public RecordStream_C<DataType_TP> {
+
+    // Construction / Destruction / Copying
+public:
+    MITRecordStream_C(size_t block_size = 4096);
+
+    // Public functions
+public:
+    //! Opens the record
+    //!
+    //! \param filename the path to the record WITHOUT the file suffix (.dat/.hea)
+    bool Open(const std::string& filename);
+
+    //! Returns true, if the record is decoded without the wfdb lib
+    bool IsNative() const;
+
+    //! Returns true, if the compressed record is read
+    bool IsCompressed() const;
+
+    // Protected functions
+protected:
+    size_t ReadFrames(size_t num_frames, DataType_TP* const* channel_dst) override;
+
+    bool RewindSource() override;
+
+    // Private functions
+private:
+    //! Opens the signals with the wfdb lib
+    bool OpenWFDB();
+
+    // Private variables
+private:
+    WFDBNativeReader_C<DataType_TP> _native_reader;
+
+    CompressedRecord_C<DataType_TP> _compressed_reader;
+
+    MITFileIO_C<DataType_TP> _wfdb_reader;
+
+    bool _is_native = false;
+
+    bool _is_compressed = false;
+
+    std::string _record_dir;
+
+    std::string _record_name;
+
+    //! Index of the next frame of the native or the compressed reader
+    size_t _native_position = 0;
+
+    //! Conversion of the adc values to physical units: (adc_value - baseline) / gain
+    std::vector<int> _baselines;
+
+    std::vector<double> _gains;
+};
+
+template<typename DataType_TP>
+MITRecordStream_C<DataType_TP>::MITRecordStream_C(size_t block_size)
+    : RecordStream_C<DataType_TP>(block_size)
+{
+}
+
+template<typename DataType_TP>
+inline
+bool
+MITRecordStream_C<DataType_TP>::Open(const std::string& filename)
+{
+    this->SetRecord({}, 0);
+    const auto last_slash_pos = filename.find_last_of("/\\");
+    _record_dir = last_slash_pos == std::string::npos ? std::string(".") : filename.substr(0, last_slash_pos);
+    _record_name = last_slash_pos == std::string::npos ? filename : filename.substr(last_slash_pos + 1);
+    // remove the data suffix .dat or .hea
+    if ( _record_name.find('.') != std::string::npos ) {
+        _record_name = _record_name.substr(0, _record_name.size() - 4);
+    }
+
+    _native_position = 0;
+    _is_compressed = _compressed_reader.Open(_record_dir, _record_name);
+    _is_native = _is_compressed || _native_reader.Open(_record_dir, _record_name);
+    std::vector<MITDataChannel_TP<DataType_TP>> mit_channels;
+    if ( _is_compressed ) {
+        mit_channels = _compressed_reader.GetChannels();
+    } else if ( _is_native ) {
+        mit_channels = _native_reader.GetChannels();
+    } else {
+        std::vector<char> database_path_char(_record_dir.c_str(), _record_dir.c_str() + _record_dir.size() + 1);
+        _wfdb_reader.SetWFDBPath(database_path_char.data());
+        std::vector<char> record_name_char(_record_name.c_str(), _record_name.c_str() + _record_name.size() + 1);
+        mit_channels = _wfdb_reader.OpenSignals(record_name_char.data());
+    }
+    if ( mit_channels.empty() ) {
+        return false;
+    }
+
+    // the same channel infos as TimeSignal_C::LoadFromMITFileFormat()
+    std::vector<ECGChannelInfo_TP<DataType_TP>> channels(mit_channels.size());
+    _baselines.clear();
+    _gains.clear();
+    for ( size_t channel_idx = 0; channel_idx < mit_channels.size(); ++channel_idx ) {
+        const auto& mit_channel = mit_channels[channel_idx];
+        auto& channel = channels[channel_idx];
+        channel._sample_rate_hz = mit_channel._sample_frequency_hz;
+        channel._label = mit_channel._description;
+        channel._id = static_cast<uint32_t>(channel_idx);
+        channel._units = mit_channel._units;
+        channel._gain = mit_channel._gain;
+        channel._adc_resolution_bits = mit_channel._adc_resolution_bits;
+        _baselines.push_back(mit_channel._adc_baseline_0U_output_mV);
+        _gains.push_back(mit_channel._gain);
+    }
+    this->SetRecord(std::move(channels), mit_channels.front()._num_samples);
+    return true;
+}
+
+template<typename DataType_TP>
+inline
+bool
+MITRecordStream_C<DataType_TP>::IsNative() const
+{
+    return _is_native;
+}
+
+template<typename DataType_TP>
+inline
+bool
+MITRecordStream_C<DataType_TP>::IsCompressed() const
+{
+    return _is_compressed;
+}
+
+template<typename DataType_TP>
+inline
+size_t
+MITRecordStream_C<DataType_TP>::ReadFrames(size_t num_frames, DataType_TP* const* channel_dst)
+{
+    size_t num_read_frames = 0;
+    if ( _is_compressed ) {
+        num_read_frames = std::min(num_frames, _compressed_reader.GetNumFrames() - _native_position);
+        if ( !_compressed_reader.DecodeFrames(_native_position, num_read_frames, channel_dst) ) {
+            num_read_frames = 0;
+        }
+        _compressed_reader.ReleaseFrames(_native_position, num_read_frames);
+        _native_position += num_read_frames;
+    } else if ( _is_native ) {
+        num_read_frames = std::min(num_frames, _native_reader.GetNumFrames() - _native_position);
+        _native_reader.DecodeFrames(_native_position, num_read_frames, channel_dst);
+        // the decoded bytes are not read again
+        _native_reader.ReleaseFrames(_native_position, num_read_frames);
+        _native_position += num_read_frames;
+    } else {
+        num_read_frames = _wfdb_reader.ReadFrames(num_frames, channel_dst);
+    }
+
+    // scale y values to the real voltage range (physical units)
+    for ( size_t channel_idx = 0; channel_idx < _gains.size(); ++channel_idx ) {
+        DataType_TP* samples = channel_dst[channel_idx];
+        const int baseline = _baselines[channel_idx];
+        const double gain = _gains[channel_idx];
+        for ( size_t frame_idx = 0; frame_idx < num_read_frames; ++frame_idx ) {
+            samples[frame_idx] = (samples[frame_idx] - baseline) / gain;
+        }
+    }
+    return num_read_frames;
+}
+
+template<typename DataType_TP>
+inline
+bool
+MITRecordStream_C<DataType_TP>::RewindSource()
+{
+    if ( _is_native ) {
+        _native_position = 0;
+        return true;
+    }
+    // the wfdb lib reads the signals from the start, when they are opened again
+    std::vector<char> record_name_char(_record_name.c_str(), _record_name.c_str() + _record_name.size() + 1);
+    return !_wfdb_reader.OpenSignals(record_name_char.data()).empty();
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: G11RecordStream_C
+//
+//! Streams a G11 export (see TimeSignal_C::ReadG11Data()). The samples are scaled to the range of the channel by the
+//! maximum of the channel, like TimeSignal_C does: Open() reads the data once to find the maxima and the number of rows,
+//! without storing the samples. The rows are parsed from the mapped file (see TextColumnParser_C::ParseRow());
+//! the pages of the parsed blocks are released.
+template<typename DataType_TP>
+class G11RecordStream_C : public RecordStream_C<DataType_TP> {
+
+    // Construction / Destruction / Copying
+public:
+    G11RecordStream_C(size_t block_size = 4096);
+
+    // Public functions
+public:
+    bool Open(const std::string& filename);
+
+    // Protected functions
+protected:
+    size_t ReadFrames(size_t num_frames, DataType_TP* const* channel_dst) override;
+
+    bool RewindSource() override;
+
+    // Private functions
+private:
+    //! Parses the next row (the enumeration of the row and one value of each channel) into _row. Empty lines are skipped
+    bool ReadRow();
+
+    // Private variables
+private:
+    MappedFile_C _file;
+
+    //! Position of the first data row inside the file
+    size_t _data_position = 0;
+
+    //! Position of the next row inside the file
+    size_t _position = 0;
+
+    std::vector<DataType_TP> _scale_factors;
+
+    //! Values of the last read row (the enumeration and the values of the channels)
+    std::vector<DataType_TP> _row;
+};
+
+template<typename DataType_TP>
+G11RecordStream_C<DataType_TP>::G11RecordStream_C(size_t block_size)
+    : RecordStream_C<DataType_TP>(block_size)
+{
+}
+
+template<typename DataType_TP>
+inline
+bool
+G11RecordStream_C<DataType_TP>::Open(const std::string& filename)
+{
+    this->SetRecord({}, 0);
+    std::vector<ECGChannelInfo_TP<DataType_TP>> channels;
+    {
+        FileIO_C filereader;
+        if ( !filereader.OpenFile(filename) || !TimeSignal_C<DataType_TP>::ReadG11Header(filereader, channels) ) {
+            return false;
+        }
+        _data_position = static_cast<size_t>(std::streamoff(filereader.GetFile()->tellg()));
+    }
+    if ( !_file.Open(filename) || _data_position > _file.GetSize() ) {
+        return false;
+    }
+
+    // The first pass finds the maximum of each channel
+    _row.resize(channels.size() + 1);
+    std::vector<DataType_TP> max_values(channels.size(), std::numeric_limits<DataType_TP>::lowest());
+    size_t num_rows = 0;
+    _position = _data_position;
+    while ( ReadRow() ) {
+        for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+            max_values[channel_idx] = std::max(max_values[channel_idx], _row[channel_idx + 1]);
+        }
+        ++num_rows;
+    }
+    _file.ReleasePages(0, _file.GetSize());
+    if ( num_rows == 0 ) {
+        return false;
+    }
+
+    // scale y values to the real voltage range
+    _scale_factors.clear();
+    for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+        auto& channel = channels[channel_idx];
+        const DataType_TP scale_factor = channel._range_mV / max_values[channel_idx];
+        channel._scale = scale_factor;
+        channel._max_val = max_values[channel_idx];
+        _scale_factors.push_back(scale_factor);
+    }
+    this->SetRecord(std::move(channels), num_rows);
+    return RewindSource();
+}
+
+template<typename DataType_TP>
+inline
+bool
+G11RecordStream_C<DataType_TP>::ReadRow()
+{
+    const char* text = reinterpret_cast<const char*>(_file.GetData());
+    const char* pos = text + _position;
+    const char* end = text + _file.GetSize();
+    size_t num_values = 0;
+    while ( pos < end && num_values == 0 ) {
+        if ( !TextColumnParser_C<DataType_TP>::ParseRow(pos, end, _row.size(), _row.data(), num_values) ) {
+            return false;
+        }
+    }
+    _position = pos - text;
+    return num_values == _row.size();
+}
+
+template<typename DataType_TP>
+inline
+size_t
+G11RecordStream_C<DataType_TP>::ReadFrames(size_t num_frames, DataType_TP* const* channel_dst)
+{
+    const size_t block_position = _position;
+    size_t num_read_frames = 0;
+    for ( ; num_read_frames < num_frames && ReadRow(); ++num_read_frames ) {
+        for ( size_t channel_idx = 0; channel_idx < _scale_factors.size(); ++channel_idx ) {
+            channel_dst[channel_idx][num_read_frames] = _row[channel_idx + 1] * _scale_factors[channel_idx];
+        }
+    }
+    // the parsed text is not read again
+    _file.ReleasePages(block_position, _position - block_position);
+    return num_read_frames;
+}
+
+template<typename DataType_TP>
+inline
+bool
+G11RecordStream_C<DataType_TP>::RewindSource()
+{
+    _position = _data_position;
+    return _file.IsOpen();
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: TimeSignalStream_C
+//
+//! Streams the channels of a loaded TimeSignal_C, so the consumers of the streams process loaded signals the same way.
+//! The signal must outlive the stream
+template<typename DataType_TP>
+class TimeSignalStream_C : public RecordStream_C<DataType_TP> {
+
+    // Construction / Destruction / Copying
+public:
+    TimeSignalStream_C(const TimeSignal_C<DataType_TP>& signal, size_t block_size = 4096);
+
+    // Protected functions
+protected:
+    size_t ReadFrames(size_t num_frames, DataType_TP* const* channel_dst) override;
+
+    bool RewindSource() override;
+
+    // Private variables
+private:
+    const TimeSignal_C<DataType_TP>& _signal;
+
+    size_t _signal_position = 0;
+};
+
+template<typename DataType_TP>
+TimeSignalStream_C<DataType_TP>::TimeSignalStream_C(const TimeSignal_C<DataType_TP>& signal, size_t block_size)
+    : RecordStream_C<DataType_TP>(block_size),
+    _signal(signal)
+{
+    // the channel infos without the samples
+    std::vector<ECGChannelInfo_TP<DataType_TP>> channels;
+    size_t num_frames = signal.constData().empty() ? 0 : std::numeric_limits<size_t>::max();
+    for ( size_t channel_idx = 0; channel_idx < signal.constData().size(); ++channel_idx ) {
+        const auto& channel = signal.constData()[channel_idx];
+        channels.push_back(ECGChannelInfo_TP<DataType_TP>());
+        auto& channel_info = channels.back();
+        channel_info._sample_rate_hz = channel._sample_rate_hz;
+        channel_info._label = channel._label;
+        channel_info._units = channel._units;
+        channel_info._range_mV = channel._range_mV;
+        channel_info._id = channel._id;
+        channel_info._scale = channel._scale;
+        channel_info._gain = channel._gain;
+        channel_info._adc_resolution_bits = channel._adc_resolution_bits;
+        channel_info._min_val = channel._min_val;
+        channel_info._max_val = channel._max_val;
+        num_frames = std::min(num_frames, signal.GetSamples(channel_idx).size());
+    }
+    this->SetRecord(std::move(channels), num_frames);
+}
+
+template<typename DataType_TP>
+inline
+size_t
+TimeSignalStream_C<DataType_TP>::ReadFrames(size_t num_frames, DataType_TP* const* channel_dst)
+{
+    num_frames = std::min(num_frames, this->GetNumFrames() - _signal_position);
+    for ( size_t channel_idx = 0; channel_idx < _signal.constData().size(); ++channel_idx ) {
+        const auto samples_begin = _signal.GetSamples(channel_idx).data() + _signal_position;
+        std::copy(samples_begin, samples_begin + num_frames, channel_dst[channel_idx]);
+    }
+    _signal_position += num_frames;
+    return num_frames;
+}
+
+template<typename DataType_TP>
+inline
+bool
+TimeSignalStream_C<DataType_TP>::RewindSource()
+{
+    _signal_position = 0;
+    return true;
+}
@@ -2,9 +2,13 @@
 
 // STL includes
 #include <vector>
-
-// visualization includes - this is not good -> put the buffer in utility project/lib ?
-#include "../visualization/circular_buffer.h"
+#include <array>
+#include <tuple>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cmath>
+#include <type_traits>
 
 ///////////////////////////////////////////////////////
 //
@@ -17,11 +21,17 @@ public:
     void ResetState();
     void Apply(DataType_TP& value);
 
+    //! Block version of Apply(): differentiates the block in place.
+    //! The state is kept between consecutive blocks, so the output is
+    //! identical to calling Apply() for each sample.
+    void Apply(DataType_TP* block, size_t block_size);
+
+    //! Returns the difference of the input and the previous input (stage of FilterPipeline)
+    DataType_TP Process(const DataType_TP input);
+
 private:
     DataType_TP _last_input = 0;
 
-    DataType_TP _current_input = 0;
-
     bool _running = false;
 };
 
@@ -39,16 +49,238 @@ inline
 void 
 DerivationStateFilter<DataType_TP>::Apply(DataType_TP& value)
 {
-    _current_input = (value);
-    value -= _last_input;
-    _last_input = _current_input;
- 
+    value = Process(value);
+}
+
+template<typename DataType_TP>
+inline
+void
+DerivationStateFilter<DataType_TP>::Apply(DataType_TP* block, size_t block_size)
+{
+    for ( size_t idx = 0; idx < block_size; ++idx ) {
+        block[idx] = Process(block[idx]);
+    }
+}
+
+template<typename DataType_TP>
+inline
+DataType_TP
+DerivationStateFilter<DataType_TP>::Process(const DataType_TP input)
+{
+    const DataType_TP output = input - _last_input;
+    _last_input = input;
+    return output;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: SquaringStateFilter
+//
+//! Squares each sample (without state). Stage of FilterPipeline
+template<typename DataType_TP>
+class SquaringStateFilter {
+
+public:
+    void ResetState();
+
+    DataType_TP Process(const DataType_TP input);
+};
+
+template<typename DataType_TP>
+inline
+void
+SquaringStateFilter<DataType_TP>::ResetState()
+{
+}
+
+template<typename DataType_TP>
+inline
+DataType_TP
+SquaringStateFilter<DataType_TP>::Process(const DataType_TP input)
+{
+    return input * input;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: FIRStateFilter
+//
+//! FIR filter with the number of taps known at compile time. Stage of FilterPipeline
+template<typename DataType_TP, unsigned int NumTaps_TP>
+class FIRStateFilter {
+
+    // Construction / Destruction / Copying
+public:
+    FIRStateFilter() = default;
+
+    template<typename TapType_TP>
+    FIRStateFilter(const std::array<TapType_TP, NumTaps_TP>& taps);
+
+    // Public functions
+public:
+    DataType_TP Process(const DataType_TP input);
+
+    void ResetState();
+
+    // Private variables
+private:
+    std::array<DataType_TP, NumTaps_TP> _taps{};
+
+    //! Delay line, stored twice in a row:
+    //! the newest sample is at _read_idx, the older ones follow without wrapping
+    std::array<DataType_TP, 2 * NumTaps_TP> _delay_line{};
+
+    unsigned int _read_idx = 0;
+};
+
+template<typename DataType_TP, unsigned int NumTaps_TP>
+template<typename TapType_TP>
+FIRStateFilter<DataType_TP, NumTaps_TP>::FIRStateFilter(const std::array<TapType_TP, NumTaps_TP>& taps)
+{
+    for ( unsigned int tap_idx = 0; tap_idx < NumTaps_TP; ++tap_idx ) {
+        _taps[tap_idx] = static_cast<DataType_TP>(taps[tap_idx]);
+    }
+}
+
+template<typename DataType_TP, unsigned int NumTaps_TP>
+inline
+DataType_TP
+FIRStateFilter<DataType_TP, NumTaps_TP>::Process(const DataType_TP input)
+{
+    _read_idx = _read_idx == 0 ? NumTaps_TP - 1 : _read_idx - 1;
+    _delay_line[_read_idx] = input;
+    _delay_line[_read_idx + NumTaps_TP] = input;
+
+    const DataType_TP* history = _delay_line.data() + _read_idx;
+    DataType_TP result = 0;
+    for ( unsigned int tap_idx = 0; tap_idx < NumTaps_TP; ++tap_idx ) {
+        result += _taps[tap_idx] * history[tap_idx];
+    }
+    return result;
+}
+
+template<typename DataType_TP, unsigned int NumTaps_TP>
+inline
+void
+FIRStateFilter<DataType_TP, NumTaps_TP>::ResetState()
+{
+    _delay_line.fill(0);
+    _read_idx = 0;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: BiquadCascadeStateFilter
+//
+//! Coefficients of one second order section, normalized to a0 = 1:
+//! H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)
+struct BiquadCoefficients_TP {
+    double _b0 = 1.0;
+    double _b1 = 0.0;
+    double _b2 = 0.0;
+    double _a1 = 0.0;
+    double _a2 = 0.0;
+};
+
+//! IIR filter as cascade of second order sections (SOS) with the number of sections known at compile time.
+//! Each section is calculated in transposed direct form II, which needs two state values per section.
+//! The state belongs to one channel: use one instance per channel. Stage of FilterPipeline
+template<typename DataType_TP, unsigned int NumSections_TP>
+class BiquadCascadeStateFilter {
+
+    // Construction / Destruction / Copying
+public:
+    BiquadCascadeStateFilter() = default;
+
+    BiquadCascadeStateFilter(const std::array<BiquadCoefficients_TP, NumSections_TP>& sections);
+
+    // Public functions
+public:
+    DataType_TP Process(const DataType_TP input);
+
+    //! Block version of Process(): filters the block in place.
+    //! The state is kept between consecutive blocks, so the output is
+    //! identical to calling Process() for each sample.
+    void Apply(DataType_TP* block, size_t block_size);
+
+    void ResetState();
+
+    // Private types
+private:
+    struct Section_TP {
+        DataType_TP _b0 = 1;
+        DataType_TP _b1 = 0;
+        DataType_TP _b2 = 0;
+        DataType_TP _a1 = 0;
+        DataType_TP _a2 = 0;
+        //! transposed direct form II state
+        DataType_TP _state_1 = 0;
+        DataType_TP _state_2 = 0;
+    };
+
+    // Private variables
+private:
+    std::array<Section_TP, NumSections_TP> _sections{};
+};
+
+template<typename DataType_TP, unsigned int NumSections_TP>
+BiquadCascadeStateFilter<DataType_TP, NumSections_TP>::BiquadCascadeStateFilter(const std::array<BiquadCoefficients_TP, NumSections_TP>& sections)
+{
+    for ( unsigned int section_idx = 0; section_idx < NumSections_TP; ++section_idx ) {
+        auto& section = _sections[section_idx];
+        section._b0 = static_cast<DataType_TP>(sections[section_idx]._b0);
+        section._b1 = static_cast<DataType_TP>(sections[section_idx]._b1);
+        section._b2 = static_cast<DataType_TP>(sections[section_idx]._b2);
+        section._a1 = static_cast<DataType_TP>(sections[section_idx]._a1);
+        section._a2 = static_cast<DataType_TP>(sections[section_idx]._a2);
+    }
+}
+
+template<typename DataType_TP, unsigned int NumSections_TP>
+inline
+DataType_TP
+BiquadCascadeStateFilter<DataType_TP, NumSections_TP>::Process(const DataType_TP input)
+{
+    DataType_TP value = input;
+    for ( auto& section : _sections ) {
+        const DataType_TP output = section._b0 * value + section._state_1;
+        section._state_1 = section._b1 * value - section._a1 * output + section._state_2;
+        section._state_2 = section._b2 * value - section._a2 * output;
+        value = output;
+    }
+    return value;
+}
+
+template<typename DataType_TP, unsigned int NumSections_TP>
+inline
+void
+BiquadCascadeStateFilter<DataType_TP, NumSections_TP>::Apply(DataType_TP* block, size_t block_size)
+{
+    for ( size_t idx = 0; idx < block_size; ++idx ) {
+        block[idx] = Process(block[idx]);
+    }
+}
+
+template<typename DataType_TP, unsigned int NumSections_TP>
+inline
+void
+BiquadCascadeStateFilter<DataType_TP, NumSections_TP>::ResetState()
+{
+    for ( auto& section : _sections ) {
+        section._state_1 = 0;
+        section._state_2 = 0;
+    }
 }
 
 ///////////////////////////////////////////////////////
 //
 // Class: MovingAverageStateFilter
 //
+//! Moving average over the last window_length_samples samples (samples before the first one count as zero).
+//!
+//! The running window sum is re-anchored to the exact sum of the window each time the window was filled
+//! with new samples, so rounding errors do not accumulate over hours of streaming:
+//! the error of an output is bounded by the rounding of one window, independent of the stream length.
 template<typename DataType_TP>
 class MovingAverageStateFilter {
     // Construction / Destruction / Copying..
@@ -59,6 +291,19 @@ public:
     // Public functions
 public:
     void Apply(DataType_TP& sample);
+
+    //! Block version of Apply(): replaces each sample of the block with its moving average.
+    //! The sliding window is kept between consecutive blocks and with Process().
+    //!
+    //! The window sums of each chunk of the block are calculated as differences of prefix sums over the
+    //! window history followed by the chunk. The difference and division pass has no loop carried dependency
+    //! and no index wrapping, so it is vectorized by the compiler. The window sum is calculated anew for each chunk,
+    //! so it does not drift. The outputs differ from the sample by sample outputs only by rounding
+    //! (relative to the window sum at most about (window length + chunk size) / window length * epsilon).
+    void Apply(DataType_TP* block, size_t block_size);
+
+    //! Returns the moving average including the input (stage of FilterPipeline)
+    DataType_TP Process(const DataType_TP input);
     
     void ResetState();
 
@@ -66,35 +311,43 @@ public:
     void SetParams(int window_length_samples);
     
     int GetFilterDelay();
+
+    // Private functions
+private:
+    //! Sets the window sum to the exact sum of the samples inside the window
+    void ReanchorSum();
+
     // Private vars
 private:
+    //! Number of samples processed at once by the block version of Apply()
+    static constexpr size_t _block_chunk_size = 1024;
+
+    //! Number of samples of the groups, in which the block version of Apply() calculates the prefix sums
+    static constexpr size_t _scan_width = 16;
+
     // sum of all samples inside the current 'window'
     DataType_TP _current_sum = 0;
-    // number of saples processed since state reset
-    size_t _num_samples = 0;
     // length of the sliding window in samples
     int _interval_length = 0;
     // delay of the filter due to the sliding window in samples
     unsigned int _delay_samples = 0;
 
-    // 'sliding window' buffer
+    // 'sliding window' buffer (zero before the first samples)
     std::vector<DataType_TP> _input_buffer;
 
-    //  this is the idx inside the input buffer, where a new value is inserted
+    //  this is the idx inside the input buffer, where a new value is inserted.
+    //  It holds the oldest value of the window, which is removed when the new value is added
     size_t _head_idx = 0;
-    
-    // idx of the value to be removed inside the input buffer, when a new value is added
-    size_t _tail_idx = 0;
+
+    //! Working buffer of the block version of Apply(): window history followed by one chunk
+    std::vector<DataType_TP> _work_buffer;
 };
 
 template<typename DataType_TP>
 inline 
 MovingAverageStateFilter<DataType_TP>::MovingAverageStateFilter(int window_length_samples)
 {
-    _interval_length = window_length_samples;
-    _delay_samples = window_length_samples / 2;
-    _input_buffer.reserve(window_length_samples);
-    _input_buffer.resize(window_length_samples);
+    SetParams(window_length_samples);
 }
 
 template<typename DataType_TP>
@@ -103,32 +356,96 @@ MovingAverageStateFilter<DataType_TP>::MovingAverageStateFilter()
 {
 }
 
-// Returns true when a valid output was produces, false if not.
 template<typename DataType_TP>
 inline
 void 
 MovingAverageStateFilter<DataType_TP>::Apply(DataType_TP & sample)
 {
-    _current_sum += sample;
-    ++_num_samples; 
+    sample = Process(sample);
+}
+
+template<typename DataType_TP>
+inline
+DataType_TP
+MovingAverageStateFilter<DataType_TP>::Process(const DataType_TP input)
+{
+    // add the new sample and remove the oldest one
+    _current_sum += input - _input_buffer[_head_idx];
+    _input_buffer[_head_idx] = input;
 
-    // store current sample
-    _input_buffer[_head_idx] = sample;
-    _head_idx = (_head_idx + 1) % _interval_length;
+    if ( ++_head_idx == static_cast<size_t>(_interval_length) ) {
+        _head_idx = 0;
+        ReanchorSum();
+    }
 
-    // return moving average
-    sample = _current_sum / static_cast<DataType_TP>(_interval_length);
+    // moving average
+    return _current_sum / static_cast<DataType_TP>(_interval_length);
+}
 
-    if (_num_samples <_interval_length) {
-        // Until not the complete window was collected
-    } else {
-        // remove last sample from signal history 
-        _current_sum -= _input_buffer[_tail_idx];
-        // TODO: take in consideration that: _tail_idx == _head_idx -1, 
-        // after init phase is completed
-        // -> but then we need to check when _head_idx is zero, because then _tail_idx will be minus one if this is the case
-        _tail_idx = (_tail_idx + 1) % _interval_length;
+template<typename DataType_TP>
+inline
+void
+MovingAverageStateFilter<DataType_TP>::Apply(DataType_TP* block, size_t block_size)
+{
+    const size_t window_length = _interval_length;
+    const DataType_TP divisor = static_cast<DataType_TP>(_interval_length);
+    // window history in order (oldest sample first), followed by the chunk
+    DataType_TP* work = _work_buffer.data();
+    std::copy(_input_buffer.begin() + _head_idx, _input_buffer.end(), work);
+    std::copy(_input_buffer.begin(), _input_buffer.begin() + _head_idx, work + (window_length - _head_idx));
+
+    for ( size_t chunk_begin = 0; chunk_begin < block_size; chunk_begin += _block_chunk_size ) {
+        const size_t chunk_size = std::min(_block_chunk_size, block_size - chunk_begin);
+        DataType_TP* chunk = block + chunk_begin;
+        std::copy(chunk, chunk + chunk_size, work + window_length);
+
+        // the exact sum of the window history
+        DataType_TP sum = 0;
+        for ( size_t idx = 0; idx < window_length; ++idx ) {
+            sum += work[idx];
+        }
+
+        // Prefix sum of the changes of the window sum in groups of _scan_width samples:
+        // the prefix sums inside a group do not depend on the sum of the previous groups,
+        // so only one addition per group is on the critical path.
+        const DataType_TP* added = work + window_length;
+        const DataType_TP* removed = work;
+        size_t idx = 0;
+        for ( ; idx + _scan_width <= chunk_size; idx += _scan_width ) {
+            std::array<DataType_TP, _scan_width> group_sums;
+            group_sums[0] = added[idx] - removed[idx];
+            for ( size_t lane = 1; lane < _scan_width; ++lane ) {
+                group_sums[lane] = group_sums[lane - 1] + (added[idx + lane] - removed[idx + lane]);
+            }
+            for ( size_t lane = 0; lane < _scan_width; ++lane ) {
+                chunk[idx + lane] = (sum + group_sums[lane]) / divisor;
+            }
+            sum += group_sums[_scan_width - 1];
+        }
+        for ( ; idx < chunk_size; ++idx ) {
+            sum += added[idx] - removed[idx];
+            chunk[idx] = sum / divisor;
+        }
+
+        // the newest window_length samples are the history of the next chunk
+        std::copy(work + chunk_size, work + chunk_size + window_length, work);
+    }
+
+    std::copy(work, work + window_length, _input_buffer.begin());
+    _head_idx = 0;
+    ReanchorSum();
+}
+
+template<typename DataType_TP>
+inline
+void
+MovingAverageStateFilter<DataType_TP>::ReanchorSum()
+{
+    DataType_TP sum = 0;
+    for ( const auto& value : _input_buffer ) {
+        sum += value;
     }
+    _current_sum = sum;
 }
 
 template<typename DataType_TP>
@@ -137,9 +454,8 @@ void
 MovingAverageStateFilter<DataType_TP>::ResetState()
 {
     _current_sum = 0;
-    _num_samples = 0;
     _head_idx = 0;
-    _tail_idx = 0;
+    std::fill(_input_buffer.begin(), _input_buffer.end(), DataType_TP(0));
 }
 
 template<typename DataType_TP>
@@ -149,9 +465,10 @@ MovingAverageStateFilter<DataType_TP>::SetParams(int window_length_samples)
 {
     _interval_length = window_length_samples;
     _delay_samples = window_length_samples/2;
-    _input_buffer.reserve(window_length_samples);
-    _input_buffer.resize(window_length_samples);
-
+    _input_buffer.assign(window_length_samples, DataType_TP(0));
+    _work_buffer.assign(window_length_samples + _block_chunk_size, DataType_TP(0));
+    _current_sum = 0;
+    _head_idx = 0;
 }
 
 template<typename DataType_TP>
@@ -160,122 +477,1137 @@ inline int MovingAverageStateFilter<DataType_TP>::GetFilterDelay()
     return _delay_samples;
 }
 
+///////////////////////////////////////////////////////
+//
+// Class: FixedLengthMovingAverageStateFilter
+//
+//! MovingAverageStateFilter with the window length known at compile time
+//! (same arithmetic as MovingAverageStateFilter::Process(), the window is stored inside the object). Stage of FilterPipeline
+template<typename DataType_TP, unsigned int WindowLength_TP>
+class FixedLengthMovingAverageStateFilter {
+
+    // Public functions
+public:
+    DataType_TP Process(const DataType_TP input);
+
+    void ResetState();
+
+    // Private variables
+private:
+    std::array<DataType_TP, WindowLength_TP> _input_buffer{};
 
+    DataType_TP _current_sum = 0;
 
+    unsigned int _head_idx = 0;
+};
 
-inline 
-long long 
-mod_negative(const long long x, const long long y) 
+template<typename DataType_TP, unsigned int WindowLength_TP>
+inline
+DataType_TP
+FixedLengthMovingAverageStateFilter<DataType_TP, WindowLength_TP>::Process(const DataType_TP input)
 {
-    if ( x >= y ) {
-        return x % y;
-    }
-    else if ( x < 0 ) {
-        return (x % y + y) % y;
-    }
-    else {
-        return x;
+    _current_sum += input - _input_buffer[_head_idx];
+    _input_buffer[_head_idx] = input;
+
+    if ( ++_head_idx == WindowLength_TP ) {
+        _head_idx = 0;
+        // re-anchor the sum, so it does not drift
+        DataType_TP sum = 0;
+        for ( const auto& value : _input_buffer ) {
+            sum += value;
+        }
+        _current_sum = sum;
     }
+    return _current_sum / static_cast<DataType_TP>(WindowLength_TP);
+}
+
+template<typename DataType_TP, unsigned int WindowLength_TP>
+inline
+void
+FixedLengthMovingAverageStateFilter<DataType_TP, WindowLength_TP>::ResetState()
+{
+    _input_buffer.fill(0);
+    _current_sum = 0;
+    _head_idx = 0;
 }
 
 ///////////////////////////////////////////////////////
 //
 // Class: PeakDetectorFilter
 //
+//! Detects local maxima of a stream: a sample is a peak, if it is not smaller than its predecessor and its successor.
+//! A peak is reported when its successor is added; only the last two samples are stored.
 template<typename DataType_TP>
 class PeakDetectorFilter {
 
-    // Construction / Destructon / Copying
-public:
-    PeakDetectorFilter(unsigned int buffer_size);
-
+    // Public functions
 public:
-    // First three return values ARE NOT VALID RETURN VALUES
-    // Returns true when the sample previously added to the current sample was a peak.
-    // This means output peak location is: current_sample_loc - 1
+    //! Returns true, if the sample added before this sample is a peak.
+    //! This means the output peak location is: current_sample_loc - 1.
+    //! The first two samples after construction or ResetState() are never peaks
     bool Apply(const DataType_TP& sample);
 
-    // A window version of the Apply() function, which returns the index of the found peaks inside the window-array
-    //
-    // The last value from the window is restored in the delay line to check if the first value of the next window is a peak
-    // Returns an empty vector, if no peak was found
-    std::vector<unsigned int> Apply(const std::vector<DataType_TP>& window);
+    //! Block version of Apply() without allocations: writes the index (inside the block) of each sample,
+    //! for which Apply(sample) would return true, into peak_indices, which needs space for block_size indices.
+    //! The peak itself is the sample before the index; for index 0 it is the last sample of the previous block.
+    //!
+    //! The comparisons of _group_size samples are done without branches and combined into a bitmask,
+    //! so the compiler vectorizes them; only the set bits are visited to collect the indices.
+    //!
+    //! \returns the number of found peaks
+    size_t Apply(const DataType_TP* block, size_t block_size, unsigned int* peak_indices);
+
+    void ResetState();
 
+    // Private variables
 private:
-    RingBuffer_TC<DataType_TP> _buffer;
+    //! Number of samples, which are compared into one bitmask by the block version of Apply()
+    static constexpr size_t _group_size = 64;
 
+    //! The last and the second last sample
     DataType_TP _value_previous = 0;
 
     DataType_TP _value_prev_previous = 0;
 
-    DataType_TP _last_value_last_window = 0;
+    //! Number of samples inside the history (up to two)
+    unsigned int _num_history_samples = 0;
 };
 
 template<typename DataType_TP>
-PeakDetectorFilter<DataType_TP>::PeakDetectorFilter(unsigned int buffer_size)
-    : _buffer(buffer_size)
+inline
+bool
+PeakDetectorFilter<DataType_TP>::Apply(const DataType_TP& sample)
 {
+    const bool is_peak = (_num_history_samples == 2) &
+                         (_value_previous >= _value_prev_previous) &
+                         (_value_previous >= sample);
+    _value_prev_previous = _value_previous;
+    _value_previous = sample;
+    _num_history_samples += _num_history_samples < 2;
+    return is_peak;
 }
 
 template<typename DataType_TP>
 inline
-bool 
-PeakDetectorFilter<DataType_TP>::Apply(const DataType_TP & sample)
+size_t
+PeakDetectorFilter<DataType_TP>::Apply(const DataType_TP* block, size_t block_size, unsigned int* peak_indices)
 {
-    _buffer.InsertAtTail(sample);     
+    size_t num_peaks = 0;
 
-    const auto curr_head_idx = _buffer.GetTailIdx(); 
-    // Do peak detection after three samples are aquired
-    if ( _buffer.Size() >= 3 ) { 
+    // The first two samples are compared with the history
+    const size_t num_head_samples = std::min<size_t>(2, block_size);
+    for ( size_t idx = 0; idx < num_head_samples; ++idx ) {
+        if ( Apply(block[idx]) ) {
+            peak_indices[num_peaks++] = idx;
+        }
+    }
+    if ( block_size <= 2 ) {
+        return num_peaks;
+    }
+
+    // All following samples are compared with their predecessors inside the block
+    for ( size_t group_begin = 2; group_begin < block_size; group_begin += _group_size ) {
+        const size_t group_size = std::min(_group_size, block_size - group_begin);
+        const DataType_TP* samples = block + group_begin;
+        const DataType_TP* previous = samples - 1;
+        const DataType_TP* prev_previous = samples - 2;
 
-        if ( curr_head_idx < 3 ) {
-            // Special "wrap" case  -> don't access invalid memory locations ( When _head_idx < 2 )
-            // When _head_idx == 0 -> compare _buffer[MAX] with _buffer[MAX-1] AND _buffer[0]
-            // When _head_idx == 1 -> comp. _buffer[0] with _buffer[MAX] and _buffer[1]
-            _value_previous = _buffer.constData()[ mod_negative(curr_head_idx - 2, _buffer.MaxSize()) ];
-            _value_prev_previous = _buffer.constData()[ mod_negative(curr_head_idx - 3, _buffer.MaxSize()) ];
+        uint64_t peak_mask = 0;
+        if ( group_size == _group_size ) {
+            // constant trip count
+            for ( size_t lane = 0; lane < _group_size; ++lane ) {
+                const bool is_peak = (previous[lane] >= prev_previous[lane]) & (previous[lane] >= samples[lane]);
+                peak_mask |= static_cast<uint64_t>(is_peak) << lane;
+            }
         } else {
-            _value_previous = _buffer.constData()[ curr_head_idx - 2 ];
-            _value_prev_previous = _buffer.constData()[ curr_head_idx - 3 ];
+            for ( size_t lane = 0; lane < group_size; ++lane ) {
+                const bool is_peak = (previous[lane] >= prev_previous[lane]) & (previous[lane] >= samples[lane]);
+                peak_mask |= static_cast<uint64_t>(is_peak) << lane;
+            }
         }
 
-        // Check if there was a peak
-        if ( _value_previous >= _value_prev_previous ) {
-            if ( _value_previous >= sample ) {
-                // PEAK DETECTED
-                return true;
-            }
+        while ( peak_mask != 0 ) {
+            peak_indices[num_peaks++] = static_cast<unsigned int>(group_begin + std::countr_zero(peak_mask));
+            peak_mask &= peak_mask - 1;
         }
     }
 
-    return false;
+    _value_prev_previous = block[block_size - 2];
+    _value_previous = block[block_size - 1];
+    return num_peaks;
+}
+
+template<typename DataType_TP>
+inline
+void
+PeakDetectorFilter<DataType_TP>::ResetState()
+{
+    _value_previous = 0;
+    _value_prev_previous = 0;
+    _num_history_samples = 0;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: RunningMedianStateFilter
+//
+//! Median of the last window_length_samples samples with O(log window length) operations per sample.
+//!
+//! The window is stored in a ring buffer. The positions of the samples are ordered in two heaps around the median:
+//! a max heap with the smaller half and a min heap with the bigger half of the window.
+//! A new sample replaces the oldest one at its heap position and is moved up or down its heap;
+//! only if it passes the median, the root of the other heap is fixed as well.
+//! All buffers are allocated at construction, so Process() does not allocate.
+//!
+//! Before the first sample, the window is considered to be filled with the first sample.
+template<typename DataType_TP>
+class RunningMedianStateFilter {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param window_length_samples an even window length is extended by one sample, so the median is a sample of the window
+    RunningMedianStateFilter(unsigned int window_length_samples = 1);
+
+    // Public functions
+public:
+    //! Returns the median of the window including the input
+    DataType_TP Process(const DataType_TP input);
+
+    //! Block version of Process(): replaces each sample of the block with the median
+    void Apply(DataType_TP* block, size_t block_size);
+
+    void ResetState();
+
+    //! Returns the delay of the median in samples: the median of the window is the estimate for its center sample
+    unsigned int GetFilterDelay();
+
+    unsigned int GetWindowLength();
+
+    // Private functions
+private:
+    //! Heap positions: 0 is the median, 1..._heap_size the min heap (children of i are 2i and 2i + 1),
+    //! -1...-_heap_size the max heap (children of -i are -2i and -2i - 1)
+    int& HeapSlot(const int heap_idx);
+
+    bool IsLess(const int lhs_heap_idx, const int rhs_heap_idx);
+
+    void Exchange(const int lhs_heap_idx, const int rhs_heap_idx);
+
+    //! Moves the sample towards the root of the min heap. Returns true, if it became the median
+    bool MinHeapSortUp(int heap_idx);
+
+    //! Moves the sample towards the root of the max heap. Returns true, if it became the median
+    bool MaxHeapSortUp(int heap_idx);
+
+    //! Moves the sample at the parent of heap_idx away from the median
+    void MinHeapSortDown(int heap_idx);
+
+    void MaxHeapSortDown(int heap_idx);
+
+    // Private variables
+private:
+    unsigned int _window_length = 1;
+
+    //! Number of samples inside each heap
+    int _heap_size = 0;
+
+    //! 'sliding window' ring buffer
+    std::vector<DataType_TP> _values;
+
+    //! Slot of _values at each heap position (offset by _heap_size)
+    std::vector<int> _heap;
+
+    //! Heap position of each slot of _values
+    std::vector<int> _heap_positions;
+
+    //! Slot of the oldest sample, which is replaced by the next sample
+    unsigned int _oldest_slot = 0;
+
+    bool _is_filled = false;
+};
+
+template<typename DataType_TP>
+RunningMedianStateFilter<DataType_TP>::RunningMedianStateFilter(unsigned int window_length_samples)
+{
+    _window_length = std::max(1u, window_length_samples | 1u);
+    _heap_size = static_cast<int>(_window_length / 2);
+    _values.resize(_window_length);
+    _heap.resize(_window_length);
+    _heap_positions.resize(_window_length);
+    ResetState();
+}
+
+template<typename DataType_TP>
+inline
+int&
+RunningMedianStateFilter<DataType_TP>::HeapSlot(const int heap_idx)
+{
+    return _heap[heap_idx + _heap_size];
+}
+
+template<typename DataType_TP>
+inline
+bool
+RunningMedianStateFilter<DataType_TP>::IsLess(const int lhs_heap_idx, const int rhs_heap_idx)
+{
+    return _values[HeapSlot(lhs_heap_idx)] < _values[HeapSlot(rhs_heap_idx)];
 }
 
 template<typename DataType_TP>
 inline
-std::vector<unsigned int>
-PeakDetectorFilter<DataType_TP>::Apply(const std::vector<DataType_TP>& window)
+void
+RunningMedianStateFilter<DataType_TP>::Exchange(const int lhs_heap_idx, const int rhs_heap_idx)
 {
-    std::vector<unsigned int> peak_indices;
+    std::swap(HeapSlot(lhs_heap_idx), HeapSlot(rhs_heap_idx));
+    _heap_positions[HeapSlot(lhs_heap_idx)] = lhs_heap_idx;
+    _heap_positions[HeapSlot(rhs_heap_idx)] = rhs_heap_idx;
+}
 
-    //First check the last value from the last window with the first value from the current window? Requires extra if(
-    if (window[0] >= _last_value_last_window  &&
-        window[0] >= window[1] )
-    {
-        peak_indices.push_back(0);
+template<typename DataType_TP>
+inline
+bool
+RunningMedianStateFilter<DataType_TP>::MinHeapSortUp(int heap_idx)
+{
+    while ( heap_idx > 0 && IsLess(heap_idx, heap_idx / 2) ) {
+        Exchange(heap_idx, heap_idx / 2);
+        heap_idx /= 2;
     }
+    return heap_idx == 0;
+}
 
-    // Check for peaks inside the window
-    for ( size_t idx = 1; idx < window.size(); ++idx ) {
-        if ( window[idx-1] <= window[idx] &&
-            window[idx] >= window[idx+1])
-        {
-            peak_indices.push_back(idx)
-        }
+template<typename DataType_TP>
+inline
+bool
+RunningMedianStateFilter<DataType_TP>::MaxHeapSortUp(int heap_idx)
+{
+    while ( heap_idx < 0 && IsLess(heap_idx / 2, heap_idx) ) {
+        Exchange(heap_idx, heap_idx / 2);
+        heap_idx /= 2;
     }
+    return heap_idx == 0;
+}
 
-    // Remember last value from the window to check if the first value from the next window is a peak
-    _last_value_last_window = (window.end() - 1); // I think end points at not the end but one after the end
+template<typename DataType_TP>
+inline
+void
+RunningMedianStateFilter<DataType_TP>::MinHeapSortDown(int heap_idx)
+{
+    for ( ; heap_idx <= _heap_size; heap_idx *= 2 ) {
+        // the smaller child
+        if ( heap_idx < _heap_size && IsLess(heap_idx + 1, heap_idx) ) {
+            ++heap_idx;
+        }
+        if ( !IsLess(heap_idx, heap_idx / 2) ) {
+            break;
+        }
+        Exchange(heap_idx, heap_idx / 2);
+    }
+}
 
-    return peak_indices;
+template<typename DataType_TP>
+inline
+void
+RunningMedianStateFilter<DataType_TP>::MaxHeapSortDown(int heap_idx)
+{
+    for ( ; heap_idx >= -_heap_size; heap_idx *= 2 ) {
+        // the bigger child
+        if ( heap_idx > -_heap_size && IsLess(heap_idx, heap_idx - 1) ) {
+            --heap_idx;
+        }
+        if ( !IsLess(heap_idx / 2, heap_idx) ) {
+            break;
+        }
+        Exchange(heap_idx, heap_idx / 2);
+    }
+}
+
+template<typename DataType_TP>
+inline
+DataType_TP
+RunningMedianStateFilter<DataType_TP>::Process(const DataType_TP input)
+{
+    if ( !_is_filled ) {
+        std::fill(_values.begin(), _values.end(), input);
+        _is_filled = true;
+    }
+
+    const unsigned int slot = _oldest_slot;
+    if ( ++_oldest_slot == _window_length ) {
+        _oldest_slot = 0;
+    }
+    const int heap_idx = _heap_positions[slot];
+    const DataType_TP old_value = _values[slot];
+    _values[slot] = input;
+
+    if ( heap_idx > 0 ) {
+        // inside the min heap
+        if ( old_value < input ) {
+            MinHeapSortDown(heap_idx * 2);
+        } else if ( MinHeapSortUp(heap_idx) ) {
+            MaxHeapSortDown(-1);
+        }
+    } else if ( heap_idx < 0 ) {
+        // inside the max heap
+        if ( input < old_value ) {
+            MaxHeapSortDown(heap_idx * 2);
+        } else if ( MaxHeapSortUp(heap_idx) ) {
+            MinHeapSortDown(1);
+        }
+    } else {
+        // the median was replaced
+        MaxHeapSortDown(-1);
+        MinHeapSortDown(1);
+    }
+    return _values[HeapSlot(0)];
+}
+
+template<typename DataType_TP>
+inline
+void
+RunningMedianStateFilter<DataType_TP>::Apply(DataType_TP* block, size_t block_size)
+{
+    for ( size_t idx = 0; idx < block_size; ++idx ) {
+        block[idx] = Process(block[idx]);
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+RunningMedianStateFilter<DataType_TP>::ResetState()
+{
+    // all samples are equal after the first sample, so any order is a valid heap
+    for ( unsigned int slot = 0; slot < _window_length; ++slot ) {
+        _heap[slot] = slot;
+        _heap_positions[slot] = static_cast<int>(slot) - _heap_size;
+    }
+    std::fill(_values.begin(), _values.end(), DataType_TP(0));
+    _oldest_slot = 0;
+    _is_filled = false;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+RunningMedianStateFilter<DataType_TP>::GetFilterDelay()
+{
+    return _window_length / 2;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+RunningMedianStateFilter<DataType_TP>::GetWindowLength()
+{
+    return _window_length;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: BaselineWanderStateFilter
+//
+//! Removes the baseline wander with two cascaded running medians (de Chazal et al.):
+//! the 200 ms median removes the QRS complexes and P-waves, the 600 ms median of its output removes the T-waves.
+//! The result is the baseline, which is subtracted from the input.
+//!
+//! The medians estimate the baseline at the center of their windows, so the input is delayed by GetFilterDelay() samples
+//! before the baseline is subtracted: the output belongs to the input sample GetFilterDelay() samples ago.
+//! For the display, draw the output at the timestamp of this sample;
+//! in front of a detector, subtract GetFilterDelay() / sample frequency from the timestamps.
+//! Stage of FilterPipeline
+template<typename DataType_TP>
+class BaselineWanderStateFilter {
+
+    // Construction / Destruction / Copying
+public:
+    BaselineWanderStateFilter(double sample_freq_hz,
+                              double qrs_window_length_ms = 200.0,
+                              double t_wave_window_length_ms = 600.0);
+
+    // Public functions
+public:
+    //! Returns the input of GetFilterDelay() samples ago without the baseline
+    DataType_TP Process(const DataType_TP input);
+
+    //! Block version of Process(): removes the baseline from the block in place
+    void Apply(DataType_TP* block, size_t block_size);
+
+    void ResetState();
+
+    //! Returns the delay of the output in samples
+    unsigned int GetFilterDelay();
+
+    // Private variables
+private:
+    RunningMedianStateFilter<DataType_TP> _qrs_median;
+
+    RunningMedianStateFilter<DataType_TP> _t_wave_median;
+
+    //! Delay line of the input: GetFilterDelay() + 1 samples
+    std::vector<DataType_TP> _delay_line;
+
+    //! Position of the next input inside _delay_line, which holds the delayed input
+    size_t _delay_idx = 0;
+
+    bool _is_filled = false;
+};
+
+template<typename DataType_TP>
+BaselineWanderStateFilter<DataType_TP>::BaselineWanderStateFilter(double sample_freq_hz,
+                                                                  double qrs_window_length_ms,
+                                                                  double t_wave_window_length_ms)
+    : _qrs_median(static_cast<unsigned int>(qrs_window_length_ms / 1000.0 * sample_freq_hz)),
+    _t_wave_median(static_cast<unsigned int>(t_wave_window_length_ms / 1000.0 * sample_freq_hz))
+{
+    _delay_line.resize(GetFilterDelay() + 1);
+}
+
+template<typename DataType_TP>
+inline
+DataType_TP
+BaselineWanderStateFilter<DataType_TP>::Process(const DataType_TP input)
+{
+    if ( !_is_filled ) {
+        // like the medians: the signal before the first sample equals the first sample
+        std::fill(_delay_line.begin(), _delay_line.end(), input);
+        _is_filled = true;
+    }
+
+    const DataType_TP baseline = _t_wave_median.Process(_qrs_median.Process(input));
+
+    _delay_line[_delay_idx] = input;
+    if ( ++_delay_idx == _delay_line.size() ) {
+        _delay_idx = 0;
+    }
+    // the oldest sample of the delay line
+    return _delay_line[_delay_idx] - baseline;
+}
+
+template<typename DataType_TP>
+inline
+void
+BaselineWanderStateFilter<DataType_TP>::Apply(DataType_TP* block, size_t block_size)
+{
+    for ( size_t idx = 0; idx < block_size; ++idx ) {
+        block[idx] = Process(block[idx]);
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+BaselineWanderStateFilter<DataType_TP>::ResetState()
+{
+    _qrs_median.ResetState();
+    _t_wave_median.ResetState();
+    _delay_idx = 0;
+    _is_filled = false;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+BaselineWanderStateFilter<DataType_TP>::GetFilterDelay()
+{
+    return _qrs_median.GetFilterDelay() + _t_wave_median.GetFilterDelay();
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: PowerlineNotchStateFilter
+//
+//! Removes the powerline interference (50 or 60 Hz) and its harmonics from one or multiple channels.
+//!
+//! One second order notch per harmonic below the nyquist frequency is cascaded (bilinear design, unity gain at DC,
+//! -3 dB width notch_bandwidth_hz). The coefficients are shared by all channels and the state is stored as
+//! structure of arrays (one array per state variable of a notch, with one entry per channel), like in MultiChannelQRSDetection:
+//! the innermost loop of a frame runs over the channels, so the compiler vectorizes it and one SIMD instruction
+//! advances multiple leads at once.
+//!
+//! The frames are filtered in place, so the filter runs directly on the buffer, which is passed to the detector or the display.
+//! Apart from the notches, the group delay is below one sample and the timestamps need no correction.
+//! Before the first frame, each channel is considered to be constant at its first sample, so there is no start transient.
+//!
+//! Usage:
+//! PowerlineNotchStateFilter<double> notch(360.0, 50.0, 12);
+//! // frames[frame_idx * 12 + channel_idx]
+//! notch.Apply(frames, num_frames);
+//! // the interleaved frames are passed to a detector of all 12 channels (see MultiChannelQRSDetection)
+//! MultiChannelQRSDetection<double> detector(360.0, 12, 2);
+//! detector.AppendBlock(span<const double>(frames, num_frames * 12), t0_sec);
+template<typename DataType_TP>
+class PowerlineNotchStateFilter {
+
+    static_assert(std::is_floating_point<DataType_TP>::value, "PowerlineNotchStateFilter requires a floating point type");
+
+    // Construction / Destruction / Copying
+public:
+    //! \param mains_freq_hz frequency of the powerline: 50 or 60 Hz (see EstimateMainsFrequency())
+    //! \param num_channels number of channels of a frame
+    //! \param notch_bandwidth_hz -3 dB width of each notch
+    //! \param max_num_harmonics maximum number of notches including the fundamental
+    PowerlineNotchStateFilter(double sample_freq_hz,
+                              double mains_freq_hz = 50.0,
+                              unsigned int num_channels = 1,
+                              double notch_bandwidth_hz = 2.0,
+                              unsigned int max_num_harmonics = 4);
+
+    // Public functions
+public:
+    //! Returns the filtered input (single channel)
+    DataType_TP Process(const DataType_TP input);
+
+    //! Filters the sample in place (single channel)
+    void Apply(DataType_TP& sample);
+
+    //! Filters one frame in place
+    //!
+    //! \param frame one sample of each channel (num_channels values)
+    void ApplyFrame(DataType_TP* frame);
+
+    //! Block version of ApplyFrame(): filters consecutive frames in place.
+    //! With one channel, the frames are a block of samples, like with MovingAverageStateFilter::Apply().
+    //! The state is kept between consecutive blocks, so the output is identical to calling ApplyFrame() for each frame.
+    //!
+    //! \param frames interleaved samples: frames[frame_idx * num_channels + channel_idx]
+    void Apply(DataType_TP* frames, size_t num_frames);
+
+    void ResetState();
+
+    //! Changes the frequency of the powerline and resets the state
+    void SetMainsFrequency(double mains_freq_hz);
+
+    double GetMainsFrequency();
+
+    unsigned int GetChannelCount();
+
+    //! Returns the number of notches (fundamental and harmonics below the nyquist frequency)
+    unsigned int GetNotchCount();
+
+    //! Returns the powerline frequency of the signal: 50 or 60 Hz, whichever has more power (Goertzel algorithm).
+    //! A few seconds of the signal are sufficient
+    static double EstimateMainsFrequency(const DataType_TP* signal, size_t num_samples, double sample_freq_hz);
+
+    // Private types
+private:
+    struct Notch_TP {
+        DataType_TP _b0 = 1;
+        DataType_TP _b1 = 0;
+        DataType_TP _b2 = 0;
+        DataType_TP _a1 = 0;
+        DataType_TP _a2 = 0;
+    };
+
+    // Private functions
+private:
+    //! Calculates the notches of the fundamental and its harmonics
+    void DesignNotches();
+
+    //! Sets the state of each channel to the steady state of its (constant) first sample
+    void InitializeState(const DataType_TP* frame);
+
+    //! Power of the signal at freq_hz (Goertzel algorithm)
+    static double SignalPower(const DataType_TP* signal, size_t num_samples, double freq_hz, double sample_freq_hz);
+
+    // Private variables
+private:
+    static constexpr double _pi = 3.14159265358979323846;
+
+    double _sample_freq_hz = 0.0;
+
+    double _mains_freq_hz = 50.0;
+
+    double _notch_bandwidth_hz = 2.0;
+
+    unsigned int _max_num_harmonics = 4;
+
+    unsigned int _num_channels = 1;
+
+    std::vector<Notch_TP> _notches;
+
+    //! Transposed direct form II state: for notch n, _state[2n * num_channels + channel_idx] is the first
+    //! and _state[(2n + 1) * num_channels + channel_idx] the second state value of the channel
+    std::vector<DataType_TP> _state;
+
+    bool _is_initialized = false;
+};
+
+template<typename DataType_TP>
+PowerlineNotchStateFilter<DataType_TP>::PowerlineNotchStateFilter(double sample_freq_hz,
+                                                                  double mains_freq_hz,
+                                                                  unsigned int num_channels,
+                                                                  double notch_bandwidth_hz,
+                                                                  unsigned int max_num_harmonics)
+    : _sample_freq_hz(sample_freq_hz),
+    _mains_freq_hz(mains_freq_hz),
+    _notch_bandwidth_hz(notch_bandwidth_hz),
+    _max_num_harmonics(max_num_harmonics),
+    _num_channels(std::max(1u, num_channels))
+{
+    DesignNotches();
+}
+
+template<typename DataType_TP>
+inline
+void
+PowerlineNotchStateFilter<DataType_TP>::DesignNotches()
+{
+    _notches.clear();
+    for ( unsigned int harmonic = 1; harmonic <= _max_num_harmonics; ++harmonic ) {
+        const double notch_freq_hz = harmonic * _mains_freq_hz;
+        // the notch must fit below the nyquist frequency
+        if ( notch_freq_hz + _notch_bandwidth_hz >= 0.5 * _sample_freq_hz ) {
+            break;
+        }
+        const double omega = 2.0 * _pi * notch_freq_hz / _sample_freq_hz;
+        // bandwidth of the bilinear transformed notch: tan(omega_bw / 2) = alpha
+        const double alpha = std::tan(_pi * _notch_bandwidth_hz / _sample_freq_hz);
+        const double a0 = 1.0 + alpha;
+        Notch_TP notch;
+        notch._b0 = static_cast<DataType_TP>(1.0 / a0);
+        notch._b1 = static_cast<DataType_TP>(-2.0 * std::cos(omega) / a0);
+        notch._b2 = notch._b0;
+        notch._a1 = notch._b1;
+        notch._a2 = static_cast<DataType_TP>((1.0 - alpha) / a0);
+        _notches.push_back(notch);
+    }
+    _state.assign(2 * _notches.size() * _num_channels, DataType_TP(0));
+    _is_initialized = false;
+}
+
+template<typename DataType_TP>
+inline
+void
+PowerlineNotchStateFilter<DataType_TP>::InitializeState(const DataType_TP* frame)
+{
+    // a constant input passes all notches unchanged (unity gain at DC)
+    for ( size_t notch_idx = 0; notch_idx < _notches.size(); ++notch_idx ) {
+        const auto& notch = _notches[notch_idx];
+        DataType_TP* state_1 = _state.data() + 2 * notch_idx * _num_channels;
+        DataType_TP* state_2 = state_1 + _num_channels;
+        for ( unsigned int channel_idx = 0; channel_idx < _num_channels; ++channel_idx ) {
+            const DataType_TP value = frame[channel_idx];
+            state_1[channel_idx] = value - notch._b0 * value;
+            state_2[channel_idx] = notch._b2 * value - notch._a2 * value;
+        }
+    }
+    _is_initialized = true;
+}
+
+template<typename DataType_TP>
+inline
+DataType_TP
+PowerlineNotchStateFilter<DataType_TP>::Process(const DataType_TP input)
+{
+    DataType_TP value = input;
+    ApplyFrame(&value);
+    return value;
+}
+
+template<typename DataType_TP>
+inline
+void
+PowerlineNotchStateFilter<DataType_TP>::Apply(DataType_TP& sample)
+{
+    ApplyFrame(&sample);
+}
+
+template<typename DataType_TP>
+inline
+void
+PowerlineNotchStateFilter<DataType_TP>::ApplyFrame(DataType_TP* frame)
+{
+    if ( !_is_initialized ) {
+        InitializeState(frame);
+    }
+
+    const unsigned int num_channels = _num_channels;
+    for ( size_t notch_idx = 0; notch_idx < _notches.size(); ++notch_idx ) {
+        // local copies: the coefficients do not alias the frame, so the channel loop is vectorized
+        const DataType_TP b0 = _notches[notch_idx]._b0;
+        const DataType_TP b1 = _notches[notch_idx]._b1;
+        const DataType_TP b2 = _notches[notch_idx]._b2;
+        const DataType_TP a1 = _notches[notch_idx]._a1;
+        const DataType_TP a2 = _notches[notch_idx]._a2;
+        DataType_TP* state_1 = _state.data() + 2 * notch_idx * num_channels;
+        DataType_TP* state_2 = state_1 + num_channels;
+        for ( unsigned int channel_idx = 0; channel_idx < num_channels; ++channel_idx ) {
+            const DataType_TP input = frame[channel_idx];
+            const DataType_TP output = b0 * input + state_1[channel_idx];
+            state_1[channel_idx] = b1 * input - a1 * output + state_2[channel_idx];
+            state_2[channel_idx] = b2 * input - a2 * output;
+            frame[channel_idx] = output;
+        }
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+PowerlineNotchStateFilter<DataType_TP>::Apply(DataType_TP* frames, size_t num_frames)
+{
+    if ( num_frames == 0 ) {
+        return;
+    }
+    if ( _num_channels > 1 ) {
+        for ( size_t frame_idx = 0; frame_idx < num_frames; ++frame_idx ) {
+            ApplyFrame(frames + frame_idx * _num_channels);
+        }
+        return;
+    }
+
+    // single channel: there is nothing to vectorize over, so each notch runs over the whole block
+    // with its state inside registers
+    if ( !_is_initialized ) {
+        InitializeState(frames);
+    }
+    for ( size_t notch_idx = 0; notch_idx < _notches.size(); ++notch_idx ) {
+        const auto notch = _notches[notch_idx];
+        DataType_TP state_1 = _state[2 * notch_idx];
+        DataType_TP state_2 = _state[2 * notch_idx + 1];
+        for ( size_t idx = 0; idx < num_frames; ++idx ) {
+            const DataType_TP input = frames[idx];
+            const DataType_TP output = notch._b0 * input + state_1;
+            state_1 = notch._b1 * input - notch._a1 * output + state_2;
+            state_2 = notch._b2 * input - notch._a2 * output;
+            frames[idx] = output;
+        }
+        _state[2 * notch_idx] = state_1;
+        _state[2 * notch_idx + 1] = state_2;
+    }
+}
+
+template<typename DataType_TP>
+inline
+void
+PowerlineNotchStateFilter<DataType_TP>::ResetState()
+{
+    std::fill(_state.begin(), _state.end(), DataType_TP(0));
+    _is_initialized = false;
+}
+
+template<typename DataType_TP>
+inline
+void
+PowerlineNotchStateFilter<DataType_TP>::SetMainsFrequency(double mains_freq_hz)
+{
+    _mains_freq_hz = mains_freq_hz;
+    DesignNotches();
+}
+
+template<typename DataType_TP>
+inline
+double
+PowerlineNotchStateFilter<DataType_TP>::GetMainsFrequency()
+{
+    return _mains_freq_hz;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+PowerlineNotchStateFilter<DataType_TP>::GetChannelCount()
+{
+    return _num_channels;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+PowerlineNotchStateFilter<DataType_TP>::GetNotchCount()
+{
+    return static_cast<unsigned int>(_notches.size());
+}
+
+template<typename DataType_TP>
+inline
+double
+PowerlineNotchStateFilter<DataType_TP>::SignalPower(const DataType_TP* signal, size_t num_samples, double freq_hz, double sample_freq_hz)
+{
+    const double coefficient = 2.0 * std::cos(2.0 * _pi * freq_hz / sample_freq_hz);
+    double state_1 = 0.0;
+    double state_2 = 0.0;
+    for ( size_t idx = 0; idx < num_samples; ++idx ) {
+        const double state = static_cast<double>(signal[idx]) + coefficient * state_1 - state_2;
+        state_2 = state_1;
+        state_1 = state;
+    }
+    return state_1 * state_1 + state_2 * state_2 - coefficient * state_1 * state_2;
+}
+
+template<typename DataType_TP>
+inline
+double
+PowerlineNotchStateFilter<DataType_TP>::EstimateMainsFrequency(const DataType_TP* signal, size_t num_samples, double sample_freq_hz)
+{
+    // 60 Hz needs a sample frequency above 120 Hz
+    if ( sample_freq_hz <= 120.0 ) {
+        return 50.0;
+    }
+    return SignalPower(signal, num_samples, 60.0, sample_freq_hz) > SignalPower(signal, num_samples, 50.0, sample_freq_hz) ? 60.0 : 50.0;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: PolyphaseDecimator
+//
+//! Lowpass filters the signal and keeps every decimation_factor-th sample.
+//! The taps are split into decimation_factor phases, so only the kept output samples are calculated:
+//! the filter costs num_taps / decimation_factor multiplications per input sample.
+//!
+//! The output sample k is calculated when the input sample k * decimation_factor was added.
+template<typename DataType_TP>
+class PolyphaseDecimator {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param taps lowpass filter taps, designed for the input sample frequency
+    PolyphaseDecimator(unsigned int decimation_factor, const std::vector<double>& taps);
+
+    // Public functions
+public:
+    //! Adds one input sample. Returns true, if output contains a new output sample
+    bool Apply(const DataType_TP& sample, DataType_TP& output);
+
+    //! Block version of Apply(): decimates block_size input samples into dst.
+    //! dst needs space for block_size / decimation_factor + 1 samples.
+    //!
+    //! \param first_output_idx is set to the index of the input sample (inside src), at which the first output sample was calculated
+    //! \returns the number of output samples
+    size_t Apply(const DataType_TP* src, size_t block_size, DataType_TP* dst, size_t& first_output_idx);
+
+    void ResetState();
+
+    //! Returns the delay of the lowpass in input samples
+    unsigned int GetFilterDelay();
+
+    unsigned int GetDecimationFactor();
+
+    // Private functions
+private:
+    DataType_TP CalculateOutput();
+
+    // Private variables
+private:
+    unsigned int _decimation_factor = 1;
+
+    //! Number of taps per phase
+    unsigned int _phase_length = 0;
+
+    unsigned int _delay_samples = 0;
+
+    //! Taps of phase p: _phase_taps[p * _phase_length + idx] = taps[idx * _decimation_factor + p]
+    std::vector<DataType_TP> _phase_taps;
+
+    //! Delay line of each phase, stored twice in a row, so the newest _phase_length samples
+    //! of phase p are located at [p * 2 * _phase_length + _write_idx, + _phase_length)
+    std::vector<DataType_TP> _phase_delay_lines;
+
+    //! Position of the newest sample inside the delay lines
+    unsigned int _write_idx = 0;
+
+    //! Index of the next input sample modulo _decimation_factor
+    unsigned int _input_phase = 0;
+};
+
+template<typename DataType_TP>
+PolyphaseDecimator<DataType_TP>::PolyphaseDecimator(unsigned int decimation_factor, const std::vector<double>& taps)
+{
+    _decimation_factor = decimation_factor > 0 ? decimation_factor : 1;
+    _phase_length = (taps.size() + _decimation_factor - 1) / _decimation_factor;
+    _delay_samples = taps.empty() ? 0 : (taps.size() - 1) / 2;
+
+    _phase_taps.resize(_decimation_factor * _phase_length);
+    for ( size_t tap_idx = 0; tap_idx < taps.size(); ++tap_idx ) {
+        const size_t phase = tap_idx % _decimation_factor;
+        _phase_taps[phase * _phase_length + tap_idx / _decimation_factor] = static_cast<DataType_TP>(taps[tap_idx]);
+    }
+    _phase_delay_lines.resize(_decimation_factor * 2 * _phase_length);
+}
+
+template<typename DataType_TP>
+inline
+bool
+PolyphaseDecimator<DataType_TP>::Apply(const DataType_TP& sample, DataType_TP& output)
+{
+    // The input sample n belongs to phase (-n) mod _decimation_factor
+    const unsigned int phase = _input_phase == 0 ? 0 : _decimation_factor - _input_phase;
+    DataType_TP* delay_line = _phase_delay_lines.data() + phase * 2 * _phase_length;
+    delay_line[_write_idx] = sample;
+    delay_line[_write_idx + _phase_length] = sample;
+
+    bool has_output = false;
+    if ( _input_phase == 0 ) {
+        output = CalculateOutput();
+        has_output = true;
+        // the next samples of all phases belong to the next output
+        _write_idx = _write_idx == 0 ? _phase_length - 1 : _write_idx - 1;
+    }
+    _input_phase = _input_phase + 1 == _decimation_factor ? 0 : _input_phase + 1;
+    return has_output;
+}
+
+template<typename DataType_TP>
+inline
+size_t
+PolyphaseDecimator<DataType_TP>::Apply(const DataType_TP* src, size_t block_size, DataType_TP* dst, size_t& first_output_idx)
+{
+    first_output_idx = _input_phase == 0 ? 0 : _decimation_factor - _input_phase;
+    size_t num_outputs = 0;
+    for ( size_t idx = 0; idx < block_size; ++idx ) {
+        if ( Apply(src[idx], dst[num_outputs]) ) {
+            ++num_outputs;
+        }
+    }
+    return num_outputs;
+}
+
+template<typename DataType_TP>
+inline
+DataType_TP
+PolyphaseDecimator<DataType_TP>::CalculateOutput()
+{
+    DataType_TP result = 0;
+    for ( unsigned int phase = 0; phase < _decimation_factor; ++phase ) {
+        const DataType_TP* taps = _phase_taps.data() + phase * _phase_length;
+        const DataType_TP* history = _phase_delay_lines.data() + phase * 2 * _phase_length + _write_idx;
+        for ( unsigned int idx = 0; idx < _phase_length; ++idx ) {
+            result += taps[idx] * history[idx];
+        }
+    }
+    return result;
+}
+
+template<typename DataType_TP>
+inline
+void
+PolyphaseDecimator<DataType_TP>::ResetState()
+{
+    std::fill(_phase_delay_lines.begin(), _phase_delay_lines.end(), DataType_TP(0));
+    _write_idx = 0;
+    _input_phase = 0;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+PolyphaseDecimator<DataType_TP>::GetFilterDelay()
+{
+    return _delay_samples;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+PolyphaseDecimator<DataType_TP>::GetDecimationFactor()
+{
+    return _decimation_factor;
+}
+
+///////////////////////////////////////////////////////
+//
+// Class: FilterPipeline
+//
+//! Composes state filters at compile time into one fused loop.
+//!
+//! Each stage provides Process(input) -> output and ResetState(). The output of a stage is passed as value
+//! to the next stage, so the intermediate results stay in registers: only the output of the last stage is stored.
+//! Compared to applying each filter to the whole block one after another,
+//! the block is read and written once instead of once per stage.
+//!
+//! Usage:
+//! FilterPipeline<DerivationStateFilter<double>, SquaringStateFilter<double>> pipeline;
+//! double output = pipeline.Process(sample);
+//! pipeline.Apply(dst, src, block_size);
+template<typename... Stages_TP>
+class FilterPipeline {
+
+    // Construction / Destruction / Copying
+public:
+    FilterPipeline() = default;
+
+    FilterPipeline(Stages_TP... stages);
+
+    // Public functions
+public:
+    //! Passes one sample through all stages and returns the output of the last stage
+    template<typename Input_TP>
+    auto Process(const Input_TP input);
+
+    //! Block version of Process(): filters block_size samples of src into dst (src and dst may be the same).
+    //! The states are kept between consecutive blocks, so the output is identical to calling Process() for each sample
+    template<typename Input_TP, typename Output_TP>
+    void Apply(Output_TP* dst, const Input_TP* src, size_t block_size);
+
+    //! Resets the state of all stages
+    void ResetState();
+
+    //! Returns the stage with the index StageIdx_TP
+    template<size_t StageIdx_TP>
+    auto& GetStage();
+
+    // Private functions
+private:
+    template<size_t StageIdx_TP, typename Value_TP>
+    auto ProcessStages(const Value_TP value);
+
+    // Private variables
+private:
+    std::tuple<Stages_TP...> _stages;
+};
+
+template<typename... Stages_TP>
+FilterPipeline<Stages_TP...>::FilterPipeline(Stages_TP... stages)
+    : _stages(std::move(stages)...)
+{
+}
+
+template<typename... Stages_TP>
+template<size_t StageIdx_TP, typename Value_TP>
+inline
+auto
+FilterPipeline<Stages_TP...>::ProcessStages(const Value_TP value)
+{
+    if constexpr ( StageIdx_TP == sizeof...(Stages_TP) ) {
+        return value;
+    } else {
+        return ProcessStages<StageIdx_TP + 1>(std::get<StageIdx_TP>(_stages).Process(value));
+    }
+}
+
+template<typename... Stages_TP>
+template<typename Input_TP>
+inline
+auto
+FilterPipeline<Stages_TP...>::Process(const Input_TP input)
+{
+    return ProcessStages<0>(input);
+}
+
+template<typename... Stages_TP>
+template<typename Input_TP, typename Output_TP>
+inline
+void
+FilterPipeline<Stages_TP...>::Apply(Output_TP* dst, const Input_TP* src, size_t block_size)
+{
+    for ( size_t idx = 0; idx < block_size; ++idx ) {
+        dst[idx] = ProcessStages<0>(src[idx]);
+    }
+}
+
+template<typename... Stages_TP>
+inline
+void
+FilterPipeline<Stages_TP...>::ResetState()
+{
+    std::apply([](auto&... stages) { (stages.ResetState(), ...); }, _stages);
+}
+
+template<typename... Stages_TP>
+template<size_t StageIdx_TP>
+inline
+auto&
+FilterPipeline<Stages_TP...>::GetStage()
+{
+    return std::get<StageIdx_TP>(_stages);
 }
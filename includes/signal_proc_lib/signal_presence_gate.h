@@ -0,0 +1,345 @@
+#pragma once
+
+// STL includes
+#include <functional>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+//! State of a channel, which is monitored by a SignalPresenceGate
+enum class SignalPresence_TP {
+    //! The channel carries a signal: the downstream processing runs
+    Present,
+    //! Disconnected lead: (almost) constant signal
+    Flatline,
+    //! The samples are at the limits of the ADC
+    Saturated,
+    //! Open lead input: noise far above the amplitude of an ecg
+    Noisy
+};
+
+//! Parameters of a SignalPresenceGate. The amplitudes are in the units of the signal (mV for the loaded records)
+struct SignalPresenceParams_TP {
+    //! Length of the windows, for which the signal statistics are evaluated
+    double _window_ms = 250.0;
+    //! Windows with a standard deviation up to this value are flat
+    double _flatline_max_std = 0.005;
+    //! Windows with a larger standard deviation are noisy
+    double _noisy_min_std = 5.0;
+    //! Samples with an absolute value of at least this limit are saturated (e.g. the full scale of the ADC in mV).
+    //! Infinity disables the saturation check
+    double _saturation_limit = std::numeric_limits<double>::infinity();
+    //! Windows with a larger fraction of saturated samples are saturated
+    double _max_saturated_fraction = 0.25;
+    //! The channel is suspended after this duration of consecutive flat, saturated or noisy windows
+    double _suspend_after_ms = 2000.0;
+    //! A suspended channel is resumed after this duration of consecutive valid windows
+    double _resume_after_ms = 1000.0;
+};
+
+//! Gating statistics of one channel (see SignalPresenceGate::GetStatistics())
+struct SignalGateStatistics_TP {
+    SignalPresence_TP _state = SignalPresence_TP::Present;
+    //! Number of samples passed to the gate
+    size_t _num_samples = 0;
+    //! Number of samples, for which the downstream processing was suspended
+    size_t _num_gated_samples = 0;
+    unsigned int _num_suspensions = 0;
+    unsigned int _num_resumptions = 0;
+    //! Standard deviation and fraction of saturated samples of the last complete window
+    double _last_window_std = 0.0;
+    double _last_window_saturated_fraction = 0.0;
+};
+
+///////////////////////////////////////////////////////
+//
+// Class: SignalPresenceGate
+//
+//! Streaming lead-off detection of one channel. Suspends the downstream processing (detector, display) of channels,
+//! which are disconnected, flat, saturated or only carry noise, and resumes it when the signal is back.
+//!
+//! The standard deviation, the minimum, the maximum and the number of saturated samples are accumulated for windows of
+//! GetWindowLength() samples (one pass without branches, vectorized by the compiler), so the gate costs
+//! a fraction of the filter chain of a detector. Each complete window is classified as valid, flat, saturated or noisy.
+//! With hysteresis, the channel is suspended after _suspend_after_ms of invalid windows and resumed after
+//! _resume_after_ms of valid windows: short flat segments of an ecg (e.g. long pauses) do not suspend a channel.
+//!
+//! The state changes only at the end of a window, so the state returned by Apply() applies to the complete block,
+//! if the blocks contain GetWindowLength() samples and start at a window boundary.
+//! On a resumption the consumer resets the state of its filters and detectors (see Connect()): the samples before the
+//! suspension do not belong to the signal after the reconnection.
+//!
+//! Usage:
+//! SignalPresenceGate<double> gate(360.0);
+//! gate.Connect([&](SignalPresence_TP state) { if ( state == SignalPresence_TP::Present ) { detector.Reset(360.0, 2); } });
+//! if ( gate.Apply(window.data(), window.size()) ) { detector.AppendBlock(window, t0_sec); }
+template<typename DataType_TP>
+class SignalPresenceGate {
+
+    // Construction / Destruction / Copying
+public:
+    SignalPresenceGate(double sample_freq_hz, const SignalPresenceParams_TP& params = SignalPresenceParams_TP());
+
+    // Public functions
+public:
+    //! Adds one sample
+    //!
+    //! \returns true, if the downstream processing of the sample should run
+    bool Process(const DataType_TP sample);
+
+    //! Adds consecutive samples
+    //!
+    //! \returns true, if the downstream processing of the block should run (the state after the last sample)
+    bool Apply(const DataType_TP* samples, size_t num_samples);
+
+    bool IsPresent() const;
+
+    SignalPresence_TP GetState() const;
+
+    SignalGateStatistics_TP GetStatistics() const;
+
+    //! Returns the number of samples of a window
+    unsigned int GetWindowLength() const;
+
+    //! Stores the callback, which is called when the state changes
+    void Connect(std::function<void(SignalPresence_TP)> callback);
+
+    //! Starts with a present channel and clears the statistics
+    void Reset();
+
+    // Private functions
+private:
+    //! Accumulates samples of the current window (the window is not completed by them)
+    void AccumulateWindow(const DataType_TP* samples, size_t num_samples);
+
+    //! Classifies the complete window and updates the state
+    void EvaluateWindow();
+
+    void SetState(SignalPresence_TP state);
+
+    // Private variables
+private:
+    SignalPresenceParams_TP _params;
+
+    unsigned int _window_length_samples = 1;
+
+    unsigned int _suspend_after_windows = 1;
+
+    unsigned int _resume_after_windows = 1;
+
+    // Statistics of the current window, relative to its first sample (_window_offset), for a precise variance
+    double _window_offset = 0.0;
+
+    double _window_sum = 0.0;
+
+    double _window_square_sum = 0.0;
+
+    double _window_min = 0.0;
+
+    double _window_max = 0.0;
+
+    size_t _window_num_saturated = 0;
+
+    unsigned int _window_fill = 0;
+
+    //! Number of consecutive invalid windows (while present) or valid windows (while suspended)
+    unsigned int _num_consecutive_windows = 0;
+
+    SignalGateStatistics_TP _statistics;
+
+    std::function<void(SignalPresence_TP)> _state_callback;
+};
+
+template<typename DataType_TP>
+SignalPresenceGate<DataType_TP>::SignalPresenceGate(double sample_freq_hz, const SignalPresenceParams_TP& params)
+    : _params(params)
+{
+    _window_length_samples = std::max(1u, static_cast<unsigned int>(std::lround(_params._window_ms / 1000.0 * sample_freq_hz)));
+    const double window_duration_ms = 1000.0 * _window_length_samples / sample_freq_hz;
+    _suspend_after_windows = std::max(1u, static_cast<unsigned int>(std::ceil(_params._suspend_after_ms / window_duration_ms - 1e-9)));
+    _resume_after_windows = std::max(1u, static_cast<unsigned int>(std::ceil(_params._resume_after_ms / window_duration_ms - 1e-9)));
+    Reset();
+}
+
+template<typename DataType_TP>
+inline
+bool
+SignalPresenceGate<DataType_TP>::Process(const DataType_TP sample)
+{
+    return Apply(&sample, 1);
+}
+
+template<typename DataType_TP>
+inline
+bool
+SignalPresenceGate<DataType_TP>::Apply(const DataType_TP* samples, size_t num_samples)
+{
+    _statistics._num_samples += num_samples;
+    size_t idx = 0;
+    while ( idx < num_samples ) {
+        const size_t chunk_size = std::min(num_samples - idx, static_cast<size_t>(_window_length_samples - _window_fill));
+        if ( !IsPresent() ) {
+            _statistics._num_gated_samples += chunk_size;
+        }
+        AccumulateWindow(samples + idx, chunk_size);
+        idx += chunk_size;
+        if ( _window_fill == _window_length_samples ) {
+            EvaluateWindow();
+        }
+    }
+    return IsPresent();
+}
+
+template<typename DataType_TP>
+inline
+void
+SignalPresenceGate<DataType_TP>::AccumulateWindow(const DataType_TP* samples, size_t num_samples)
+{
+    if ( num_samples == 0 ) {
+        return;
+    }
+    if ( _window_fill == 0 ) {
+        _window_offset = static_cast<double>(samples[0]);
+        _window_min = _window_offset;
+        _window_max = _window_offset;
+    }
+    // local accumulators, so the loop has no dependency through memory
+    const double offset = _window_offset;
+    const double saturation_limit = _params._saturation_limit;
+    double sum = 0.0;
+    double square_sum = 0.0;
+    double min_value = _window_min;
+    double max_value = _window_max;
+    size_t num_saturated = 0;
+    for ( size_t idx = 0; idx < num_samples; ++idx ) {
+        const double value = static_cast<double>(samples[idx]);
+        const double centered_value = value - offset;
+        sum += centered_value;
+        square_sum += centered_value * centered_value;
+        min_value = std::min(min_value, value);
+        max_value = std::max(max_value, value);
+        num_saturated += std::abs(value) >= saturation_limit;
+    }
+    _window_sum += sum;
+    _window_square_sum += square_sum;
+    _window_min = min_value;
+    _window_max = max_value;
+    _window_num_saturated += num_saturated;
+    _window_fill += static_cast<unsigned int>(num_samples);
+}
+
+template<typename DataType_TP>
+inline
+void
+SignalPresenceGate<DataType_TP>::EvaluateWindow()
+{
+    const double num_samples = _window_fill;
+    const double mean = _window_sum / num_samples;
+    const double variance = std::max(0.0, _window_square_sum / num_samples - mean * mean);
+    const double window_std = std::sqrt(variance);
+    const double saturated_fraction = _window_num_saturated / num_samples;
+    _statistics._last_window_std = window_std;
+    _statistics._last_window_saturated_fraction = saturated_fraction;
+
+    // a saturated channel is flat as well: saturation first
+    SignalPresence_TP window_state = SignalPresence_TP::Present;
+    if ( saturated_fraction > _params._max_saturated_fraction ) {
+        window_state = SignalPresence_TP::Saturated;
+    } else if ( window_std <= _params._flatline_max_std || _window_max == _window_min ) {
+        window_state = SignalPresence_TP::Flatline;
+    } else if ( window_std >= _params._noisy_min_std ) {
+        window_state = SignalPresence_TP::Noisy;
+    }
+
+    const bool is_window_valid = window_state == SignalPresence_TP::Present;
+    if ( IsPresent() ) {
+        _num_consecutive_windows = is_window_valid ? 0 : _num_consecutive_windows + 1;
+        if ( _num_consecutive_windows >= _suspend_after_windows ) {
+            _num_consecutive_windows = 0;
+            ++_statistics._num_suspensions;
+            SetState(window_state);
+        }
+    } else {
+        _num_consecutive_windows = is_window_valid ? _num_consecutive_windows + 1 : 0;
+        if ( _num_consecutive_windows >= _resume_after_windows ) {
+            _num_consecutive_windows = 0;
+            ++_statistics._num_resumptions;
+            SetState(SignalPresence_TP::Present);
+        } else if ( !is_window_valid ) {
+            // still suspended, with the reason of the last window
+            SetState(window_state);
+        }
+    }
+
+    _window_sum = 0.0;
+    _window_square_sum = 0.0;
+    _window_num_saturated = 0;
+    _window_fill = 0;
+}
+
+template<typename DataType_TP>
+inline
+void
+SignalPresenceGate<DataType_TP>::SetState(SignalPresence_TP state)
+{
+    if ( state == _statistics._state ) {
+        return;
+    }
+    _statistics._state = state;
+    if ( _state_callback ) {
+        _state_callback(state);
+    }
+}
+
+template<typename DataType_TP>
+inline
+bool
+SignalPresenceGate<DataType_TP>::IsPresent() const
+{
+    return _statistics._state == SignalPresence_TP::Present;
+}
+
+template<typename DataType_TP>
+inline
+SignalPresence_TP
+SignalPresenceGate<DataType_TP>::GetState() const
+{
+    return _statistics._state;
+}
+
+template<typename DataType_TP>
+inline
+SignalGateStatistics_TP
+SignalPresenceGate<DataType_TP>::GetStatistics() const
+{
+    return _statistics;
+}
+
+template<typename DataType_TP>
+inline
+unsigned int
+SignalPresenceGate<DataType_TP>::GetWindowLength() const
+{
+    return _window_length_samples;
+}
+
+template<typename DataType_TP>
+inline
+void
+SignalPresenceGate<DataType_TP>::Connect(std::function<void(SignalPresence_TP)> callback)
+{
+    _state_callback = std::move(callback);
+}
+
+template<typename DataType_TP>
+inline
+void
+SignalPresenceGate<DataType_TP>::Reset()
+{
+    _window_sum = 0.0;
+    _window_square_sum = 0.0;
+    _window_num_saturated = 0;
+    _window_fill = 0;
+    _num_consecutive_windows = 0;
+    _statistics = SignalGateStatistics_TP();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+// STL includes
+#include <cstddef>
+
+//! Non-owning view of contiguous elements (pointer and length), like std::span of C++20.
+//! Part of the signal_proc_lib, so the library does not depend on the visualization (Qt)
+template<typename T>
+class span {
+    T* ptr_;
+    std::size_t len_;
+
+public:
+    span(T* ptr, std::size_t len) noexcept
+        : ptr_{ ptr }, len_{ len }
+    {}
+
+    span() noexcept
+        : ptr_{ nullptr}, len_{0}
+    {}
+
+    T& operator[](int i) noexcept {
+        return ptr_[i];
+    }
+
+    T const& operator[](int i) const noexcept {
+        return ptr_[i];
+    }
+
+    std::size_t size() const noexcept {
+        return len_;
+    }
+
+    T* data() const noexcept {
+        return ptr_;
+    }
+
+    T* begin() noexcept {
+        return ptr_;
+    }
+
+    T* end() noexcept {
+        return ptr_ + len_;
+    }
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+// STL includes
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+//! Lock-free queue for exactly one producer thread and one consumer thread.
+//!
+//! The producer never blocks: TryPush() returns false, when the queue is full.
+//! The consumer drains the queue in batches with PopBatch().
+//! The head and tail indices are located on different cache lines, so producer and consumer
+//! do not invalidate each others cache line on every push / pop.
+//!
+//! Usage:
+//! SPSCQueue_TC<BeatEvent_TP> queue(1024);
+//! // producer thread
+//! queue.TryPush(event);
+//! // consumer thread
+//! BeatEvent_TP events[64];
+//! size_t num_events = queue.PopBatch(events, 64);
+template<typename T>
+class SPSCQueue_TC {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param capacity minimal number of elements the queue can store. It is rounded up to the next power of two
+    SPSCQueue_TC(size_t capacity);
+
+    SPSCQueue_TC(const SPSCQueue_TC&) = delete;
+
+    SPSCQueue_TC& operator=(const SPSCQueue_TC&) = delete;
+
+    // Public functions
+public:
+    //! Producer: adds the element. Returns false and drops the element, if the queue is full
+    bool TryPush(const T& element);
+
+    //! Consumer: removes the oldest element. Returns false, if the queue is empty
+    bool TryPop(T& element);
+
+    //! Consumer: removes up to max_elements of the oldest elements and copies them to dst
+    //!
+    //! \returns the number of removed elements
+    size_t PopBatch(T* dst, size_t max_elements);
+
+    //! Returns the number of elements inside the queue.
+    //! The value is only exact, when neither producer nor consumer are running
+    size_t Size() const;
+
+    size_t Capacity() const;
+
+    // Private variables
+private:
+    static constexpr size_t _cache_line_size = 64;
+
+    //! Power of two, so the indices can be wrapped with a mask
+    size_t _capacity = 0;
+
+    size_t _index_mask = 0;
+
+    std::vector<T> _elements;
+
+    //! Index of the next element to pop (written by the consumer)
+    alignas(_cache_line_size) std::atomic<size_t> _head_idx = 0;
+
+    //! Index of the next element to push (written by the producer)
+    alignas(_cache_line_size) std::atomic<size_t> _tail_idx = 0;
+};
+
+template<typename T>
+SPSCQueue_TC<T>::SPSCQueue_TC(size_t capacity)
+{
+    _capacity = 1;
+    while ( _capacity < capacity ) {
+        _capacity <<= 1;
+    }
+    _index_mask = _capacity - 1;
+    _elements.resize(_capacity);
+}
+
+template<typename T>
+inline
+bool
+SPSCQueue_TC<T>::TryPush(const T& element)
+{
+    // The indices increase monotonically and are wrapped on access
+    const size_t tail_idx = _tail_idx.load(std::memory_order_relaxed);
+    if ( tail_idx - _head_idx.load(std::memory_order_acquire) == _capacity ) {
+        return false;
+    }
+    _elements[tail_idx & _index_mask] = element;
+    _tail_idx.store(tail_idx + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+inline
+bool
+SPSCQueue_TC<T>::TryPop(T& element)
+{
+    return PopBatch(&element, 1) == 1;
+}
+
+template<typename T>
+inline
+size_t
+SPSCQueue_TC<T>::PopBatch(T* dst, size_t max_elements)
+{
+    const size_t head_idx = _head_idx.load(std::memory_order_relaxed);
+    const size_t available = _tail_idx.load(std::memory_order_acquire) - head_idx;
+    const size_t num_elements = available < max_elements ? available : max_elements;
+    for ( size_t idx = 0; idx < num_elements; ++idx ) {
+        dst[idx] = _elements[(head_idx + idx) & _index_mask];
+    }
+    _head_idx.store(head_idx + num_elements, std::memory_order_release);
+    return num_elements;
+}
+
+template<typename T>
+inline
+size_t
+SPSCQueue_TC<T>::Size() const
+{
+    return _tail_idx.load(std::memory_order_acquire) - _head_idx.load(std::memory_order_acquire);
+}
+
+template<typename T>
+inline
+size_t
+SPSCQueue_TC<T>::Capacity() const
+{
+    return _capacity;
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+// Project includes
+#include "thread_pool.h"
+
+// STL includes
+#include <vector>
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <thread>
+
+///////////////////////////////////////////////////////
+//
+// Class: TextColumnParser_C
+//
+//! Parses text rows of values into columns (one row per line; the values are separated by spaces, tabs, ',' or ';'),
+//! e.g. the body of a G11 export.
+//!
+//! The text (e.g. a mapped file, see MappedFile_C) is split into chunks at line ends, which are processed in parallel
+//! (see ThreadPool_C): each chunk counts its lines, so the first row of each chunk is known, the columns are allocated
+//! once with the number of rows, then each chunk parses its lines with std::from_chars directly into its rows.
+//! Rows of empty lines are removed afterwards.
+//!
+//! Usage:
+//! TextColumnParser_C<double> parser;
+//! std::vector<std::vector<double>> columns;
+//! bool success = parser.Parse(file.GetData(), file.GetData() + file.GetSize(), 3, 1, columns);
+template<typename DataType_TP>
+class TextColumnParser_C {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param num_threads number of threads. If zero, the number of hardware threads is used
+    TextColumnParser_C(unsigned int num_threads = 0);
+
+    // Public functions
+public:
+    //! Parses the rows of [begin, end), which have num_columns values each.
+    //! Only the columns from first_column on are stored (e.g. 1 skips an enumeration of the rows):
+    //! columns[column_idx - first_column] receives the values of the column
+    //!
+    //! \returns false, if a row has too few values or a value is no number (the columns are empty)
+    bool Parse(const char* begin,
+               const char* end,
+               size_t num_columns,
+               size_t first_column,
+               std::vector<std::vector<DataType_TP>>& columns);
+
+    //! Parses the line at pos into values (up to num_columns values; further values are ignored)
+    //! and moves pos to the start of the next line
+    //!
+    //! \returns false, if a value is no number
+    static bool ParseRow(const char*& pos, const char* end, size_t num_columns, DataType_TP* values, size_t& num_values);
+
+    //! Parses the value at pos. Returns the position after the value; pos, if there is no number at pos
+    static const char* ParseValue(const char* pos, const char* end, DataType_TP& value);
+
+    //! Returns the position after the end of the line at pos (end for the last line)
+    static const char* FindNextLine(const char* pos, const char* end);
+
+    // Private types
+private:
+    struct Chunk_TP {
+        const char* _begin = nullptr;
+        const char* _end = nullptr;
+        //! Number of lines, including empty lines
+        size_t _num_lines = 0;
+        //! Row of the first line inside the columns
+        size_t _first_row = 0;
+        //! Number of parsed rows (without empty lines)
+        size_t _num_rows = 0;
+        bool _is_valid = true;
+    };
+
+    // Private functions
+private:
+    //! Parses the lines of the chunk into the rows from _first_row on
+    static void ParseChunk(Chunk_TP& chunk,
+                           size_t num_columns,
+                           size_t first_column,
+                           std::vector<std::vector<DataType_TP>>& columns);
+
+    // Private variables
+private:
+    //! Minimal size of a chunk in bytes (smaller texts are not split)
+    static constexpr size_t _min_chunk_size = 1 << 20;
+
+    unsigned int _num_threads = 1;
+};
+
+template<typename DataType_TP>
+TextColumnParser_C<DataType_TP>::TextColumnParser_C(unsigned int num_threads)
+    : _num_threads(num_threads > 0 ? num_threads : std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+template<typename DataType_TP>
+inline
+const char*
+TextColumnParser_C<DataType_TP>::FindNextLine(const char* pos, const char* end)
+{
+    const void* line_end = std::memchr(pos, '\n', end - pos);
+    return line_end != nullptr ? static_cast<const char*>(line_end) + 1 : end;
+}
+
+template<typename DataType_TP>
+inline
+const char*
+TextColumnParser_C<DataType_TP>::ParseValue(const char* pos, const char* end, DataType_TP& value)
+{
+    // std::from_chars does not accept a leading plus
+    const char* number_begin = (pos < end && *pos == '+') ? pos + 1 : pos;
+    if constexpr ( std::is_floating_point_v<DataType_TP> ) {
+        const auto result = std::from_chars(number_begin, end, value);
+        return result.ec == std::errc() ? result.ptr : pos;
+    } else {
+        // like istream >> value, the integer types accept decimal numbers
+        double decimal_value = 0.0;
+        const auto result = std::from_chars(number_begin, end, decimal_value);
+        value = static_cast<DataType_TP>(decimal_value);
+        return result.ec == std::errc() ? result.ptr : pos;
+    }
+}
+
+template<typename DataType_TP>
+inline
+bool
+TextColumnParser_C<DataType_TP>::ParseRow(const char*& pos, const char* end, size_t num_columns, DataType_TP* values, size_t& num_values)
+{
+    num_values = 0;
+    while ( pos < end ) {
+        const char character = *pos;
+        if ( character == '\n' ) {
+            ++pos;
+            return true;
+        }
+        if ( character == ' ' || character == '\t' || character == '\r' || character == ',' || character == ';' ) {
+            ++pos;
+            continue;
+        }
+        if ( num_values == num_columns ) {
+            pos = FindNextLine(pos, end);
+            return true;
+        }
+        const char* value_end = ParseValue(pos, end, values[num_values]);
+        if ( value_end == pos ) {
+            pos = FindNextLine(pos, end);
+            return false;
+        }
+        pos = value_end;
+        ++num_values;
+    }
+    return true;
+}
+
+template<typename DataType_TP>
+inline
+void
+TextColumnParser_C<DataType_TP>::ParseChunk(Chunk_TP& chunk,
+                                            size_t num_columns,
+                                            size_t first_column,
+                                            std::vector<std::vector<DataType_TP>>& columns)
+{
+    std::vector<DataType_TP> values(num_columns);
+    size_t row = chunk._first_row;
+    const char* pos = chunk._begin;
+    while ( pos < chunk._end ) {
+        size_t num_values = 0;
+        if ( !ParseRow(pos, chunk._end, num_columns, values.data(), num_values) ||
+             (num_values > 0 && num_values < num_columns) )
+        {
+            chunk._is_valid = false;
+            return;
+        }
+        if ( num_values == 0 ) {
+            // empty line
+            continue;
+        }
+        for ( size_t column_idx = first_column; column_idx < num_columns; ++column_idx ) {
+            columns[column_idx - first_column][row] = values[column_idx];
+        }
+        ++row;
+    }
+    chunk._num_rows = row - chunk._first_row;
+}
+
+template<typename DataType_TP>
+inline
+bool
+TextColumnParser_C<DataType_TP>::Parse(const char* begin,
+                                       const char* end,
+                                       size_t num_columns,
+                                       size_t first_column,
+                                       std::vector<std::vector<DataType_TP>>& columns)
+{
+    columns.assign(first_column < num_columns ? num_columns - first_column : 0, {});
+    if ( begin >= end || columns.empty() ) {
+        return true;
+    }
+
+    // Split at line ends. A few chunks per thread balance the load
+    const size_t text_size = end - begin;
+    const size_t num_chunks = std::clamp<size_t>(text_size / _min_chunk_size, 1, 4 * static_cast<size_t>(_num_threads));
+    std::vector<Chunk_TP> chunks;
+    const char* chunk_begin = begin;
+    for ( size_t chunk_idx = 1; chunk_idx <= num_chunks && chunk_begin < end; ++chunk_idx ) {
+        const char* chunk_end = chunk_idx == num_chunks ? end : FindNextLine(std::max(chunk_begin, begin + text_size * chunk_idx / num_chunks), end);
+        Chunk_TP chunk;
+        chunk._begin = chunk_begin;
+        chunk._end = chunk_end;
+        chunks.push_back(chunk);
+        chunk_begin = chunk_end;
+    }
+
+    const auto for_each_chunk = [&](auto function) {
+        if ( chunks.size() == 1 || _num_threads == 1 ) {
+            std::for_each(chunks.begin(), chunks.end(), function);
+            return;
+        }
+        ThreadPool_C pool(std::min(_num_threads, static_cast<unsigned int>(chunks.size())));
+        for ( auto& chunk : chunks ) {
+            pool.AddTask([&chunk, &function]() { function(chunk); });
+        }
+        pool.WaitUntilFinished();
+    };
+
+    // 1. count the lines; the last line may have no line end
+    for_each_chunk([](Chunk_TP& chunk) {
+        chunk._num_lines = std::count(chunk._begin, chunk._end, '\n') + (chunk._end[-1] != '\n' ? 1 : 0);
+    });
+    size_t num_lines = 0;
+    for ( auto& chunk : chunks ) {
+        chunk._first_row = num_lines;
+        num_lines += chunk._num_lines;
+    }
+    for ( auto& column : columns ) {
+        column.resize(num_lines);
+    }
+
+    // 2. parse the chunks into their rows
+    for_each_chunk([&](Chunk_TP& chunk) { ParseChunk(chunk, num_columns, first_column, columns); });
+    if ( std::any_of(chunks.begin(), chunks.end(), [](const Chunk_TP& chunk) { return !chunk._is_valid; }) ) {
+        columns.assign(columns.size(), {});
+        return false;
+    }
+
+    // 3. remove the rows of empty lines
+    size_t num_rows = 0;
+    for ( const auto& chunk : chunks ) {
+        if ( chunk._first_row != num_rows ) {
+            for ( auto& column : columns ) {
+                std::copy(column.begin() + chunk._first_row, column.begin() + chunk._first_row + chunk._num_rows, column.begin() + num_rows);
+            }
+        }
+        num_rows += chunk._num_rows;
+    }
+    for ( auto& column : columns ) {
+        column.resize(num_rows);
+    }
+    return true;
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+// STL includes
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+
+//! Fixed size pool of worker threads with work stealing.
+//!
+//! Each worker owns a task queue. Tasks added by a worker (e.g. a task which splits its work into subtasks)
+//! are pushed into the queue of this worker and are executed by it in last-in-first-out order,
+//! while their data is still in its cache. Tasks added by other threads are distributed round robin.
+//! An idle worker steals the oldest task of another worker's queue, so the load stays balanced
+//! even if the tasks differ a lot in duration (e.g. records of different length).
+//!
+//! Usage:
+//! ThreadPool_C pool(4);
+//! pool.AddTask([&]() { ... pool.AddTask([&]() { ... }); });
+//! pool.WaitUntilFinished();
+class ThreadPool_C {
+
+    // Construction / Destruction / Copying
+public:
+    //! \param num_threads number of worker threads. If zero, the number of hardware threads is used
+    ThreadPool_C(unsigned int num_threads);
+
+    ThreadPool_C(const ThreadPool_C&) = delete;
+
+    ThreadPool_C& operator=(const ThreadPool_C&) = delete;
+
+    //! Finishes all queued tasks and joins the worker threads
+    ~ThreadPool_C();
+
+    // Public functions
+public:
+    //! Adds a task. If called from a worker of this pool, the task is queued at this worker;
+    //! otherwise the workers are chosen round robin. Tasks may add further tasks
+    void AddTask(std::function<void()> task);
+
+    //! Blocks until all tasks (including the tasks added by tasks) are finished.
+    //! Must not be called from a worker of this pool
+    void WaitUntilFinished();
+
+    //! Returns the number of worker threads
+    unsigned int GetThreadCount();
+
+    // Private types
+private:
+    struct WorkerQueue_TP {
+        std::deque<std::function<void()>> _tasks;
+        //! Protects _tasks
+        std::mutex _lock;
+    };
+
+    // Private functions
+private:
+    void WorkerLoop(unsigned int worker_idx);
+
+    //! Takes the newest task of the own queue or steals the oldest task of another queue
+    bool TryPopTask(unsigned int worker_idx, std::function<void()>& task);
+
+    // Private variables
+private:
+    std::vector<std::thread> _workers;
+
+    //! One queue per worker
+    std::vector<std::unique_ptr<WorkerQueue_TP>> _queues;
+
+    //! Queue of the next task, which is added from outside of the pool
+    unsigned int _next_queue_idx = 0;
+
+    //! Number of tasks inside all queues.
+    //! Incremented under _lock before the task is queued, decremented when a task is taken
+    std::atomic<size_t> _num_queued_tasks = 0;
+
+    //! Number of tasks which are queued or currently executed
+    size_t _num_pending_tasks = 0;
+
+    bool _stop_requested = false;
+
+    //! Protects _next_queue_idx, _num_pending_tasks and _stop_requested
+    std::mutex _lock;
+
+    //! Signaled when a new task was added or the pool is destroyed
+    std::condition_variable _task_available;
+
+    //! Signaled when the last pending task was finished
+    std::condition_variable _all_tasks_finished;
+
+    //! Pool and queue index of the worker running on the current thread
+    inline static thread_local ThreadPool_C* _current_pool = nullptr;
+    inline static thread_local unsigned int _current_worker_idx = 0;
+};
+
+inline
+ThreadPool_C::ThreadPool_C(unsigned int num_threads)
+{
+    if ( num_threads == 0 ) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    _queues.reserve(num_threads);
+    for ( unsigned int count = 0; count < num_threads; ++count ) {
+        _queues.push_back(std::make_unique<WorkerQueue_TP>());
+    }
+
+    _workers.reserve(num_threads);
+    for ( unsigned int count = 0; count < num_threads; ++count ) {
+        _workers.emplace_back(&ThreadPool_C::WorkerLoop, this, count);
+    }
+}
+
+inline
+ThreadPool_C::~ThreadPool_C()
+{
+    {
+        std::unique_lock<std::mutex> lck(_lock);
+        _stop_requested = true;
+    }
+    _task_available.notify_all();
+
+    for ( auto& worker : _workers ) {
+        worker.join();
+    }
+}
+
+inline
+void
+ThreadPool_C::AddTask(std::function<void()> task)
+{
+    {
+        std::unique_lock<std::mutex> lck(_lock);
+        unsigned int queue_idx = 0;
+        if ( _current_pool == this ) {
+            queue_idx = _current_worker_idx;
+        } else {
+            queue_idx = _next_queue_idx;
+            _next_queue_idx = (_next_queue_idx + 1) % _queues.size();
+        }
+        // count the task first, so the counter never drops below the number of queued tasks
+        ++_num_queued_tasks;
+        ++_num_pending_tasks;
+
+        auto& queue = *_queues[queue_idx];
+        std::unique_lock<std::mutex> queue_lck(queue._lock);
+        queue._tasks.push_back(std::move(task));
+    }
+    _task_available.notify_one();
+}
+
+inline
+void
+ThreadPool_C::WaitUntilFinished()
+{
+    std::unique_lock<std::mutex> lck(_lock);
+    _all_tasks_finished.wait(lck, [this]() { return _num_pending_tasks == 0; });
+}
+
+inline
+unsigned int
+ThreadPool_C::GetThreadCount()
+{
+    return _workers.size();
+}
+
+inline
+bool
+ThreadPool_C::TryPopTask(unsigned int worker_idx, std::function<void()>& task)
+{
+    {
+        auto& own_queue = *_queues[worker_idx];
+        std::unique_lock<std::mutex> queue_lck(own_queue._lock);
+        if ( !own_queue._tasks.empty() ) {
+            task = std::move(own_queue._tasks.back());
+            own_queue._tasks.pop_back();
+            --_num_queued_tasks;
+            return true;
+        }
+    }
+
+    for ( size_t offset = 1; offset < _queues.size(); ++offset ) {
+        auto& victim_queue = *_queues[(worker_idx + offset) % _queues.size()];
+        std::unique_lock<std::mutex> queue_lck(victim_queue._lock);
+        if ( !victim_queue._tasks.empty() ) {
+            task = std::move(victim_queue._tasks.front());
+            victim_queue._tasks.pop_front();
+            --_num_queued_tasks;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline
+void
+ThreadPool_C::WorkerLoop(unsigned int worker_idx)
+{
+    _current_pool = this;
+    _current_worker_idx = worker_idx;
+
+    while ( true ) {
+        std::function<void()> task;
+        if ( !TryPopTask(worker_idx, task) ) {
+            std::unique_lock<std::mutex> lck(_lock);
+            _task_available.wait(lck, [this]() { return _stop_requested || _num_queued_tasks > 0; });
+            // finish all queued tasks before stopping
+            if ( _stop_requested && _num_queued_tasks == 0 ) {
+                return;
+            }
+            continue;
+        }
+
+        task();
+
+        std::unique_lock<std::mutex> lck(_lock);
+        if ( --_num_pending_tasks == 0 ) {
+            _all_tasks_finished.notify_all();
+        }
+    }
+}
@@ -3,6 +3,13 @@
 // Project includes
 #include "file_io.h"
 #include "mit_file_io.h"
+#include "wfdb_native_reader.h"
+#include "compressed_record.h"
+#include "mapped_file.h"
+#include "text_column_parser.h"
+#include "polyphase_resampler.h"
+#include "record_cache.h"
+#include "span.h"
 
 // STL includes
 #include <iostream>
@@ -15,6 +22,8 @@
 #include<iterator>
 #include <streambuf>
 #include <cstddef>
+#include <memory>
+#include <filesystem>
 
 template<typename DataFormat_TP>
 struct ECGChannelInfo_TP {
@@ -35,6 +44,8 @@ struct ECGChannelInfo_TP {
         _low_hz = other._low_hz;
         _range_mV = other._range_mV;
         _scale = other._scale;
+        _gain = other._gain;
+        _adc_resolution_bits = other._adc_resolution_bits;
         _min_val = other._min_val;
         _max_val = other._max_val;
     }
@@ -80,6 +91,13 @@ public:
 
     //! scale / gain factor
     uint32_t _scale = 0;
+
+    //! ADC counts per physical unit; zero, if unknown (MIT records only).
+    //! The ADC counts of a sample are _data[idx] * _gain (without the baseline)
+    double _gain = 0.0;
+
+    //! Resolution of the ADC in bits; zero, if unknown (MIT records only)
+    unsigned int _adc_resolution_bits = 0;
     
     //! Biggest value inside the data series(in the corresponding unit)
     DataFormat_TP _max_val = 0.0;
@@ -111,15 +129,58 @@ public:
     //! load physionet database file
     //!
     //! \param filename the path to the record WITHOUT the file suffix (.dat/.hea)
-    void LoadFromMITFileFormat(const std::string filename);
+    //!
+    //! The wfdb lib keeps the path and the open record in global variables:
+    //! calls from different threads must be serialized.
+    //!
+    //! A record, which was loaded before, is opened from its cache <record>.ecgcache (see SetUseCache()).
+    //! A compressed record <record>.ecgz (see CompressedRecord_C) is read instead of the signal files, if it is up to date
+    //!
+    //! \param num_threads number of threads, which decode a compressed record. If zero, the number of hardware threads is used
+    void LoadFromMITFileFormat(const std::string filename, unsigned int num_threads = 0);
 
     // For the custom dataset I use
-    void ReadG11Data(const std::string& filename);
+    //!
+    //! \param num_threads number of threads, which parse the data. If zero, the number of hardware threads is used
+    //!
+    //! A file, which was loaded before, is opened from its cache <filename>.ecgcache (see SetUseCache())
+    void ReadG11Data(const std::string& filename, unsigned int num_threads = 0);
+
+    //! If enabled (default), a loaded record is written into a binary cache next to the record (see RecordCache_C),
+    //! and the next load of the record maps the cache instead of reading the record. The cache is written again,
+    //! if the files of the record change.
+    //!
+    //! The samples of a record, which is opened from its cache, are not copied: the channels of constData() have
+    //! no _data and no _timestamps; GetSamples() returns the samples inside the mapped cache
+    void SetUseCache(bool use_cache);
+
+    //! Returns the samples of a channel: the _data of the channel or the samples inside the mapped cache.
+    //! The samples are valid as long as this signal (or a copy of it) exists and is not loaded again
+    span<const DataType_TP> GetSamples(size_t channel_idx) const;
+
+    //! Returns true, if the samples are inside a mapped cache (see SetUseCache())
+    bool IsMapped() const;
+
+    //! Reads the header of a G11 export up to the first data row and creates its channels (without samples)
+    //!
+    //! \returns false, if the header does not contain channels
+    static bool ReadG11Header(FileIO_C& filereader, std::vector<ECGChannelInfo_TP<DataType_TP>>& channels);
+
+    //! Resamples all channels to one sample rate (see PolyphaseResampler), so they can be processed in lockstep.
+    //! The timestamps, min and max values of the resampled channels are updated
+    //!
+    //! \param target_sample_rate_hz the common sample rate; if zero, the highest sample rate of the channels
+    void AlignSampleRates(double target_sample_rate_hz = 0.0);
 
     const std::vector<ECGChannelInfo_TP<DataType_TP>>& constData() const {
         return _data;
     }
 
+    void SetData(const std::vector<ECGChannelInfo_TP<DataType_TP>>& data) {
+        _data = data;
+        _cache.reset();
+    }
+
     std::vector<std::string> GetChannelLabels();
 
     std::string GetLabel() {
@@ -135,7 +196,7 @@ public:
 
     double GetTimerangeMs() { 
         if ( !_data.empty() ) { 
-            return (_data[0]._timestamps.size() * ( 1 / _data[0]._sample_rate_hz) ) * 1000.0 ;
+            return (GetSamples(0).size() * ( 1 / _data[0]._sample_rate_hz) ) * 1000.0 ;
         } else {
             return 0.0;
         }
@@ -162,9 +223,25 @@ private:
         unsigned int num_samples,
         double sample_rate_hz);
 
+    //! Opens the cache of the record, if it is up to date with the source files, and takes its channels
+    bool OpenCache(const std::string& cache_path, const std::vector<std::string>& source_files);
+
+    //! Writes the cache of the loaded channels
+    void WriteCache(const std::string& cache_path, const std::vector<std::string>& source_files) const;
+
+    //! Returns the header and the signal files of a MIT record or, without them, the compressed record;
+    //! empty, if the record can not be cached
+    //! (e.g. multi segment records, which consist of other records)
+    static std::vector<std::string> GetMITSourceFiles(const std::string& record_dir, const std::string& record_name);
+
 private:
     std::vector<ECGChannelInfo_TP<DataType_TP>> _data;
 
+    //! Mapped cache, which holds the samples of the channels (shared by the copies of the signal)
+    std::shared_ptr<const RecordCache_C<DataType_TP>> _cache;
+
+    bool _use_cache = true;
+
     std::string _label = "";
 
     unsigned int _id = 0;
@@ -204,6 +281,8 @@ inline
 TimeSignal_C<DataType_TP>::TimeSignal_C(const TimeSignal_C<DataType_TP>& signal)
 {
     _data = signal._data;
+    _cache = signal._cache;
+    _use_cache = signal._use_cache;
     _id = signal._id;
     _label = signal._label;
 }
@@ -214,6 +293,8 @@ TimeSignal_C<DataType_TP>::TimeSignal_C(TimeSignal_C<DataType_TP>&& signal)
 {
     _data = signal._data;
     //signal._data = nullptr;
+    _cache = signal._cache;
+    _use_cache = signal._use_cache;
     _id = signal._id;
     _label = signal._label;
 }
@@ -226,12 +307,12 @@ TimeSignal_C<DataType_TP>::TimeSignal_C()
 
 template<typename DataType_TP>
 void 
-TimeSignal_C<DataType_TP>::LoadFromMITFileFormat(const std::string filename)
+TimeSignal_C<DataType_TP>::LoadFromMITFileFormat(const std::string filename, unsigned int num_threads)
 {
     MITFileIO_C<DataType_TP> reader;
     // Prepare wfdb path variable
     // Extraxt the path to the directory in which the record is located
-    auto last_bslash_pos = filename.find_last_of('/\\');
+    auto last_bslash_pos = filename.find_last_of("/\\");
     auto record_dir_path = filename.substr(0, last_bslash_pos);
 
     if ( last_bslash_pos == std::string::npos ) {
@@ -239,9 +320,9 @@ TimeSignal_C<DataType_TP>::LoadFromMITFileFormat(const std::string filename)
         return;
     }
     // Set the path of the directory in which the record is located (this is required by the wfdb lib)
-    char database_path_char[128];
-    strcpy_s(database_path_char, record_dir_path.size() + 1, record_dir_path.c_str() );
-    reader.SetWFDBPath(database_path_char);
+    // (the wfdb lib takes non-const c strings)
+    std::vector<char> database_path_char(record_dir_path.c_str(), record_dir_path.c_str() + record_dir_path.size() + 1);
+    reader.SetWFDBPath(database_path_char.data());
 
     // Now extract just the name of the record without the directory path (I should do all this stuff inside the reader itself probably?)
     auto record_name = filename.substr(last_bslash_pos + 1);
@@ -249,9 +330,22 @@ TimeSignal_C<DataType_TP>::LoadFromMITFileFormat(const std::string filename)
     if( record_name.find('.') != std::string::npos ){
         record_name = record_name.substr(0, record_name.size() - 4);
     }
-    char record_name_char[128];
-    strcpy_s(record_name_char, record_name.size() + 1, record_name.c_str());
-    auto mit_data = reader.Read(record_name_char);
+    const auto cache_path = RecordCache_C<DataType_TP>::GetCachePath(record_dir_path + "/" + record_name);
+    const auto source_files = _use_cache ? GetMITSourceFiles(record_dir_path, record_name) : std::vector<std::string>();
+    if ( !source_files.empty() && OpenCache(cache_path, source_files) ) {
+        return;
+    }
+    // Compressed records and the common storage formats are decoded from the mapped files,
+    // all other records are read by the wfdb lib
+    auto mit_data = CompressedRecord_C<DataType_TP>(num_threads).Read(record_dir_path, record_name);
+    WFDBNativeReader_C<DataType_TP> native_reader;
+    if ( mit_data.empty() ) {
+        mit_data = native_reader.Read(record_dir_path, record_name);
+    }
+    if ( mit_data.empty() ) {
+        std::vector<char> record_name_char(record_name.c_str(), record_name.c_str() + record_name.size() + 1);
+        mit_data = reader.Read(record_name_char.data());
+    }
 
     // Translate the data structure of the wfcb lib to the ECGChannelInfo_TP datastructure
     std::vector<ECGChannelInfo_TP<DataType_TP>> ecg_data;
@@ -259,14 +353,16 @@ TimeSignal_C<DataType_TP>::LoadFromMITFileFormat(const std::string filename)
     ecg_data.resize(mit_data.size());
     
     unsigned int channel_idx = 0;
-    for ( const auto& mit_channel : mit_data ) {
+    for ( auto& mit_channel : mit_data ) {
         ecg_data[channel_idx]._sample_rate_hz = mit_channel._sample_frequency_hz;
-        ecg_data[channel_idx]._data = mit_channel._data;
+        ecg_data[channel_idx]._data = std::move(mit_channel._data);
         ecg_data[channel_idx]._label = mit_channel._description;
         ecg_data[channel_idx]._id = channel_idx;
         // ecg_data[channel_idx]._scale = /* Todo */;
         // ecg_data[channel_idx]._range_mV = /* Todo */;
         ecg_data[channel_idx]._units = mit_channel._units;
+        ecg_data[channel_idx]._gain = mit_channel._gain;
+        ecg_data[channel_idx]._adc_resolution_bits = mit_channel._adc_resolution_bits;
 
         // scale y values to the real voltage range (physical units)
         std::for_each(ecg_data[channel_idx]._data.begin(),
@@ -280,21 +376,31 @@ TimeSignal_C<DataType_TP>::LoadFromMITFileFormat(const std::string filename)
         ecg_data[channel_idx]._max_val = *std::max_element(ecg_data[channel_idx]._data.begin(), ecg_data[channel_idx]._data.end());
         
 
+        // the number of read samples (the wfdb lib stops at the end of the file, even if the header specifies more samples)
         GenerateTimestamps(ecg_data[channel_idx]._timestamps,
-            mit_channel._num_samples,
+            static_cast<unsigned int>(ecg_data[channel_idx]._data.size()),
             mit_channel._sample_frequency_hz);
 
         ++channel_idx;
     }
 
     // Set data
-    _data = ecg_data;
+    _data = std::move(ecg_data);
+    _cache.reset();
+    if ( !source_files.empty() && !_data.empty() ) {
+        WriteCache(cache_path, source_files);
+    }
 }
 
 template<typename DataType_TP>
 void
-TimeSignal_C<DataType_TP>::ReadG11Data(const std::string& filename)
+TimeSignal_C<DataType_TP>::ReadG11Data(const std::string& filename, unsigned int num_threads)
 {
+    const auto cache_path = RecordCache_C<DataType_TP>::GetCachePath(filename);
+    if ( _use_cache && OpenCache(cache_path, { filename }) ) {
+        return;
+    }
+
     FileIO_C filereader;
     bool success = filereader.OpenFile(filename);
 
@@ -304,12 +410,81 @@ TimeSignal_C<DataType_TP>::ReadG11Data(const std::string& filename)
     }
     // Stores all channels + header and body data
     std::vector< ECGChannelInfo_TP<DataType_TP> > channels;
+    if ( !ReadG11Header(filereader, channels) ) {
+        std::cout << "there is no channel data inside the header" << std::endl;
+        return;
+    }
+    auto num_of_channels = static_cast<uint32_t>(channels.size());
+
+    // Process data body
+    // The body is parsed from the mapped file in parallel, directly into the channel arrays (see TextColumnParser_C)
+    const auto data_position = static_cast<size_t>(std::streamoff(filereader.GetFile()->tellg()));
+    // File reading finished
+    filereader.CloseFile();
+    MappedFile_C file;
+    if ( !file.Open(filename) || data_position > file.GetSize() ) {
+        std::cout << "could not open the file" << std::endl;
+        return;
+    }
+
+    // + 1 because the first column is just the enumeration for the values
+    // (a 'time series' with consecutive values, starting at zero (0,1,2,3,..num_of_data_rows)
+    // and it does not count as a 'channel'
+    std::vector<std::vector<DataType_TP>> channel_data;
+    TextColumnParser_C<DataType_TP> parser(num_threads);
+    const char* body = reinterpret_cast<const char*>(file.GetData());
+    if ( !parser.Parse(body + data_position, body + file.GetSize(), num_of_channels + 1, 1, channel_data) || channel_data[0].empty() ) {
+        std::cout << "could not parse the data of the file" << std::endl;
+        return;
+    }
 
+    for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+        channels[channel_idx]._data = std::move(channel_data[channel_idx]);
+    }
+
+    for( auto& ecg_channel : channels ) {
+        // scale y values to the real voltage range
+        auto max_y_val_dataset = *max_element(ecg_channel._data.begin(),
+                                              ecg_channel._data.end()); 
+        auto scale_factor = ecg_channel._range_mV / max_y_val_dataset;
+        ecg_channel._scale = scale_factor;
+        std::for_each(ecg_channel._data.begin(), 
+                      ecg_channel._data.end(), 
+            [&](auto& element)
+        {
+            element *= scale_factor;
+        });
+        
+        ecg_channel._max_val = max_y_val_dataset;
+        ecg_channel._min_val = *min_element(ecg_channel._data.begin(),
+                                 ecg_channel._data.end());
+        // Calculate x-values if there are none values inside the timestamps attribute
+        if( ecg_channel._timestamps.empty() ) {
+            GenerateTimestamps(ecg_channel._timestamps, 
+                ecg_channel._data.size(),
+                ecg_channel._sample_rate_hz);
+        }
+    }
+
+    // Set the data
+    _data = std::move(channels);
+    _cache.reset();
+    if ( _use_cache ) {
+        WriteCache(cache_path, { filename });
+    }
+}
+
+
+template<typename DataType_TP>
+bool
+TimeSignal_C<DataType_TP>::ReadG11Header(FileIO_C& filereader, std::vector<ECGChannelInfo_TP<DataType_TP>>& channels)
+{
+    channels.clear();
     // Process the header
     int current_channel_idx = 0;
     int num_of_channels = 0;
     bool header_processed = false;
-    while ( !header_processed ){
+    while ( !header_processed && filereader.GetFile()->good() ){
         auto line_str = filereader.ReadLine();
         std::string key_str;
         std::string value_str;
@@ -346,63 +521,40 @@ TimeSignal_C<DataType_TP>::ReadG11Data(const std::string& filename)
             }
         }
     }
+    return header_processed && !channels.empty();
+}
 
-    if ( channels.empty() ) {
-        std::cout << "there is no channel data inside the header" << std::endl;
-        return;
-    }
-
-    // Process data body
-    // Count lines from end of the header to the end of the file (data-body)
-    // We do this so its easy to read the data matrix with a specific format 
-    // (e.g like matlab fscanf function)
-    auto num_of_data_rows = filereader.CountLines<char>();
-
-    // + 1 because the first column is just the enumeration for the values
-    // (they also need memory) and it does not count as a 'channel'
-    auto channel_data = filereader.ReadColumnData<DataType_TP>(num_of_channels + 1, num_of_data_rows);
-    // File reading finished
-    filereader.CloseFile();
-
-    // start at channel_idx = 1 because the first channel, 
-    // at position zero inside the vector,
-    // is just the enumeration for the sample values 
-    // (a 'time series' with consecutive values, starting at zero (0,1,2,3,..num_of_data_rows)
-    int channel_idx = 1;
-    for ( auto& channel : channels ) {
-        channel.SetData(channel_data[channel_idx]);
-        ++channel_idx;
+template<typename DataType_TP>
+void
+TimeSignal_C<DataType_TP>::AlignSampleRates(double target_sample_rate_hz)
+{
+    if ( target_sample_rate_hz <= 0.0 ) {
+        for ( const auto& channel : _data ) {
+            target_sample_rate_hz = std::max(target_sample_rate_hz, channel._sample_rate_hz);
+        }
     }
 
-    for( auto& ecg_channel : channels ) {
-        // scale y values to the real voltage range
-        auto max_y_val_dataset = *max_element(ecg_channel._data.begin(),
-                                              ecg_channel._data.end()); 
-        auto scale_factor = ecg_channel._range_mV / max_y_val_dataset;
-        ecg_channel._scale = scale_factor;
-        std::for_each(ecg_channel._data.begin(), 
-                      ecg_channel._data.end(), 
-            [&](auto& element)
-        {
-            element *= scale_factor;
-        });
-        
-        ecg_channel._max_val = max_y_val_dataset;
-        ecg_channel._min_val = *min_element(ecg_channel._data.begin(),
-                                 ecg_channel._data.end());
-        // Calculate x-values if there are none values inside the timestamps attribute
-        if( ecg_channel._timestamps.empty() ) {
-            GenerateTimestamps(ecg_channel._timestamps, 
-                ecg_channel._data.size(),
-                ecg_channel._sample_rate_hz);
+    for ( size_t channel_idx = 0; channel_idx < _data.size(); ++channel_idx ) {
+        auto& channel = _data[channel_idx];
+        const auto samples = GetSamples(channel_idx);
+        if ( samples.size() == 0 || channel._sample_rate_hz <= 0.0 || channel._sample_rate_hz == target_sample_rate_hz ) {
+            continue;
         }
+        PolyphaseResampler<DataType_TP> resampler(channel._sample_rate_hz, target_sample_rate_hz);
+        std::vector<DataType_TP> resampled(resampler.GetMaxOutputCount(samples.size() + resampler.GetFilterDelay()));
+        size_t num_outputs = resampler.Apply(samples.data(), samples.size(), resampled.data());
+        num_outputs += resampler.Flush(resampled.data() + num_outputs);
+        resampled.resize(num_outputs);
+
+        channel._data = std::move(resampled);
+        channel._sample_rate_hz = target_sample_rate_hz;
+        channel._min_val = *std::min_element(channel._data.begin(), channel._data.end());
+        channel._max_val = *std::max_element(channel._data.begin(), channel._data.end());
+        channel._timestamps.clear();
+        GenerateTimestamps(channel._timestamps, channel._data.size(), channel._sample_rate_hz);
     }
-
-    // Set the data
-    _data = channels;
 }
 
-
 template<typename DataType_TP>
 void
 TimeSignal_C<DataType_TP>::GenerateTimestamps(std::vector<DataType_TP>& timestamp_vec, 
@@ -415,4 +567,102 @@ TimeSignal_C<DataType_TP>::GenerateTimestamps(std::vector<DataType_TP>& timestam
         timestamp_vec.emplace_back(t_dist_s * sample_idx);
     }
 
-}
\ No newline at end of file
+}
+template<typename DataType_TP>
+inline
+void
+TimeSignal_C<DataType_TP>::SetUseCache(bool use_cache)
+{
+    _use_cache = use_cache;
+}
+
+template<typename DataType_TP>
+inline
+span<const DataType_TP>
+TimeSignal_C<DataType_TP>::GetSamples(size_t channel_idx) const
+{
+    const auto& channel = _data[channel_idx];
+    if ( channel._data.empty() && _cache ) {
+        return _cache->GetChannels()[channel_idx]._samples;
+    }
+    return span<const DataType_TP>(channel._data.data(), channel._data.size());
+}
+
+template<typename DataType_TP>
+inline
+bool
+TimeSignal_C<DataType_TP>::IsMapped() const
+{
+    return _cache != nullptr;
+}
+
+template<typename DataType_TP>
+bool
+TimeSignal_C<DataType_TP>::OpenCache(const std::string& cache_path, const std::vector<std::string>& source_files)
+{
+    auto cache = std::make_shared<RecordCache_C<DataType_TP>>();
+    if ( !cache->Open(cache_path, source_files) ) {
+        return false;
+    }
+    // the channel infos without samples; the samples stay inside the mapped cache
+    std::vector<ECGChannelInfo_TP<DataType_TP>> channels(cache->GetChannels().size());
+    for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+        const auto& cached_channel = cache->GetChannels()[channel_idx];
+        auto& channel = channels[channel_idx];
+        channel._label = cached_channel._label;
+        channel._units = cached_channel._units;
+        channel._sample_rate_hz = cached_channel._sample_rate_hz;
+        channel._high_hz = cached_channel._high_hz;
+        channel._low_hz = cached_channel._low_hz;
+        channel._gain = cached_channel._gain;
+        channel._range_mV = cached_channel._range_mV;
+        channel._id = cached_channel._id;
+        channel._scale = cached_channel._scale;
+        channel._adc_resolution_bits = cached_channel._adc_resolution_bits;
+        channel._min_val = cached_channel._min_val;
+        channel._max_val = cached_channel._max_val;
+    }
+    _data = std::move(channels);
+    _cache = std::move(cache);
+    return true;
+}
+
+template<typename DataType_TP>
+void
+TimeSignal_C<DataType_TP>::WriteCache(const std::string& cache_path, const std::vector<std::string>& source_files) const
+{
+    std::vector<CachedChannel_TP<DataType_TP>> cached_channels(_data.size());
+    for ( size_t channel_idx = 0; channel_idx < _data.size(); ++channel_idx ) {
+        const auto& channel = _data[channel_idx];
+        auto& cached_channel = cached_channels[channel_idx];
+        cached_channel._label = channel._label;
+        cached_channel._units = channel._units;
+        cached_channel._sample_rate_hz = channel._sample_rate_hz;
+        cached_channel._high_hz = channel._high_hz;
+        cached_channel._low_hz = channel._low_hz;
+        cached_channel._gain = channel._gain;
+        cached_channel._range_mV = channel._range_mV;
+        cached_channel._id = channel._id;
+        cached_channel._scale = channel._scale;
+        cached_channel._adc_resolution_bits = channel._adc_resolution_bits;
+        cached_channel._min_val = channel._min_val;
+        cached_channel._max_val = channel._max_val;
+        cached_channel._samples = GetSamples(channel_idx);
+    }
+    // a record inside a read only directory is loaded without a cache
+    RecordCache_C<DataType_TP>::Write(cache_path, source_files, cached_channels);
+}
+
+template<typename DataType_TP>
+std::vector<std::string>
+TimeSignal_C<DataType_TP>::GetMITSourceFiles(const std::string& record_dir, const std::string& record_name)
+{
+    // a compressed record next to the signal files is read only, if it is up to date with them (see CompressedRecord_C::Open())
+    auto source_files = WFDBNativeReader_C<DataType_TP>::GetSourceFiles(record_dir, record_name);
+    const std::string compressed_record_path = CompressedRecord_C<DataType_TP>::GetFilename(record_dir, record_name);
+    std::error_code error;
+    if ( source_files.empty() && std::filesystem::exists(compressed_record_path, error) ) {
+        source_files.push_back(compressed_record_path);
+    }
+    return source_files;
+}
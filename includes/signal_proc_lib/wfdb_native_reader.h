@@ -0,0 +1,542 @@
+#pragma once
+
+// Project includes
+#include "mit_file_io.h"
+#include "mapped_file.h"
+
+// STL includes
+#include <string>
+#include <vector>
+#include <utility>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+
+//! Value of invalid samples (same as WFDB_INVALID_SAMPLE of the wfdb lib)
+constexpr int wfdb_invalid_sample = -32768;
+
+//! One signal line of a WFDB header file.
+//! For information about the fields see: https://physionet.org/physiotools/wag/header-5.htm
+struct WFDBSignalSpec_TP {
+    //! name of the signal file
+    std::string _filename;
+    //! storage format (e.g. 212)
+    int _format = 0;
+    //! position of the first sample inside the signal file in bytes
+    size_t _byte_offset = 0;
+    double _gain = 200.0;
+    //! adc output when the input is 0 physical units
+    int _baseline = 0;
+    std::string _units = "mV";
+    int _adc_resolution_bits = 0;
+    //! adc output when the input is 0 V
+    int _adc_zero = 0;
+    std::string _description;
+    //! False, if the signal uses a feature which only the wfdb lib reads (multiple samples per frame, skew, no signal file)
+    bool _is_supported = true;
+};
+
+//! Record line and signal lines of a WFDB header file
+struct WFDBHeader_TP {
+    std::string _record_name;
+    double _sample_freq_hz = 250.0;
+    //! Number of samples of each signal; zero, if the header does not specify it
+    size_t _num_samples = 0;
+    std::vector<WFDBSignalSpec_TP> _signals;
+    //! False for multi segment records
+    bool _is_supported = true;
+};
+
+///////////////////////////////////////////////////////
+//
+// Class: WFDBNativeReader_C
+//
+//! Reads MIT records of the common storage formats 212, 16, 61 and 80 without the wfdb lib.
+//!
+//! The signal files are mapped into memory (see MappedFile_C) and decoded in chunks: the samples of a chunk are
+//! unpacked into a small buffer by a loop without branches (vectorized by the compiler),
+//! then the interleaved signals are copied into the channel arrays.
+//! Read() decodes the whole record into channel arrays, which are allocated once with the number of frames.
+//! Open() and DecodeFrames() decode any range of frames, so a record can be read block by block (see MITRecordStream_C).
+//! Records, which use other formats or features, are not opened: MITFileIO_C (wfdb lib) reads them.
+//!
+//! The samples are the adc values, like the samples of MITFileIO_C::Read()
+//! (invalid samples of the formats 212 and 80 are returned as wfdb_invalid_sample, like getvec() does).
+//!
+//! Usage:
+//! WFDBNativeReader_C<double> reader;
+//! auto channels = reader.Read("/data/mitdb", "100");
+template<typename SampleDataType_TP>
+class WFDBNativeReader_C {
+
+    // Public functions
+public:
+    //! Reads the record <record_dir>/<record_name>.hea and its signal files.
+    //! Returns an empty vector, if the record can not be read natively
+    std::vector<MITDataChannel_TP<SampleDataType_TP>> Read(const std::string& record_dir, const std::string& record_name);
+
+    //! Parses the header and maps the signal files of the record.
+    //! Returns false, if the record can not be read natively
+    bool Open(const std::string& record_dir, const std::string& record_name);
+
+    //! Releases the signal files
+    void Close();
+
+    const WFDBHeader_TP& GetHeader() const;
+
+    //! Returns the number of frames of the opened record (one sample of each signal)
+    size_t GetNumFrames() const;
+
+    //! Returns the channels of the opened record without samples
+    std::vector<MITDataChannel_TP<SampleDataType_TP>> GetChannels() const;
+
+    //! Decodes the frames [first_frame, first_frame + num_frames) of the opened record.
+    //! channel_dst[signal_idx] receives the num_frames samples of the signal
+    void DecodeFrames(size_t first_frame, size_t num_frames, SampleDataType_TP* const* channel_dst);
+
+    //! Releases the mapped pages of the frames, which are decoded and not needed anymore (see MappedFile_C::ReleasePages())
+    void ReleaseFrames(size_t first_frame, size_t num_frames);
+
+    //! Returns the header and the signal files of the record, which is read natively, e.g. to check whether a cache or a
+    //! compressed record of the record is up to date. Empty, if there is no header or the record can not be read natively
+    //! (e.g. multi segment records, which consist of other records)
+    static std::vector<std::string> GetSourceFiles(const std::string& record_dir, const std::string& record_name);
+
+    //! Parses the text of a header file. Returns false, if the text is no valid header
+    static bool ParseHeader(const std::string& header_text, WFDBHeader_TP& header);
+
+    //! Returns true for the storage formats, which are decoded natively
+    static bool IsSupportedFormat(int format);
+
+    //! Returns the number of bits of one sample of the storage format
+    static unsigned int GetBitsPerSample(int format);
+
+    //! Decodes num_samples consecutive samples of the storage format into dst.
+    //! For format 212, src must point to the first byte of a pair of samples
+    static void Unpack(int format, const unsigned char* src, size_t num_samples, int32_t* dst);
+
+    // Private types
+private:
+    //! Signal file and the indices of the signals, which are stored interleaved inside it (with the same format)
+    struct SignalFile_TP {
+        std::string _filename;
+        std::vector<size_t> _signal_indices;
+        MappedFile_C _file;
+    };
+
+    // Private functions
+private:
+    //! Decodes the frames of one signal file into the channels
+    void DecodeSignalFile(const SignalFile_TP& signal_file,
+                          size_t first_frame,
+                          size_t num_frames,
+                          SampleDataType_TP* const* channel_dst);
+
+    // Private variables
+private:
+    //! Number of frames, which are unpacked at once
+    static constexpr size_t _chunk_num_frames = 4096;
+
+    WFDBHeader_TP _header;
+
+    std::vector<SignalFile_TP> _signal_files;
+
+    size_t _num_frames = 0;
+
+    //! Unpacked samples of one chunk
+    std::vector<int32_t> _unpacked_samples;
+};
+
+template<typename SampleDataType_TP>
+inline
+bool
+WFDBNativeReader_C<SampleDataType_TP>::IsSupportedFormat(int format)
+{
+    return format == 212 || format == 16 || format == 61 || format == 80;
+}
+
+template<typename SampleDataType_TP>
+inline
+unsigned int
+WFDBNativeReader_C<SampleDataType_TP>::GetBitsPerSample(int format)
+{
+    switch ( format ) {
+    case 212:
+        return 12;
+    case 80:
+        return 8;
+    default:
+        return 16;
+    }
+}
+
+template<typename SampleDataType_TP>
+inline
+std::vector<std::string>
+WFDBNativeReader_C<SampleDataType_TP>::GetSourceFiles(const std::string& record_dir, const std::string& record_name)
+{
+    const std::string header_path = record_dir + "/" + record_name + ".hea";
+    std::ifstream header_file(header_path);
+    WFDBHeader_TP header;
+    if ( !header_file.is_open() ||
+         !ParseHeader(std::string(std::istreambuf_iterator<char>(header_file), std::istreambuf_iterator<char>()), header) ||
+         !header._is_supported )
+    {
+        return {};
+    }
+    std::vector<std::string> source_files = { header_path };
+    for ( const auto& signal : header._signals ) {
+        if ( signal._filename == "~" || signal._filename == "-" ) {
+            return {};
+        }
+        const std::string signal_path = record_dir + "/" + signal._filename;
+        if ( std::find(source_files.begin(), source_files.end(), signal_path) == source_files.end() ) {
+            source_files.push_back(signal_path);
+        }
+    }
+    return source_files;
+}
+
+template<typename SampleDataType_TP>
+inline
+bool
+WFDBNativeReader_C<SampleDataType_TP>::ParseHeader(const std::string& header_text, WFDBHeader_TP& header)
+{
+    header = WFDBHeader_TP();
+    std::istringstream lines(header_text);
+    std::string line;
+    bool has_record_line = false;
+    size_t num_signals = 0;
+    while ( header._signals.size() < num_signals || !has_record_line ) {
+        if ( !std::getline(lines, line) ) {
+            return false;
+        }
+        std::istringstream line_stream(line);
+        std::vector<std::string> tokens{ std::istream_iterator<std::string>(line_stream), std::istream_iterator<std::string>() };
+        // empty lines and comments
+        if ( tokens.empty() || tokens[0][0] == '#' ) {
+            continue;
+        }
+
+        if ( !has_record_line ) {
+            // name[/num_segments] num_signals [sample_freq[/counter_freq[(base_counter)]] [num_samples [time [date]]]]
+            if ( tokens.size() < 2 ) {
+                return false;
+            }
+            header._record_name = tokens[0];
+            header._is_supported = tokens[0].find('/') == std::string::npos;
+            num_signals = std::strtoul(tokens[1].c_str(), nullptr, 10);
+            if ( tokens.size() > 2 ) {
+                const double sample_freq_hz = std::strtod(tokens[2].c_str(), nullptr);
+                if ( sample_freq_hz > 0.0 ) {
+                    header._sample_freq_hz = sample_freq_hz;
+                }
+            }
+            if ( tokens.size() > 3 ) {
+                header._num_samples = std::strtoull(tokens[3].c_str(), nullptr, 10);
+            }
+            has_record_line = true;
+            continue;
+        }
+
+        // filename format[xsamples_per_frame][:skew][+byte_offset] [gain[(baseline)][/units] [adc_resolution [adc_zero
+        // [initial_value [checksum [block_size [description]]]]]]]
+        if ( tokens.size() < 2 ) {
+            return false;
+        }
+        WFDBSignalSpec_TP signal;
+        signal._filename = tokens[0];
+        signal._is_supported = signal._filename != "~" && signal._filename != "-";
+        char* end = nullptr;
+        signal._format = static_cast<int>(std::strtol(tokens[1].c_str(), &end, 10));
+        while ( *end != '\0' ) {
+            const char modifier = *end;
+            const long value = std::strtol(end + 1, &end, 10);
+            if ( modifier == '+' ) {
+                signal._byte_offset = static_cast<size_t>(value);
+            } else if ( (modifier == 'x' && value > 1) || (modifier == ':' && value != 0) || (modifier != 'x' && modifier != ':') ) {
+                signal._is_supported = false;
+            }
+        }
+        signal._adc_resolution_bits = static_cast<int>(GetBitsPerSample(signal._format));
+
+        bool has_baseline = false;
+        if ( tokens.size() > 2 ) {
+            const double gain = std::strtod(tokens[2].c_str(), &end);
+            // zero means uncalibrated: the default gain of the wfdb lib
+            signal._gain = gain != 0.0 ? gain : 200.0;
+            if ( *end == '(' ) {
+                signal._baseline = static_cast<int>(std::strtol(end + 1, &end, 10));
+                has_baseline = true;
+                if ( *end == ')' ) {
+                    ++end;
+                }
+            }
+            if ( *end == '/' ) {
+                signal._units = end + 1;
+            }
+        }
+        if ( tokens.size() > 3 ) {
+            const int adc_resolution_bits = std::atoi(tokens[3].c_str());
+            if ( adc_resolution_bits > 0 ) {
+                signal._adc_resolution_bits = adc_resolution_bits;
+            }
+        }
+        if ( tokens.size() > 4 ) {
+            signal._adc_zero = std::atoi(tokens[4].c_str());
+        }
+        if ( !has_baseline ) {
+            signal._baseline = signal._adc_zero;
+        }
+        // the description is the rest of the line
+        for ( size_t token_idx = 8; token_idx < tokens.size(); ++token_idx ) {
+            signal._description += (token_idx > 8 ? " " : "") + tokens[token_idx];
+        }
+        if ( signal._description.empty() ) {
+            signal._description = "record " + header._record_name + ", signal " + std::to_string(header._signals.size());
+        }
+        header._signals.push_back(std::move(signal));
+    }
+    return true;
+}
+
+template<typename SampleDataType_TP>
+inline
+void
+WFDBNativeReader_C<SampleDataType_TP>::Unpack(int format, const unsigned char* src, size_t num_samples, int32_t* dst)
+{
+    switch ( format ) {
+    case 212: {
+        // two 12 bit samples in three bytes: the low bytes of the samples and the high nibbles in the middle byte.
+        // -2048 marks an invalid sample
+        const size_t num_pairs = num_samples / 2;
+        for ( size_t pair_idx = 0; pair_idx < num_pairs; ++pair_idx ) {
+            const int32_t byte_0 = src[3 * pair_idx];
+            const int32_t byte_1 = src[3 * pair_idx + 1];
+            const int32_t byte_2 = src[3 * pair_idx + 2];
+            const int32_t sample_0 = ((byte_0 | ((byte_1 & 0x0F) << 8)) ^ 0x800) - 0x800;
+            const int32_t sample_1 = ((byte_2 | ((byte_1 & 0xF0) << 4)) ^ 0x800) - 0x800;
+            dst[2 * pair_idx] = sample_0 == -2048 ? wfdb_invalid_sample : sample_0;
+            dst[2 * pair_idx + 1] = sample_1 == -2048 ? wfdb_invalid_sample : sample_1;
+        }
+        if ( num_samples % 2 != 0 ) {
+            const int32_t sample = ((src[3 * num_pairs] | ((src[3 * num_pairs + 1] & 0x0F) << 8)) ^ 0x800) - 0x800;
+            dst[num_samples - 1] = sample == -2048 ? wfdb_invalid_sample : sample;
+        }
+        break;
+    }
+    case 16:
+        // 16 bit two's complement, little endian
+        for ( size_t idx = 0; idx < num_samples; ++idx ) {
+            dst[idx] = static_cast<int16_t>(static_cast<uint16_t>(src[2 * idx] | (src[2 * idx + 1] << 8)));
+        }
+        break;
+    case 61:
+        // 16 bit two's complement, big endian
+        for ( size_t idx = 0; idx < num_samples; ++idx ) {
+            dst[idx] = static_cast<int16_t>(static_cast<uint16_t>((src[2 * idx] << 8) | src[2 * idx + 1]));
+        }
+        break;
+    case 80:
+        // 8 bit offset binary. -128 marks an invalid sample
+        for ( size_t idx = 0; idx < num_samples; ++idx ) {
+            const int32_t sample = static_cast<int32_t>(src[idx]) - 128;
+            dst[idx] = sample == -128 ? wfdb_invalid_sample : sample;
+        }
+        break;
+    default:
+        std::fill_n(dst, num_samples, wfdb_invalid_sample);
+        break;
+    }
+}
+
+template<typename SampleDataType_TP>
+inline
+void
+WFDBNativeReader_C<SampleDataType_TP>::DecodeSignalFile(const SignalFile_TP& signal_file,
+                                                        size_t first_frame,
+                                                        size_t num_frames,
+                                                        SampleDataType_TP* const* channel_dst)
+{
+    const auto& signal_indices = signal_file._signal_indices;
+    const auto& first_signal = _header._signals[signal_indices.front()];
+    const unsigned char* src = signal_file._file.GetData() + first_signal._byte_offset;
+    const size_t num_signals = signal_indices.size();
+    const size_t bits_per_sample = GetBitsPerSample(first_signal._format);
+    // one more sample for a chunk, which starts in the middle of a pair of format 212
+    _unpacked_samples.resize(_chunk_num_frames * num_signals + 1);
+
+    for ( size_t frame_begin = 0; frame_begin < num_frames; frame_begin += _chunk_num_frames ) {
+        const size_t chunk_num_frames = std::min(_chunk_num_frames, num_frames - frame_begin);
+        // the unpacking starts at an even sample, so at a full byte for all formats
+        const size_t first_sample = (first_frame + frame_begin) * num_signals;
+        const size_t num_skipped_samples = first_sample % 2;
+        const size_t first_unpacked_sample = first_sample - num_skipped_samples;
+        Unpack(first_signal._format,
+               src + first_unpacked_sample * bits_per_sample / 8,
+               chunk_num_frames * num_signals + num_skipped_samples,
+               _unpacked_samples.data());
+
+        // deinterleave
+        for ( size_t signal_idx = 0; signal_idx < num_signals; ++signal_idx ) {
+            SampleDataType_TP* dst = channel_dst[signal_indices[signal_idx]] + frame_begin;
+            const int32_t* unpacked = _unpacked_samples.data() + num_skipped_samples + signal_idx;
+            for ( size_t frame_idx = 0; frame_idx < chunk_num_frames; ++frame_idx ) {
+                dst[frame_idx] = static_cast<SampleDataType_TP>(unpacked[frame_idx * num_signals]);
+            }
+        }
+    }
+}
+
+template<typename SampleDataType_TP>
+inline
+bool
+WFDBNativeReader_C<SampleDataType_TP>::Open(const std::string& record_dir, const std::string& record_name)
+{
+    Close();
+    std::ifstream header_file(record_dir + "/" + record_name + ".hea");
+    if ( !header_file ) {
+        return false;
+    }
+    std::stringstream header_text;
+    header_text << header_file.rdbuf();
+    if ( !ParseHeader(header_text.str(), _header) || !_header._is_supported || _header._signals.empty() ) {
+        return false;
+    }
+
+    // The signals of one file are stored interleaved, with the same format
+    std::vector<SignalFile_TP> signal_files;
+    for ( size_t signal_idx = 0; signal_idx < _header._signals.size(); ++signal_idx ) {
+        const auto& signal = _header._signals[signal_idx];
+        if ( !signal._is_supported || !IsSupportedFormat(signal._format) ) {
+            return false;
+        }
+        auto file_it = std::find_if(signal_files.begin(), signal_files.end(),
+                                    [&signal](const auto& signal_file) { return signal_file._filename == signal._filename; });
+        if ( file_it == signal_files.end() ) {
+            signal_files.push_back({ signal._filename, { signal_idx }, MappedFile_C() });
+        } else {
+            const auto& first_signal = _header._signals[file_it->_signal_indices.front()];
+            if ( first_signal._format != signal._format || first_signal._byte_offset != signal._byte_offset ) {
+                return false;
+            }
+            file_it->_signal_indices.push_back(signal_idx);
+        }
+    }
+
+    // Map all files first: the record is read completely or not at all
+    size_t num_frames = _header._num_samples;
+    for ( size_t file_idx = 0; file_idx < signal_files.size(); ++file_idx ) {
+        auto& signal_file = signal_files[file_idx];
+        const auto& signal = _header._signals[signal_file._signal_indices.front()];
+        if ( !signal_file._file.Open(record_dir + "/" + signal_file._filename) || signal_file._file.GetSize() < signal._byte_offset ) {
+            return false;
+        }
+        // like getvec(), stop at the end of the shortest file
+        const size_t num_file_samples = (signal_file._file.GetSize() - signal._byte_offset) * 8 / GetBitsPerSample(signal._format);
+        const size_t num_file_frames = num_file_samples / signal_file._signal_indices.size();
+        num_frames = (_header._num_samples == 0 && file_idx == 0) ? num_file_frames : std::min(num_frames, num_file_frames);
+    }
+    _signal_files = std::move(signal_files);
+    _num_frames = num_frames;
+    return true;
+}
+
+template<typename SampleDataType_TP>
+inline
+void
+WFDBNativeReader_C<SampleDataType_TP>::Close()
+{
+    _signal_files.clear();
+    _header = WFDBHeader_TP();
+    _num_frames = 0;
+}
+
+template<typename SampleDataType_TP>
+inline
+const WFDBHeader_TP&
+WFDBNativeReader_C<SampleDataType_TP>::GetHeader() const
+{
+    return _header;
+}
+
+template<typename SampleDataType_TP>
+inline
+size_t
+WFDBNativeReader_C<SampleDataType_TP>::GetNumFrames() const
+{
+    return _num_frames;
+}
+
+template<typename SampleDataType_TP>
+inline
+std::vector<MITDataChannel_TP<SampleDataType_TP>>
+WFDBNativeReader_C<SampleDataType_TP>::GetChannels() const
+{
+    std::vector<MITDataChannel_TP<SampleDataType_TP>> channels(_header._signals.size());
+    for ( size_t signal_idx = 0; signal_idx < _header._signals.size(); ++signal_idx ) {
+        const auto& signal = _header._signals[signal_idx];
+        auto& channel = channels[signal_idx];
+        channel._filename = signal._filename;
+        channel._description = signal._description;
+        channel._units = signal._units;
+        channel._gain = signal._gain;
+        channel._sample_frequency_hz = _header._sample_freq_hz;
+        channel._adc_resolution_bits = signal._adc_resolution_bits;
+        channel._adc_baseline_0U_output_mV = signal._baseline;
+        channel._adc_baseline_0mV_output_U = signal._adc_zero;
+        channel._num_samples = static_cast<unsigned int>(_num_frames);
+    }
+    return channels;
+}
+
+template<typename SampleDataType_TP>
+inline
+void
+WFDBNativeReader_C<SampleDataType_TP>::DecodeFrames(size_t first_frame, size_t num_frames, SampleDataType_TP* const* channel_dst)
+{
+    if ( first_frame >= _num_frames ) {
+        return;
+    }
+    num_frames = std::min(num_frames, _num_frames - first_frame);
+    for ( const auto& signal_file : _signal_files ) {
+        DecodeSignalFile(signal_file, first_frame, num_frames, channel_dst);
+    }
+}
+
+template<typename SampleDataType_TP>
+inline
+void
+WFDBNativeReader_C<SampleDataType_TP>::ReleaseFrames(size_t first_frame, size_t num_frames)
+{
+    for ( auto& signal_file : _signal_files ) {
+        const auto& signal = _header._signals[signal_file._signal_indices.front()];
+        const size_t bits_per_frame = GetBitsPerSample(signal._format) * signal_file._signal_indices.size();
+        const size_t first_byte = signal._byte_offset + first_frame * bits_per_frame / 8;
+        const size_t end_byte = signal._byte_offset + (first_frame + num_frames) * bits_per_frame / 8;
+        signal_file._file.ReleasePages(first_byte, end_byte - first_byte);
+    }
+}
+
+template<typename SampleDataType_TP>
+inline
+std::vector<MITDataChannel_TP<SampleDataType_TP>>
+WFDBNativeReader_C<SampleDataType_TP>::Read(const std::string& record_dir, const std::string& record_name)
+{
+    if ( !Open(record_dir, record_name) ) {
+        Close();
+        return {};
+    }
+    auto channels = GetChannels();
+    std::vector<SampleDataType_TP*> channel_dst;
+    for ( auto& channel : channels ) {
+        channel._data.resize(_num_frames);
+        channel_dst.push_back(channel._data.data());
+    }
+    DecodeFrames(0, _num_frames, channel_dst.data());
+    Close();
+    return channels;
+}
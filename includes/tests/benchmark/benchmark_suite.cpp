@@ -0,0 +1,340 @@
+// Project includes
+#include "../../signal_proc_lib/time_signal.h"
+#include "../../signal_proc_lib/mit_file_io.h"
+#include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "../../signal_proc_lib/fixed_point_qrs_detector.h"
+#include "../../signal_proc_lib/decimating_qrs_detector.h"
+#include "../../signal_proc_lib/beat_matching.h"
+
+// STL includes
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Throughput and accuracy of the qrs detectors on MIT-BIH records.
+//
+// The detected beats are compared with the reference beat annotations (.atr) of the record.
+// The results are printed and optionally written as JSON, so throughput and accuracy can be tracked between releases.
+
+using BenchmarkClock_TP = std::chrono::steady_clock;
+
+//! Result of one detector on one channel
+struct SuiteResult_TP {
+    std::string _record;
+    std::string _channel;
+    std::string _detector;
+    size_t _num_samples = 0;
+    double _sample_rate_hz = 0.0;
+    //! Processing time of all blocks in seconds
+    double _duration_sec = 0.0;
+    //! Processing time of each block in seconds
+    std::vector<double> _block_latencies_sec;
+    size_t _num_reference_beats = 0;
+    size_t _num_detected_beats = 0;
+    BeatMatchResult_TP _match;
+};
+
+//! Options of the benchmark suite
+struct SuiteOptions_TP {
+    std::vector<std::string> _record_paths;
+    std::vector<std::string> _detectors = { "pan_topkins" };
+    std::string _json_path;
+    size_t _block_size = 256;
+    unsigned int _channel = 0;
+    double _tolerance_sec = 0.15;
+    unsigned int _training_phase_duration_sec = 2;
+};
+
+//! Returns the value below which the given fraction of the values is located
+double Percentile(std::vector<double> values, double fraction)
+{
+    if ( values.empty() ) {
+        return 0.0;
+    }
+    const size_t idx = std::min(values.size() - 1,
+                                static_cast<size_t>(std::ceil(fraction * values.size())) - (fraction > 0.0 ? 1 : 0));
+    std::nth_element(values.begin(), values.begin() + idx, values.end());
+    return values[idx];
+}
+
+//! Feeds the samples in blocks into the detector and measures the processing time of each block
+template<typename Detector_TP, typename Sample_TP>
+void RunDetector(Detector_TP& detector,
+                 const std::vector<Sample_TP>& samples,
+                 const SuiteOptions_TP& options,
+                 SuiteResult_TP& result,
+                 std::vector<double>& beats_sec)
+{
+    // reserve in front, so the callback does not allocate during the measurement
+    beats_sec.reserve(static_cast<size_t>(samples.size() / result._sample_rate_hz * 5.0) + 16);
+    detector.Connect([&beats_sec](const double& timestamp_sec) { beats_sec.push_back(timestamp_sec); });
+
+    const size_t block_size = options._block_size;
+    result._block_latencies_sec.reserve(samples.size() / block_size + 1);
+    const double sample_dist_sec = 1.0 / result._sample_rate_hz;
+    for ( size_t idx = 0; idx < samples.size(); idx += block_size ) {
+        const size_t current_block_size = std::min(block_size, samples.size() - idx);
+        auto block_start = BenchmarkClock_TP::now();
+        detector.AppendBlock(span<const Sample_TP>(samples.data() + idx, current_block_size), idx * sample_dist_sec);
+        const double latency_sec = std::chrono::duration<double>(BenchmarkClock_TP::now() - block_start).count();
+        result._block_latencies_sec.push_back(latency_sec);
+        result._duration_sec += latency_sec;
+    }
+}
+
+//! Runs the detector with the given name over the channel. Returns false, if the detector is unknown
+bool RunDetectorByName(const std::string& detector_name,
+                       const ECGChannelInfo_TP<double>& channel,
+                       const SuiteOptions_TP& options,
+                       SuiteResult_TP& result,
+                       std::vector<double>& beats_sec)
+{
+    const double sample_rate_hz = channel._sample_rate_hz;
+    const unsigned int training_sec = options._training_phase_duration_sec;
+    if ( detector_name == "pan_topkins" ) {
+        PanTopkinsQRSDetection<double> detector(sample_rate_hz, training_sec);
+        RunDetector(detector, channel._data, options, result, beats_sec);
+    } else if ( detector_name == "pan_topkins_iir" ) {
+        PanTopkinsQRSDetection<double> detector(sample_rate_hz, training_sec, QRSBandpass_TP::ButterworthIIR);
+        RunDetector(detector, channel._data, options, result, beats_sec);
+    } else if ( detector_name == "decimating" ) {
+        DecimatingQRSDetection<double> detector(sample_rate_hz, training_sec);
+        RunDetector(detector, channel._data, options, result, beats_sec);
+    } else if ( detector_name == "fixed_point" ) {
+        // TimeSignal_C stores physical units; the detector works on the ADC counts
+        std::vector<int16_t> counts(channel._data.size());
+        for ( size_t idx = 0; idx < counts.size(); ++idx ) {
+            counts[idx] = static_cast<int16_t>(std::lround(channel._data[idx] * channel._gain));
+        }
+        FixedPointQRSDetection<int16_t> detector(sample_rate_hz, training_sec, channel._adc_resolution_bits);
+        RunDetector(detector, counts, options, result, beats_sec);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//! Reads the beat annotations of the record and returns their timestamps in seconds.
+//! The wfdb path must already point to the directory of the record (see TimeSignal_C::LoadFromMITFileFormat())
+std::vector<double> ReadReferenceBeats(const std::string& record_path, double sample_rate_hz)
+{
+    auto record_name = record_path.substr(record_path.find_last_of("/\\") + 1);
+    // remove the data suffix .dat or .hea if there is a dot inside the record name
+    if ( record_name.find('.') != std::string::npos ) {
+        record_name = record_name.substr(0, record_name.size() - 4);
+    }
+    std::vector<char> record_name_char(record_name.begin(), record_name.end());
+    record_name_char.push_back('\0');
+    char annotator[] = "atr";
+
+    MITFileIO_C<double> reader;
+    std::vector<double> beats_sec;
+    for ( const auto& annotation : reader.ReadAnnotations(record_name_char.data(), annotator) ) {
+        if ( annotation._is_beat ) {
+            beats_sec.push_back(annotation._sample_idx / sample_rate_hz);
+        }
+    }
+    return beats_sec;
+}
+
+std::string EscapeJSON(const std::string& text)
+{
+    std::string escaped;
+    for ( const char character : text ) {
+        if ( character == '"' || character == '\\' ) {
+            escaped += '\\';
+        }
+        escaped += character;
+    }
+    return escaped;
+}
+
+//! Writes the fields shared by the per-channel results and the summary
+void WriteJSONMetrics(std::ostream& os,
+                      size_t num_samples,
+                      double duration_sec,
+                      const std::vector<double>& block_latencies_sec,
+                      size_t num_reference_beats,
+                      size_t num_detected_beats,
+                      const BeatMatchResult_TP& match,
+                      const std::string& indent)
+{
+    os << indent << "\"num_samples\": " << num_samples << ",\n"
+       << indent << "\"duration_sec\": " << duration_sec << ",\n"
+       << indent << "\"samples_per_sec\": " << (duration_sec > 0.0 ? num_samples / duration_sec : 0.0) << ",\n"
+       << indent << "\"ns_per_sample\": " << (num_samples > 0 ? duration_sec * 1e9 / num_samples : 0.0) << ",\n"
+       << indent << "\"block_latency_p50_us\": " << Percentile(block_latencies_sec, 0.5) * 1e6 << ",\n"
+       << indent << "\"block_latency_p99_us\": " << Percentile(block_latencies_sec, 0.99) * 1e6 << ",\n"
+       << indent << "\"block_latency_max_us\": " << Percentile(block_latencies_sec, 1.0) * 1e6 << ",\n"
+       << indent << "\"reference_beats\": " << num_reference_beats << ",\n"
+       << indent << "\"detected_beats\": " << num_detected_beats << ",\n"
+       << indent << "\"true_positives\": " << match._true_positives << ",\n"
+       << indent << "\"false_positives\": " << match._false_positives << ",\n"
+       << indent << "\"false_negatives\": " << match._false_negatives << ",\n"
+       << indent << "\"sensitivity\": " << match.Sensitivity() << ",\n"
+       << indent << "\"positive_predictivity\": " << match.PositivePredictivity() << "\n";
+}
+
+void WriteJSON(std::ostream& os, const SuiteOptions_TP& options, const std::vector<SuiteResult_TP>& results)
+{
+    os << std::setprecision(10);
+    os << "{\n"
+       << "  \"block_size\": " << options._block_size << ",\n"
+       << "  \"channel\": " << options._channel << ",\n"
+       << "  \"tolerance_ms\": " << options._tolerance_sec * 1000.0 << ",\n"
+       << "  \"results\": [\n";
+    for ( size_t result_idx = 0; result_idx < results.size(); ++result_idx ) {
+        const auto& result = results[result_idx];
+        os << "    {\n"
+           << "      \"record\": \"" << EscapeJSON(result._record) << "\",\n"
+           << "      \"channel\": \"" << EscapeJSON(result._channel) << "\",\n"
+           << "      \"detector\": \"" << EscapeJSON(result._detector) << "\",\n"
+           << "      \"sample_rate_hz\": " << result._sample_rate_hz << ",\n";
+        WriteJSONMetrics(os, result._num_samples, result._duration_sec, result._block_latencies_sec,
+                         result._num_reference_beats, result._num_detected_beats, result._match, "      ");
+        os << "    }" << (result_idx + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ],\n"
+       << "  \"summary\": [\n";
+    // gross statistics of all records per detector
+    for ( size_t detector_idx = 0; detector_idx < options._detectors.size(); ++detector_idx ) {
+        const auto& detector_name = options._detectors[detector_idx];
+        size_t num_samples = 0;
+        double duration_sec = 0.0;
+        std::vector<double> block_latencies_sec;
+        size_t num_reference_beats = 0;
+        size_t num_detected_beats = 0;
+        BeatMatchResult_TP match;
+        for ( const auto& result : results ) {
+            if ( result._detector != detector_name ) {
+                continue;
+            }
+            num_samples += result._num_samples;
+            duration_sec += result._duration_sec;
+            block_latencies_sec.insert(block_latencies_sec.end(), result._block_latencies_sec.begin(), result._block_latencies_sec.end());
+            num_reference_beats += result._num_reference_beats;
+            num_detected_beats += result._num_detected_beats;
+            match += result._match;
+        }
+        os << "    {\n"
+           << "      \"detector\": \"" << EscapeJSON(detector_name) << "\",\n";
+        WriteJSONMetrics(os, num_samples, duration_sec, block_latencies_sec,
+                         num_reference_beats, num_detected_beats, match, "      ");
+        os << "    }" << (detector_idx + 1 < options._detectors.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n"
+       << "}\n";
+}
+
+void PrintUsage()
+{
+    std::cout << "usage: qrs_benchmark_suite <record_path> [<record_path> ...] [--block-size N] [--channel N]" << std::endl;
+    std::cout << "                           [--detector pan_topkins|pan_topkins_iir|decimating|fixed_point|all] [--tolerance-ms T] [--json <file>]" << std::endl;
+    std::cout << "record_path is the path to the MIT-BIH record WITHOUT the file suffix (e.g data/100)." << std::endl;
+    std::cout << "The reference beats are read from the annotation file <record_path>.atr" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    SuiteOptions_TP options;
+    for ( int arg_idx = 1; arg_idx < argc; ++arg_idx ) {
+        std::string arg = argv[arg_idx];
+        const bool has_value = arg_idx + 1 < argc;
+        if ( arg == "--block-size" && has_value ) {
+            options._block_size = std::stoul(argv[++arg_idx]);
+        } else if ( arg == "--channel" && has_value ) {
+            options._channel = std::stoul(argv[++arg_idx]);
+        } else if ( arg == "--tolerance-ms" && has_value ) {
+            options._tolerance_sec = std::stod(argv[++arg_idx]) / 1000.0;
+        } else if ( arg == "--json" && has_value ) {
+            options._json_path = argv[++arg_idx];
+        } else if ( arg == "--detector" && has_value ) {
+            std::string detector_name = argv[++arg_idx];
+            if ( detector_name == "all" ) {
+                options._detectors = { "pan_topkins", "pan_topkins_iir", "decimating", "fixed_point" };
+            } else {
+                options._detectors = { detector_name };
+            }
+        } else {
+            options._record_paths.push_back(arg);
+        }
+    }
+
+    if ( options._record_paths.empty() || options._block_size == 0 ) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(10) << "record" << std::setw(18) << "detector"
+              << std::setw(16) << "samp/s" << std::setw(12) << "ns/samp" << std::setw(14) << "p99 [us]"
+              << std::setw(8) << "ref" << std::setw(8) << "TP" << std::setw(8) << "FP" << std::setw(8) << "FN"
+              << std::setw(10) << "Se [%]" << "+P [%]" << std::endl;
+
+    std::vector<SuiteResult_TP> results;
+    for ( const auto& record_path : options._record_paths ) {
+        TimeSignal_C<double> signal;
+        signal.LoadFromMITFileFormat(record_path);
+        const auto& channels = signal.constData();
+        if ( options._channel >= channels.size() || channels[options._channel]._data.empty() ) {
+            std::cout << "Could not read channel " << options._channel << " of " << record_path << std::endl;
+            continue;
+        }
+        const auto& channel = channels[options._channel];
+        const auto reference_beats_sec = ReadReferenceBeats(record_path, channel._sample_rate_hz);
+        if ( reference_beats_sec.empty() ) {
+            std::cout << "Could not read the beat annotations of " << record_path << std::endl;
+            continue;
+        }
+
+        for ( const auto& detector_name : options._detectors ) {
+            SuiteResult_TP result;
+            result._record = record_path.substr(record_path.find_last_of("/\\") + 1);
+            result._channel = channel._label;
+            result._detector = detector_name;
+            result._num_samples = channel._data.size();
+            result._sample_rate_hz = channel._sample_rate_hz;
+
+            std::vector<double> beats_sec;
+            if ( !RunDetectorByName(detector_name, channel, options, result, beats_sec) ) {
+                std::cout << "Unknown detector " << detector_name << std::endl;
+                PrintUsage();
+                return 1;
+            }
+            // No detections are possible during the training phase
+            result._match = MatchBeats(reference_beats_sec, beats_sec, options._tolerance_sec,
+                                       options._training_phase_duration_sec);
+            result._num_reference_beats = result._match._true_positives + result._match._false_negatives;
+            result._num_detected_beats = result._match._true_positives + result._match._false_positives;
+
+            std::cout << std::left << std::setw(10) << result._record << std::setw(18) << detector_name
+                      << std::setw(16) << result._num_samples / result._duration_sec
+                      << std::setw(12) << result._duration_sec * 1e9 / result._num_samples
+                      << std::setw(14) << Percentile(result._block_latencies_sec, 0.99) * 1e6
+                      << std::setw(8) << result._num_reference_beats
+                      << std::setw(8) << result._match._true_positives
+                      << std::setw(8) << result._match._false_positives
+                      << std::setw(8) << result._match._false_negatives
+                      << std::setw(10) << result._match.Sensitivity() * 100.0
+                      << result._match.PositivePredictivity() * 100.0 << std::endl;
+            results.push_back(std::move(result));
+        }
+    }
+
+    if ( !options._json_path.empty() ) {
+        std::ofstream json_file(options._json_path);
+        if ( !json_file ) {
+            std::cout << "Could not write " << options._json_path << std::endl;
+            return 1;
+        }
+        WriteJSON(json_file, options, results);
+    }
+    return results.empty() ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+// Project includes
+#include "../../signal_proc_lib/fft_convolution.h"
+
+// STL includes
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+// Throughput of the direct and the overlap-save FFT convolution of OfflineFIRFilter for growing numbers of taps.
+//
+// The first number of taps, from which on the FFT convolution is faster, is the crossover used by
+// ConvolutionMethod_TP::Auto (fft_crossover_num_taps).
+
+using BenchmarkClock_TP = std::chrono::steady_clock;
+
+//! Returns the throughput of the filter in million samples per second (best of the repetitions)
+double MeasureThroughput(const OfflineFIRFilter<double>& filter, const std::vector<double>& signal, unsigned int num_repetitions)
+{
+    double best_duration_sec = 0.0;
+    for ( unsigned int repetition = 0; repetition < num_repetitions; ++repetition ) {
+        auto data = signal;
+        auto start = BenchmarkClock_TP::now();
+        filter.Apply(data);
+        const double duration_sec = std::chrono::duration<double>(BenchmarkClock_TP::now() - start).count();
+        if ( repetition == 0 || duration_sec < best_duration_sec ) {
+            best_duration_sec = duration_sec;
+        }
+    }
+    return signal.size() / best_duration_sec / 1e6;
+}
+
+void PrintUsage()
+{
+    std::cout << "usage: fir_convolution_benchmark [--samples N] [--repetitions N]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    // 30 minutes at 360 Hz
+    size_t num_samples = 650000;
+    unsigned int num_repetitions = 3;
+    for ( int arg_idx = 1; arg_idx < argc; ++arg_idx ) {
+        std::string arg = argv[arg_idx];
+        const bool has_value = arg_idx + 1 < argc;
+        if ( arg == "--samples" && has_value ) {
+            num_samples = std::stoul(argv[++arg_idx]);
+        } else if ( arg == "--repetitions" && has_value ) {
+            num_repetitions = std::stoul(argv[++arg_idx]);
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::mt19937 generator(1);
+    std::normal_distribution<double> distribution(0.0, 1.0);
+    std::vector<double> signal(num_samples);
+    for ( auto& sample : signal ) {
+        sample = distribution(generator);
+    }
+
+    std::cout << std::setw(8) << "taps" << std::setw(16) << "direct [MS/s]" << std::setw(16) << "fft [MS/s]" << std::setw(12) << "fft size" << std::endl;
+    unsigned int crossover_num_taps = 0;
+    for ( const unsigned int num_taps : { 8u, 16u, 24u, 32u, 48u, 64u, 96u, 128u, 192u, 256u, 512u, 1024u, 2048u } ) {
+        std::vector<double> taps(num_taps);
+        for ( auto& tap : taps ) {
+            tap = distribution(generator);
+        }
+        OfflineFIRFilter<double> direct_filter(taps, true, ConvolutionMethod_TP::Direct);
+        OfflineFIRFilter<double> fft_filter(taps, true, ConvolutionMethod_TP::FFT);
+        const double direct_throughput = MeasureThroughput(direct_filter, signal, num_repetitions);
+        const double fft_throughput = MeasureThroughput(fft_filter, signal, num_repetitions);
+        if ( crossover_num_taps == 0 && fft_throughput > direct_throughput ) {
+            crossover_num_taps = num_taps;
+        }
+        std::cout << std::setw(8) << num_taps << std::setw(16) << std::fixed << std::setprecision(1) << direct_throughput
+                  << std::setw(16) << fft_throughput << std::setw(12) << fft_filter.GetFFTSize() << std::endl;
+    }
+    std::cout << "crossover: " << crossover_num_taps << " taps (fft_crossover_num_taps = " << fft_crossover_num_taps << ")" << std::endl;
+    return 0;
+}
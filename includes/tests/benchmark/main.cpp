@@ -0,0 +1,194 @@
+// Project includes
+#include "../../signal_proc_lib/time_signal.h"
+#include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "../../signal_proc_lib/multi_channel_qrs_detector.h"
+#include "../../signal_proc_lib/fixed_point_qrs_detector.h"
+
+// STL includes
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+using BenchmarkClock_TP = std::chrono::steady_clock;
+
+//! Result of one detector run over a channel
+struct DetectorRunResult_TP {
+    //! Number of detected qrs complexes
+    size_t _num_beats = 0;
+    //! Processing time in seconds
+    double _duration_sec = 0.0;
+};
+
+//! Feeds the channel sample by sample via AppendPoint()
+DetectorRunResult_TP RunPerSample(const ECGChannelInfo_TP<double>& channel)
+{
+    DetectorRunResult_TP result;
+    PanTopkinsQRSDetection<double> detector(channel._sample_rate_hz, 2);
+    detector.Connect([&](const double&) { ++result._num_beats; });
+
+    const double sample_dist_sec = 1.0 / channel._sample_rate_hz;
+    auto start = BenchmarkClock_TP::now();
+    for ( size_t idx = 0; idx < channel._data.size(); ++idx ) {
+        detector.AppendPoint(channel._data[idx], idx * sample_dist_sec);
+    }
+    result._duration_sec = std::chrono::duration<double>(BenchmarkClock_TP::now() - start).count();
+    return result;
+}
+
+//! Feeds the channel in blocks of block_size samples via AppendBlock()
+DetectorRunResult_TP RunBlock(const ECGChannelInfo_TP<double>& channel, size_t block_size)
+{
+    DetectorRunResult_TP result;
+    PanTopkinsQRSDetection<double> detector(channel._sample_rate_hz, 2);
+    detector.Connect([&](const double&) { ++result._num_beats; });
+
+    const double sample_dist_sec = 1.0 / channel._sample_rate_hz;
+    const auto& data = channel._data;
+    auto start = BenchmarkClock_TP::now();
+    for ( size_t idx = 0; idx < data.size(); idx += block_size ) {
+        auto current_block_size = std::min(block_size, data.size() - idx);
+        detector.AppendBlock(span<const double>(data.data() + idx, current_block_size), idx * sample_dist_sec);
+    }
+    result._duration_sec = std::chrono::duration<double>(BenchmarkClock_TP::now() - start).count();
+    return result;
+}
+
+//! Feeds the raw ADC counts of the channel in blocks of block_size samples into FixedPointQRSDetection
+DetectorRunResult_TP RunFixedPoint(const ECGChannelInfo_TP<double>& channel, size_t block_size)
+{
+    DetectorRunResult_TP result;
+    // TimeSignal_C stores physical units; the detector works on the ADC counts
+    std::vector<int16_t> counts(channel._data.size());
+    for ( size_t idx = 0; idx < counts.size(); ++idx ) {
+        counts[idx] = static_cast<int16_t>(std::lround(channel._data[idx] * channel._gain));
+    }
+
+    FixedPointQRSDetection<int16_t> detector(channel._sample_rate_hz, 2, channel._adc_resolution_bits);
+    detector.Connect([&](const double&) { ++result._num_beats; });
+
+    const double sample_dist_sec = 1.0 / channel._sample_rate_hz;
+    auto start = BenchmarkClock_TP::now();
+    for ( size_t idx = 0; idx < counts.size(); idx += block_size ) {
+        auto current_block_size = std::min(block_size, counts.size() - idx);
+        detector.AppendBlock(span<const int16_t>(counts.data() + idx, current_block_size), idx * sample_dist_sec);
+    }
+    result._duration_sec = std::chrono::duration<double>(BenchmarkClock_TP::now() - start).count();
+    return result;
+}
+
+//! Feeds all channels of the record at once into one MultiChannelQRSDetection.
+//! All channels must have the same sample rate (see TimeSignal_C::AlignSampleRates()).
+DetectorRunResult_TP RunMultiChannel(const std::vector<ECGChannelInfo_TP<double>>& channels, size_t block_size)
+{
+    DetectorRunResult_TP result;
+    const unsigned int num_channels = channels.size();
+    // the resampled channels may differ by one sample
+    size_t num_samples = channels[0]._data.size();
+    for ( const auto& channel : channels ) {
+        num_samples = std::min(num_samples, channel._data.size());
+    }
+
+    // interleave the channels into frames
+    std::vector<double> frames(num_samples * num_channels);
+    for ( size_t idx = 0; idx < num_samples; ++idx ) {
+        for ( unsigned int channel = 0; channel < num_channels; ++channel ) {
+            frames[idx * num_channels + channel] = channels[channel]._data[idx];
+        }
+    }
+
+    MultiChannelQRSDetection<double> detector(channels[0]._sample_rate_hz, num_channels, 2);
+    detector.Connect([&](unsigned int, const double&) { ++result._num_beats; });
+
+    const double sample_dist_sec = 1.0 / channels[0]._sample_rate_hz;
+    const size_t frames_per_block = block_size;
+    auto start = BenchmarkClock_TP::now();
+    for ( size_t idx = 0; idx < num_samples; idx += frames_per_block ) {
+        auto current_num_frames = std::min(frames_per_block, num_samples - idx);
+        detector.AppendBlock(span<const double>(frames.data() + idx * num_channels, current_num_frames * num_channels), 
+                             idx * sample_dist_sec);
+    }
+    result._duration_sec = std::chrono::duration<double>(BenchmarkClock_TP::now() - start).count();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> record_paths;
+    size_t block_size = 256;
+    for ( int arg_idx = 1; arg_idx < argc; ++arg_idx ) {
+        std::string arg = argv[arg_idx];
+        if ( arg == "--block-size" && arg_idx + 1 < argc ) {
+            block_size = std::stoul(argv[++arg_idx]);
+        } else {
+            record_paths.push_back(arg);
+        }
+    }
+
+    if ( record_paths.empty() || block_size == 0 ) {
+        std::cout << "usage: qrs_detector_benchmark <record_path> [<record_path> ...] [--block-size N]" << std::endl;
+        std::cout << "record_path is the path to the MIT-BIH record WITHOUT the file suffix (e.g data/100)" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(16) << "record" << std::setw(10) << "channel"
+              << std::setw(22) << "per-sample [samp/s]" << std::setw(22) << "block [samp/s]"
+              << std::setw(10) << "speedup" << std::setw(22) << "fixed-point [samp/s]"
+              << "beats (sample/block/fixed-point)" << std::endl;
+
+    for ( const auto& record_path : record_paths ) {
+        TimeSignal_C<double> signal;
+        signal.LoadFromMITFileFormat(record_path);
+
+        double single_channel_duration_sec = 0.0;
+        size_t single_channel_beats = 0;
+        for ( const auto& channel : signal.constData() ) {
+            if ( channel._data.empty() ) {
+                continue;
+            }
+            auto per_sample = RunPerSample(channel);
+            auto block = RunBlock(channel, block_size);
+            auto fixed_point = RunFixedPoint(channel, block_size);
+            single_channel_duration_sec += block._duration_sec;
+            single_channel_beats += block._num_beats;
+
+            double num_samples = static_cast<double>(channel._data.size());
+            double per_sample_rate = num_samples / per_sample._duration_sec;
+            double block_rate = num_samples / block._duration_sec;
+            double fixed_point_rate = num_samples / fixed_point._duration_sec;
+
+            std::cout << std::left << std::setw(16) << record_path.substr(record_path.find_last_of("/\\") + 1)
+                      << std::setw(10) << channel._label
+                      << std::setw(22) << per_sample_rate
+                      << std::setw(22) << block_rate
+                      << std::setw(10) << block_rate / per_sample_rate
+                      << std::setw(22) << fixed_point_rate
+                      << per_sample._num_beats << "/" << block._num_beats << "/" << fixed_point._num_beats << std::endl;
+        }
+
+        // All channels of the record at once (in lockstep, so they need a common sample rate)
+        signal.AlignSampleRates();
+        const auto& channels = signal.constData();
+        if ( !channels.empty() && !channels[0]._data.empty() ) {
+            auto multi_channel = RunMultiChannel(channels, block_size);
+            double num_samples = static_cast<double>(channels.size() * channels[0]._data.size());
+            double single_channel_rate = num_samples / single_channel_duration_sec;
+            double multi_channel_rate = num_samples / multi_channel._duration_sec;
+
+            std::cout << std::left << std::setw(16) << record_path.substr(record_path.find_last_of("/\\") + 1)
+                      << std::setw(10) << "all(" + std::to_string(channels.size()) + ")"
+                      << std::setw(22) << single_channel_rate
+                      << std::setw(22) << multi_channel_rate
+                      << std::setw(10) << multi_channel_rate / single_channel_rate
+                      << std::setw(22) << "-"
+                      << single_channel_beats << "/" << multi_channel._num_beats
+                      << "  (block single lane / multi lane)" << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// STL includes
+#include <atomic>
+#include <cstddef>
+
+//! Number of calls of the global operator new of the test executable (all overloads).
+//! The replacements of the global operator new / delete are defined in allocation_counter.cpp
+extern std::atomic<size_t> g_num_allocations;
@@ -0,0 +1,238 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/lossless_codec.h"
+#include "../../signal_proc_lib/compressed_record.h"
+#include "../../signal_proc_lib/record_stream.h"
+#include "wfdb_native_reader_test.h"
+#include "record_stream_test.h"
+#include "record_cache_test.h"
+#include "pan_topkins_qrs_detector_test.h"
+
+// STL includes
+#include <iostream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <random>
+#include <cmath>
+#include <cstdint>
+
+class CompressedRecordTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(CompressedRecordTest);
+    CPPUNIT_TEST(testCodecRoundTrip);
+    CPPUNIT_TEST(testInvalidBlock);
+    CPPUNIT_TEST(testRecordRoundTrip);
+    CPPUNIT_TEST(testTransparentLoading);
+    CPPUNIT_TEST(testOutdatedRecordIsNotOpened);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+        _record_dir = std::filesystem::temp_directory_path() / "ecg_analyzer_compressed_record_test";
+        _archive_dir = _record_dir / "archive";
+        std::filesystem::create_directories(_archive_dir);
+    }
+
+    void tearDown()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(_record_dir, error);
+    }
+
+    //! Any integer samples are decoded exactly; an ecg of 11 bit adc values needs less than half of its 16 bit storage
+    void testCodecRoundTrip()
+    {
+        std::mt19937 generator(7);
+        std::uniform_int_distribution<int32_t> full_range(INT32_MIN, INT32_MAX);
+        std::vector<std::vector<int32_t>> signals;
+        for ( size_t num_samples : { 0, 1, 2, 3, 31, 32, 33, 100, 4097 } ) {
+            std::vector<int32_t> random(num_samples);
+            std::vector<int32_t> ramp(num_samples);
+            for ( size_t idx = 0; idx < num_samples; ++idx ) {
+                random[idx] = full_range(generator);
+                ramp[idx] = static_cast<int32_t>(idx * 3) - 1000;
+            }
+            signals.push_back(random);
+            signals.push_back(ramp);
+            signals.push_back(std::vector<int32_t>(num_samples, -5));
+        }
+        signals.push_back({ INT32_MIN, INT32_MAX, INT32_MIN, INT32_MAX, 0, INT32_MIN });
+
+        const auto ecg = PanTokpinsQRSDetectorTest::CreateSyntheticECG(360.0, 60.0, 0.8);
+        std::normal_distribution<double> noise(0.0, 2.0);
+        std::vector<int32_t> ecg_adc_values(ecg.size());
+        for ( size_t idx = 0; idx < ecg.size(); ++idx ) {
+            ecg_adc_values[idx] = static_cast<int32_t>(std::lround(ecg[idx] * 200.0 + noise(generator))) + 1024;
+        }
+        signals.push_back(ecg_adc_values);
+
+        for ( const auto& samples : signals ) {
+            std::vector<unsigned char> encoded = { 0xAB };
+            LosslessCodec_C::Encode(samples.data(), samples.size(), encoded);
+            // a trailing block follows
+            const size_t num_block_bytes = encoded.size() - 1;
+            encoded.push_back(0xCD);
+            std::vector<int32_t> decoded(samples.size() + 1, 77);
+            CPPUNIT_ASSERT_EQUAL(num_block_bytes, LosslessCodec_C::Decode(encoded.data() + 1, encoded.size() - 1, samples.size(), decoded.data()));
+            CPPUNIT_ASSERT(std::equal(samples.begin(), samples.end(), decoded.begin()));
+            CPPUNIT_ASSERT_EQUAL(77, decoded.back());
+        }
+
+        std::vector<unsigned char> encoded;
+        LosslessCodec_C::Encode(ecg_adc_values.data(), ecg_adc_values.size(), encoded);
+        CPPUNIT_ASSERT(encoded.size() < ecg_adc_values.size());
+    }
+
+    //! Truncated or corrupted blocks are not decoded
+    void testInvalidBlock()
+    {
+        std::vector<int32_t> samples(100);
+        for ( size_t idx = 0; idx < samples.size(); ++idx ) {
+            samples[idx] = static_cast<int32_t>(idx * idx);
+        }
+        std::vector<unsigned char> encoded;
+        LosslessCodec_C::Encode(samples.data(), samples.size(), encoded);
+        std::vector<int32_t> decoded(samples.size());
+        for ( size_t size = 0; size < encoded.size(); ++size ) {
+            CPPUNIT_ASSERT_EQUAL(size_t(0), LosslessCodec_C::Decode(encoded.data(), size, samples.size(), decoded.data()));
+        }
+        encoded[0] = 3;
+        CPPUNIT_ASSERT_EQUAL(size_t(0), LosslessCodec_C::Decode(encoded.data(), encoded.size(), samples.size(), decoded.data()));
+    }
+
+    //! The compressed record holds the adc values of the record; any range of frames is decoded, with any number of threads
+    void testRecordRoundTrip()
+    {
+        const auto channels = WriteTestRecord(10007);
+        CPPUNIT_ASSERT(CompressedRecord_C<double>::Write(CompressedRecord_C<double>::GetFilename(_archive_dir.string(), "rec"), channels, 1000, 3));
+
+        for ( unsigned int num_threads : { 1u, 4u } ) {
+            CompressedRecord_C<double> record(num_threads);
+            const auto decoded_channels = record.Read(_archive_dir.string(), "rec");
+            CPPUNIT_ASSERT_EQUAL(channels.size(), decoded_channels.size());
+            for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+                CPPUNIT_ASSERT(channels[channel_idx]._data == decoded_channels[channel_idx]._data);
+                CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._description, decoded_channels[channel_idx]._description);
+                CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._gain, decoded_channels[channel_idx]._gain);
+                CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._adc_baseline_0U_output_mV, decoded_channels[channel_idx]._adc_baseline_0U_output_mV);
+                CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._sample_frequency_hz, decoded_channels[channel_idx]._sample_frequency_hz);
+                CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._num_samples, decoded_channels[channel_idx]._num_samples);
+            }
+        }
+
+        // seek into the middle of the blocks
+        CompressedRecord_C<double> record(2);
+        CPPUNIT_ASSERT(record.Open(_archive_dir.string(), "rec"));
+        CPPUNIT_ASSERT_EQUAL(size_t(10007), record.GetNumFrames());
+        std::vector<std::vector<double>> frames(channels.size(), std::vector<double>(3000));
+        std::vector<double*> channel_dst = { frames[0].data(), frames[1].data(), frames[2].data() };
+        CPPUNIT_ASSERT(record.DecodeFrames(1234, 3000, channel_dst.data()));
+        for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+            CPPUNIT_ASSERT(std::equal(frames[channel_idx].begin(), frames[channel_idx].end(), channels[channel_idx]._data.begin() + 1234));
+        }
+        record.Close();
+
+        // only adc values are compressed losslessly
+        auto scaled_channels = channels;
+        scaled_channels[1]._data[5] = 0.5;
+        CPPUNIT_ASSERT(!CompressedRecord_C<double>::Write((_archive_dir / "scaled.ecgz").string(), scaled_channels));
+
+        // the last block ends behind the truncated file
+        const auto filename = CompressedRecord_C<double>::GetFilename(_archive_dir.string(), "rec");
+        std::filesystem::resize_file(filename, std::filesystem::file_size(filename) - 1);
+        CPPUNIT_ASSERT(!record.Open(_archive_dir.string(), "rec"));
+        CPPUNIT_ASSERT(record.Read(_archive_dir.string(), "rec").empty());
+        CPPUNIT_ASSERT(!record.Open(_archive_dir.string(), "missing"));
+    }
+
+    //! The signal and the stream of the compressed record equal the signal and the stream of the record
+    void testTransparentLoading()
+    {
+        const auto channels = WriteTestRecord(5003);
+        CPPUNIT_ASSERT(CompressedRecord_C<double>::Write(CompressedRecord_C<double>::GetFilename(_archive_dir.string(), "rec"), channels, 512));
+
+        TimeSignal_C<double> signal;
+        signal.SetUseCache(false);
+        signal.LoadFromMITFileFormat((_record_dir / "rec").string());
+        TimeSignal_C<double> compressed_signal;
+        compressed_signal.SetUseCache(false);
+        compressed_signal.LoadFromMITFileFormat((_archive_dir / "rec").string(), 2);
+        RecordCacheTest::CompareSignals(signal, compressed_signal);
+        CPPUNIT_ASSERT(compressed_signal.constData()[2]._timestamps.size() == 5003);
+
+        MITRecordStream_C<double> stream(700);
+        CPPUNIT_ASSERT(stream.Open((_archive_dir / "rec").string()));
+        CPPUNIT_ASSERT(stream.IsCompressed());
+        CPPUNIT_ASSERT(stream.IsNative());
+        CPPUNIT_ASSERT_EQUAL(std::string("III"), stream.GetChannels()[2]._label);
+        for ( int pass = 0; pass < 2; ++pass ) {
+            RecordStreamTest::CompareBlocks(stream, signal);
+            CPPUNIT_ASSERT(stream.Rewind());
+        }
+
+        // the cache of the compressed record depends on the compressed record
+        TimeSignal_C<double> cached_signal;
+        cached_signal.LoadFromMITFileFormat((_archive_dir / "rec").string());
+        cached_signal.LoadFromMITFileFormat((_archive_dir / "rec").string());
+        CPPUNIT_ASSERT(cached_signal.IsMapped());
+        RecordCacheTest::CompareSignals(signal, cached_signal);
+    }
+
+    //! A compressed record next to the signal files is opened only, if it was written from them and they did not change
+    void testOutdatedRecordIsNotOpened()
+    {
+        const auto channels = WriteTestRecord(3000);
+        const auto source_files = WFDBNativeReader_C<double>::GetSourceFiles(_record_dir.string(), "rec");
+        CPPUNIT_ASSERT_EQUAL(size_t(2), source_files.size());
+        const auto filename = CompressedRecord_C<double>::GetFilename(_record_dir.string(), "rec");
+
+        CompressedRecord_C<double> record(2);
+        CPPUNIT_ASSERT(CompressedRecord_C<double>::Write(filename, channels, 512, 2, source_files));
+        CPPUNIT_ASSERT(record.Open(_record_dir.string(), "rec"));
+        record.Close();
+        CPPUNIT_ASSERT(!CompressedRecord_C<double>::Write(filename, channels, 512, 2, { (_record_dir / "missing.dat").string() }));
+
+        // unknown source files
+        CPPUNIT_ASSERT(CompressedRecord_C<double>::Write(filename, channels, 512));
+        CPPUNIT_ASSERT(!record.Open(_record_dir.string(), "rec"));
+
+        // the signal files changed
+        CPPUNIT_ASSERT(CompressedRecord_C<double>::Write(filename, channels, 512, 2, source_files));
+        const auto changed_channels = WriteTestRecord(2000);
+        CPPUNIT_ASSERT(!record.Open(_record_dir.string(), "rec"));
+
+        // the signal files are read instead of the outdated compressed record
+        TimeSignal_C<double> signal;
+        signal.SetUseCache(false);
+        signal.LoadFromMITFileFormat((_record_dir / "rec").string());
+        CPPUNIT_ASSERT_EQUAL(changed_channels[0]._data.size(), signal.constData()[0]._data.size());
+        MITRecordStream_C<double> stream(700);
+        CPPUNIT_ASSERT(stream.Open((_record_dir / "rec").string()));
+        CPPUNIT_ASSERT(!stream.IsCompressed());
+    }
+
+private:
+    //! Writes the record <_record_dir>/rec of 3 signals (format 212) and returns its adc values
+    std::vector<MITDataChannel_TP<double>> WriteTestRecord(size_t num_frames)
+    {
+        std::vector<int> samples(3 * num_frames);
+        for ( size_t idx = 0; idx < samples.size(); ++idx ) {
+            const size_t frame_idx = idx / 3;
+            samples[idx] = static_cast<int>(std::lround(300.0 * std::sin(0.01 * frame_idx * (idx % 3 + 1)))) + static_cast<int>(frame_idx % 7);
+        }
+        WFDBNativeReaderTest::WriteRecord(_record_dir, "rec", 212, 3, samples, true, 0);
+        return WFDBNativeReader_C<double>().Read(_record_dir.string(), "rec");
+    }
+
+    std::filesystem::path _record_dir;
+
+    std::filesystem::path _archive_dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CompressedRecordTest);
@@ -0,0 +1,144 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/decimating_qrs_detector.h"
+#include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "pan_topkins_qrs_detector_test.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+class DecimatingQRSDetectorTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(DecimatingQRSDetectorTest);
+    CPPUNIT_TEST(testDecimatorBlockMatchesSampleBySample);
+    CPPUNIT_TEST(testBeatsOnOriginalTimeline);
+    CPPUNIT_TEST(testFilterDelayIsAppliedDelay);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! The block version must produce the same output samples as Apply() sample by sample;
+    //! a constant signal passes with unity gain
+    void testDecimatorBlockMatchesSampleBySample()
+    {
+        const unsigned int decimation_factor = 5;
+        const auto taps = DesignLowpassTaps(8 * decimation_factor + 1, 57.5, 1000.0, 5.0);
+        std::vector<double> signal(1000, 1.0);
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            signal[idx] += 0.5 * std::sin(idx * 0.05);
+        }
+
+        std::vector<double> expected_output;
+        PolyphaseDecimator<double> decimator(decimation_factor, taps);
+        for ( const auto& sample : signal ) {
+            double output = 0.0;
+            if ( decimator.Apply(sample, output) ) {
+                expected_output.push_back(output);
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL(signal.size() / decimation_factor, expected_output.size());
+
+        // Use a block size which is no multiple of the decimation factor
+        const size_t block_size = 13;
+        std::vector<double> output;
+        std::vector<double> block_output(block_size / decimation_factor + 1);
+        PolyphaseDecimator<double> block_decimator(decimation_factor, taps);
+        for ( size_t idx = 0; idx < signal.size(); idx += block_size ) {
+            auto current_block_size = std::min(block_size, signal.size() - idx);
+            size_t first_output_idx = 0;
+            auto num_outputs = block_decimator.Apply(signal.data() + idx, current_block_size, block_output.data(), first_output_idx);
+            CPPUNIT_ASSERT_EQUAL(size_t(0), (idx + first_output_idx) % decimation_factor);
+            output.insert(output.end(), block_output.begin(), block_output.begin() + num_outputs);
+        }
+
+        CPPUNIT_ASSERT_EQUAL(expected_output.size(), output.size());
+        for ( size_t idx = 0; idx < output.size(); ++idx ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_output[idx], output[idx], 1e-12);
+        }
+
+        // DC gain
+        PolyphaseDecimator<double> dc_decimator(decimation_factor, taps);
+        double dc_output = 0.0;
+        for ( int idx = 0; idx < 200; ++idx ) {
+            dc_decimator.Apply(1.0, dc_output);
+        }
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, dc_output, 1e-9);
+    }
+
+    //! The beats of the decimated detection are reported at the timestamps of the detection on the original signal
+    void testBeatsOnOriginalTimeline()
+    {
+        const double sample_rate_hz = 360.0;
+        auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 10.0, 0.8);
+
+        std::vector<double> expected_beats;
+        PanTopkinsQRSDetection<double> detector(sample_rate_hz, 2);
+        detector.Connect([&](const double& timestamp) { expected_beats.push_back(timestamp); });
+
+        std::vector<double> beats;
+        DecimatingQRSDetection<double> decimating_detector(sample_rate_hz, 2);
+        decimating_detector.Connect([&](const double& timestamp) { beats.push_back(timestamp); });
+        CPPUNIT_ASSERT_EQUAL(2u, decimating_detector.GetDecimationFactor());
+
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            detector.AppendPoint(signal[idx], idx / sample_rate_hz);
+            decimating_detector.AppendPoint(signal[idx], idx / sample_rate_hz);
+        }
+
+        CPPUNIT_ASSERT(!expected_beats.empty());
+        CPPUNIT_ASSERT_EQUAL(expected_beats.size(), beats.size());
+        // within two samples of the decimated signal
+        const double tolerance_sec = 2.0 * decimating_detector.GetDecimationFactor() / sample_rate_hz;
+        for ( size_t idx = 0; idx < beats.size(); ++idx ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_beats[idx], beats[idx], tolerance_sec);
+        }
+    }
+
+    //! GetFilterDelay() is the delay subtracted from the timestamps: a beat is reported while the input sample idx is
+    //! processed, at the timestamp of the previous decimated sample (idx - decimation factor) minus the delay.
+    //! Blocks bigger than the working buffer report the same beats
+    void testFilterDelayIsAppliedDelay()
+    {
+        const double sample_rate_hz = 1000.0;
+        auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 20.0, 0.8);
+
+        size_t sample_idx = 0;
+        std::vector<double> beats;
+        DecimatingQRSDetection<double> decimating_detector(sample_rate_hz, 2);
+        const double decimation_factor = decimating_detector.GetDecimationFactor();
+        const double filter_delay = decimating_detector.GetFilterDelay();
+        decimating_detector.Connect([&](const double& timestamp) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL((sample_idx - decimation_factor - filter_delay) / sample_rate_hz, timestamp, 1e-9);
+            beats.push_back(timestamp);
+        });
+        for ( sample_idx = 0; sample_idx < signal.size(); ++sample_idx ) {
+            decimating_detector.AppendPoint(signal[sample_idx], sample_idx / sample_rate_hz);
+        }
+        CPPUNIT_ASSERT(!beats.empty());
+
+        std::vector<double> block_beats;
+        DecimatingQRSDetection<double> block_detector(sample_rate_hz, 2);
+        block_detector.Connect([&](const double& timestamp) { block_beats.push_back(timestamp); });
+        block_detector.AppendBlock(span<const double>(signal.data(), signal.size()), 0.0);
+        CPPUNIT_ASSERT_EQUAL(beats.size(), block_beats.size());
+        for ( size_t idx = 0; idx < beats.size(); ++idx ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(beats[idx], block_beats[idx], 1e-9);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DecimatingQRSDetectorTest);
@@ -0,0 +1,179 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/fft_convolution.h"
+#include "../../signal_proc_lib/qrs_filter_chain.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <complex>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+class FFTConvolutionTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(FFTConvolutionTest);
+    CPPUNIT_TEST(testFFTEqualsDFT);
+    CPPUNIT_TEST(testFFTAndDirectEqualReference);
+    CPPUNIT_TEST(testZeroPhaseBandpass);
+    CPPUNIT_TEST(testParallelChannels);
+    CPPUNIT_TEST(testRuntimeTapsEqualCompileTimeTaps);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! Forward transform equals the DFT, the inverse transform restores the input (scaled by the size)
+    void testFFTEqualsDFT()
+    {
+        std::mt19937 generator(3);
+        std::normal_distribution<double> distribution(0.0, 1.0);
+        for ( const size_t size : { 1, 2, 4, 8, 64, 512 } ) {
+            std::vector<std::complex<double>> signal(size);
+            for ( auto& value : signal ) {
+                value = std::complex<double>(distribution(generator), distribution(generator));
+            }
+            auto spectrum = signal;
+            const auto plan = FFTPlan_C::Get(size);
+            CPPUNIT_ASSERT_EQUAL(size, plan->GetSize());
+            // the plan is cached
+            CPPUNIT_ASSERT(plan == FFTPlan_C::Get(size));
+            plan->Forward(spectrum.data());
+
+            for ( size_t k = 0; k < size; ++k ) {
+                std::complex<double> expected(0.0, 0.0);
+                for ( size_t n = 0; n < size; ++n ) {
+                    expected += signal[n] * std::polar(1.0, -2.0 * constexpr_pi * k * n / size);
+                }
+                CPPUNIT_ASSERT(std::abs(expected - spectrum[k]) < 1e-9);
+            }
+
+            plan->Inverse(spectrum.data());
+            for ( size_t n = 0; n < size; ++n ) {
+                CPPUNIT_ASSERT(std::abs(signal[n] - spectrum[n] / static_cast<double>(size)) < 1e-12);
+            }
+        }
+    }
+
+    //! Both methods equal the convolution with constant extension at the edges,
+    //! for signals shorter than the filter, shorter than one chunk and longer than multiple chunks
+    void testFFTAndDirectEqualReference()
+    {
+        std::mt19937 generator(5);
+        std::normal_distribution<double> distribution(0.0, 1.0);
+        for ( const unsigned int num_taps : { 1u, 2u, 31u, 64u, 257u, 501u } ) {
+            std::vector<double> taps(num_taps);
+            for ( auto& tap : taps ) {
+                tap = distribution(generator);
+            }
+            for ( const size_t num_samples : { 1, 100, 1000, 10007 } ) {
+                std::vector<double> signal(num_samples);
+                for ( auto& sample : signal ) {
+                    sample = distribution(generator);
+                }
+                for ( const bool compensate_delay : { false, true } ) {
+                    const auto expected = ReferenceConvolution(signal, taps, compensate_delay);
+                    for ( const auto method : { ConvolutionMethod_TP::Direct, ConvolutionMethod_TP::FFT } ) {
+                        OfflineFIRFilter<double> filter(taps, compensate_delay, method);
+                        CPPUNIT_ASSERT(method == filter.GetMethod());
+                        auto output = signal;
+                        filter.Apply(output);
+                        for ( size_t idx = 0; idx < num_samples; ++idx ) {
+                            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[idx], output[idx], 1e-9);
+                        }
+                    }
+                }
+            }
+        }
+
+        CPPUNIT_ASSERT(OfflineFIRFilter<double>(std::vector<double>(fft_crossover_num_taps - 1, 1.0)).GetMethod() == ConvolutionMethod_TP::Direct);
+        CPPUNIT_ASSERT(OfflineFIRFilter<double>(std::vector<double>(fft_crossover_num_taps, 1.0)).GetMethod() == ConvolutionMethod_TP::FFT);
+    }
+
+    //! A 501 tap linear phase bandpass with delay compensation passes a sine inside the passband without phase shift
+    //! and removes the baseline offset
+    void testZeroPhaseBandpass()
+    {
+        const double sample_rate_hz = 360.0;
+        OfflineFIRFilter<float> filter(DesignBandpassTaps(501, 2.0, 40.0, sample_rate_hz, 6.0));
+        CPPUNIT_ASSERT(filter.GetMethod() == ConvolutionMethod_TP::FFT);
+
+        std::vector<float> signal(static_cast<size_t>(20.0 * sample_rate_hz));
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            signal[idx] = static_cast<float>(2.0 + std::sin(2.0 * constexpr_pi * 10.0 * idx / sample_rate_hz));
+        }
+        filter.Apply(signal);
+        // skip the edges
+        for ( size_t idx = 1000; idx < signal.size() - 1000; ++idx ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(std::sin(2.0 * constexpr_pi * 10.0 * idx / sample_rate_hz), signal[idx], 0.01);
+        }
+    }
+
+    //! Filtering all channels in parallel equals filtering them one after another
+    void testParallelChannels()
+    {
+        std::mt19937 generator(7);
+        std::normal_distribution<double> distribution(0.0, 1.0);
+        std::vector<ECGChannelInfo_TP<double>> channels(5);
+        for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+            channels[channel_idx]._data.resize(20000 + 1000 * channel_idx);
+            for ( auto& sample : channels[channel_idx]._data ) {
+                sample = distribution(generator);
+            }
+        }
+        auto expected = channels;
+
+        OfflineFIRFilter<double> filter(DesignBandpassTaps(301, 0.5, 40.0, 360.0, 6.0));
+        for ( auto& channel : expected ) {
+            filter.Apply(channel);
+        }
+        filter.Apply(channels, 3);
+        for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+            CPPUNIT_ASSERT(expected[channel_idx]._data == channels[channel_idx]._data);
+            CPPUNIT_ASSERT_EQUAL(*std::max_element(expected[channel_idx]._data.begin(), expected[channel_idx]._data.end()),
+                                 channels[channel_idx]._max_val);
+        }
+    }
+
+    //! The runtime design returns exactly the taps of the compile time design
+    void testRuntimeTapsEqualCompileTimeTaps()
+    {
+        constexpr auto compile_time_taps = DesignBandpassTaps<QRSFilterParams_TP::_num_taps>(QRSFilterParams_TP::_highpass_cutoff_hz,
+                                                                                              QRSFilterParams_TP::_lowpass_cutoff_hz,
+                                                                                              360.0,
+                                                                                              QRSFilterParams_TP::_kaiser_beta);
+        const auto runtime_taps = DesignBandpassTaps(QRSFilterParams_TP::_num_taps,
+                                                     QRSFilterParams_TP::_highpass_cutoff_hz,
+                                                     QRSFilterParams_TP::_lowpass_cutoff_hz,
+                                                     360.0,
+                                                     QRSFilterParams_TP::_kaiser_beta);
+        CPPUNIT_ASSERT(std::equal(compile_time_taps.begin(), compile_time_taps.end(), runtime_taps.begin(), runtime_taps.end()));
+    }
+
+    //! y[n] = sum_k taps[k] x[n + delay - k], with x constant outside of the signal
+    static std::vector<double> ReferenceConvolution(const std::vector<double>& signal, const std::vector<double>& taps, bool compensate_delay)
+    {
+        const long long delay = compensate_delay ? (static_cast<long long>(taps.size()) - 1) / 2 : 0;
+        const long long num_samples = static_cast<long long>(signal.size());
+        std::vector<double> output(signal.size(), 0.0);
+        for ( long long n = 0; n < num_samples; ++n ) {
+            for ( long long k = 0; k < static_cast<long long>(taps.size()); ++k ) {
+                output[n] += taps[k] * signal[std::clamp(n + delay - k, 0LL, num_samples - 1)];
+            }
+        }
+        return output;
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FFTConvolutionTest);
@@ -0,0 +1,115 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/rt_state_filters.h"
+#include "../../signal_proc_lib/qrs_filter_chain.h"
+#include "pan_topkins_qrs_detector_test.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+class FilterPipelineTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(FilterPipelineTest);
+    CPPUNIT_TEST(testPipelineMatchesSeparateFilters);
+    CPPUNIT_TEST(testResetState);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! The fused pipeline filters like the stages applied one after another on the whole signal,
+    //! per sample and in blocks of any size
+    void testPipelineMatchesSeparateFilters()
+    {
+        const double sample_rate_hz = 360.0;
+        auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 10.0, 0.8);
+        const auto taps = DesignBandpassTaps<QRSFilterParams_TP::_num_taps>(QRSFilterParams_TP::_highpass_cutoff_hz,
+                                                                            QRSFilterParams_TP::_lowpass_cutoff_hz,
+                                                                            sample_rate_hz,
+                                                                            QRSFilterParams_TP::_kaiser_beta);
+        const int window_length = 54;
+
+        // one stage after another
+        std::vector<double> expected(signal.size());
+        FIRStateFilter<double, QRSFilterParams_TP::_num_taps> bandpass(taps);
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            expected[idx] = bandpass.Process(signal[idx]);
+        }
+        DerivationStateFilter<double> diff_filter;
+        diff_filter.Apply(expected.data(), expected.size());
+        for ( auto& sample : expected ) {
+            sample = sample * sample;
+        }
+        // sample by sample: the block version of the moving average differs by rounding (see MovingAverageTest)
+        MovingAverageStateFilter<double> ma_filter(window_length);
+        for ( auto& sample : expected ) {
+            ma_filter.Apply(sample);
+        }
+
+        using Pipeline_TP = FilterPipeline<FIRStateFilter<double, QRSFilterParams_TP::_num_taps>,
+                                           DerivationStateFilter<double>,
+                                           SquaringStateFilter<double>,
+                                           MovingAverageStateFilter<double>>;
+
+        std::vector<double> output_per_sample(signal.size());
+        Pipeline_TP pipeline_per_sample(FIRStateFilter<double, QRSFilterParams_TP::_num_taps>(taps), {}, {},
+                                        MovingAverageStateFilter<double>(window_length));
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            output_per_sample[idx] = pipeline_per_sample.Process(signal[idx]);
+        }
+
+        // in place, in blocks which do not divide the signal length
+        std::vector<double> output_block = signal;
+        Pipeline_TP pipeline_block(FIRStateFilter<double, QRSFilterParams_TP::_num_taps>(taps), {}, {},
+                                   MovingAverageStateFilter<double>(window_length));
+        const size_t block_size = 97;
+        for ( size_t idx = 0; idx < output_block.size(); idx += block_size ) {
+            const size_t current_block_size = std::min(block_size, output_block.size() - idx);
+            pipeline_block.Apply(output_block.data() + idx, output_block.data() + idx, current_block_size);
+        }
+
+        // with the window length known at compile time
+        std::vector<double> output_fixed_length(signal.size());
+        FilterPipeline<FIRStateFilter<double, QRSFilterParams_TP::_num_taps>,
+                       DerivationStateFilter<double>,
+                       SquaringStateFilter<double>,
+                       FixedLengthMovingAverageStateFilter<double, window_length>>
+            pipeline_fixed_length(FIRStateFilter<double, QRSFilterParams_TP::_num_taps>(taps), {}, {}, {});
+        pipeline_fixed_length.Apply(output_fixed_length.data(), signal.data(), signal.size());
+
+        for ( size_t idx = 0; idx < expected.size(); ++idx ) {
+            CPPUNIT_ASSERT_EQUAL(expected[idx], output_per_sample[idx]);
+            CPPUNIT_ASSERT_EQUAL(expected[idx], output_block[idx]);
+            CPPUNIT_ASSERT_EQUAL(expected[idx], output_fixed_length[idx]);
+        }
+    }
+
+    //! After ResetState() the pipeline filters like a new one
+    void testResetState()
+    {
+        auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(250.0, 5.0, 0.8);
+        FilterPipeline<DerivationStateFilter<double>, SquaringStateFilter<double>, FixedLengthMovingAverageStateFilter<double, 37>> pipeline;
+
+        std::vector<double> first_output(signal.size());
+        pipeline.Apply(first_output.data(), signal.data(), signal.size());
+        pipeline.ResetState();
+        std::vector<double> second_output(signal.size());
+        pipeline.Apply(second_output.data(), signal.data(), signal.size());
+
+        CPPUNIT_ASSERT(first_output == second_output);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FilterPipelineTest);
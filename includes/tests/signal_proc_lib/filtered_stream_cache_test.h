@@ -0,0 +1,158 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/filtered_stream_cache.h"
+#include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "pan_topkins_qrs_detector_test.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+
+class FilteredStreamCacheTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(FilteredStreamCacheTest);
+    CPPUNIT_TEST(testStreamsMatchFilterChains);
+    CPPUNIT_TEST(testReferenceCountedTeardown);
+    CPPUNIT_TEST(testDetectorsShareIntegratedStream);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! The integrated streams are identical to the output of the filter chains of the detector
+    //! (300 Hz uses the runtime design), the bandpassed streams to the bandpass alone, for blocks of varying size
+    void testStreamsMatchFilterChains()
+    {
+        const double sample_rate_hz = 300.0;
+        const auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 30.0, 0.8);
+
+        for ( const auto bandpass : { QRSBandpass_TP::FIR, QRSBandpass_TP::ButterworthIIR } ) {
+            FilteredStreamCache_TC<double> cache(sample_rate_hz);
+            const auto integrated = cache.Acquire({ QRSStreamStage_TP::Integrated, bandpass });
+            const auto bandpassed = cache.Acquire({ QRSStreamStage_TP::Bandpassed, bandpass });
+            CPPUNIT_ASSERT_EQUAL(size_t(4), cache.GetStreamCount());
+
+            auto filter_chain = CreateQRSFilterChain<double>(sample_rate_hz, bandpass);
+            std::vector<double> expected_integrated(signal.size());
+            filter_chain->Apply(expected_integrated.data(), signal.data(), signal.size());
+
+            std::vector<double> integrated_output;
+            std::vector<double> bandpassed_output;
+            size_t block_size = 1;
+            for ( size_t idx = 0; idx < signal.size(); idx += block_size ) {
+                block_size = std::min(1 + (idx % 500), signal.size() - idx);
+                const double t0_sec = idx / sample_rate_hz;
+                cache.AppendBlock(span<const double>(signal.data() + idx, block_size), t0_sec);
+                CPPUNIT_ASSERT_EQUAL(block_size, integrated->GetBlock().size());
+                CPPUNIT_ASSERT_EQUAL(t0_sec, integrated->GetBlockTimestamp());
+                integrated_output.insert(integrated_output.end(), integrated->GetBlock().begin(), integrated->GetBlock().end());
+                bandpassed_output.insert(bandpassed_output.end(), bandpassed->GetBlock().begin(), bandpassed->GetBlock().end());
+            }
+            CPPUNIT_ASSERT(expected_integrated == integrated_output);
+
+            if ( bandpass == QRSBandpass_TP::FIR ) {
+                FIRStateFilter<double, QRSFilterParams_TP::_num_taps> fir(
+                    DesignBandpassTaps<QRSFilterParams_TP::_num_taps>(QRSFilterParams_TP::_highpass_cutoff_hz,
+                                                                      QRSFilterParams_TP::_lowpass_cutoff_hz,
+                                                                      sample_rate_hz,
+                                                                      QRSFilterParams_TP::_kaiser_beta));
+                for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+                    CPPUNIT_ASSERT_EQUAL(fir.Process(signal[idx]), bandpassed_output[idx]);
+                }
+                CPPUNIT_ASSERT_EQUAL(QRSFilterParams_TP::_num_taps / 2, bandpassed->GetFilterDelay());
+            }
+            // the integrated stream adds the half window of the moving average (150 ms)
+            CPPUNIT_ASSERT_EQUAL(bandpassed->GetFilterDelay() + 22u, integrated->GetFilterDelay());
+        }
+    }
+
+    //! A stream lives as long as a consumer or a derived stream holds it; released streams leave the cache with the next block
+    void testReferenceCountedTeardown()
+    {
+        const double sample_rate_hz = 360.0;
+        const std::vector<double> block(100, 1.0);
+        FilteredStreamCache_TC<double> cache(sample_rate_hz);
+
+        auto integrated = cache.Acquire({ QRSStreamStage_TP::Integrated, QRSBandpass_TP::FIR });
+        auto squared = cache.Acquire({ QRSStreamStage_TP::Squared, QRSBandpass_TP::FIR });
+        // the same configuration is shared
+        CPPUNIT_ASSERT(squared == cache.Acquire({ QRSStreamStage_TP::Squared, QRSBandpass_TP::FIR }));
+        CPPUNIT_ASSERT_EQUAL(size_t(4), cache.GetStreamCount());
+        cache.AppendBlock(span<const double>(block.data(), block.size()), 0.0);
+
+        // the squared stream is still the source of the integrated stream
+        std::weak_ptr<const FilteredStream_TC<double>> weak_squared = squared;
+        squared.reset();
+        CPPUNIT_ASSERT(!weak_squared.expired());
+        cache.AppendBlock(span<const double>(block.data(), block.size()), 0.0);
+        CPPUNIT_ASSERT_EQUAL(size_t(4), cache.GetStreamCount());
+
+        // releasing the last consumer tears down the whole chain
+        std::weak_ptr<const FilteredStream_TC<double>> weak_integrated = integrated;
+        integrated.reset();
+        CPPUNIT_ASSERT(weak_integrated.expired());
+        CPPUNIT_ASSERT(weak_squared.expired());
+        cache.AppendBlock(span<const double>(block.data(), block.size()), 0.0);
+        CPPUNIT_ASSERT_EQUAL(size_t(0), cache.GetStreamCount());
+
+        // a new stream starts with the next block
+        auto bandpassed = cache.Acquire({ QRSStreamStage_TP::Bandpassed, QRSBandpass_TP::ButterworthIIR });
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.GetStreamCount());
+        CPPUNIT_ASSERT_EQUAL(size_t(0), bandpassed->GetBlock().size());
+        cache.AppendBlock(span<const double>(block.data(), block.size()), 1.0);
+        CPPUNIT_ASSERT_EQUAL(block.size(), bandpassed->GetBlock().size());
+        CPPUNIT_ASSERT_EQUAL(1.0, bandpassed->GetBlockTimestamp());
+    }
+
+    //! Two detectors, which read the one integrated stream, detect the same beats as a detector with its own filter chain
+    void testDetectorsShareIntegratedStream()
+    {
+        const double sample_rate_hz = 360.0;
+        const auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 120.0, 0.8);
+
+        std::vector<double> expected_beats;
+        PanTopkinsQRSDetection<double> reference_detector(sample_rate_hz, 2);
+        reference_detector.Connect([&](const double& timestamp) { expected_beats.push_back(timestamp); });
+
+        FilteredStreamCache_TC<double> cache(sample_rate_hz);
+        const auto integrated = cache.Acquire({ QRSStreamStage_TP::Integrated, QRSBandpass_TP::FIR });
+        std::vector<double> beats_0;
+        std::vector<double> beats_1;
+        PanTopkinsQRSDetection<double> detector_0(sample_rate_hz, 2);
+        PanTopkinsQRSDetection<double> detector_1(sample_rate_hz, 2);
+        detector_0.Connect([&](const double& timestamp) { beats_0.push_back(timestamp); });
+        detector_1.Connect([&](const double& timestamp) { beats_1.push_back(timestamp); });
+
+        const size_t block_size = 256;
+        for ( size_t idx = 0; idx < signal.size(); idx += block_size ) {
+            const span<const double> block(signal.data() + idx, std::min(block_size, signal.size() - idx));
+            reference_detector.AppendBlock(block, idx / sample_rate_hz);
+            cache.AppendBlock(block, idx / sample_rate_hz);
+            detector_0.AppendFilteredBlock(integrated->GetBlock(), integrated->GetBlockTimestamp());
+            detector_1.AppendFilteredBlock(integrated->GetBlock(), integrated->GetBlockTimestamp());
+        }
+
+        // the stream uses the runtime filter design, which differs from the compile time design only by rounding
+        CPPUNIT_ASSERT(!expected_beats.empty());
+        CPPUNIT_ASSERT(beats_0 == beats_1);
+        CPPUNIT_ASSERT_EQUAL(expected_beats.size(), beats_0.size());
+        for ( size_t idx = 0; idx < expected_beats.size(); ++idx ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_beats[idx], beats_0[idx], 1e-9);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FilteredStreamCacheTest);
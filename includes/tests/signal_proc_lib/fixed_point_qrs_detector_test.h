@@ -0,0 +1,101 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/fixed_point_qrs_detector.h"
+#include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "pan_topkins_qrs_detector_test.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+class FixedPointQRSDetectorTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(FixedPointQRSDetectorTest);
+    CPPUNIT_TEST(testSameBeatsAsFloatingPoint);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! The fixed point detection on ADC counts reports the same beats as the floating point detection on the same counts,
+    //! AppendBlock() the same beats as AppendPoint()
+    void testSameBeatsAsFloatingPoint()
+    {
+        // full range of the sample type
+        CheckSameBeatsAsFloatingPoint<int16_t>(360.0, 0);
+        CheckSameBeatsAsFloatingPoint<int16_t>(250.0, 0);
+        CheckSameBeatsAsFloatingPoint<int16_t>(1000.0, 0);
+        // resolution of the MIT-BIH ADC
+        CheckSameBeatsAsFloatingPoint<int16_t>(360.0, 11);
+        CheckSameBeatsAsFloatingPoint<int32_t>(360.0, 11);
+        CheckSameBeatsAsFloatingPoint<int32_t>(1000.0, 11);
+        // 24 bit ADC
+        CheckSameBeatsAsFloatingPoint<int32_t>(500.0, 24);
+    }
+
+    template<typename SampleType_TP>
+    void CheckSameBeatsAsFloatingPoint(double sample_rate_hz, unsigned int adc_resolution_bits)
+    {
+        // 200 counts per mV at 11 bit like the MIT-BIH arrhythmia database, scaled to the ADC resolution
+        const unsigned int used_bits = adc_resolution_bits == 0 ? 8 * sizeof(SampleType_TP) : adc_resolution_bits;
+        const double counts_per_mv = std::ldexp(200.0, used_bits - 11);
+        const long baseline = 1l << (used_bits - 2);
+        auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 60.0, 0.8);
+        std::vector<SampleType_TP> counts(signal.size());
+        std::vector<double> float_counts(signal.size());
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            counts[idx] = static_cast<SampleType_TP>(std::lround(signal[idx] * counts_per_mv) + baseline);
+            float_counts[idx] = counts[idx];
+        }
+
+        std::vector<double> expected_beats;
+        PanTopkinsQRSDetection<double> detector(sample_rate_hz, 2);
+        detector.Connect([&](const double& timestamp) { expected_beats.push_back(timestamp); });
+        for ( size_t idx = 0; idx < float_counts.size(); ++idx ) {
+            detector.AppendPoint(float_counts[idx], idx / sample_rate_hz);
+        }
+
+        std::vector<double> beats_per_sample;
+        FixedPointQRSDetection<SampleType_TP> fixed_detector_per_sample(sample_rate_hz, 2, adc_resolution_bits);
+        fixed_detector_per_sample.Connect([&](const double& timestamp) { beats_per_sample.push_back(timestamp); });
+        for ( size_t idx = 0; idx < counts.size(); ++idx ) {
+            fixed_detector_per_sample.AppendPoint(counts[idx], idx / sample_rate_hz);
+        }
+
+        // Use a block size which is bigger than the internal chunks and does not divide the signal length
+        const size_t block_size = 1001;
+        std::vector<double> beats_block;
+        FixedPointQRSDetection<SampleType_TP> fixed_detector_block(sample_rate_hz, 2, adc_resolution_bits);
+        fixed_detector_block.Connect([&](const double& timestamp) { beats_block.push_back(timestamp); });
+        for ( size_t idx = 0; idx < counts.size(); idx += block_size ) {
+            auto current_block_size = std::min(block_size, counts.size() - idx);
+            fixed_detector_block.AppendBlock(span<const SampleType_TP>(counts.data() + idx, current_block_size),
+                                             idx / sample_rate_hz);
+        }
+
+        CPPUNIT_ASSERT(!expected_beats.empty());
+        CPPUNIT_ASSERT_EQUAL(expected_beats.size(), beats_per_sample.size());
+        CPPUNIT_ASSERT_EQUAL(expected_beats.size(), beats_block.size());
+        // The quantized taps can move the maximum of the integrated signal to the neighbouring sample
+        const double tolerance_sec = 1.0 / sample_rate_hz + 1e-9;
+        for ( size_t idx = 0; idx < expected_beats.size(); ++idx ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_beats[idx], beats_per_sample[idx], tolerance_sec);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(beats_per_sample[idx], beats_block[idx], 1e-9);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FixedPointQRSDetectorTest);
@@ -0,0 +1,128 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/rt_state_filters.h"
+#include "../../signal_proc_lib/qrs_filter_chain.h"
+#include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "pan_topkins_qrs_detector_test.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+class IIRBandpassTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(IIRBandpassTest);
+    CPPUNIT_TEST(testFrequencyResponse);
+    CPPUNIT_TEST(testBlockEqualsSampleBySample);
+    CPPUNIT_TEST(testDetectorAppendBlockMatchesAppendPoint);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! The designed sections have unity gain in the center of the passband and block DC and high frequencies.
+    //! The filtered sine waves have the amplitude of the designed response
+    void testFrequencyResponse()
+    {
+        // designed at compile time
+        constexpr auto sections = DesignButterworthBandpassSections(5.0, 11.0, 360.0);
+        static_assert(BiquadCascadeGroupDelay(sections, 8.0, 360.0) > 0.0);
+
+        for ( const double sample_rate_hz : { 250.0, 360.0, 1000.0 } ) {
+            const auto designed_sections = DesignButterworthBandpassSections(5.0, 11.0, sample_rate_hz);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, BiquadCascadeGain(designed_sections, 8.0, sample_rate_hz), 1e-9);
+            CPPUNIT_ASSERT(BiquadCascadeGain(designed_sections, 0.0, sample_rate_hz) < 1e-9);
+            CPPUNIT_ASSERT(BiquadCascadeGain(designed_sections, 60.0, sample_rate_hz) < 0.05);
+
+            for ( const double freq_hz : { 1.0, 5.0, 8.0, 11.0, 30.0 } ) {
+                BiquadCascadeStateFilter<double, QRSFilterParams_TP::_num_iir_sections> filter(designed_sections);
+                const size_t num_samples = static_cast<size_t>(10.0 * sample_rate_hz);
+                // amplitude of the output (correlation with sine and cosine) after the transient response, over full periods
+                double sin_sum = 0.0;
+                double cos_sum = 0.0;
+                for ( size_t idx = 0; idx < num_samples; ++idx ) {
+                    const double phase = 2.0 * constexpr_pi * freq_hz * idx / sample_rate_hz;
+                    const double output = filter.Process(std::sin(phase));
+                    if ( idx >= num_samples / 2 ) {
+                        sin_sum += output * std::sin(phase);
+                        cos_sum += output * std::cos(phase);
+                    }
+                }
+                const double amplitude = 2.0 * std::sqrt(sin_sum * sin_sum + cos_sum * cos_sum) / (num_samples - num_samples / 2);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(BiquadCascadeGain(designed_sections, freq_hz, sample_rate_hz), amplitude, 1e-3);
+            }
+        }
+    }
+
+    //! The block version filters like Process(), also across blocks and after ResetState()
+    void testBlockEqualsSampleBySample()
+    {
+        const double sample_rate_hz = 360.0;
+        auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 10.0, 0.8);
+        const auto sections = DesignButterworthBandpassSections(5.0, 11.0, sample_rate_hz);
+
+        BiquadCascadeStateFilter<double, QRSFilterParams_TP::_num_iir_sections> filter_per_sample(sections);
+        std::vector<double> expected(signal.size());
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            expected[idx] = filter_per_sample.Process(signal[idx]);
+        }
+
+        BiquadCascadeStateFilter<double, QRSFilterParams_TP::_num_iir_sections> filter_block(sections);
+        std::vector<double> output = signal;
+        // the state of the first run must be cleared
+        filter_block.Apply(output.data(), 100);
+        filter_block.ResetState();
+        output = signal;
+        const size_t block_size = 97;
+        for ( size_t idx = 0; idx < output.size(); idx += block_size ) {
+            filter_block.Apply(output.data() + idx, std::min(block_size, output.size() - idx));
+        }
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            CPPUNIT_ASSERT_EQUAL(expected[idx], output[idx]);
+        }
+    }
+
+    void testDetectorAppendBlockMatchesAppendPoint()
+    {
+        const double sample_rate_hz = 360.0;
+        auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 60.0, 0.8);
+
+        std::vector<double> beats_per_sample;
+        PanTopkinsQRSDetection<double> detector_per_sample(sample_rate_hz, 2, QRSBandpass_TP::ButterworthIIR);
+        detector_per_sample.Connect([&](const double& timestamp) { beats_per_sample.push_back(timestamp); });
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            detector_per_sample.AppendPoint(signal[idx], idx / sample_rate_hz);
+        }
+
+        const size_t block_size = 97;
+        std::vector<double> beats_block;
+        PanTopkinsQRSDetection<double> detector_block(sample_rate_hz, 2, QRSBandpass_TP::ButterworthIIR);
+        detector_block.Connect([&](const double& timestamp) { beats_block.push_back(timestamp); });
+        for ( size_t idx = 0; idx < signal.size(); idx += block_size ) {
+            auto current_block_size = std::min(block_size, signal.size() - idx);
+            detector_block.AppendBlock(span<const double>(signal.data() + idx, current_block_size), idx / sample_rate_hz);
+        }
+
+        CPPUNIT_ASSERT(!beats_per_sample.empty());
+        CPPUNIT_ASSERT_EQUAL(beats_per_sample.size(), beats_block.size());
+        for ( size_t idx = 0; idx < beats_block.size(); ++idx ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(beats_per_sample[idx], beats_block[idx], 1e-9);
+        }
+        // less delay than the FIR bandpass
+        CPPUNIT_ASSERT(detector_block.GetFilterDelay() < PanTopkinsQRSDetection<double>(sample_rate_hz, 2).GetFilterDelay());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(IIRBandpassTest);
@@ -1,3 +1,28 @@
+// Project includes
+#include "pan_topkins_qrs_detector_test.h"
+#include "multi_channel_qrs_detector_test.h"
+#include "offline_qrs_detector_test.h"
+#include "decimating_qrs_detector_test.h"
+#include "spsc_queue_test.h"
+#include "fixed_point_qrs_detector_test.h"
+#include "zero_allocation_test.h"
+#include "thread_pool_test.h"
+#include "filter_pipeline_test.h"
+#include "moving_average_test.h"
+#include "peak_detector_test.h"
+#include "iir_bandpass_test.h"
+#include "running_median_test.h"
+#include "powerline_notch_test.h"
+#include "fft_convolution_test.h"
+#include "polyphase_resampler_test.h"
+#include "filtered_stream_cache_test.h"
+#include "signal_presence_gate_test.h"
+#include "wfdb_native_reader_test.h"
+#include "record_stream_test.h"
+#include "text_column_parser_test.h"
+#include "record_cache_test.h"
+#include "compressed_record_test.h"
+
 // CPPUnit includes
 #include "cppunit/CompilerOutputter.h"
 #include "cppunit/XmlOutputter.h"
@@ -0,0 +1,102 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/rt_state_filters.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+class MovingAverageTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(MovingAverageTest);
+    CPPUNIT_TEST(testNoDriftOver24Hours);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! Sample by sample and block version stay within the tolerance of the exact moving average over 24 hours
+    //! at 360 Hz. After the signal, a silent minute must be averaged to exactly zero (no residual of the sum).
+    //! Tolerance relative to the biggest input: 5e-7 for float, 1e-14 for double
+    //! (the running sum without re-anchoring drifts to about 3e-6 for float)
+    void testNoDriftOver24Hours()
+    {
+        CheckNoDrift<float>(5e-7);
+        CheckNoDrift<double>(1e-14);
+    }
+
+    template<typename DataType_TP>
+    static void CheckNoDrift(double tolerance)
+    {
+        const double sample_rate_hz = 360.0;
+        const size_t num_samples = static_cast<size_t>(24.0 * 3600.0 * sample_rate_hz);
+        const size_t num_silent_samples = static_cast<size_t>(60.0 * sample_rate_hz);
+        constexpr unsigned int window_length = 54;
+
+        MovingAverageStateFilter<DataType_TP> filter_per_sample(window_length);
+        MovingAverageStateFilter<DataType_TP> filter_block(window_length);
+        FixedLengthMovingAverageStateFilter<DataType_TP, window_length> filter_fixed_length;
+
+        // exact reference
+        std::vector<long double> window(window_length, 0.0L);
+        long double window_sum = 0.0L;
+
+        // The block size does not divide the chunks of the filter
+        const size_t block_size = 1000;
+        std::vector<DataType_TP> block(block_size);
+        std::vector<DataType_TP> input(block_size);
+        double max_error_per_sample = 0.0;
+        double max_error_block = 0.0;
+        double max_error_fixed_length = 0.0;
+        DataType_TP last_output_per_sample = 0;
+        DataType_TP last_output_fixed_length = 0;
+        for ( size_t block_begin = 0; block_begin < num_samples + num_silent_samples; block_begin += block_size ) {
+            const size_t current_block_size = std::min(block_size, num_samples + num_silent_samples - block_begin);
+            for ( size_t idx = 0; idx < current_block_size; ++idx ) {
+                // squared ecg like signal (like the input of the moving average inside the qrs detection)
+                const size_t sample_idx = block_begin + idx;
+                const double phase_sec = std::fmod(sample_idx / sample_rate_hz, 0.8);
+                const double ecg = std::exp(-std::pow((phase_sec - 0.4) / 0.012, 2)) + 0.01 * std::sin(sample_idx * 0.37);
+                input[idx] = sample_idx < num_samples ? static_cast<DataType_TP>(ecg * ecg) : DataType_TP(0);
+                block[idx] = input[idx];
+            }
+
+            filter_block.Apply(block.data(), current_block_size);
+
+            for ( size_t idx = 0; idx < current_block_size; ++idx ) {
+                const size_t window_idx = (block_begin + idx) % window_length;
+                window_sum += static_cast<long double>(input[idx]) - window[window_idx];
+                window[window_idx] = input[idx];
+                const double expected = static_cast<double>(window_sum / window_length);
+
+                last_output_per_sample = filter_per_sample.Process(input[idx]);
+                last_output_fixed_length = filter_fixed_length.Process(input[idx]);
+                max_error_per_sample = std::max(max_error_per_sample, std::abs(last_output_per_sample - expected));
+                max_error_fixed_length = std::max(max_error_fixed_length, std::abs(last_output_fixed_length - expected));
+                max_error_block = std::max(max_error_block, std::abs(block[idx] - expected));
+            }
+        }
+
+        // the biggest input is about one
+        CPPUNIT_ASSERT(max_error_per_sample < tolerance);
+        CPPUNIT_ASSERT(max_error_fixed_length < tolerance);
+        CPPUNIT_ASSERT(max_error_block < tolerance);
+        CPPUNIT_ASSERT_EQUAL(DataType_TP(0), last_output_per_sample);
+        CPPUNIT_ASSERT_EQUAL(DataType_TP(0), last_output_fixed_length);
+        CPPUNIT_ASSERT_EQUAL(DataType_TP(0), block[(num_samples + num_silent_samples - 1) % block_size]);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MovingAverageTest);
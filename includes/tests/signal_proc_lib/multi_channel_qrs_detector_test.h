@@ -0,0 +1,98 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/multi_channel_qrs_detector.h"
+#include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "pan_topkins_qrs_detector_test.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+
+class MultiChannelQRSDetectorTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(MultiChannelQRSDetectorTest);
+    CPPUNIT_TEST(testChannelsMatchSingleChannelDetector);
+    CPPUNIT_TEST(testDetectionWithoutCallback);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! Each lane of the multi channel detector must detect the same beats as 
+    //! an own PanTopkinsQRSDetection for this channel.
+    void testChannelsMatchSingleChannelDetector()
+    {
+        const double sample_rate_hz = 360.0;
+        const unsigned int num_channels = 5;
+        // Different heart rates and amplitudes, so each lane has other thresholds
+        std::vector<std::vector<double>> channels;
+        for ( unsigned int channel = 0; channel < num_channels; ++channel ) {
+            auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 30.0, 0.6 + 0.1 * channel);
+            for ( auto& sample : signal ) {
+                sample *= 0.5 + channel;
+            }
+            channels.push_back(signal);
+        }
+        const size_t num_samples = channels[0].size();
+
+        // Reference: one detector per channel
+        std::vector<std::vector<double>> expected_beats(num_channels);
+        for ( unsigned int channel = 0; channel < num_channels; ++channel ) {
+            PanTopkinsQRSDetection<double> detector(sample_rate_hz, 2);
+            detector.Connect([&](const double& timestamp) { expected_beats[channel].push_back(timestamp); });
+            for ( size_t idx = 0; idx < num_samples; ++idx ) {
+                detector.AppendPoint(channels[channel][idx], idx / sample_rate_hz);
+            }
+        }
+
+        // Interleave the channels into frames
+        std::vector<double> frames(num_samples * num_channels);
+        for ( size_t idx = 0; idx < num_samples; ++idx ) {
+            for ( unsigned int channel = 0; channel < num_channels; ++channel ) {
+                frames[idx * num_channels + channel] = channels[channel][idx];
+            }
+        }
+
+        std::vector<std::vector<double>> beats(num_channels);
+        MultiChannelQRSDetection<double> multi_detector(sample_rate_hz, num_channels, 2);
+        multi_detector.Connect([&](unsigned int channel, const double& timestamp) { beats[channel].push_back(timestamp); });
+        for ( size_t idx = 0; idx < num_samples; ++idx ) {
+            multi_detector.AppendFrame(frames.data() + idx * num_channels, idx / sample_rate_hz);
+        }
+
+        for ( unsigned int channel = 0; channel < num_channels; ++channel ) {
+            CPPUNIT_ASSERT(!expected_beats[channel].empty());
+            CPPUNIT_ASSERT_EQUAL(expected_beats[channel].size(), beats[channel].size());
+            for ( size_t idx = 0; idx < beats[channel].size(); ++idx ) {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_beats[channel][idx], beats[channel][idx], 1e-9);
+            }
+        }
+    }
+
+    //! Without a connected callback, the detected qrs complexes are dropped
+    void testDetectionWithoutCallback()
+    {
+        const double sample_rate_hz = 360.0;
+        const auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 10.0, 0.8);
+        std::vector<double> frames(2 * signal.size());
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            frames[2 * idx] = signal[idx];
+            frames[2 * idx + 1] = 2.0 * signal[idx];
+        }
+
+        MultiChannelQRSDetection<double> multi_detector(sample_rate_hz, 2, 2);
+        multi_detector.AppendBlock(span<const double>(frames.data(), frames.size()), 0.0);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MultiChannelQRSDetectorTest);
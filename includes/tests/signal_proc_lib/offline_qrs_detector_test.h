@@ -0,0 +1,142 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/offline_qrs_detector.h"
+#include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "pan_topkins_qrs_detector_test.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+class OfflineQRSDetectorTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(OfflineQRSDetectorTest);
+    CPPUNIT_TEST(testDetectAllMatchesSequentialDetector);
+    CPPUNIT_TEST(testShortOverlapIsResynced);
+    CPPUNIT_TEST(testPeakCloseToThresholdAfterBoundary);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! The parallel detection must find the same beats as one detector running over the whole record,
+    //! independent of the number of threads. The warm-up of each segment converges, so no segment is processed again
+    void testDetectAllMatchesSequentialDetector()
+    {
+        ECGChannelInfo_TP<double> channel;
+        channel._sample_rate_hz = 360.0;
+        channel._data = PanTokpinsQRSDetectorTest::CreateSyntheticECG(channel._sample_rate_hz, 120.0, 0.8);
+        const auto expected_beats = DetectSequential(channel);
+
+        for ( unsigned int num_threads : { 1u, 2u, 3u, 8u } ) {
+            OfflineQRSDetection<double> offline_detector(num_threads, 2);
+            offline_detector.SetSegmentLength(20.0);
+            offline_detector.SetOverlap(10.0);
+            CompareBeats(expected_beats, offline_detector.DetectAll(channel));
+            CPPUNIT_ASSERT_EQUAL(0u, offline_detector.GetNumResyncedSegments());
+        }
+
+        // default segmentation
+        channel._data = PanTokpinsQRSDetectorTest::CreateSyntheticECG(channel._sample_rate_hz, 1200.0, 0.8);
+        OfflineQRSDetection<double> offline_detector(4, 2);
+        CompareBeats(DetectSequential(channel), offline_detector.DetectAll(channel));
+        CPPUNIT_ASSERT_EQUAL(0u, offline_detector.GetNumResyncedSegments());
+    }
+
+    //! A warm-up shorter than the training phase never converges: each segment is continued by the previous detector
+    void testShortOverlapIsResynced()
+    {
+        ECGChannelInfo_TP<double> channel;
+        channel._sample_rate_hz = 360.0;
+        channel._data = PanTokpinsQRSDetectorTest::CreateSyntheticECG(channel._sample_rate_hz, 60.0, 0.8);
+
+        OfflineQRSDetection<double> offline_detector(2, 2);
+        offline_detector.SetSegmentLength(10.0);
+        offline_detector.SetOverlap(1.0);
+        CompareBeats(DetectSequential(channel), offline_detector.DetectAll(channel));
+        CPPUNIT_ASSERT_EQUAL(5u, offline_detector.GetNumResyncedSegments());
+    }
+
+    //! The beat right after a segment boundary is scaled, so its peak lies just above or below the signal threshold
+    //! of the sequential pass. The detector of the segment, whose levels still differ slightly, would decide
+    //! differently; the segment must be processed again to find the same beats as the sequential pass
+    void testPeakCloseToThresholdAfterBoundary()
+    {
+        const size_t num_beats = DetectSequential(CreateScaledBeatECG(1.0)).size();
+        CPPUNIT_ASSERT_EQUAL(num_beats - 1, DetectSequential(CreateScaledBeatECG(0.0)).size());
+
+        // scale of the beat, at which the sequential pass starts to detect it
+        double min_scale = 0.0;
+        double max_scale = 1.0;
+        for ( int iteration = 0; iteration < 50; ++iteration ) {
+            const double scale = 0.5 * (min_scale + max_scale);
+            if ( DetectSequential(CreateScaledBeatECG(scale)).size() == num_beats ) {
+                max_scale = scale;
+            } else {
+                min_scale = scale;
+            }
+        }
+
+        for ( const double relative_offset : { -1e-3, -1e-5, -1e-8, 1e-8, 1e-5, 1e-3 } ) {
+            const auto channel = CreateScaledBeatECG(max_scale * (1.0 + relative_offset));
+            const auto expected_beats = DetectSequential(channel);
+            CPPUNIT_ASSERT_EQUAL(relative_offset < 0.0 ? num_beats - 1 : num_beats, expected_beats.size());
+
+            OfflineQRSDetection<double> offline_detector(2, 2);
+            offline_detector.SetSegmentLength(20.0);
+            offline_detector.SetOverlap(10.0);
+            CompareBeats(expected_beats, offline_detector.DetectAll(channel));
+            if ( std::abs(relative_offset) < 1e-4 ) {
+                CPPUNIT_ASSERT(offline_detector.GetNumResyncedSegments() > 0);
+            }
+        }
+    }
+
+private:
+    //! Synthetic ecg of 60 s, whose beat right after 20 s is scaled
+    static ECGChannelInfo_TP<double> CreateScaledBeatECG(double scale)
+    {
+        ECGChannelInfo_TP<double> channel;
+        channel._sample_rate_hz = 360.0;
+        channel._data = PanTokpinsQRSDetectorTest::CreateSyntheticECG(channel._sample_rate_hz, 60.0, 0.8);
+        const size_t beat_begin = static_cast<size_t>(20.0 * channel._sample_rate_hz);
+        const size_t beat_end = static_cast<size_t>(20.8 * channel._sample_rate_hz);
+        for ( size_t idx = beat_begin; idx < beat_end; ++idx ) {
+            channel._data[idx] *= scale;
+        }
+        return channel;
+    }
+
+    static std::vector<double> DetectSequential(const ECGChannelInfo_TP<double>& channel)
+    {
+        std::vector<double> beats;
+        PanTopkinsQRSDetection<double> detector(channel._sample_rate_hz, 2);
+        detector.Connect([&](const double& timestamp) { beats.push_back(timestamp); });
+        for ( size_t idx = 0; idx < channel._data.size(); ++idx ) {
+            detector.AppendPoint(channel._data[idx], idx / channel._sample_rate_hz);
+        }
+        CPPUNIT_ASSERT(!beats.empty());
+        return beats;
+    }
+
+    static void CompareBeats(const std::vector<double>& expected_beats, const std::vector<double>& beats)
+    {
+        CPPUNIT_ASSERT_EQUAL(expected_beats.size(), beats.size());
+        for ( size_t idx = 0; idx < beats.size(); ++idx ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_beats[idx], beats[idx], 1e-9);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(OfflineQRSDetectorTest);
@@ -4,16 +4,24 @@
 
 // Project includes
 #include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "../../signal_proc_lib/beat_matching.h"
 
 
 // STL includes
 #include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
 
 class PanTokpinsQRSDetectorTest : public CPPUNIT_NS::TestFixture{
 
 private:
     CPPUNIT_TEST_SUITE(PanTokpinsQRSDetectorTest);
-    CPPUNIT_TEST(testFiltering);
+    CPPUNIT_TEST(testSyntheticECGAccuracy);
+    CPPUNIT_TEST(testIIRBandpassAccuracy);
+    CPPUNIT_TEST(testAppendBlockMatchesAppendPoint);
+    CPPUNIT_TEST(testFixedRateFilterChainMatchesRuntimeChain);
+    CPPUNIT_TEST(testEventQueueMatchesCallback);
     CPPUNIT_TEST_SUITE_END();
    
 public:
@@ -27,11 +35,170 @@ public:
         std::cout << "tear down" << std::endl;
     }
 
-    void testFiltering()
+    //! The detected beats match the r-peaks of the synthetic ecg (see CreateSyntheticECG()) within the tolerance of 150 ms
+    void testSyntheticECGAccuracy()
     {
-        CPPUNIT_ASSERT(0 == 0);
-        CPPUNIT_ASSERT_MESSAGE("compare test", 0 == 1);
-        CPPUNIT_ASSERT(1== 2);
+        // compile time filter chains
+        CheckSyntheticECGAccuracy(360.0, 0.8);
+        CheckSyntheticECGAccuracy(250.0, 0.6);
+        // runtime filter chain
+        CheckSyntheticECGAccuracy(500.0, 1.0);
+    }
+
+    //! The IIR bandpass detects the same r-peaks. Its delay correction (group delay + moving average delay)
+    //! keeps the mean timing error below 15 ms for all sample frequencies
+    void testIIRBandpassAccuracy()
+    {
+        for ( const double sample_rate_hz : { 250.0, 360.0, 500.0, 1000.0 } ) {
+            CheckSyntheticECGAccuracy(sample_rate_hz, 0.8, QRSBandpass_TP::ButterworthIIR, 0.015);
+        }
+        CheckSyntheticECGAccuracy(360.0, 0.6, QRSBandpass_TP::ButterworthIIR, 0.015);
+    }
+
+    //! \param max_mean_error_sec maximum of the mean timing error of the detected beats; not checked if negative
+    static void CheckSyntheticECGAccuracy(double sample_rate_hz,
+                                          double rr_interval_sec,
+                                          QRSBandpass_TP bandpass = QRSBandpass_TP::FIR,
+                                          double max_mean_error_sec = -1.0)
+    {
+        const double duration_sec = 120.0;
+        auto signal = CreateSyntheticECG(sample_rate_hz, duration_sec, rr_interval_sec);
+        std::vector<double> reference_beats;
+        for ( double r_peak_sec = 0.4; r_peak_sec < duration_sec; r_peak_sec += rr_interval_sec ) {
+            reference_beats.push_back(r_peak_sec);
+        }
+
+        std::vector<double> beats;
+        PanTopkinsQRSDetection<double> detector(sample_rate_hz, 2, bandpass);
+        detector.Connect([&](const double& timestamp) { beats.push_back(timestamp); });
+        detector.AppendBlock(span<const double>(signal.data(), signal.size()), 0.0);
+
+        // no detections are possible during the training phase
+        auto result = MatchBeats(reference_beats, beats, 0.15, 2.0);
+        CPPUNIT_ASSERT(result._true_positives > 0);
+        CPPUNIT_ASSERT(result.Sensitivity() >= 0.99);
+        CPPUNIT_ASSERT(result.PositivePredictivity() >= 0.95);
+
+        if ( max_mean_error_sec >= 0.0 ) {
+            double error_sum_sec = 0.0;
+            for ( const double beat_sec : beats ) {
+                const double r_peak_sec = 0.4 + std::round((beat_sec - 0.4) / rr_interval_sec) * rr_interval_sec;
+                error_sum_sec += beat_sec - r_peak_sec;
+            }
+            CPPUNIT_ASSERT(std::abs(error_sum_sec / beats.size()) <= max_mean_error_sec);
+        }
+    }
+
+    void testAppendBlockMatchesAppendPoint()
+    {
+        const double sample_rate_hz = 360.0;
+        auto signal = CreateSyntheticECG(sample_rate_hz, 60.0, 0.8);
+
+        std::vector<double> beats_per_sample;
+        PanTopkinsQRSDetection<double> detector_per_sample(sample_rate_hz, 2);
+        detector_per_sample.Connect([&](const double& timestamp) { beats_per_sample.push_back(timestamp); });
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            detector_per_sample.AppendPoint(signal[idx], idx / sample_rate_hz);
+        }
+
+        // Use a block size which does not divide the signal length
+        const size_t block_size = 97;
+        std::vector<double> beats_block;
+        PanTopkinsQRSDetection<double> detector_block(sample_rate_hz, 2);
+        detector_block.Connect([&](const double& timestamp) { beats_block.push_back(timestamp); });
+        for ( size_t idx = 0; idx < signal.size(); idx += block_size ) {
+            auto current_block_size = std::min(block_size, signal.size() - idx);
+            detector_block.AppendBlock(span<const double>(signal.data() + idx, current_block_size), idx / sample_rate_hz);
+        }
+
+        CPPUNIT_ASSERT(!beats_per_sample.empty());
+        CPPUNIT_ASSERT_EQUAL(beats_per_sample.size(), beats_block.size());
+        for ( size_t idx = 0; idx < beats_block.size(); ++idx ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(beats_per_sample[idx], beats_block[idx], 1e-9);
+        }
+    }
+
+    //! The compile time specializations must filter like the runtime design for the same sample frequency
+    void testFixedRateFilterChainMatchesRuntimeChain()
+    {
+        // The taps are generated at compile time
+        static_assert(QRSFilterDesign_TP<360>::_bandpass_taps[QRSFilterParams_TP::_num_taps / 2] > 0.0);
+        static_assert(QRSFilterDesign_TP<360>::_window_length_samples == 54);
+
+        CompareFilterChains<250>();
+        CompareFilterChains<360>();
+        CompareFilterChains<500>();
+        CompareFilterChains<1000>();
+    }
+
+    template<unsigned int SampleRate_TP>
+    static void CompareFilterChains()
+    {
+        auto signal = CreateSyntheticECG(SampleRate_TP, 10.0, 0.8);
+
+        std::vector<double> fixed_output(signal.size());
+        FixedRateQRSFilterChain<double, SampleRate_TP> fixed_chain;
+        fixed_chain.Apply(fixed_output.data(), signal.data(), signal.size());
+
+        // sample by sample, to check the state between calls
+        std::vector<double> runtime_output(signal.size());
+        RuntimeQRSFilterChain<double> runtime_chain(SampleRate_TP);
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            runtime_chain.Apply(&runtime_output[idx], &signal[idx], 1);
+        }
+
+        const double max_output = *std::max_element(runtime_output.begin(), runtime_output.end());
+        CPPUNIT_ASSERT(max_output > 0.0);
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(runtime_output[idx], fixed_output[idx], max_output * 1e-9);
+        }
+    }
+
+    //! The qrs events inside the event queue must match the callback
+    void testEventQueueMatchesCallback()
+    {
+        const double sample_rate_hz = 360.0;
+        auto signal = CreateSyntheticECG(sample_rate_hz, 20.0, 0.8);
+
+        std::vector<double> beats;
+        SPSCQueue_TC<BeatEvent_TP> event_queue(256);
+        PanTopkinsQRSDetection<double> detector(sample_rate_hz, 2);
+        detector.Connect([&](const double& timestamp) { beats.push_back(timestamp); });
+        detector.ConnectEventQueue(&event_queue);
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            detector.AppendPoint(signal[idx], idx / sample_rate_hz);
+        }
+        CPPUNIT_ASSERT_EQUAL(size_t(0), detector.GetNumDroppedEvents());
+
+        std::vector<BeatEvent_TP> qrs_events;
+        BeatEvent_TP event;
+        while ( event_queue.TryPop(event) ) {
+            if ( event._classification == BeatClassification_TP::QRS ) {
+                qrs_events.push_back(event);
+            }
+        }
+
+        CPPUNIT_ASSERT(!beats.empty());
+        CPPUNIT_ASSERT_EQUAL(beats.size(), qrs_events.size());
+        for ( size_t idx = 0; idx < beats.size(); ++idx ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(beats[idx], qrs_events[idx]._timestamp_sec, 1e-12);
+            // the timestamps were calculated from the sample index
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(beats[idx], qrs_events[idx]._sample_idx / sample_rate_hz, 1e-9);
+            CPPUNIT_ASSERT(qrs_events[idx]._amplitude > 0.0);
+        }
+    }
+
+    // Creates a noise free ecg like signal with a gaussian shaped R-peak and T-wave for each beat
+    static std::vector<double> CreateSyntheticECG(double sample_rate_hz, double duration_sec, double rr_interval_sec)
+    {
+        std::vector<double> signal(static_cast<size_t>(duration_sec * sample_rate_hz));
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            double phase_sec = std::fmod(idx / sample_rate_hz, rr_interval_sec);
+            double r_peak = std::exp(-std::pow((phase_sec - 0.4) / 0.012, 2));
+            double t_wave = 0.2 * std::exp(-std::pow((phase_sec - 0.65) / 0.04, 2));
+            signal[idx] = r_peak + t_wave;
+        }
+        return signal;
     }
 
     //void testAddition()
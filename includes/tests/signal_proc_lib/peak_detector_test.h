@@ -0,0 +1,106 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/rt_state_filters.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <algorithm>
+
+class PeakDetectorTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(PeakDetectorTest);
+    CPPUNIT_TEST(testBlockEqualsSampleBySample);
+    CPPUNIT_TEST(testResetState);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! Sample by sample and block version report the same peaks as the definition
+    //! (not smaller than the predecessor and the successor), for blocks smaller and bigger than the bitmask groups
+    void testBlockEqualsSampleBySample()
+    {
+        CheckBlockEqualsSampleBySample<double>();
+        CheckBlockEqualsSampleBySample<float>();
+        CheckBlockEqualsSampleBySample<int32_t>();
+    }
+
+    //! After ResetState() the history of the previous samples is not used
+    void testResetState()
+    {
+        PeakDetectorFilter<double> peak_filter;
+        peak_filter.Apply(0.0);
+        peak_filter.Apply(5.0);
+        peak_filter.ResetState();
+        // without reset, 5.0 would be a peak
+        CPPUNIT_ASSERT(!peak_filter.Apply(1.0));
+        CPPUNIT_ASSERT(!peak_filter.Apply(2.0));
+        CPPUNIT_ASSERT(!peak_filter.Apply(3.0));
+        CPPUNIT_ASSERT(peak_filter.Apply(1.0));
+
+        std::vector<unsigned int> peak_indices(4);
+        const std::vector<double> block = { 2.0, 1.0, 4.0, 3.0 };
+        peak_filter.ResetState();
+        CPPUNIT_ASSERT_EQUAL(size_t(1), peak_filter.Apply(block.data(), block.size(), peak_indices.data()));
+        CPPUNIT_ASSERT_EQUAL(3u, peak_indices[0]);
+    }
+
+    template<typename DataType_TP>
+    void CheckBlockEqualsSampleBySample()
+    {
+        // few distinct values, so there are plateaus of equal samples
+        std::mt19937 generator(7);
+        std::uniform_int_distribution<int> distribution(-3, 3);
+        std::vector<DataType_TP> signal(10000);
+        for ( auto& sample : signal ) {
+            sample = static_cast<DataType_TP>(distribution(generator));
+        }
+
+        std::vector<unsigned int> expected_indices;
+        for ( size_t idx = 2; idx < signal.size(); ++idx ) {
+            if ( signal[idx - 1] >= signal[idx - 2] && signal[idx - 1] >= signal[idx] ) {
+                expected_indices.push_back(idx);
+            }
+        }
+        CPPUNIT_ASSERT(!expected_indices.empty());
+
+        std::vector<unsigned int> indices_per_sample;
+        PeakDetectorFilter<DataType_TP> filter_per_sample;
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            if ( filter_per_sample.Apply(signal[idx]) ) {
+                indices_per_sample.push_back(idx);
+            }
+        }
+        CPPUNIT_ASSERT(expected_indices == indices_per_sample);
+
+        for ( const size_t block_size : { 1, 2, 3, 5, 63, 64, 65, 66, 67, 130, 1000, 10000 } ) {
+            std::vector<unsigned int> indices_block;
+            std::vector<unsigned int> peak_indices(block_size);
+            PeakDetectorFilter<DataType_TP> filter_block;
+            for ( size_t block_begin = 0; block_begin < signal.size(); block_begin += block_size ) {
+                const size_t current_block_size = std::min(block_size, signal.size() - block_begin);
+                const size_t num_peaks = filter_block.Apply(signal.data() + block_begin, current_block_size, peak_indices.data());
+                for ( size_t peak = 0; peak < num_peaks; ++peak ) {
+                    CPPUNIT_ASSERT(peak_indices[peak] < current_block_size);
+                    indices_block.push_back(block_begin + peak_indices[peak]);
+                }
+            }
+            CPPUNIT_ASSERT_MESSAGE("block size " + std::to_string(block_size), expected_indices == indices_block);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PeakDetectorTest);
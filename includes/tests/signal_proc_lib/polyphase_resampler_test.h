@@ -0,0 +1,158 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/polyphase_resampler.h"
+#include "../../signal_proc_lib/time_signal.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+class PolyphaseResamplerTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(PolyphaseResamplerTest);
+    CPPUNIT_TEST(testApproximateRatio);
+    CPPUNIT_TEST(testSineOnCommonTimeline);
+    CPPUNIT_TEST(testBlockEqualsSampleBySample);
+    CPPUNIT_TEST(testAlignSampleRates);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void testApproximateRatio()
+    {
+        using Ratio_TP = std::pair<unsigned int, unsigned int>;
+        CPPUNIT_ASSERT(Ratio_TP(36, 25) == PolyphaseResampler<double>::ApproximateRatio(360.0 / 250.0, 1000));
+        CPPUNIT_ASSERT(Ratio_TP(25, 36) == PolyphaseResampler<double>::ApproximateRatio(250.0 / 360.0, 1000));
+        CPPUNIT_ASSERT(Ratio_TP(1, 1) == PolyphaseResampler<double>::ApproximateRatio(1.0, 1000));
+        CPPUNIT_ASSERT(Ratio_TP(9, 25) == PolyphaseResampler<double>::ApproximateRatio(360.0 / 1000.0, 1000));
+        CPPUNIT_ASSERT(Ratio_TP(360, 257) == PolyphaseResampler<double>::ApproximateRatio(360.0 / 257.0, 1000));
+        CPPUNIT_ASSERT(Ratio_TP(1, 4) == PolyphaseResampler<double>::ApproximateRatio(0.25, 1000));
+        CPPUNIT_ASSERT(Ratio_TP(3, 1) == PolyphaseResampler<double>::ApproximateRatio(3.0, 1000));
+
+        // irrational ratio: best fraction with up <= 100
+        const auto ratio = PolyphaseResampler<double>::ApproximateRatio(std::sqrt(2.0), 100);
+        CPPUNIT_ASSERT(ratio.first <= 100);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(std::sqrt(2.0), static_cast<double>(ratio.first) / ratio.second, 1e-4);
+    }
+
+    //! Output sample k of a sine equals the sine at the time k / output sample frequency (no delay),
+    //! for up- and downsampling; Flush() completes the outputs of the whole input
+    void testSineOnCommonTimeline()
+    {
+        for ( const auto& rates : { std::pair<double, double>(250.0, 360.0),
+                                    std::pair<double, double>(360.0, 250.0),
+                                    std::pair<double, double>(257.0, 360.0),
+                                    std::pair<double, double>(1000.0, 360.0),
+                                    std::pair<double, double>(128.0, 512.0) } ) {
+            const double input_rate_hz = rates.first;
+            const double output_rate_hz = rates.second;
+            const double sine_freq_hz = 5.0;
+            std::vector<double> input(static_cast<size_t>(10.0 * input_rate_hz));
+            for ( size_t idx = 0; idx < input.size(); ++idx ) {
+                input[idx] = std::sin(2.0 * constexpr_pi * sine_freq_hz * idx / input_rate_hz);
+            }
+
+            PolyphaseResampler<double> resampler(input_rate_hz, output_rate_hz);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(output_rate_hz, resampler.GetOutputSampleFrequency(), 1e-9);
+            std::vector<double> output(resampler.GetMaxOutputCount(input.size() + resampler.GetFilterDelay()));
+            size_t num_outputs = resampler.Apply(input.data(), input.size(), output.data());
+            num_outputs += resampler.Flush(output.data() + num_outputs);
+
+            // all outputs at times up to the last input sample
+            const size_t expected_num_outputs = static_cast<size_t>(std::floor((input.size() - 1) / input_rate_hz * output_rate_hz + 1e-9)) + 1;
+            CPPUNIT_ASSERT_EQUAL(expected_num_outputs, num_outputs);
+
+            // skip the edges, where the signal is extended with constant values
+            const size_t num_edge_samples = static_cast<size_t>(0.1 * output_rate_hz);
+            for ( size_t idx = num_edge_samples; idx < num_outputs - num_edge_samples; ++idx ) {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(std::sin(2.0 * constexpr_pi * sine_freq_hz * idx / output_rate_hz), output[idx], 0.005);
+            }
+        }
+    }
+
+    //! Blocks of any size give the same output as single samples; ResetState() restarts the stream
+    void testBlockEqualsSampleBySample()
+    {
+        std::vector<float> input(3000);
+        for ( size_t idx = 0; idx < input.size(); ++idx ) {
+            input[idx] = static_cast<float>(std::sin(0.05 * idx) + 0.3 * std::cos(0.31 * idx));
+        }
+
+        PolyphaseResampler<float> resampler(360.0, 250.0);
+        std::vector<float> expected;
+        std::vector<float> output(resampler.GetMaxOutputCount(1));
+        for ( const float sample : input ) {
+            const size_t num_outputs = resampler.Apply(sample, output.data());
+            expected.insert(expected.end(), output.begin(), output.begin() + num_outputs);
+        }
+
+        for ( const size_t block_size : { 1, 7, 64, 1000, 3000 } ) {
+            resampler.ResetState();
+            std::vector<float> result;
+            std::vector<float> block_output(resampler.GetMaxOutputCount(block_size));
+            for ( size_t idx = 0; idx < input.size(); idx += block_size ) {
+                const size_t current_block_size = std::min(block_size, input.size() - idx);
+                const size_t num_outputs = resampler.Apply(input.data() + idx, current_block_size, block_output.data());
+                CPPUNIT_ASSERT(num_outputs <= resampler.GetMaxOutputCount(current_block_size));
+                result.insert(result.end(), block_output.begin(), block_output.begin() + num_outputs);
+            }
+            CPPUNIT_ASSERT(expected == result);
+        }
+
+        // integer samples are rounded
+        PolyphaseResampler<int> int_resampler(250.0, 500.0);
+        std::vector<int> int_output(int_resampler.GetMaxOutputCount(100 + int_resampler.GetFilterDelay()));
+        const std::vector<int> int_input(100, 1000);
+        size_t num_int_outputs = int_resampler.Apply(int_input.data(), int_input.size(), int_output.data());
+        num_int_outputs += int_resampler.Flush(int_output.data() + num_int_outputs);
+        CPPUNIT_ASSERT_EQUAL(size_t(199), num_int_outputs);
+        for ( size_t idx = 0; idx < num_int_outputs; ++idx ) {
+            CPPUNIT_ASSERT_EQUAL(1000, int_output[idx]);
+        }
+    }
+
+    //! Channels with different sample rates are resampled to the highest rate and stay aligned in time
+    void testAlignSampleRates()
+    {
+        std::vector<ECGChannelInfo_TP<double>> channels(3);
+        const double rates_hz[] = { 360.0, 250.0, 500.0 };
+        const double duration_sec = 10.0;
+        for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+            auto& channel = channels[channel_idx];
+            channel._sample_rate_hz = rates_hz[channel_idx];
+            for ( size_t idx = 0; idx < duration_sec * channel._sample_rate_hz; ++idx ) {
+                channel._data.push_back(std::sin(2.0 * constexpr_pi * 3.0 * idx / channel._sample_rate_hz));
+                channel._timestamps.push_back(idx / channel._sample_rate_hz);
+            }
+        }
+        TimeSignal_C<double> signal;
+        signal.SetData(channels);
+        signal.AlignSampleRates();
+
+        const auto& aligned_channels = signal.constData();
+        for ( const auto& channel : aligned_channels ) {
+            CPPUNIT_ASSERT_EQUAL(500.0, channel._sample_rate_hz);
+            CPPUNIT_ASSERT(channel._data.size() >= 4999 && channel._data.size() <= 5000);
+            CPPUNIT_ASSERT_EQUAL(channel._data.size(), channel._timestamps.size());
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(channel._data.size() - 1, channel._timestamps.back() * 500.0, 1e-6);
+            for ( size_t idx = 100; idx < 4900; ++idx ) {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(aligned_channels[2]._data[idx], channel._data[idx], 0.005);
+            }
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PolyphaseResamplerTest);
@@ -0,0 +1,175 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/rt_state_filters.h"
+#include "pan_topkins_qrs_detector_test.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+class PowerlineNotchTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(PowerlineNotchTest);
+    CPPUNIT_TEST(testHarmonicsAreRemoved);
+    CPPUNIT_TEST(testMultiChannelEqualsSingleChannel);
+    CPPUNIT_TEST(testPowerlineRemovalFromECG);
+    CPPUNIT_TEST(testEstimateMainsFrequency);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! The fundamental and the harmonics below the nyquist frequency are attenuated by more than 40 dB,
+    //! the qrs band passes with unity gain
+    void testHarmonicsAreRemoved()
+    {
+        PowerlineNotchStateFilter<double> notch_50(360.0, 50.0);
+        // 50, 100, 150 Hz
+        CPPUNIT_ASSERT_EQUAL(3u, notch_50.GetNotchCount());
+        for ( const double freq_hz : { 50.0, 100.0, 150.0 } ) {
+            CPPUNIT_ASSERT(SineGain(notch_50, freq_hz, 360.0) < 0.01);
+        }
+        for ( const double freq_hz : { 1.0, 5.0, 10.0, 20.0 } ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, SineGain(notch_50, freq_hz, 360.0), 0.01);
+        }
+
+        PowerlineNotchStateFilter<float> notch_60(500.0, 60.0);
+        // 60, 120, 180, 240 Hz
+        CPPUNIT_ASSERT_EQUAL(4u, notch_60.GetNotchCount());
+        for ( const double freq_hz : { 60.0, 120.0, 180.0, 240.0 } ) {
+            CPPUNIT_ASSERT(SineGain(notch_60, freq_hz, 500.0) < 0.01);
+        }
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, SineGain(notch_60, 10.0, 500.0), 0.01);
+
+        notch_60.SetMainsFrequency(50.0);
+        CPPUNIT_ASSERT(SineGain(notch_60, 50.0, 500.0) < 0.01);
+    }
+
+    //! Each channel of the interleaved frames is filtered like with an own single channel filter,
+    //! frame by frame, in blocks and after ResetState()
+    void testMultiChannelEqualsSingleChannel()
+    {
+        const double sample_rate_hz = 360.0;
+        const unsigned int num_channels = 7;
+        const size_t num_frames = 3000;
+        std::vector<double> frames(num_frames * num_channels);
+        for ( size_t frame_idx = 0; frame_idx < num_frames; ++frame_idx ) {
+            for ( unsigned int channel_idx = 0; channel_idx < num_channels; ++channel_idx ) {
+                const double time_sec = frame_idx / sample_rate_hz;
+                frames[frame_idx * num_channels + channel_idx] = channel_idx + std::sin(2.0 * constexpr_pi * (3.0 + channel_idx) * time_sec) +
+                    0.5 * std::sin(2.0 * constexpr_pi * 50.0 * time_sec + channel_idx);
+            }
+        }
+
+        std::vector<double> expected(frames.size());
+        for ( unsigned int channel_idx = 0; channel_idx < num_channels; ++channel_idx ) {
+            PowerlineNotchStateFilter<double> channel_notch(sample_rate_hz);
+            std::vector<double> channel(num_frames);
+            for ( size_t frame_idx = 0; frame_idx < num_frames; ++frame_idx ) {
+                channel[frame_idx] = frames[frame_idx * num_channels + channel_idx];
+            }
+            // block and sample by sample
+            std::vector<double> channel_block = channel;
+            channel_notch.Apply(channel_block.data(), channel_block.size());
+            channel_notch.ResetState();
+            for ( size_t frame_idx = 0; frame_idx < num_frames; ++frame_idx ) {
+                expected[frame_idx * num_channels + channel_idx] = channel_notch.Process(channel[frame_idx]);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(channel_block[frame_idx], expected[frame_idx * num_channels + channel_idx], 1e-12);
+            }
+        }
+
+        PowerlineNotchStateFilter<double> notch(sample_rate_hz, 50.0, num_channels);
+        CPPUNIT_ASSERT_EQUAL(num_channels, notch.GetChannelCount());
+        for ( int pass = 0; pass < 2; ++pass ) {
+            std::vector<double> output = frames;
+            const size_t block_size = 97;
+            for ( size_t frame_idx = 0; frame_idx < num_frames; frame_idx += block_size ) {
+                notch.Apply(output.data() + frame_idx * num_channels, std::min(block_size, num_frames - frame_idx));
+            }
+            for ( size_t idx = 0; idx < output.size(); ++idx ) {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[idx], output[idx], 1e-12);
+            }
+            notch.ResetState();
+        }
+    }
+
+    //! 50 Hz interference with harmonics is removed from a synthetic ecg without timestamp shift
+    void testPowerlineRemovalFromECG()
+    {
+        const double sample_rate_hz = 360.0;
+        const auto ecg = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 30.0, 0.8);
+        std::vector<double> signal = ecg;
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            const double time_sec = idx / sample_rate_hz;
+            signal[idx] += 0.3 * std::sin(2.0 * constexpr_pi * 50.0 * time_sec) + 0.1 * std::sin(2.0 * constexpr_pi * 150.0 * time_sec + 1.0);
+        }
+
+        PowerlineNotchStateFilter<double> notch(sample_rate_hz,
+                                                PowerlineNotchStateFilter<double>::EstimateMainsFrequency(signal.data(), signal.size(), sample_rate_hz));
+        CPPUNIT_ASSERT_EQUAL(50.0, notch.GetMainsFrequency());
+        notch.Apply(signal.data(), signal.size());
+
+        double interference_square_sum = 0.0;
+        double error_square_sum = 0.0;
+        size_t num_compared_samples = 0;
+        // skip the settling of the notches
+        for ( size_t idx = static_cast<size_t>(sample_rate_hz); idx < signal.size(); ++idx ) {
+            const double time_sec = idx / sample_rate_hz;
+            const double interference = 0.3 * std::sin(2.0 * constexpr_pi * 50.0 * time_sec) + 0.1 * std::sin(2.0 * constexpr_pi * 150.0 * time_sec + 1.0);
+            interference_square_sum += interference * interference;
+            error_square_sum += (signal[idx] - ecg[idx]) * (signal[idx] - ecg[idx]);
+            ++num_compared_samples;
+        }
+        const double interference_rms = std::sqrt(interference_square_sum / num_compared_samples);
+        const double error_rms = std::sqrt(error_square_sum / num_compared_samples);
+        std::cout << "powerline interference rms: " << interference_rms << " error rms after removal: " << error_rms << std::endl;
+        CPPUNIT_ASSERT(error_rms < 0.1 * interference_rms);
+    }
+
+    void testEstimateMainsFrequency()
+    {
+        const double sample_rate_hz = 500.0;
+        for ( const double mains_freq_hz : { 50.0, 60.0 } ) {
+            auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 5.0, 0.8);
+            for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+                signal[idx] += 0.05 * std::sin(2.0 * constexpr_pi * mains_freq_hz * idx / sample_rate_hz);
+            }
+            CPPUNIT_ASSERT_EQUAL(mains_freq_hz, PowerlineNotchStateFilter<double>::EstimateMainsFrequency(signal.data(), signal.size(), sample_rate_hz));
+        }
+    }
+
+    //! Amplitude of the filtered sine (after the settling of the notches) relative to the input amplitude
+    template<typename DataType_TP>
+    static double SineGain(PowerlineNotchStateFilter<DataType_TP>& notch, double freq_hz, double sample_rate_hz)
+    {
+        notch.ResetState();
+        const size_t num_samples = static_cast<size_t>(4.0 * sample_rate_hz);
+        const size_t num_settling_samples = num_samples / 2;
+        double sin_sum = 0.0;
+        double cos_sum = 0.0;
+        for ( size_t idx = 0; idx < num_samples; ++idx ) {
+            const double phase = 2.0 * constexpr_pi * freq_hz * idx / sample_rate_hz;
+            const double output = notch.Process(static_cast<DataType_TP>(std::sin(phase)));
+            if ( idx >= num_settling_samples ) {
+                sin_sum += output * std::sin(phase);
+                cos_sum += output * std::cos(phase);
+            }
+        }
+        const double num_compared_samples = static_cast<double>(num_samples - num_settling_samples);
+        return 2.0 * std::sqrt(sin_sum * sin_sum + cos_sum * cos_sum) / num_compared_samples;
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PowerlineNotchTest);
@@ -0,0 +1,236 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/record_cache.h"
+#include "../../signal_proc_lib/record_stream.h"
+#include "wfdb_native_reader_test.h"
+#include "record_stream_test.h"
+
+// STL includes
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cmath>
+#include <cstdint>
+
+class RecordCacheTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(RecordCacheTest);
+    CPPUNIT_TEST(testWriteAndOpen);
+    CPPUNIT_TEST(testOutdatedCache);
+    CPPUNIT_TEST(testG11SignalFromCache);
+    CPPUNIT_TEST(testMITSignalFromCache);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+        _record_dir = std::filesystem::temp_directory_path() / "ecg_analyzer_record_cache_test";
+        std::filesystem::create_directories(_record_dir);
+    }
+
+    void tearDown()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(_record_dir, error);
+    }
+
+    //! The opened cache holds the channels, which were written; the samples are aligned inside the mapped file
+    void testWriteAndOpen()
+    {
+        const auto source_path = WriteSource("source.txt", "source");
+        const auto cache_path = RecordCache_C<double>::GetCachePath(source_path);
+        std::vector<std::vector<double>> samples = { { 1.0, -2.5, 3.25 }, {}, std::vector<double>(1001, 0.5) };
+        std::vector<CachedChannel_TP<double>> channels(samples.size());
+        for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+            channels[channel_idx]._label = "lead " + std::to_string(channel_idx);
+            channels[channel_idx]._units = channel_idx == 1 ? "uV" : "mV";
+            channels[channel_idx]._sample_rate_hz = 250.0 * (channel_idx + 1);
+            channels[channel_idx]._gain = 200.0;
+            channels[channel_idx]._range_mV = 5;
+            channels[channel_idx]._id = static_cast<uint32_t>(channel_idx + 1);
+            channels[channel_idx]._adc_resolution_bits = 12;
+            channels[channel_idx]._min_val = -2.5;
+            channels[channel_idx]._max_val = 3.25;
+            channels[channel_idx]._samples = span<const double>(samples[channel_idx].data(), samples[channel_idx].size());
+        }
+        CPPUNIT_ASSERT(RecordCache_C<double>::Write(cache_path, { source_path }, channels));
+        CPPUNIT_ASSERT(!std::filesystem::exists(cache_path + ".tmp"));
+
+        RecordCache_C<double> cache;
+        CPPUNIT_ASSERT(cache.Open(cache_path, { source_path }));
+        CPPUNIT_ASSERT_EQUAL(size_t(3), cache.GetChannels().size());
+        for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+            const auto& channel = cache.GetChannels()[channel_idx];
+            CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._label, channel._label);
+            CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._units, channel._units);
+            CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._sample_rate_hz, channel._sample_rate_hz);
+            CPPUNIT_ASSERT_EQUAL(200.0, channel._gain);
+            CPPUNIT_ASSERT_EQUAL(uint32_t(5), channel._range_mV);
+            CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._id, channel._id);
+            CPPUNIT_ASSERT_EQUAL(uint32_t(12), channel._adc_resolution_bits);
+            CPPUNIT_ASSERT_EQUAL(-2.5, channel._min_val);
+            CPPUNIT_ASSERT_EQUAL(3.25, channel._max_val);
+            CPPUNIT_ASSERT_EQUAL(samples[channel_idx].size(), channel._samples.size());
+            CPPUNIT_ASSERT_EQUAL(size_t(0), reinterpret_cast<uintptr_t>(channel._samples.data()) % 64);
+            for ( size_t idx = 0; idx < samples[channel_idx].size(); ++idx ) {
+                CPPUNIT_ASSERT_EQUAL(samples[channel_idx][idx], channel._samples[static_cast<int>(idx)]);
+            }
+        }
+
+        // the cache of another data type or with other source files is not opened
+        RecordCache_C<float> float_cache;
+        CPPUNIT_ASSERT(!float_cache.Open(cache_path, { source_path }));
+        CPPUNIT_ASSERT(!cache.Open(cache_path, { source_path, source_path }));
+        CPPUNIT_ASSERT(!cache.IsOpen());
+        CPPUNIT_ASSERT(!cache.Open((_record_dir / "missing.ecgcache").string(), { source_path }));
+    }
+
+    //! A cache is outdated, if the source file changes; truncated or foreign files are no caches
+    void testOutdatedCache()
+    {
+        const auto source_path = WriteSource("source.txt", "source");
+        const auto cache_path = RecordCache_C<int>::GetCachePath(source_path);
+        std::vector<int> samples = { 1, 2, 3, 4 };
+        std::vector<CachedChannel_TP<int>> channels(1);
+        channels[0]._samples = span<const int>(samples.data(), samples.size());
+        CPPUNIT_ASSERT(RecordCache_C<int>::Write(cache_path, { source_path }, channels));
+        RecordCache_C<int> cache;
+        CPPUNIT_ASSERT(cache.Open(cache_path, { source_path }));
+        cache.Close();
+
+        // the same size, but a new modification time
+        const auto modification_time = std::filesystem::last_write_time(source_path);
+        std::filesystem::last_write_time(source_path, modification_time + std::chrono::seconds(1));
+        CPPUNIT_ASSERT(!cache.Open(cache_path, { source_path }));
+        std::filesystem::last_write_time(source_path, modification_time);
+        CPPUNIT_ASSERT(cache.Open(cache_path, { source_path }));
+        cache.Close();
+
+        WriteSource("source.txt", "changed source");
+        CPPUNIT_ASSERT(!cache.Open(cache_path, { source_path }));
+
+        // truncated cache
+        CPPUNIT_ASSERT(RecordCache_C<int>::Write(cache_path, { source_path }, channels));
+        std::filesystem::resize_file(cache_path, std::filesystem::file_size(cache_path) - sizeof(int));
+        CPPUNIT_ASSERT(!cache.Open(cache_path, { source_path }));
+        CPPUNIT_ASSERT(!cache.Open(source_path, { source_path }));
+    }
+
+    //! The second load of a G11 export maps the cache: the samples are the same, but not copied
+    void testG11SignalFromCache()
+    {
+        std::ostringstream text;
+        text << "Channels exported: 2\n";
+        for ( int channel_idx = 0; channel_idx < 2; ++channel_idx ) {
+            text << "Channel #: " << channel_idx + 1 << "\nLabel: L" << channel_idx << "\nRange: 5\nSample rate: 500\nScale: 1\n";
+        }
+        for ( int row_idx = 0; row_idx < 3000; ++row_idx ) {
+            text << row_idx << " " << std::sin(0.02 * row_idx) * 50.0 << " " << (row_idx % 100) - 30 << "\n";
+        }
+        const auto filename = WriteSource("g11.txt", text.str());
+
+        TimeSignal_C<double> loaded_signal;
+        loaded_signal.ReadG11Data(filename);
+        CPPUNIT_ASSERT(!loaded_signal.IsMapped());
+        CPPUNIT_ASSERT(std::filesystem::exists(RecordCache_C<double>::GetCachePath(filename)));
+
+        TimeSignal_C<double> cached_signal;
+        cached_signal.ReadG11Data(filename);
+        CPPUNIT_ASSERT(cached_signal.IsMapped());
+        CompareSignals(loaded_signal, cached_signal);
+
+        // the copies share the mapped cache
+        TimeSignal_C<double> copied_signal(cached_signal);
+        CPPUNIT_ASSERT(copied_signal.GetSamples(1).data() == cached_signal.GetSamples(1).data());
+        TimeSignalStream_C<double> stream(copied_signal, 512);
+        RecordStreamTest::CompareBlocks(stream, loaded_signal);
+
+        // the resampled channels are copied out of the cache
+        copied_signal.AlignSampleRates(250.0);
+        CPPUNIT_ASSERT_EQUAL(size_t(1500), copied_signal.constData()[0]._data.size());
+        CPPUNIT_ASSERT_EQUAL(size_t(3000), cached_signal.GetSamples(0).size());
+
+        TimeSignal_C<double> uncached_signal;
+        uncached_signal.SetUseCache(false);
+        uncached_signal.ReadG11Data(filename);
+        CPPUNIT_ASSERT(!uncached_signal.IsMapped());
+        CompareSignals(loaded_signal, uncached_signal);
+    }
+
+    //! A MIT record is cached with its header and signal file; the cache is written again, if the signal file changes
+    void testMITSignalFromCache()
+    {
+        std::vector<int> samples(2 * 4000);
+        for ( size_t idx = 0; idx < samples.size(); ++idx ) {
+            samples[idx] = static_cast<int>((idx * 31) % 1000) - 500;
+        }
+        WFDBNativeReaderTest::WriteRecord(_record_dir, "rec", 212, 2, samples, true, 0);
+        const auto record_path = (_record_dir / "rec").string();
+
+        TimeSignal_C<double> loaded_signal;
+        loaded_signal.LoadFromMITFileFormat(record_path);
+        CPPUNIT_ASSERT(!loaded_signal.IsMapped());
+        TimeSignal_C<double> cached_signal;
+        cached_signal.LoadFromMITFileFormat(record_path);
+        CPPUNIT_ASSERT(cached_signal.IsMapped());
+        CompareSignals(loaded_signal, cached_signal);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(loaded_signal.GetTimerangeMs(), cached_signal.GetTimerangeMs(), 1e-9);
+
+        for ( auto& sample : samples ) {
+            sample = -sample;
+        }
+        WFDBNativeReaderTest::WriteRecord(_record_dir, "rec", 212, 2, samples, true, 0);
+        const auto modification_time = std::filesystem::last_write_time(_record_dir / "rec.dat");
+        std::filesystem::last_write_time(_record_dir / "rec.dat", modification_time + std::chrono::seconds(1));
+        TimeSignal_C<double> changed_signal;
+        changed_signal.LoadFromMITFileFormat(record_path);
+        CPPUNIT_ASSERT(!changed_signal.IsMapped());
+        // (-adc_value - baseline) / gain (see WFDBNativeReaderTest::WriteRecord())
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(-loaded_signal.GetSamples(1)[10] - 2 * 10 / 200.0, changed_signal.GetSamples(1)[10], 1e-12);
+        changed_signal.LoadFromMITFileFormat(record_path);
+        CPPUNIT_ASSERT(changed_signal.IsMapped());
+    }
+
+    //! Compares the channel infos and the samples of two signals
+    static void CompareSignals(const TimeSignal_C<double>& expected_signal, const TimeSignal_C<double>& signal)
+    {
+        const auto& expected_channels = expected_signal.constData();
+        const auto& channels = signal.constData();
+        CPPUNIT_ASSERT_EQUAL(expected_channels.size(), channels.size());
+        for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+            CPPUNIT_ASSERT_EQUAL(expected_channels[channel_idx]._label, channels[channel_idx]._label);
+            CPPUNIT_ASSERT_EQUAL(expected_channels[channel_idx]._sample_rate_hz, channels[channel_idx]._sample_rate_hz);
+            CPPUNIT_ASSERT_EQUAL(expected_channels[channel_idx]._range_mV, channels[channel_idx]._range_mV);
+            CPPUNIT_ASSERT_EQUAL(expected_channels[channel_idx]._scale, channels[channel_idx]._scale);
+            CPPUNIT_ASSERT_EQUAL(expected_channels[channel_idx]._gain, channels[channel_idx]._gain);
+            CPPUNIT_ASSERT_EQUAL(expected_channels[channel_idx]._min_val, channels[channel_idx]._min_val);
+            CPPUNIT_ASSERT_EQUAL(expected_channels[channel_idx]._max_val, channels[channel_idx]._max_val);
+            const auto expected_samples = expected_signal.GetSamples(channel_idx);
+            const auto samples = signal.GetSamples(channel_idx);
+            CPPUNIT_ASSERT_EQUAL(expected_samples.size(), samples.size());
+            for ( size_t idx = 0; idx < samples.size(); ++idx ) {
+                CPPUNIT_ASSERT_EQUAL(expected_samples[static_cast<int>(idx)], samples[static_cast<int>(idx)]);
+            }
+        }
+    }
+
+private:
+    std::string WriteSource(const std::string& name, const std::string& text)
+    {
+        const auto filename = (_record_dir / name).string();
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        file << text;
+        return filename;
+    }
+
+    std::filesystem::path _record_dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(RecordCacheTest);
@@ -0,0 +1,209 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/record_stream.h"
+#include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "wfdb_native_reader_test.h"
+#include "pan_topkins_qrs_detector_test.h"
+
+// STL includes
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <cmath>
+
+class RecordStreamTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(RecordStreamTest);
+    CPPUNIT_TEST(testMITStreamEqualsLoadedRecord);
+    CPPUNIT_TEST(testG11StreamEqualsLoadedRecord);
+    CPPUNIT_TEST(testTimeSignalStream);
+    CPPUNIT_TEST(testDetectionFromStream);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+        _record_dir = std::filesystem::temp_directory_path() / "ecg_analyzer_record_stream_test";
+        std::filesystem::create_directories(_record_dir);
+    }
+
+    void tearDown()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(_record_dir, error);
+    }
+
+    //! The blocks of the stream hold the samples of the loaded record; blocks of an odd number of frames of 3 signals
+    //! start in the middle of a sample pair of format 212
+    void testMITStreamEqualsLoadedRecord()
+    {
+        const size_t num_frames = 10001;
+        std::vector<int> samples(3 * num_frames);
+        for ( size_t idx = 0; idx < samples.size(); ++idx ) {
+            samples[idx] = static_cast<int>((idx * 7919) % 4000) - 2000;
+        }
+        WFDBNativeReaderTest::WriteRecord(_record_dir, "rec", 212, 3, samples, true, 0);
+        const auto record_path = (_record_dir / "rec").string();
+
+        TimeSignal_C<double> signal;
+        signal.LoadFromMITFileFormat(record_path);
+        const auto& channels = signal.constData();
+        CPPUNIT_ASSERT_EQUAL(size_t(3), channels.size());
+
+        MITRecordStream_C<double> stream(999);
+        CPPUNIT_ASSERT(stream.Open(record_path));
+        CPPUNIT_ASSERT(stream.IsNative());
+        CPPUNIT_ASSERT_EQUAL(num_frames, stream.GetNumFrames());
+        CPPUNIT_ASSERT_EQUAL(size_t(3), stream.GetChannels().size());
+        for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+            const auto& channel_info = stream.GetChannels()[channel_idx];
+            CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._label, channel_info._label);
+            CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._sample_rate_hz, channel_info._sample_rate_hz);
+            CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._gain, channel_info._gain);
+            CPPUNIT_ASSERT(channel_info._data.empty());
+        }
+
+        for ( int pass = 0; pass < 2; ++pass ) {
+            CompareBlocks(stream, signal);
+            CPPUNIT_ASSERT(stream.Rewind());
+        }
+    }
+
+    //! The stream scales the samples of a G11 export like TimeSignal_C::ReadG11Data()
+    void testG11StreamEqualsLoadedRecord()
+    {
+        const auto filename = (_record_dir / "g11.txt").string();
+        {
+            std::ofstream file(filename);
+            file << "Channels exported: 2\n";
+            const char* labels[] = { "I", "II" };
+            for ( int channel_idx = 0; channel_idx < 2; ++channel_idx ) {
+                file << "Channel #: " << channel_idx + 1 << "\nLabel: " << labels[channel_idx]
+                     << "\nRange: " << 5 * (channel_idx + 1) << "\nSample rate: 500\nScale: 1\n";
+            }
+            for ( int row_idx = 0; row_idx < 5000; ++row_idx ) {
+                file << row_idx << " " << std::sin(0.01 * row_idx) * 100.0 << " " << (row_idx % 250) * 0.5 - 20.0 << "\n";
+            }
+        }
+
+        TimeSignal_C<double> signal;
+        signal.ReadG11Data(filename);
+        CPPUNIT_ASSERT_EQUAL(size_t(2), signal.constData().size());
+
+        G11RecordStream_C<double> stream(1024);
+        CPPUNIT_ASSERT(stream.Open(filename));
+        CPPUNIT_ASSERT_EQUAL(size_t(5000), stream.GetNumFrames());
+        CPPUNIT_ASSERT_EQUAL(std::string(" II"), stream.GetChannels()[1]._label);
+        CPPUNIT_ASSERT_EQUAL(500.0, stream.GetChannels()[1]._sample_rate_hz);
+        for ( int pass = 0; pass < 2; ++pass ) {
+            CompareBlocks(stream, signal);
+            CPPUNIT_ASSERT(stream.Rewind());
+        }
+
+        G11RecordStream_C<double> missing_stream;
+        CPPUNIT_ASSERT(!missing_stream.Open((_record_dir / "missing.txt").string()));
+        RecordBlock_TP<double> block;
+        CPPUNIT_ASSERT(!missing_stream.ReadBlock(block));
+    }
+
+    //! A loaded signal is streamed up to the end of its shortest channel
+    void testTimeSignalStream()
+    {
+        std::vector<ECGChannelInfo_TP<float>> channels(2);
+        for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+            channels[channel_idx]._sample_rate_hz = 250.0;
+            channels[channel_idx]._label = channel_idx == 0 ? "I" : "II";
+            for ( size_t idx = 0; idx < 1000 + 10 * channel_idx; ++idx ) {
+                channels[channel_idx]._data.push_back(static_cast<float>(idx + channel_idx));
+            }
+        }
+        TimeSignal_C<float> signal;
+        signal.SetData(channels);
+
+        TimeSignalStream_C<float> stream(signal, 300);
+        CPPUNIT_ASSERT_EQUAL(size_t(1000), stream.GetNumFrames());
+        CPPUNIT_ASSERT_EQUAL(std::string("II"), stream.GetChannels()[1]._label);
+        RecordBlock_TP<float> block;
+        std::vector<size_t> block_sizes;
+        while ( stream.ReadBlock(block) ) {
+            block_sizes.push_back(block._num_frames);
+            CPPUNIT_ASSERT_EQUAL(static_cast<float>(block._first_frame + 1), block.GetChannel(1)[0]);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(block._first_frame / 250.0, block.GetTimestampSec(250.0), 1e-12);
+        }
+        CPPUNIT_ASSERT(block_sizes == std::vector<size_t>({ 300, 300, 300, 100 }));
+        CPPUNIT_ASSERT_EQUAL(size_t(1000), stream.GetPosition());
+        CPPUNIT_ASSERT_EQUAL(size_t(0), block._num_frames);
+    }
+
+    //! The detector finds the same beats in the blocks of a stream as in the loaded signal
+    void testDetectionFromStream()
+    {
+        // the records of WFDBNativeReaderTest::WriteRecord() are sampled with 500 Hz
+        const double sample_rate_hz = 500.0;
+        const auto ecg = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 60.0, 0.8);
+        std::vector<int> samples(ecg.size());
+        for ( size_t idx = 0; idx < ecg.size(); ++idx ) {
+            // gain 200, baseline 10 (see WFDBNativeReaderTest::WriteRecord())
+            samples[idx] = static_cast<int>(std::lround(ecg[idx] * 200.0)) + 10;
+        }
+        WFDBNativeReaderTest::WriteRecord(_record_dir, "ecg", 16, 1, samples, true, 0);
+        const auto record_path = (_record_dir / "ecg").string();
+
+        TimeSignal_C<double> signal;
+        signal.LoadFromMITFileFormat(record_path);
+        std::vector<double> expected_beats;
+        PanTopkinsQRSDetection<double> expected_detector(sample_rate_hz, 2);
+        expected_detector.Connect([&expected_beats](const double& timestamp_sec) { expected_beats.push_back(timestamp_sec); });
+        const auto& data = signal.constData()[0]._data;
+        expected_detector.AppendBlock(span<const double>(data.data(), data.size()), 0.0);
+
+        MITRecordStream_C<double> stream(777);
+        CPPUNIT_ASSERT(stream.Open(record_path));
+        std::vector<double> beats;
+        PanTopkinsQRSDetection<double> detector(stream.GetChannels()[0]._sample_rate_hz, 2);
+        detector.Connect([&beats](const double& timestamp_sec) { beats.push_back(timestamp_sec); });
+        RecordBlock_TP<double> block;
+        while ( stream.ReadBlock(block) ) {
+            detector.AppendBlock(block.GetChannel(0), block.GetTimestampSec(sample_rate_hz));
+        }
+
+        CPPUNIT_ASSERT(expected_beats.size() > 50);
+        CPPUNIT_ASSERT_EQUAL(expected_beats.size(), beats.size());
+        for ( size_t idx = 0; idx < beats.size(); ++idx ) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_beats[idx], beats[idx], 1e-9);
+        }
+    }
+
+    //! Reads all blocks of the stream and compares them with the channels of the loaded signal
+    template<typename DataType_TP>
+    static void CompareBlocks(RecordStream_C<DataType_TP>& stream, const TimeSignal_C<DataType_TP>& signal)
+    {
+        const auto& channels = signal.constData();
+        RecordBlock_TP<DataType_TP> block;
+        size_t num_frames = 0;
+        while ( stream.ReadBlock(block) ) {
+            CPPUNIT_ASSERT_EQUAL(num_frames, block._first_frame);
+            CPPUNIT_ASSERT(block._num_frames <= stream.GetBlockSize());
+            for ( size_t channel_idx = 0; channel_idx < channels.size(); ++channel_idx ) {
+                const auto samples = block.GetChannel(channel_idx);
+                for ( size_t frame_idx = 0; frame_idx < block._num_frames; ++frame_idx ) {
+                    CPPUNIT_ASSERT_EQUAL(channels[channel_idx]._data[block._first_frame + frame_idx], samples[frame_idx]);
+                }
+            }
+            num_frames += block._num_frames;
+        }
+        CPPUNIT_ASSERT_EQUAL(channels[0]._data.size(), num_frames);
+        CPPUNIT_ASSERT_EQUAL(num_frames, stream.GetPosition());
+    }
+
+private:
+    std::filesystem::path _record_dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(RecordStreamTest);
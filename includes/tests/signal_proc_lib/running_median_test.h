@@ -0,0 +1,160 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/rt_state_filters.h"
+#include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "../../signal_proc_lib/beat_matching.h"
+#include "pan_topkins_qrs_detector_test.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+class RunningMedianTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(RunningMedianTest);
+    CPPUNIT_TEST(testMatchesSortedWindow);
+    CPPUNIT_TEST(testBaselineWanderRemoval);
+    CPPUNIT_TEST(testDetectionWithBaselineWander);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! The running median equals the median of the sorted window, for windows with many equal samples,
+    //! sample by sample, in blocks and after ResetState()
+    void testMatchesSortedWindow()
+    {
+        for ( const unsigned int window_length : { 1u, 2u, 3u, 5u, 72u, 216u } ) {
+            CheckMatchesSortedWindow<double>(window_length);
+            CheckMatchesSortedWindow<float>(window_length);
+            CheckMatchesSortedWindow<int32_t>(window_length);
+        }
+    }
+
+    //! The baseline wander (slow sine and linear drift) is removed from the delayed ecg
+    void testBaselineWanderRemoval()
+    {
+        const double sample_rate_hz = 360.0;
+        const auto ecg = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 60.0, 0.8);
+        const auto signal = AddBaselineWander(ecg, sample_rate_hz);
+
+        BaselineWanderStateFilter<double> filter(sample_rate_hz);
+        const unsigned int delay_samples = filter.GetFilterDelay();
+        // 100 ms + 300 ms
+        CPPUNIT_ASSERT_EQUAL(36u + 108u, delay_samples);
+
+        double wander_square_sum = 0.0;
+        double error_square_sum = 0.0;
+        size_t num_compared_samples = 0;
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            const double output = filter.Process(signal[idx]);
+            // skip the start, until the windows are filled with the signal
+            if ( idx < 2 * sample_rate_hz ) {
+                continue;
+            }
+            const size_t input_idx = idx - delay_samples;
+            const double wander = signal[input_idx] - ecg[input_idx];
+            wander_square_sum += wander * wander;
+            error_square_sum += (output - ecg[input_idx]) * (output - ecg[input_idx]);
+            ++num_compared_samples;
+        }
+        const double wander_rms = std::sqrt(wander_square_sum / num_compared_samples);
+        const double error_rms = std::sqrt(error_square_sum / num_compared_samples);
+        std::cout << "baseline wander rms: " << wander_rms << " error rms after removal: " << error_rms << std::endl;
+        CPPUNIT_ASSERT(error_rms < 0.05 * wander_rms);
+    }
+
+    //! Used as front end of the detector, the timestamps are corrected by the delay of the baseline removal
+    void testDetectionWithBaselineWander()
+    {
+        const double sample_rate_hz = 360.0;
+        const double rr_interval_sec = 0.8;
+        const double duration_sec = 120.0;
+        auto signal = AddBaselineWander(PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, duration_sec, rr_interval_sec),
+                                        sample_rate_hz);
+        std::vector<double> reference_beats;
+        for ( double r_peak_sec = 0.4; r_peak_sec < duration_sec; r_peak_sec += rr_interval_sec ) {
+            reference_beats.push_back(r_peak_sec);
+        }
+
+        BaselineWanderStateFilter<double> filter(sample_rate_hz);
+        const double delay_sec = filter.GetFilterDelay() / sample_rate_hz;
+        std::vector<double> beats;
+        PanTopkinsQRSDetection<double> detector(sample_rate_hz, 2);
+        detector.Connect([&](const double& timestamp) { beats.push_back(timestamp); });
+        const size_t block_size = 256;
+        for ( size_t idx = 0; idx < signal.size(); idx += block_size ) {
+            const size_t current_block_size = std::min(block_size, signal.size() - idx);
+            filter.Apply(signal.data() + idx, current_block_size);
+            detector.AppendBlock(span<const double>(signal.data() + idx, current_block_size), idx / sample_rate_hz - delay_sec);
+        }
+
+        auto result = MatchBeats(reference_beats, beats, 0.15, 3.0);
+        CPPUNIT_ASSERT(result._true_positives > 0);
+        CPPUNIT_ASSERT(result.Sensitivity() >= 0.99);
+        CPPUNIT_ASSERT(result.PositivePredictivity() >= 0.95);
+    }
+
+    //! Adds a slow sine wave (0.3 Hz, 1.5 mV) and a linear drift (1 mV per minute)
+    static std::vector<double> AddBaselineWander(std::vector<double> signal, double sample_rate_hz)
+    {
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            const double time_sec = idx / sample_rate_hz;
+            signal[idx] += 1.5 * std::sin(2.0 * constexpr_pi * 0.3 * time_sec) + time_sec / 60.0;
+        }
+        return signal;
+    }
+
+    template<typename DataType_TP>
+    void CheckMatchesSortedWindow(unsigned int window_length)
+    {
+        // few distinct values, so the window contains many equal samples
+        std::mt19937 generator(window_length);
+        std::uniform_int_distribution<int> distribution(-20, 20);
+        std::vector<DataType_TP> signal(5000);
+        for ( auto& sample : signal ) {
+            sample = static_cast<DataType_TP>(distribution(generator));
+        }
+
+        // the window is extended to an odd length and filled with the first sample
+        RunningMedianStateFilter<DataType_TP> filter(window_length);
+        const unsigned int odd_window_length = window_length | 1u;
+        CPPUNIT_ASSERT_EQUAL(odd_window_length, filter.GetWindowLength());
+        std::deque<DataType_TP> window(odd_window_length, signal[0]);
+        std::vector<DataType_TP> sorted_window(odd_window_length);
+        std::vector<DataType_TP> expected(signal.size());
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            window.pop_front();
+            window.push_back(signal[idx]);
+            std::copy(window.begin(), window.end(), sorted_window.begin());
+            std::nth_element(sorted_window.begin(), sorted_window.begin() + odd_window_length / 2, sorted_window.end());
+            expected[idx] = sorted_window[odd_window_length / 2];
+            CPPUNIT_ASSERT_EQUAL(expected[idx], filter.Process(signal[idx]));
+        }
+
+        filter.ResetState();
+        std::vector<DataType_TP> output = signal;
+        const size_t block_size = 97;
+        for ( size_t idx = 0; idx < output.size(); idx += block_size ) {
+            filter.Apply(output.data() + idx, std::min(block_size, output.size() - idx));
+        }
+        CPPUNIT_ASSERT(expected == output);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(RunningMedianTest);
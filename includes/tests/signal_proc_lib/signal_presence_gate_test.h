@@ -0,0 +1,201 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/signal_presence_gate.h"
+#include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "../../signal_proc_lib/beat_matching.h"
+#include "pan_topkins_qrs_detector_test.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+class SignalPresenceGateTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(SignalPresenceGateTest);
+    CPPUNIT_TEST(testFlatlineSuspendsAndResumes);
+    CPPUNIT_TEST(testSaturatedAndNoisyLeads);
+    CPPUNIT_TEST(testBlockEqualsSampleBySample);
+    CPPUNIT_TEST(testDetectionResumesAfterReconnection);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! The ecg stays present; a disconnected lead is suspended after 2 s
+    //! and resumed 1 s after the reconnection
+    void testFlatlineSuspendsAndResumes()
+    {
+        const double sample_rate_hz = 360.0;
+        const auto signal = CreateLeadOffSignal(sample_rate_hz, 0.5, 1.0);
+
+        SignalPresenceGate<double> gate(sample_rate_hz);
+        CPPUNIT_ASSERT_EQUAL(90u, gate.GetWindowLength());
+        std::vector<SignalPresence_TP> states;
+        gate.Connect([&states](SignalPresence_TP state) { states.push_back(state); });
+        std::vector<bool> is_present(signal.size());
+        const size_t window_length = gate.GetWindowLength();
+        for ( size_t idx = 0; idx < signal.size(); idx += window_length ) {
+            const size_t block_size = std::min(window_length, signal.size() - idx);
+            std::fill_n(is_present.begin() + idx, block_size, gate.Apply(signal.data() + idx, block_size));
+        }
+
+        CPPUNIT_ASSERT(states == std::vector<SignalPresence_TP>({ SignalPresence_TP::Flatline, SignalPresence_TP::Present }));
+        const auto statistics = gate.GetStatistics();
+        CPPUNIT_ASSERT_EQUAL(SignalPresence_TP::Present, statistics._state);
+        CPPUNIT_ASSERT_EQUAL(1u, statistics._num_suspensions);
+        CPPUNIT_ASSERT_EQUAL(1u, statistics._num_resumptions);
+        CPPUNIT_ASSERT_EQUAL(signal.size(), statistics._num_samples);
+        // flat from 30 to 45 s: the window, which ends at 32 s, suspends the channel and the window, which ends at 46 s, resumes it
+        const auto is_present_at = [&](double time_sec) { return static_cast<bool>(is_present[static_cast<size_t>(time_sec * sample_rate_hz)]); };
+        CPPUNIT_ASSERT(is_present_at(31.7));
+        CPPUNIT_ASSERT(!is_present_at(31.8));
+        CPPUNIT_ASSERT(!is_present_at(45.7));
+        CPPUNIT_ASSERT(is_present_at(45.8));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(14.0, statistics._num_gated_samples / sample_rate_hz, 1e-9);
+    }
+
+    //! Samples at the limit of the ADC and noise far above the ecg amplitude suspend the channel
+    void testSaturatedAndNoisyLeads()
+    {
+        const double sample_rate_hz = 250.0;
+        SignalPresenceParams_TP params;
+        params._saturation_limit = 10.0;
+
+        SignalPresenceGate<float> saturated_gate(sample_rate_hz, params);
+        std::vector<float> saturated_signal(static_cast<size_t>(3.0 * sample_rate_hz), 10.0f);
+        CPPUNIT_ASSERT(!saturated_gate.Apply(saturated_signal.data(), saturated_signal.size()));
+        CPPUNIT_ASSERT_EQUAL(SignalPresence_TP::Saturated, saturated_gate.GetState());
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, saturated_gate.GetStatistics()._last_window_saturated_fraction, 1e-12);
+
+        SignalPresenceGate<float> noisy_gate(sample_rate_hz, params);
+        std::mt19937 generator(7);
+        std::normal_distribution<float> distribution(0.0f, 8.0f);
+        std::vector<float> noisy_signal(static_cast<size_t>(3.0 * sample_rate_hz));
+        for ( auto& sample : noisy_signal ) {
+            sample = distribution(generator);
+        }
+        CPPUNIT_ASSERT(!noisy_gate.Apply(noisy_signal.data(), noisy_signal.size()));
+        CPPUNIT_ASSERT_EQUAL(SignalPresence_TP::Noisy, noisy_gate.GetState());
+        CPPUNIT_ASSERT(noisy_gate.GetStatistics()._last_window_std > params._noisy_min_std);
+
+        // a large offset does not affect the standard deviation
+        SignalPresenceGate<double> offset_gate(sample_rate_hz);
+        auto ecg = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 10.0, 0.8);
+        for ( auto& sample : ecg ) {
+            sample += 1e6;
+        }
+        CPPUNIT_ASSERT(offset_gate.Apply(ecg.data(), ecg.size()));
+        CPPUNIT_ASSERT_EQUAL(0u, offset_gate.GetStatistics()._num_suspensions);
+    }
+
+    //! The decisions do not depend on the block size
+    void testBlockEqualsSampleBySample()
+    {
+        const double sample_rate_hz = 500.0;
+        const auto signal = CreateLeadOffSignal(sample_rate_hz, 0.5, 1.0);
+
+        SignalPresenceGate<double> sample_gate(sample_rate_hz);
+        std::vector<bool> expected(signal.size());
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            expected[idx] = sample_gate.Process(signal[idx]);
+        }
+
+        SignalPresenceGate<double> block_gate(sample_rate_hz);
+        const size_t block_size = 37;
+        for ( size_t idx = 0; idx < signal.size(); idx += block_size ) {
+            const size_t current_block_size = std::min(block_size, signal.size() - idx);
+            const bool is_present = block_gate.Apply(signal.data() + idx, current_block_size);
+            CPPUNIT_ASSERT_EQUAL(static_cast<bool>(expected[idx + current_block_size - 1]), is_present);
+        }
+        const auto sample_statistics = sample_gate.GetStatistics();
+        const auto block_statistics = block_gate.GetStatistics();
+        CPPUNIT_ASSERT_EQUAL(sample_statistics._num_suspensions, block_statistics._num_suspensions);
+        CPPUNIT_ASSERT_EQUAL(sample_statistics._num_resumptions, block_statistics._num_resumptions);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(sample_statistics._last_window_std, block_statistics._last_window_std, 1e-12);
+    }
+
+    //! The detector is suspended during the lead-off and detects the beats of the reconnected lead with its new amplitude,
+    //! after it was reset on the resumption
+    void testDetectionResumesAfterReconnection()
+    {
+        const double sample_rate_hz = 360.0;
+        const double rr_interval_sec = 0.8;
+        const auto signal = CreateLeadOffSignal(sample_rate_hz, 0.5, 3.0);
+
+        PanTopkinsQRSDetection<double> detector(sample_rate_hz, 2);
+        std::vector<double> beats;
+        detector.Connect([&beats](const double& timestamp) { beats.push_back(timestamp); });
+        SignalPresenceGate<double> gate(sample_rate_hz);
+        gate.Connect([&](SignalPresence_TP state) {
+            if ( state == SignalPresence_TP::Present ) {
+                detector.Reset(sample_rate_hz, 2);
+            }
+        });
+        const size_t window_length = gate.GetWindowLength();
+        size_t num_detected_samples = 0;
+        for ( size_t idx = 0; idx < signal.size(); idx += window_length ) {
+            const size_t block_size = std::min(window_length, signal.size() - idx);
+            if ( gate.Apply(signal.data() + idx, block_size) ) {
+                detector.AppendBlock(span<const double>(signal.data() + idx, block_size), idx / sample_rate_hz);
+                num_detected_samples += block_size;
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL(signal.size() - gate.GetStatistics()._num_gated_samples, num_detected_samples);
+
+        std::vector<double> reference_beats;
+        for ( double r_peak_sec = 0.4; r_peak_sec < 89.5; r_peak_sec += rr_interval_sec ) {
+            if ( r_peak_sec < 30.0 || r_peak_sec >= 45.0 ) {
+                reference_beats.push_back(r_peak_sec);
+            }
+        }
+        // no beats during the lead-off; after the resumption at 46 s the detector is trained for 2 s.
+        // The step of the disconnection at 30 s is not compared
+        CPPUNIT_ASSERT(std::none_of(beats.begin(), beats.end(), [](double beat_sec) { return beat_sec > 30.2 && beat_sec < 45.0; }));
+        std::vector<double> reference_before;
+        std::vector<double> reference_after;
+        std::vector<double> beats_before;
+        std::vector<double> beats_after;
+        std::copy_if(reference_beats.begin(), reference_beats.end(), std::back_inserter(reference_before), [](double sec) { return sec < 30.0; });
+        std::copy_if(reference_beats.begin(), reference_beats.end(), std::back_inserter(reference_after), [](double sec) { return sec >= 49.0; });
+        std::copy_if(beats.begin(), beats.end(), std::back_inserter(beats_before), [](double sec) { return sec < 29.8; });
+        std::copy_if(beats.begin(), beats.end(), std::back_inserter(beats_after), [](double sec) { return sec >= 48.9; });
+        for ( const auto& result : { MatchBeats(reference_before, beats_before, 0.15, 4.0), MatchBeats(reference_after, beats_after) } ) {
+            CPPUNIT_ASSERT(result._true_positives > 0);
+            CPPUNIT_ASSERT(result.Sensitivity() >= 0.99);
+            CPPUNIT_ASSERT(result.PositivePredictivity() >= 0.95);
+        }
+    }
+
+    //! Synthetic ecg with the noise of a connected lead (20 uV), a lead-off from 30 to 45 s (constant level)
+    //! and the amplitude reconnected_gain after it (90 s)
+    static std::vector<double> CreateLeadOffSignal(double sample_rate_hz, double lead_off_level, double reconnected_gain)
+    {
+        auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, 90.0, 0.8);
+        std::mt19937 generator(3);
+        std::normal_distribution<double> noise(0.0, 0.02);
+        for ( size_t idx = 0; idx < signal.size(); ++idx ) {
+            const double time_sec = idx / sample_rate_hz;
+            if ( time_sec >= 30.0 && time_sec < 45.0 ) {
+                signal[idx] = lead_off_level;
+            } else {
+                signal[idx] = (time_sec < 30.0 ? 1.0 : reconnected_gain) * signal[idx] + noise(generator);
+            }
+        }
+        return signal;
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SignalPresenceGateTest);
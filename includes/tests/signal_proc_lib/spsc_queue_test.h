@@ -0,0 +1,87 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/spsc_queue.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <thread>
+
+class SPSCQueueTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(SPSCQueueTest);
+    CPPUNIT_TEST(testFullQueueRejectsPush);
+    CPPUNIT_TEST(testProducerConsumerKeepOrder);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void testFullQueueRejectsPush()
+    {
+        SPSCQueue_TC<int> queue(5);
+        CPPUNIT_ASSERT_EQUAL(size_t(8), queue.Capacity());
+        for ( int value = 0; value < 8; ++value ) {
+            CPPUNIT_ASSERT(queue.TryPush(value));
+        }
+        CPPUNIT_ASSERT(!queue.TryPush(8));
+        CPPUNIT_ASSERT_EQUAL(size_t(8), queue.Size());
+
+        int value = -1;
+        CPPUNIT_ASSERT(queue.TryPop(value));
+        CPPUNIT_ASSERT_EQUAL(0, value);
+        CPPUNIT_ASSERT(queue.TryPush(8));
+
+        int values[16];
+        CPPUNIT_ASSERT_EQUAL(size_t(8), queue.PopBatch(values, 16));
+        for ( int idx = 0; idx < 8; ++idx ) {
+            CPPUNIT_ASSERT_EQUAL(idx + 1, values[idx]);
+        }
+        CPPUNIT_ASSERT(!queue.TryPop(value));
+    }
+
+    //! All elements arrive in order, when producer and consumer run on different threads
+    void testProducerConsumerKeepOrder()
+    {
+        const int num_elements = 200000;
+        SPSCQueue_TC<int> queue(64);
+
+        std::thread producer([&]() {
+            for ( int value = 0; value < num_elements; ) {
+                if ( queue.TryPush(value) ) {
+                    ++value;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        std::vector<int> received;
+        received.reserve(num_elements);
+        int batch[16];
+        while ( received.size() < static_cast<size_t>(num_elements) ) {
+            size_t num_popped = queue.PopBatch(batch, 16);
+            received.insert(received.end(), batch, batch + num_popped);
+            if ( num_popped == 0 ) {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+
+        for ( int idx = 0; idx < num_elements; ++idx ) {
+            CPPUNIT_ASSERT_EQUAL(idx, received[idx]);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SPSCQueueTest);
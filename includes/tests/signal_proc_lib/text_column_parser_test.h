@@ -0,0 +1,101 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/text_column_parser.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+
+class TextColumnParserTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(TextColumnParserTest);
+    CPPUNIT_TEST(testParseRows);
+    CPPUNIT_TEST(testParseChunksInParallel);
+    CPPUNIT_TEST(testInvalidRows);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! Empty lines are skipped, the last line needs no line end; separators are spaces, tabs, ',' and ';'
+    void testParseRows()
+    {
+        const std::string text = "0 1.5 -2\r\n\n1,\t+2.5;3e1\n   \n2 -0.25 4 99";
+        TextColumnParser_C<double> parser(1);
+        std::vector<std::vector<double>> columns;
+        CPPUNIT_ASSERT(parser.Parse(text.data(), text.data() + text.size(), 3, 1, columns));
+        CPPUNIT_ASSERT_EQUAL(size_t(2), columns.size());
+        CPPUNIT_ASSERT(columns[0] == std::vector<double>({ 1.5, 2.5, -0.25 }));
+        CPPUNIT_ASSERT(columns[1] == std::vector<double>({ -2.0, 30.0, 4.0 }));
+
+        std::vector<std::vector<int>> int_columns;
+        TextColumnParser_C<int> int_parser(1);
+        CPPUNIT_ASSERT(int_parser.Parse(text.data(), text.data() + text.size(), 3, 0, int_columns));
+        CPPUNIT_ASSERT(int_columns[0] == std::vector<int>({ 0, 1, 2 }));
+        CPPUNIT_ASSERT(int_columns[2] == std::vector<int>({ -2, 30, 4 }));
+
+        CPPUNIT_ASSERT(parser.Parse(text.data(), text.data(), 3, 1, columns));
+        CPPUNIT_ASSERT(columns[0].empty());
+    }
+
+    //! A text of several chunks is parsed into the same columns by one and by several threads
+    void testParseChunksInParallel()
+    {
+        std::ostringstream stream;
+        const size_t num_rows = 150000;
+        for ( size_t row_idx = 0; row_idx < num_rows; ++row_idx ) {
+            stream << row_idx << " " << 0.001 * row_idx << "\t" << -static_cast<double>(row_idx % 977) / 7.0 << "\n";
+            if ( row_idx % 1000 == 0 ) {
+                stream << "\n";
+            }
+        }
+        const std::string text = stream.str();
+        CPPUNIT_ASSERT(text.size() > 3 * (1 << 20));
+
+        std::vector<std::vector<double>> expected_columns;
+        CPPUNIT_ASSERT(TextColumnParser_C<double>(1).Parse(text.data(), text.data() + text.size(), 3, 0, expected_columns));
+        CPPUNIT_ASSERT_EQUAL(num_rows, expected_columns[0].size());
+        for ( size_t row_idx = 0; row_idx < num_rows; row_idx += 997 ) {
+            CPPUNIT_ASSERT_EQUAL(static_cast<double>(row_idx), expected_columns[0][row_idx]);
+        }
+
+        std::vector<std::vector<double>> columns;
+        CPPUNIT_ASSERT(TextColumnParser_C<double>(4).Parse(text.data(), text.data() + text.size(), 3, 0, columns));
+        CPPUNIT_ASSERT(expected_columns == columns);
+    }
+
+    //! Rows with too few values or values, which are no numbers, fail the parsing
+    void testInvalidRows()
+    {
+        TextColumnParser_C<double> parser(2);
+        std::vector<std::vector<double>> columns;
+        const std::string missing_value = "0 1 2\n1 2\n2 3 4\n";
+        CPPUNIT_ASSERT(!parser.Parse(missing_value.data(), missing_value.data() + missing_value.size(), 3, 1, columns));
+        CPPUNIT_ASSERT(columns[0].empty());
+
+        const std::string no_number = "0 1 2\n1 x 3\n";
+        CPPUNIT_ASSERT(!parser.Parse(no_number.data(), no_number.data() + no_number.size(), 3, 1, columns));
+
+        const char* pos = no_number.data();
+        double values[3] = {};
+        size_t num_values = 0;
+        CPPUNIT_ASSERT(TextColumnParser_C<double>::ParseRow(pos, no_number.data() + no_number.size(), 3, values, num_values));
+        CPPUNIT_ASSERT_EQUAL(size_t(3), num_values);
+        CPPUNIT_ASSERT_EQUAL(2.0, values[2]);
+        CPPUNIT_ASSERT(pos == no_number.data() + 6);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TextColumnParserTest);
@@ -0,0 +1,77 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/thread_pool.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+class ThreadPoolTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(ThreadPoolTest);
+    CPPUNIT_TEST(testNestedTasksAreFinished);
+    CPPUNIT_TEST(testIdleWorkersStealTasks);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! WaitUntilFinished() also waits for the tasks, which were added by tasks
+    void testNestedTasksAreFinished()
+    {
+        ThreadPool_C pool(4);
+        std::atomic<size_t> num_finished_tasks = 0;
+        for ( int record = 0; record < 16; ++record ) {
+            pool.AddTask([&]() {
+                for ( int channel = 0; channel < 8; ++channel ) {
+                    pool.AddTask([&]() { ++num_finished_tasks; });
+                }
+                ++num_finished_tasks;
+            });
+        }
+        pool.WaitUntilFinished();
+        CPPUNIT_ASSERT_EQUAL(size_t(16 * 9), num_finished_tasks.load());
+
+        // the pool can be reused
+        pool.AddTask([&]() { ++num_finished_tasks; });
+        pool.WaitUntilFinished();
+        CPPUNIT_ASSERT_EQUAL(size_t(16 * 9 + 1), num_finished_tasks.load());
+    }
+
+    //! The subtasks of a task are queued at its worker. The task waits for its subtasks,
+    //! so they can only finish if the other workers steal them
+    void testIdleWorkersStealTasks()
+    {
+        const size_t num_subtasks = 64;
+        ThreadPool_C pool(4);
+        std::atomic<size_t> num_finished_subtasks = 0;
+        bool all_subtasks_finished = false;
+        pool.AddTask([&]() {
+            for ( size_t count = 0; count < num_subtasks; ++count ) {
+                pool.AddTask([&]() { ++num_finished_subtasks; });
+            }
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while ( num_finished_subtasks < num_subtasks && std::chrono::steady_clock::now() < deadline ) {
+                std::this_thread::yield();
+            }
+            all_subtasks_finished = num_finished_subtasks == num_subtasks;
+        });
+        pool.WaitUntilFinished();
+        CPPUNIT_ASSERT(all_subtasks_finished);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ThreadPoolTest);
@@ -0,0 +1,239 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/wfdb_native_reader.h"
+#include "../../signal_proc_lib/time_signal.h"
+
+// STL includes
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <random>
+#include <cmath>
+#include <cstdint>
+
+class WFDBNativeReaderTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(WFDBNativeReaderTest);
+    CPPUNIT_TEST(testParseHeader);
+    CPPUNIT_TEST(testDecodeFormats);
+    CPPUNIT_TEST(testUnsupportedRecords);
+    CPPUNIT_TEST(testTimeSignalLoadsNativeRecord);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+        _record_dir = std::filesystem::temp_directory_path() / "ecg_analyzer_wfdb_native_reader_test";
+        std::filesystem::create_directories(_record_dir);
+    }
+
+    void tearDown()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(_record_dir, error);
+    }
+
+    //! The fields of the record line and the signal lines, with the defaults of the omitted fields
+    void testParseHeader()
+    {
+        WFDBHeader_TP header;
+        const std::string mitdb_header = "100 2 360 650000 0:0:0 0/0/0\r\n"
+                                         "100.dat 212 200 11 1024 995 -22131 0 MLII\r\n"
+                                         "100.dat 212 200 11 1024 1011 20052 0 V5\r\n"
+                                         "# 69 M 1085 1629 x1\r\n";
+        CPPUNIT_ASSERT(WFDBNativeReader_C<double>::ParseHeader(mitdb_header, header));
+        CPPUNIT_ASSERT(header._is_supported);
+        CPPUNIT_ASSERT_EQUAL(std::string("100"), header._record_name);
+        CPPUNIT_ASSERT_EQUAL(360.0, header._sample_freq_hz);
+        CPPUNIT_ASSERT_EQUAL(size_t(650000), header._num_samples);
+        CPPUNIT_ASSERT_EQUAL(size_t(2), header._signals.size());
+        const auto& signal = header._signals[1];
+        CPPUNIT_ASSERT_EQUAL(std::string("100.dat"), signal._filename);
+        CPPUNIT_ASSERT_EQUAL(212, signal._format);
+        CPPUNIT_ASSERT_EQUAL(200.0, signal._gain);
+        CPPUNIT_ASSERT_EQUAL(11, signal._adc_resolution_bits);
+        CPPUNIT_ASSERT_EQUAL(1024, signal._adc_zero);
+        CPPUNIT_ASSERT_EQUAL(1024, signal._baseline);
+        CPPUNIT_ASSERT_EQUAL(std::string("mV"), signal._units);
+        CPPUNIT_ASSERT_EQUAL(std::string("V5"), signal._description);
+        CPPUNIT_ASSERT(signal._is_supported);
+
+        const std::string custom_header = "# comment before the record line\n"
+                                          "rec 2 250/1000(0)\n"
+                                          "\n"
+                                          "rec.dat 16+512 1000(-5)/uV 16 3 0 0 0 lead I (limb)\n"
+                                          "rec.dat 16+512\n";
+        CPPUNIT_ASSERT(WFDBNativeReader_C<double>::ParseHeader(custom_header, header));
+        CPPUNIT_ASSERT_EQUAL(250.0, header._sample_freq_hz);
+        CPPUNIT_ASSERT_EQUAL(size_t(0), header._num_samples);
+        CPPUNIT_ASSERT_EQUAL(size_t(512), header._signals[0]._byte_offset);
+        CPPUNIT_ASSERT_EQUAL(1000.0, header._signals[0]._gain);
+        CPPUNIT_ASSERT_EQUAL(-5, header._signals[0]._baseline);
+        CPPUNIT_ASSERT_EQUAL(3, header._signals[0]._adc_zero);
+        CPPUNIT_ASSERT_EQUAL(std::string("uV"), header._signals[0]._units);
+        CPPUNIT_ASSERT_EQUAL(std::string("lead I (limb)"), header._signals[0]._description);
+        // defaults of the wfdb lib
+        CPPUNIT_ASSERT_EQUAL(200.0, header._signals[1]._gain);
+        CPPUNIT_ASSERT_EQUAL(16, header._signals[1]._adc_resolution_bits);
+        CPPUNIT_ASSERT_EQUAL(std::string("record rec, signal 1"), header._signals[1]._description);
+
+        // fewer signal lines than signals
+        CPPUNIT_ASSERT(!WFDBNativeReader_C<double>::ParseHeader("rec 3 360\nrec.dat 212\n", header));
+    }
+
+    //! All formats are decoded like the wfdb lib: for 1, 2 and 3 interleaved signals, across chunks,
+    //! with invalid samples, with and without the number of samples inside the header
+    void testDecodeFormats()
+    {
+        std::mt19937 generator(11);
+        for ( const int format : { 212, 16, 61, 80 } ) {
+            for ( const unsigned int num_signals : { 1u, 2u, 3u } ) {
+                for ( const bool has_num_samples : { true, false } ) {
+                    const size_t num_frames = 10001;
+                    const int max_value = format == 212 ? 2047 : (format == 80 ? 127 : 32767);
+                    std::uniform_int_distribution<int> distribution(-max_value, max_value);
+                    std::vector<int> samples(num_frames * num_signals);
+                    for ( auto& sample : samples ) {
+                        sample = distribution(generator);
+                    }
+                    samples[5] = wfdb_invalid_sample;
+
+                    const size_t byte_offset = format == 16 ? 24 : 0;
+                    WriteRecord("rec", format, num_signals, samples, has_num_samples, byte_offset);
+                    WFDBNativeReader_C<double> reader;
+                    const auto channels = reader.Read(_record_dir.string(), "rec");
+                    CPPUNIT_ASSERT_EQUAL(size_t(num_signals), channels.size());
+                    for ( unsigned int signal_idx = 0; signal_idx < num_signals; ++signal_idx ) {
+                        const auto& channel = channels[signal_idx];
+                        CPPUNIT_ASSERT_EQUAL(num_frames, channel._data.size());
+                        CPPUNIT_ASSERT_EQUAL(static_cast<unsigned int>(num_frames), channel._num_samples);
+                        CPPUNIT_ASSERT_EQUAL(500.0, channel._sample_frequency_hz);
+                        for ( size_t frame_idx = 0; frame_idx < num_frames; ++frame_idx ) {
+                            CPPUNIT_ASSERT_EQUAL(static_cast<double>(samples[frame_idx * num_signals + signal_idx]), channel._data[frame_idx]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    //! Records with features, which only the wfdb lib reads, are not read natively
+    void testUnsupportedRecords()
+    {
+        const std::vector<int> samples(100, 1);
+        WriteRecord("rec", 212, 1, samples, true, 0);
+        WFDBNativeReader_C<double> reader;
+        CPPUNIT_ASSERT_EQUAL(size_t(1), reader.Read(_record_dir.string(), "rec").size());
+
+        for ( const std::string& header : { std::string("rec 1 360 100\nrec.dat 212x2 200 12 0 0 0 0 I\n"),
+                                            std::string("rec 1 360 100\nrec.dat 212:3 200 12 0 0 0 0 I\n"),
+                                            std::string("rec 1 360 100\nrec.dat 310 200 12 0 0 0 0 I\n"),
+                                            std::string("rec/2 1 360 100\nrec_1 50\nrec_2 50\n"),
+                                            std::string("rec 1 360 100\nmissing.dat 212 200 12 0 0 0 0 I\n") } ) {
+            std::ofstream(_record_dir / "rec.hea") << header;
+            CPPUNIT_ASSERT(reader.Read(_record_dir.string(), "rec").empty());
+        }
+        CPPUNIT_ASSERT(reader.Read(_record_dir.string(), "no_record").empty());
+    }
+
+    //! TimeSignal_C reads the record natively and scales the samples to physical units
+    void testTimeSignalLoadsNativeRecord()
+    {
+        const size_t num_frames = 1000;
+        std::vector<int> samples(2 * num_frames);
+        for ( size_t idx = 0; idx < samples.size(); ++idx ) {
+            samples[idx] = static_cast<int>(idx % 700) - 300;
+        }
+        WriteRecord("rec", 212, 2, samples, true, 0);
+
+        TimeSignal_C<double> signal;
+        signal.LoadFromMITFileFormat((_record_dir / "rec").string());
+        const auto& channels = signal.constData();
+        CPPUNIT_ASSERT_EQUAL(size_t(2), channels.size());
+        for ( size_t signal_idx = 0; signal_idx < 2; ++signal_idx ) {
+            const auto& channel = channels[signal_idx];
+            CPPUNIT_ASSERT_EQUAL(num_frames, channel._data.size());
+            CPPUNIT_ASSERT_EQUAL(num_frames, channel._timestamps.size());
+            CPPUNIT_ASSERT_EQUAL(std::string(signal_idx == 0 ? "I" : "II"), channel._label);
+            for ( size_t frame_idx = 0; frame_idx < num_frames; ++frame_idx ) {
+                // baseline 10, gain 200
+                CPPUNIT_ASSERT_DOUBLES_EQUAL((samples[2 * frame_idx + signal_idx] - 10) / 200.0, channel._data[frame_idx], 1e-12);
+            }
+        }
+    }
+
+    //! Writes the header and the signal file of a record with interleaved samples
+    void WriteRecord(const std::string& record_name,
+                     int format,
+                     unsigned int num_signals,
+                     const std::vector<int>& samples,
+                     bool has_num_samples,
+                     size_t byte_offset)
+    {
+        WriteRecord(_record_dir, record_name, format, num_signals, samples, has_num_samples, byte_offset);
+    }
+
+    //! Writes the header and the signal file of a record with interleaved samples into record_dir
+    //! (gain 200, baseline 10, labels I, II, III)
+    static void WriteRecord(const std::filesystem::path& record_dir,
+                            const std::string& record_name,
+                            int format,
+                            unsigned int num_signals,
+                            const std::vector<int>& samples,
+                            bool has_num_samples,
+                            size_t byte_offset)
+    {
+        std::ofstream header(record_dir / (record_name + ".hea"));
+        header << record_name << " " << num_signals << " 500";
+        if ( has_num_samples ) {
+            header << " " << samples.size() / num_signals;
+        }
+        header << "\n";
+        const char* labels[] = { "I", "II", "III" };
+        for ( unsigned int signal_idx = 0; signal_idx < num_signals; ++signal_idx ) {
+            header << record_name << ".dat " << format;
+            if ( byte_offset > 0 ) {
+                header << "+" << byte_offset;
+            }
+            header << " 200(10)/mV 12 0 0 0 0 " << labels[signal_idx] << "\n";
+        }
+
+        std::vector<unsigned char> bytes(byte_offset, 0xAB);
+        const auto stored_value = [](int sample, int invalid_value) { return sample == wfdb_invalid_sample ? invalid_value : sample; };
+        if ( format == 212 ) {
+            for ( size_t idx = 0; idx < samples.size(); idx += 2 ) {
+                const int sample_0 = stored_value(samples[idx], -2048) & 0xFFF;
+                const int sample_1 = idx + 1 < samples.size() ? stored_value(samples[idx + 1], -2048) & 0xFFF : 0;
+                bytes.push_back(static_cast<unsigned char>(sample_0 & 0xFF));
+                bytes.push_back(static_cast<unsigned char>(((sample_0 >> 8) & 0x0F) | ((sample_1 >> 4) & 0xF0)));
+                if ( idx + 1 < samples.size() ) {
+                    bytes.push_back(static_cast<unsigned char>(sample_1 & 0xFF));
+                }
+            }
+        } else {
+            for ( const int sample : samples ) {
+                if ( format == 80 ) {
+                    bytes.push_back(static_cast<unsigned char>(stored_value(sample, -128) + 128));
+                } else {
+                    const uint16_t value = static_cast<uint16_t>(static_cast<int16_t>(sample));
+                    const unsigned char low_byte = static_cast<unsigned char>(value & 0xFF);
+                    const unsigned char high_byte = static_cast<unsigned char>(value >> 8);
+                    bytes.push_back(format == 16 ? low_byte : high_byte);
+                    bytes.push_back(format == 16 ? high_byte : low_byte);
+                }
+            }
+        }
+        std::ofstream(record_dir / (record_name + ".dat"), std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+
+private:
+    std::filesystem::path _record_dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(WFDBNativeReaderTest);
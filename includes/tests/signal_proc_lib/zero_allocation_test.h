@@ -0,0 +1,121 @@
+#pragma once
+// Static macros cppunit
+#include <cppunit/extensions/HelperMacros.h>
+
+// Project includes
+#include "../../signal_proc_lib/pan_topkins_qrs_detector.h"
+#include "../../signal_proc_lib/spsc_queue.h"
+#include "pan_topkins_qrs_detector_test.h"
+#include "allocation_counter.h"
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <cstdint>
+
+class ZeroAllocationTest : public CPPUNIT_NS::TestFixture {
+
+private:
+    CPPUNIT_TEST_SUITE(ZeroAllocationTest);
+    CPPUNIT_TEST(testAllocationsAreCounted);
+    CPPUNIT_TEST(testNoAllocationsAfterConstruction);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    //! Each overload of the global operator new is counted (see allocation_counter.cpp)
+    void testAllocationsAreCounted()
+    {
+        struct alignas(64) AlignedBlock_TP {
+            double _values[8];
+        };
+
+        // the pointers escape, so the compiler can not elide the allocations
+        void* volatile sink = nullptr;
+        const size_t num_allocations_before = g_num_allocations;
+        int* value = new int(1);
+        sink = value;
+        delete value;
+        int* values = new int[4];
+        sink = values;
+        delete[] values;
+        value = new (std::nothrow) int(2);
+        sink = value;
+        delete value;
+        values = new (std::nothrow) int[4];
+        sink = values;
+        delete[] values;
+        auto* aligned_block = new AlignedBlock_TP();
+        sink = aligned_block;
+        CPPUNIT_ASSERT(reinterpret_cast<uintptr_t>(aligned_block) % alignof(AlignedBlock_TP) == 0);
+        delete aligned_block;
+        aligned_block = new AlignedBlock_TP[3];
+        sink = aligned_block;
+        delete[] aligned_block;
+        aligned_block = new (std::nothrow) AlignedBlock_TP();
+        sink = aligned_block;
+        delete aligned_block;
+        (void)sink;
+        CPPUNIT_ASSERT_EQUAL(size_t(7), g_num_allocations - num_allocations_before);
+    }
+
+    //! After construction and connection the detector does not allocate memory while processing one hour of data,
+    //! neither sample by sample nor in blocks of any size, and not when it is reset
+    void testNoAllocationsAfterConstruction()
+    {
+        // compile time filter chain
+        CheckNoAllocations(360.0, 3600.0);
+        // runtime filter chain
+        CheckNoAllocations(300.0, 600.0);
+    }
+
+    void CheckNoAllocations(double sample_rate_hz, double duration_sec)
+    {
+        auto signal = PanTokpinsQRSDetectorTest::CreateSyntheticECG(sample_rate_hz, duration_sec, 0.8);
+        const size_t num_samples = signal.size();
+
+        size_t num_beats = 0;
+        SPSCQueue_TC<BeatEvent_TP> event_queue(1024);
+        BeatEvent_TP events[64];
+        PanTopkinsQRSDetection<double> detector(sample_rate_hz, 2);
+        detector.Connect([&num_beats](const double&) { ++num_beats; });
+        detector.ConnectEventQueue(&event_queue);
+
+        const size_t num_allocations_before = g_num_allocations;
+
+        // first quarter sample by sample
+        size_t idx = 0;
+        for ( ; idx < num_samples / 4; ++idx ) {
+            detector.AppendPoint(signal[idx], idx / sample_rate_hz);
+        }
+
+        // the rest in blocks of changing sizes, which are smaller and bigger than the internal working buffer
+        const size_t block_sizes[] = { 1, 97, 256, 4096, 100000 };
+        for ( size_t block_idx = 0; idx < num_samples; ++block_idx ) {
+            const size_t block_size = std::min(block_sizes[block_idx % 5], num_samples - idx);
+            detector.AppendBlock(span<const double>(signal.data() + idx, block_size), idx / sample_rate_hz);
+            idx += block_size;
+            while ( event_queue.PopBatch(events, 64) > 0 ) {
+            }
+        }
+
+        // restart the detection with the same sample frequency
+        detector.Reset(sample_rate_hz, 2);
+        detector.AppendBlock(span<const double>(signal.data(), num_samples / 4), 0.0);
+
+        const size_t num_allocations = g_num_allocations - num_allocations_before;
+        CPPUNIT_ASSERT(num_beats > 0);
+        CPPUNIT_ASSERT_EQUAL(size_t(0), num_allocations);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ZeroAllocationTest);
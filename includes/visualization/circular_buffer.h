@@ -5,7 +5,8 @@
 // This belongs in an utility library/Project, which is included by visualization and sig_proc_llib to use the RingBuffer 
 //
 // Project includes
-#include "chart_Types.h"
+#include "chart_types.h"
+#include "../signal_proc_lib/span.h"
 
 // STL includes
 #include <array>
@@ -19,41 +20,6 @@
 
 #include <cstdint>
 
-template<typename T>
-class span {
-    T* ptr_;
-    std::size_t len_;
-
-public:
-    span(T* ptr, std::size_t len) noexcept
-        : ptr_{ ptr }, len_{ len }
-    {}
-
-    span() noexcept
-        : ptr_{ nullptr}, len_{0}
-    {}
-
-    T& operator[](int i) noexcept {
-        return *ptr_[i];
-    }
-
-    T const& operator[](int i) const noexcept {
-        return *ptr_[i];
-    }
-
-    std::size_t size() const noexcept {
-        return len_;
-    }
-
-    T* begin() noexcept {
-        return ptr_;
-    }
-
-    T* end() noexcept {
-        return ptr_ + len_;
-    }
-};
-
 enum RingBufferSize_TP {
     Size2, Size4, Size8, Size16, Size32,
     Size64, Size128, Size256, Size512,